@@ -1,60 +1,195 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
 namespace cgv {
 	namespace data {
 
-template <typename Pnt, typename Idx = int>
-class grid : public std::vector<std::vector<Idx> >
+/** default executor of the parallel grid build that runs each block on its own std::thread. An executor
+    provides get_concurrency() and run(nr_blocks, f), which calls f(b) for all b in [0,nr_blocks) and returns
+	when all calls are finished. Callers that link a thread pool can pass an executor that forwards to it. */
+struct thread_executor
+{
+	/// return the number of hardware threads
+	unsigned get_concurrency() const { unsigned n = std::thread::hardware_concurrency(); return n == 0 ? 1 : n; }
+	/// run f(b) for all blocks b, where block 0 is processed by the calling thread
+	template <typename F>
+	void run(std::size_t nr_blocks, const F& f) const
+	{
+		std::vector<std::thread> threads;
+		for (std::size_t b = 1; b < nr_blocks; ++b)
+			threads.push_back(std::thread([&f, b]() { f(b); }));
+		f(std::size_t(0));
+		for (std::size_t b = 0; b < threads.size(); ++b)
+			threads[b].join();
+	}
+};
+
+/** uniform grid over a set of 3d points for radius and box queries. The points are not copied but accessed
+    through a functor pnts(i) that returns the i-th point. The point indices of all cells are stored in a single
+	array sorted by cells and the cells store offsets into this array, such that a row of cells along the x-axis
+	covers a contiguous range of indices. The grid is built with a parallel counting sort and the indices within
+	a cell are sorted, such that the result does not depend on the number of threads.
+
+	By default cells are ordered row major. With CO_MORTON the cells are ordered along a Morton curve, such that
+	neighboring cells are close in the index array as well. get_indices() can be used to reorder the points in
+	the cell order for cache friendly scans.
+
+	The blocks of the parallel build are run by an executor of type Executor, see thread_executor. */
+template <typename Pnt, typename Idx = int, typename Executor = thread_executor>
+class grid
 {
 public:
-	typename decltype(min_pnt[0]) Crd;
-	typename decltype(max_pnt-min_pnt) Vec;
+	/// coordinate type
+	typedef typename std::decay<decltype(std::declval<Pnt>()[0])>::type Crd;
+	/// order of the cells in the index array
+	enum CellOrder { CO_ROW_MAJOR, CO_MORTON };
+	/// number of cells along each axis
 	std::size_t dim[3];
+	/// neighbor radius of extract_neighbors
 	Crd rmax;
+	/// squared neighbor radius of extract_neighbors
 	Crd rmax_sqr;
+	/// factor applied to the estimated point spacing to compute rmax in build()
 	Crd rmax_estimate_factor;
 protected:
-	Vec scale;
-	Vec extent;
-	Vec cell_extent;
+	/// number of cells per unit length along each axis
+	Crd scale[3];
+	/// extent of the box and of a cell along each axis
+	Crd extent[3], cell_extent[3];
+	/// bounding box of the grid
 	Pnt min_pnt, max_pnt;
+	/// order of the cells
+	CellOrder cell_order;
+	/// for Morton order per row major cell index the position of the cell in the Morton order, empty for row major order
+	std::vector<Idx> cell_slots;
+	/// per cell in cell order the offset of its first point index plus the total number of points at the end
+	std::vector<Idx> offsets;
+	/// point indices sorted by cells
+	std::vector<Idx> indices;
+	/// maximal number of threads used in the build, 0 selects the concurrency of the executor
+	unsigned max_nr_threads;
+	/// executor that runs the blocks of the parallel build
+	Executor executor;
 
-	void init() {
-		clear();
-		resize(get_size());
+	/// call f(begin,end) on blocks of [0,n) with the executor if n is large enough, at most max_nr_threads blocks are used
+	template <typename F>
+	void parallel_ranges(std::size_t n, const F& f) const
+	{
+		std::size_t nr_blocks = max_nr_threads == 0 ? executor.get_concurrency() : max_nr_threads;
+		if (nr_blocks > n / 16384)
+			nr_blocks = n / 16384;
+		if (nr_blocks < 2) {
+			f(std::size_t(0), n);
+			return;
+		}
+		executor.run(nr_blocks, [&](std::size_t b) {
+			f(n*b / nr_blocks, n*(b + 1) / nr_blocks);
+		});
+	}
+	/// spread the lower 21 bits of x such that there are two zero bits between consecutive bits
+	static std::uint64_t spread_bits(std::uint64_t x)
+	{
+		x &= 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffull;
+		x = (x | x << 16) & 0x1f0000ff0000ffull;
+		x = (x | x << 8) & 0x100f00f00f00f00full;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+		x = (x | x << 2) & 0x1249249249249249ull;
+		return x;
+	}
+	/// compute the position of each cell in the cell order
+	void compute_cell_slots()
+	{
+		cell_slots.clear();
+		if (cell_order == CO_ROW_MAJOR)
+			return;
+		std::size_t n = get_size();
+		std::vector<std::pair<std::uint64_t, Idx> > codes(n);
+		for (std::size_t ci = 0; ci < n; ++ci) {
+			std::size_t cc[3];
+			split_index(Idx(ci), cc);
+			codes[ci].first = spread_bits(cc[0]) | spread_bits(cc[1]) << 1 | spread_bits(cc[2]) << 2;
+			codes[ci].second = Idx(ci);
+		}
+		std::sort(codes.begin(), codes.end());
+		cell_slots.resize(n);
+		for (std::size_t si = 0; si < n; ++si)
+			cell_slots[codes[si].second] = Idx(si);
 	}
 	void compute_scales() {
-		extent = max_pnt-min_pnt;
 		for (int c=0; c<3; ++c) {
-			scale[c]       = dim[c]/extent[c];
+			extent[c]      = max_pnt[c]-min_pnt[c];
+			scale[c]       = extent[c] > 0 ? Crd(dim[c])/extent[c] : Crd(0);
 			cell_extent[c] = extent[c]/dim[c];
 		}
 	}
+	/// return the grid coordinate of coordinate x along axis c clamped to the grid
+	std::size_t get_cell_coordinate(Crd x, int c) const {
+		Crd f = scale[c]*(x-min_pnt[c]);
+		if (!(f > 0))
+			return 0;
+		std::size_t i = std::size_t(f);
+		return i < dim[c] ? i : dim[c]-1;
+	}
+	/// return the position of a cell in the cell order
+	Idx get_slot(Idx ci) const { return cell_slots.empty() ? ci : cell_slots[ci]; }
 public:
-	grid(Idx dim = 20)                 { set_dim(dim); init(); }
-	grid(Idx dimx, Idx dimy, Idx dimz) { set_dim(dimx,dimy,dimz); init(); }
+	grid(Idx dim = 20) : rmax(0), rmax_sqr(0), rmax_estimate_factor(2), cell_order(CO_ROW_MAJOR), max_nr_threads(0) { clear(); set_dim(dim); }
+	grid(Idx dimx, Idx dimy, Idx dimz) : rmax(0), rmax_sqr(0), rmax_estimate_factor(2), cell_order(CO_ROW_MAJOR), max_nr_threads(0) { clear(); set_dim(dimx,dimy,dimz); }
+	/// remove all points and reset the box to [-1,1]^3
 	void clear() {
-		std::vector<std::vector<Idx> >::clear();
-		min_pnt = Pnt(-1,-1,-1);
-		max_pnt = Pnt(1,1,1);
-	}
-	bool is_empty() const { return std::vector<std::vector<Idx> >::empty(); }
-	void set_dim(Cnt dim) { set_dim(dim,dim,dim); }
-	void set_dim(Cnt dimx, Cnt dimy, Cnt dimz) {
-		dim[0] = dimx;
-		dim[1] = dimy;
-		dim[2] = dimz;
-		init();
+		offsets.clear();
+		indices.clear();
+		for (int c = 0; c < 3; ++c) {
+			min_pnt[c] = -1;
+			max_pnt[c] = 1;
+		}
+	}
+	/// return whether no points have been sorted into the grid
+	bool is_empty() const { return indices.empty(); }
+	void set_dim(std::size_t dim) { set_dim(dim,dim,dim); }
+	/// set the number of cells along each axis, which removes all points
+	void set_dim(std::size_t dimx, std::size_t dimy, std::size_t dimz) {
+		dim[0] = std::max(std::size_t(1), dimx);
+		dim[1] = std::max(std::size_t(1), dimy);
+		dim[2] = std::max(std::size_t(1), dimz);
+		offsets.clear();
+		indices.clear();
 		compute_scales();
+		compute_cell_slots();
 	}
+	/// set the order of the cells, which removes all points
+	void set_cell_order(CellOrder co) {
+		cell_order = co;
+		offsets.clear();
+		indices.clear();
+		compute_cell_slots();
+	}
+	/// return the order of the cells
+	CellOrder get_cell_order() const { return cell_order; }
+	/// set the maximal number of threads used to sort points into the grid, 0 selects the concurrency of the executor
+	void set_max_nr_threads(unsigned n) { max_nr_threads = n; }
+	/// set the executor that runs the blocks of the parallel build
+	void set_executor(const Executor& e) { executor = e; }
 	void set_box(const Pnt& _min_pnt, const Pnt& _max_pnt) {
 		min_pnt = _min_pnt;
 		max_pnt = _max_pnt;
 		compute_scales();
 	}
+	const Pnt& get_min_pnt() const { return min_pnt; }
+	const Pnt& get_max_pnt() const { return max_pnt; }
 	template <typename Func>
 	void compute_box(Idx nr_points, const Func& pnts) {
+		if (nr_points == 0)
+			return;
 		min_pnt = max_pnt = pnts(0);
 		for (Idx i=1; i<nr_points; ++i) {
 			for (int c=0; c<3; ++c) {
@@ -66,108 +201,182 @@ public:
 		}
 		compute_scales();
 	}
-	/// before calling the build function, ensure that the bounding box has been set with set_box or computed with compute_box
+	/** before calling the build function, ensure that the bounding box has been set with set_box or computed with compute_box.
+	    The neighbor radius rmax is estimated from the point spacing of points sampled from a surface with the area of the
+		box and the dimensions are chosen such that cells have extent rmax, before the points are sorted into the grid. */
 	template <typename Func>
 	void build(Idx nr_points, const Func& pnts) {
-		init();
-		rmax = (Crd) (rmax_estimate_factor*sqrt(2*(extent[0]*(extent[1]+extent[2])+extent[1]*extent[2])/nr_points));
+		rmax = (Crd) (rmax_estimate_factor*std::sqrt(2*(extent[0]*(extent[1]+extent[2])+extent[1]*extent[2])/std::max(nr_points, Idx(1))));
 		rmax_sqr = rmax*rmax;
-		cout << "rmax = " << rmax << endl;
-		set_dim((Idx)(extent[0]/rmax), (Idx)(extent[1]/rmax), (Idx)(extent[2]/rmax));
-		for (Idx i=0; i<nr_points; ++i)
-			insert(pnts(i), i);
+		if (rmax > 0)
+			set_dim((std::size_t)(extent[0]/rmax), (std::size_t)(extent[1]/rmax), (std::size_t)(extent[2]/rmax));
+		sort_points(nr_points, pnts);
 	}
-	Idx get_size() const { 
-		return dim[0]*dim[1]*dim[2]; 
+	/// sort the points into the cells of the grid with the current box and dimensions
+	template <typename Func>
+	void sort_points(Idx nr_points, const Func& pnts) {
+		std::size_t n = std::size_t(nr_points);
+		std::size_t nr_cells = get_size();
+		// compute slot of each point and its rank in the cell with atomic counters
+		std::unique_ptr<std::atomic<Idx>[]> counts(new std::atomic<Idx>[nr_cells]);
+		std::vector<Idx> point_slots(n), ranks(n);
+		parallel_ranges(nr_cells, [&](std::size_t b, std::size_t e) {
+			for (std::size_t si = b; si < e; ++si)
+				counts[si].store(0, std::memory_order_relaxed);
+		});
+		parallel_ranges(n, [&](std::size_t b, std::size_t e) {
+			for (std::size_t i = b; i < e; ++i) {
+				Idx si = get_slot(get_index(pnts(Idx(i))));
+				point_slots[i] = si;
+				ranks[i] = counts[si].fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+		// prefix sum over the cell counts
+		offsets.resize(nr_cells + 1);
+		Idx sum = 0;
+		for (std::size_t si = 0; si < nr_cells; ++si) {
+			offsets[si] = sum;
+			sum += counts[si].load(std::memory_order_relaxed);
+		}
+		offsets[nr_cells] = sum;
+		// scatter point indices and sort them within the cells
+		indices.resize(n);
+		parallel_ranges(n, [&](std::size_t b, std::size_t e) {
+			for (std::size_t i = b; i < e; ++i)
+				indices[offsets[point_slots[i]] + ranks[i]] = Idx(i);
+		});
+		parallel_ranges(nr_cells, [&](std::size_t b, std::size_t e) {
+			for (std::size_t si = b; si < e; ++si)
+				if (offsets[si + 1] - offsets[si] > 1)
+					std::sort(indices.begin() + offsets[si], indices.begin() + offsets[si + 1]);
+		});
 	}
+	/// return the number of cells
+	std::size_t get_size() const {
+		return dim[0]*dim[1]*dim[2];
+	}
+	/// return the row major index of the cell with the given grid coordinates
 	template <typename Jdx>
-	Idx get_index(Jdx *ci) const { 
-		return (ci[2]*dim[1]+ci[1])*dim[0]+ci[0]; 
+	Idx get_index(Jdx *ci) const {
+		return Idx((ci[2]*dim[1]+ci[1])*dim[0]+ci[0]);
 	}
-	Idx get_index(const Pnt& p) const { 
-		Idx ci[3];
-		for (int c = 0; c < 3; ++c) {
-			ci[c] = (Idx) (scale[c]*(p[c]-min_pnt[c]));
-			if (ci[c] >= (Idx)dim[c])
-				ci[c] = dim[c]-1;
-		}
-		return get_index(ci);	
+	/// return the row major index of the cell containing p, points outside of the box are clamped to the boundary cells
+	Idx get_index(const Pnt& p) const {
+		std::size_t ci[3];
+		for (int c = 0; c < 3; ++c)
+			ci[c] = get_cell_coordinate(p[c], c);
+		return get_index(ci);
 	}
+	/// compute the grid coordinates of the cell with the given row major index
 	template <typename Jdx>
 	void split_index(Idx idx, Jdx* ci) const {
-		Idx n = dim[0]*dim[1];
-		ci[2] = (Jdx)(idx / n);
-		idx -= n*ci[2];
-		ci[1] = (Jdx)(idx/dim[0]);
-		ci[0] = (Jdx)(idx-dim[0]*ci[1]);
-	}
-	void put_grid_cell(Idx idx, const Pnt& _min_pnt, const Pnt& _max_pnt) const {
-		Idx ci[3];
+		std::size_t i = std::size_t(idx);
+		std::size_t n = dim[0]*dim[1];
+		ci[2] = (Jdx)(i / n);
+		i -= n*ci[2];
+		ci[1] = (Jdx)(i/dim[0]);
+		ci[0] = (Jdx)(i-dim[0]*ci[1]);
+	}
+	/// compute the box of the cell with the given row major index
+	void put_grid_cell(Idx idx, Pnt& _min_pnt, Pnt& _max_pnt) const {
+		std::size_t ci[3];
 		split_index(idx, ci);
-		for (int c=0; c<3; ++c)
-			_min_pnt[c] = ci[c]/scale[c] + min_pnt[c];
-		_max_pnt = _min_pnt+cell_extent;
-	}
-	void insert(const Pnt& p, Idx i) {
-		Idx ci = get_index(p);
-		if (ci >= size()) {
-			std::cerr << "hit not available cell " << ci << endl;
+		_min_pnt = _max_pnt = min_pnt;
+		for (int c=0; c<3; ++c) {
+			_min_pnt[c] = min_pnt[c] + ci[c]*cell_extent[c];
+			_max_pnt[c] = _min_pnt[c] + cell_extent[c];
+		}
+	}
+	/// return the point indices sorted by cells
+	const std::vector<Idx>& get_indices() const { return indices; }
+	/// return the range [begin,end) of the cell with the given row major index in the array returned by get_indices()
+	void get_cell_range(Idx ci, Idx& begin, Idx& end) const {
+		Idx si = get_slot(ci);
+		begin = offsets[si];
+		end = offsets[si + 1];
+	}
+	/// return the number of points in the cell with the given row major index
+	Idx get_cell_size(Idx ci) const { Idx si = get_slot(ci); return offsets[si + 1] - offsets[si]; }
+	/** call f(pi) for the index pi of every point in the cells overlapping the box [qmin,qmax]. Cells are visited row by
+	    row and with row major order the points of a row are a single contiguous range of the index array. */
+	template <typename F>
+	void for_each_in_cells(const Pnt& qmin, const Pnt& qmax, const F& f) const {
+		if (indices.empty())
 			return;
+		std::size_t c0[3], c1[3];
+		for (int c = 0; c < 3; ++c) {
+			if (qmax[c] < min_pnt[c] || qmin[c] > max_pnt[c])
+				return;
+			c0[c] = get_cell_coordinate(qmin[c], c);
+			c1[c] = get_cell_coordinate(qmax[c], c);
 		}
-		at(ci).push_back(i);
-	}
-	void add_neighbors(Idx pi, const Pnt& p, Idx ci, const Func& pnts, vector<Idx>& N) const {
-		for (Idx i=0; i<at(ci).size(); ++i) {
-			Idx ni = at(ci)[i];
-			if (ni != pi) {
-				if (sqr_length(pnts(ni)-p) < rmax_sqr)
-					N.push_back(ni);
+		std::size_t cc[3];
+		for (cc[2] = c0[2]; cc[2] <= c1[2]; ++cc[2])
+			for (cc[1] = c0[1]; cc[1] <= c1[1]; ++cc[1]) {
+				cc[0] = c0[0];
+				Idx ci = get_index(cc);
+				if (cell_slots.empty()) {
+					for (Idx j = offsets[ci], end = offsets[ci + (c1[0] - c0[0]) + 1]; j < end; ++j)
+						f(indices[j]);
+				}
+				else {
+					for (Idx k = 0; k <= Idx(c1[0] - c0[0]); ++k) {
+						Idx si = cell_slots[ci + k];
+						for (Idx j = offsets[si]; j < offsets[si + 1]; ++j)
+							f(indices[j]);
+					}
+				}
 			}
+	}
+	/// call f(pi) for the index pi of every point inside the box [qmin,qmax]
+	template <typename Func, typename F>
+	void for_each_in_box(const Pnt& qmin, const Pnt& qmax, const Func& pnts, const F& f) const {
+		for_each_in_cells(qmin, qmax, [&](Idx pi) {
+			const Pnt& p = pnts(pi);
+			for (int c = 0; c < 3; ++c)
+				if (p[c] < qmin[c] || p[c] > qmax[c])
+					return;
+			f(pi);
+		});
+	}
+	/// call f(pi, sqr_dist) for the index pi of every point with squared distance sqr_dist < r*r to q
+	template <typename Func, typename F>
+	void for_each_in_radius(const Pnt& q, Crd r, const Func& pnts, const F& f) const {
+		Pnt qmin = q, qmax = q;
+		for (int c = 0; c < 3; ++c) {
+			qmin[c] -= r;
+			qmax[c] += r;
 		}
+		Crd r_sqr = r*r;
+		for_each_in_cells(qmin, qmax, [&](Idx pi) {
+			const Pnt& p = pnts(pi);
+			Crd sqr_dist = 0;
+			for (int c = 0; c < 3; ++c)
+				sqr_dist += (p[c] - q[c])*(p[c] - q[c]);
+			if (sqr_dist < r_sqr)
+				f(pi, sqr_dist);
+		});
+	}
+	/// append the indices of all points with distance less than r to q to N
+	template <typename Func>
+	void find_points_in_radius(const Pnt& q, Crd r, const Func& pnts, std::vector<Idx>& N) const {
+		for_each_in_radius(q, r, pnts, [&](Idx pi, Crd) { N.push_back(pi); });
 	}
+	/// append the indices of all points inside the box [qmin,qmax] to N
 	template <typename Func>
-	void extract_neighbors(Idx i, const Func& pnts, vector<Idx>& N) const
+	void find_points_in_box(const Pnt& qmin, const Pnt& qmax, const Func& pnts, std::vector<Idx>& N) const {
+		for_each_in_box(qmin, qmax, pnts, [&](Idx pi) { N.push_back(pi); });
+	}
+	/// append the indices of all points other than the i-th one with distance less than rmax to the i-th point to N
+	template <typename Func>
+	void extract_neighbors(Idx i, const Func& pnts, std::vector<Idx>& N) const
 	{
-		static const int d[3*26] = {
-			1,0,0,
-			0,1,0,
-			0,0,1,
-			-1,0,0,
-			0,-1,0,
-			0,0,-1,
-
-			1,1,0,
-			0,1,1,
-			1,0,1,
-			-1,1,0,
-			0,-1,1,
-			-1,0,1,
-			1,-1,0,
-			0,1,-1,
-			1,0,-1,
-			-1,-1,0,
-			0,-1,-1,
-			-1,0,-1,
-
-			1,1,1,
-			-1,1,1,
-			1,-1,1,
-			-1,-1,1,
-			1,1,-1,
-			-1,1,-1,
-			1,-1,-1,
-			-1,-1,-1
-		};
-		const Pnt& p = pnts(i);
-		Idx ci = get_index(p);
-		add_neighbors(i, p, ci, N);
-		for (int j=0; j<26; ++j) {
-			Idx cj = ci+d[3*j]+dim[0]*(d[3*j+1]+dim[1]*d[3*j+2]);
-			if (cj >= 0 && cj < (Idx)size())
-				add_neighbors(i, p, cj, N);
-		}
+		for_each_in_radius(pnts(i), rmax, pnts, [&](Idx pi, Crd) {
+			if (pi != i)
+				N.push_back(pi);
+		});
 	}
 };
 
 	}
-}
\ No newline at end of file
+}
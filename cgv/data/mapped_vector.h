@@ -0,0 +1,166 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cgv/utils/mapped_file.h>
+#include <cgv/data/ref_ptr.h>
+
+namespace cgv {
+	namespace data {
+
+/// reference counted pointer to a file mapping that can be shared among several mapped_vector instances
+typedef ref_ptr<cgv::utils::mapped_file> mapped_file_ptr;
+
+/** vector like container that either owns its elements in a std::vector or references a section of a
+    memory mapped file. The mapping is attached with map() and used in place. Element writes go directly
+	to the copy-on-write pages of the mapping, such that only touched pages are copied by the operating
+	system. Any operation that grows the container (resize, push_back, reserve) first
+	detaches the container by copying the mapped section into the owned std::vector. Copies of a mapped
+	container always own their elements as the copy-on-write pages are shared by all views of a mapping. */
+template <typename T>
+class mapped_vector
+{
+public:
+	typedef T value_type;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+	typedef size_t size_type;
+protected:
+	/// owned elements, only used if no mapping is attached
+	std::vector<T> V;
+	/// mapping that is referenced
+	mapped_file_ptr mapping;
+	/// pointer to the first mapped element
+	T* mapped_data;
+	/// number of mapped elements
+	size_t mapped_size;
+public:
+	/// construct empty container
+	mapped_vector() : mapped_data(0), mapped_size(0) {}
+	/// construct container with n copies of v
+	explicit mapped_vector(size_t n, const T& v = T()) : V(n, v), mapped_data(0), mapped_size(0) {}
+	/// copy construct, copies always own their elements
+	mapped_vector(const mapped_vector<T>& mv) : V(mv.begin(), mv.end()), mapped_data(0), mapped_size(0) {}
+	/// assignment, after assignment the container owns its elements
+	mapped_vector<T>& operator = (const mapped_vector<T>& mv)
+	{
+		if (this == &mv)
+			return *this;
+		std::vector<T> tmp(mv.begin(), mv.end());
+		unmap();
+		V.swap(tmp);
+		return *this;
+	}
+	/// reference the n elements starting at byte offset in the mapped file, offset must be aligned to T; return whether successful
+	bool map(const mapped_file_ptr& _mapping, size_t offset, size_t n)
+	{
+		if (_mapping.empty() || !_mapping->is_open() || !_mapping->is_copy_on_write())
+			return false;
+		if (offset + n * sizeof(T) > _mapping->get_size())
+			return false;
+		char* ptr = _mapping->get_data() + offset;
+		if (size_t(ptr) % alignof(T) != 0)
+			return false;
+		std::vector<T>().swap(V);
+		mapping = _mapping;
+		mapped_data = reinterpret_cast<T*>(ptr);
+		mapped_size = n;
+		return true;
+	}
+	/// release mapping without copying the elements such that the container is empty afterwards
+	void unmap()
+	{
+		mapping.clear();
+		mapped_data = 0;
+		mapped_size = 0;
+	}
+	/// copy mapped elements into owned vector and release mapping
+	void detach()
+	{
+		if (mapping.empty())
+			return;
+		V.assign(mapped_data, mapped_data + mapped_size);
+		unmap();
+	}
+	/// return whether the container references a file mapping
+	bool is_mapped() const { return !mapping.empty(); }
+	/// return number of elements
+	size_t size() const { return is_mapped() ? mapped_size : V.size(); }
+	/// return whether container is empty
+	bool empty() const { return size() == 0; }
+	/// return pointer to first element
+	T* data() { return is_mapped() ? mapped_data : (V.empty() ? 0 : &V.front()); }
+	/// return const pointer to first element
+	const T* data() const { return is_mapped() ? mapped_data : (V.empty() ? 0 : &V.front()); }
+	/// return iterator to first element
+	iterator begin() { return data(); }
+	/// return iterator behind last element
+	iterator end() { return data() + size(); }
+	/// return const iterator to first element
+	const_iterator begin() const { return data(); }
+	/// return const iterator behind last element
+	const_iterator end() const { return data() + size(); }
+	/// access element
+	T& operator [] (size_t i) { return data()[i]; }
+	/// const access to element
+	const T& operator [] (size_t i) const { return data()[i]; }
+	/// access first element
+	T& front() { return data()[0]; }
+	/// const access to first element
+	const T& front() const { return data()[0]; }
+	/// access last element
+	T& back() { return data()[size() - 1]; }
+	/// const access to last element
+	const T& back() const { return data()[size() - 1]; }
+	/// remove all elements and release mapping
+	void clear() { unmap(); V.clear(); }
+	/// change number of elements, shrinking keeps the mapping, growing copies mapped elements before
+	void resize(size_t n)
+	{
+		if (is_mapped() && n <= mapped_size) {
+			mapped_size = n;
+			return;
+		}
+		detach();
+		V.resize(n);
+	}
+	/// change number of elements and initialize new elements with v, growing copies mapped elements before
+	void resize(size_t n, const T& v)
+	{
+		if (is_mapped() && n <= mapped_size) {
+			mapped_size = n;
+			return;
+		}
+		// v might reference a mapped element that is released by detach
+		T v_copy(v);
+		detach();
+		V.resize(n, v_copy);
+	}
+	/// reserve memory, mapped elements are copied before
+	void reserve(size_t n) { detach(); V.reserve(n); }
+	/// append an element, mapped elements are copied before
+	void push_back(const T& v)
+	{
+		if (!is_mapped()) {
+			V.push_back(v);
+			return;
+		}
+		// v might reference a mapped element that is released by detach
+		T v_copy(v);
+		detach();
+		V.push_back(v_copy);
+	}
+	/// swap content with another container
+	void swap(mapped_vector<T>& mv)
+	{
+		V.swap(mv.V);
+		std::swap(mapping, mv.mapping);
+		std::swap(mapped_data, mv.mapped_data);
+		std::swap(mapped_size, mv.mapped_size);
+	}
+};
+
+	}
+}
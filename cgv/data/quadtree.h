@@ -2,11 +2,19 @@
 
 #include <vector>
 #include <cassert>
+#include <cstdint>
+#include <algorithm>
 #include <cgv/math/fvec.h>
 #include <cgv/media/axis_aligned_box.h>
 
 namespace cgv {
 	namespace data {
+		/** quadtree over points of a point provider for collision queries as used in Poisson disk sampling. Leaves
+		    contain up to four points and full leaves are split at the center of their cell into four children that
+			are stored consecutively in the node array. Each node additionally stores the tight bounding box of the
+			points below it, such that queries prune with the extent of the points instead of the cells as in a loose
+			quadtree. Points can be inserted one by one or a complete point set can be bulk loaded with build(), which
+			sorts the points along a Morton curve and creates the same tree as inserting the points one by one. */
 		template <typename T>
 		class quadtree
 		{
@@ -18,6 +26,10 @@ namespace cgv {
 				virtual const vec2& get_point(int i) const = 0;
 			};
 		protected:
+			/** node of the quadtree. Leaves store the indices of up to four points in children, which is terminated by -1 if
+			    less than four points are contained. Inner nodes store the indices of their children, which are consecutive,
+				such that children[k] equals children[0]+k. A single first child index would not shrink the node as leaves,
+				which are about three quarters of the nodes, need all four slots. */
 			struct node
 			{
 				bool is_leaf;
@@ -30,103 +42,230 @@ namespace cgv {
 			const point_provider& provider;
 			int root_idx;
 			std::vector<node> nodes;
+			/// per node the bounding box of the contained points, which is invalid for empty nodes
+			std::vector<box2> bounds;
 
 			const node& get_node(int ni) const { return nodes[ni]; }
 				  node& ref_node(int ni)       { return nodes[ni]; }
 
 				  bool is_leaf(int ni) const { return nodes[ni].is_leaf; }
+			/// append four empty children and return the index of the first one
+			int add_children() {
+				int c0 = (int)nodes.size();
+				nodes.resize(nodes.size() + 4);
+				bounds.resize(bounds.size() + 4);
+				return c0;
+			}
 			void add_point_to_leaf(int pi, int ni) {
 				node& n = ref_node(ni);
 				assert(n.is_leaf && n.size() < 4);
 				n.children[n.size()] = pi;
+				bounds[ni].add_point(provider.get_point(pi));
 			}
 			bool split_leaf(int ni, const vec2& x) {
 				if (!is_leaf(ni))
 					return false;
-				int c0 = (int)nodes.size();
-				nodes.resize(nodes.size() + 4);
+				int c0 = add_children();
 				node& n = ref_node(ni);
 				for (unsigned j = 0; j < 4; ++j) {
 					int pi = n.children[j];
-					if (pi != -1) {
-						const vec2& p = provider.get_point(pi);
-						unsigned k = 0;
-						if (p(0) > x(0))
-							k += 1;
-						if (p(1) > x(1))
-							k += 2;
-						add_point_to_leaf(pi, c0 + k);
-					}
+					if (pi != -1)
+						add_point_to_leaf(pi, c0 + get_child_index(provider.get_point(pi), x));
 					n.children[j] = c0 + j;
 				}
 				n.is_leaf = false;
 				return true;
 			}
-		public:
-			quadtree(const point_provider& _provider, const box2& _box) : provider(_provider), box(_box) { nodes.push_back(node()); root_idx = 0; }
-			bool empty() const { return is_leaf(get_root_index()) && get_node(get_root_index()).size() == 0; }
-			int get_root_index() const { return root_idx; }
-			bool collides(const vec2& x, T d, int ni = -1, box2 b = box2()) const {
-				if (ni == -1) {
-					ni = get_root_index();
-					b = box;
+			/// return index of the child of a node with center x that contains p
+			static unsigned get_child_index(const vec2& p, const vec2& x) {
+				unsigned k = 0;
+				if (p(0) > x(0))
+					k += 1;
+				if (p(1) > x(1))
+					k += 2;
+				return k;
+			}
+			/// return whether the disk of radius d around x overlaps the box b
+			static bool overlaps(const box2& b, const vec2& x, T d) {
+				return x(0) + d > b.get_min_pnt()(0) && x(0) - d < b.get_max_pnt()(0) &&
+					   x(1) + d > b.get_min_pnt()(1) && x(1) - d < b.get_max_pnt()(1);
+			}
+			/// return whether a point of the leaf ni has distance less than d to x
+			bool leaf_collides(int ni, const vec2& x, T d) const {
+				const node& n = get_node(ni);
+				for (unsigned j = 0; j < 4; ++j) {
+					if (n.children[j] == -1)
+						break;
+					if ((provider.get_point(n.children[j]) - x).length() < d)
+						return true;
 				}
-				// check for overlap
-				if (x(0) + d > b.get_min_pnt()(0) && x(0) - d < b.get_max_pnt()(0) &&
-					x(1) + d > b.get_min_pnt()(1) && x(1) - d < b.get_max_pnt()(1)) {
-					// in leaf case compare to points
-					if (is_leaf(ni)) {
-						const node& n = get_node(ni);
-						for (unsigned j = 0; j < 4; ++j) {
-							if (n.children[j] == -1)
-								break;
-							if ((provider.get_point(n.children[j])-x).length() < d)
-								return true;
-						}
-						return false;
+				return false;
+			}
+			/// return the child box of box b with center x for child index k
+			static box2 get_child_box(const box2& b, const vec2& x, unsigned k) {
+				box2 cb = b;
+				if (k & 1)
+					cb.ref_min_pnt()(0) = x(0);
+				else
+					cb.ref_max_pnt()(0) = x(0);
+				if (k & 2)
+					cb.ref_min_pnt()(1) = x(1);
+				else
+					cb.ref_max_pnt()(1) = x(1);
+				return cb;
+			}
+			/// number of levels encoded in Morton codes
+			static const int nr_code_levels = 16;
+			/// return the center of the interval [lo,hi] as computed for the cells
+			static T get_center(T lo, T hi) { return lo + T(0.5)*(hi - lo); }
+			/// return the center of the cell with box b
+			static vec2 get_center(const box2& b) { return vec2(get_center(b.get_min_pnt()(0), b.get_max_pnt()(0)), get_center(b.get_min_pnt()(1), b.get_max_pnt()(1))); }
+			/// return the Morton code of p composed of the child indices along the path of the first 16 levels below the root
+			std::uint32_t get_morton_code(const vec2& p) const {
+				std::uint32_t code = 0;
+				T lo[2] = { box.get_min_pnt()(0), box.get_min_pnt()(1) };
+				T hi[2] = { box.get_max_pnt()(0), box.get_max_pnt()(1) };
+				// select without branches as the bits of random points are not predictable
+				for (int l = 0; l < nr_code_levels; ++l) {
+					for (int c = 1; c >= 0; --c) {
+						T x = get_center(lo[c], hi[c]);
+						bool upper = p(c) > x;
+						code = code << 1 | std::uint32_t(upper);
+						lo[c] = upper ? x : lo[c];
+						hi[c] = upper ? hi[c] : x;
 					}
-					else {
-						vec2 c = b.get_center();
-						const node& n = get_node(ni);
-						return
-							collides(x, d, n.children[0], box2(b.get_min_pnt(), c)) ||
-							collides(x, d, n.children[1], box2(vec2(c(0), b.get_min_pnt()(1)), vec2(b.get_max_pnt()(0), c(1)))) ||
-							collides(x, d, n.children[2], box2(vec2(b.get_min_pnt()(0), c(1)), vec2(c(0), b.get_max_pnt()(1)))) ||
-							collides(x, d, n.children[3], box2(c, b.get_max_pnt()));
+				}
+				return code;
+			}
+			/** create the subtree of node ni with box b on the given level over the points [begin,end) sorted by Morton
+			    codes. The children correspond to consecutive ranges of codes, below the levels encoded in the codes the
+				points are partitioned with comparisons. */
+			void build_node(int ni, const box2& b, int level, std::pair<std::uint32_t, int>* begin, std::pair<std::uint32_t, int>* end) {
+				if (end - begin <= 4) {
+					for (auto* pi = begin; pi < end; ++pi)
+						add_point_to_leaf(pi->second, ni);
+					return;
+				}
+				vec2 x = get_center(b);
+				int c0 = add_children();
+				node& n = ref_node(ni);
+				n.is_leaf = false;
+				for (unsigned k = 0; k < 4; ++k)
+					n.children[k] = c0 + k;
+				std::pair<std::uint32_t, int>* ranges[5] = { begin, 0, 0, 0, end };
+				for (unsigned k = 0; k < 3; ++k) {
+					if (level < nr_code_levels) {
+						int shift = 2 * (nr_code_levels - 1 - level);
+						ranges[k + 1] = std::partition_point(ranges[k], end, [&](const std::pair<std::uint32_t, int>& c) { return ((c.first >> shift) & 3) <= k; });
 					}
+					else
+						ranges[k + 1] = std::stable_partition(ranges[k], end, [&](const std::pair<std::uint32_t, int>& c) { return get_child_index(provider.get_point(c.second), x) == k; });
 				}
-				else
+				for (unsigned k = 0; k < 4; ++k) {
+					build_node(c0 + k, get_child_box(b, x, k), level + 1, ranges[k], ranges[k + 1]);
+					bounds[ni].add_axis_aligned_box(bounds[c0 + k]);
+				}
+			}
+			/// test candidates[begin,end) against the subtree of node ni and set result for the colliding ones
+			void collides_batch(int ni, size_t begin, size_t end, const vec2* X, T d, std::vector<int>& candidates, bool* result) const {
+				if (is_leaf(ni)) {
+					for (size_t j = begin; j < end; ++j) {
+						int ci = candidates[j];
+						if (!result[ci] && leaf_collides(ni, X[ci], d))
+							result[ci] = true;
+					}
+					return;
+				}
+				int c0 = get_node(ni).children[0];
+				for (unsigned k = 0; k < 4; ++k) {
+					int ni_k = c0 + k;
+					if (!bounds[ni_k].is_valid())
+						continue;
+					size_t child_begin = candidates.size();
+					for (size_t j = begin; j < end; ++j) {
+						int ci = candidates[j];
+						if (!result[ci] && overlaps(bounds[ni_k], X[ci], d))
+							candidates.push_back(ci);
+					}
+					if (candidates.size() > child_begin)
+						collides_batch(ni_k, child_begin, candidates.size(), X, d, candidates, result);
+					candidates.resize(child_begin);
+				}
+			}
+			/// recursively test x against the subtree of node ni
+			bool collides_node(const vec2& x, T d, int ni) const {
+				if (!bounds[ni].is_valid() || !overlaps(bounds[ni], x, d))
 					return false;
+				if (is_leaf(ni))
+					return leaf_collides(ni, x, d);
+				int c0 = get_node(ni).children[0];
+				return
+					collides_node(x, d, c0) ||
+					collides_node(x, d, c0 + 1) ||
+					collides_node(x, d, c0 + 2) ||
+					collides_node(x, d, c0 + 3);
+			}
+		public:
+			quadtree(const point_provider& _provider, const box2& _box) : provider(_provider), box(_box) { clear(); }
+			/// remove all points
+			void clear() {
+				nodes.assign(1, node());
+				bounds.assign(1, box2());
+				root_idx = 0;
+			}
+			bool empty() const { return is_leaf(get_root_index()) && get_node(get_root_index()).size() == 0; }
+			int get_root_index() const { return root_idx; }
+			/// return the number of nodes
+			size_t get_nr_nodes() const { return nodes.size(); }
+			/// return whether a point has distance less than d to x
+			bool collides(const vec2& x, T d) const {
+				return collides_node(x, d, get_root_index());
+			}
+			/** test n candidate points X against the tree in one traversal and set result[i] to whether X[i] has distance
+			    less than d to a point in the tree. Candidates are passed down to the children whose bounds they overlap. */
+			void collides(size_t n, const vec2* X, T d, bool* result) const {
+				std::fill(result, result + n, false);
+				if (n == 0 || !bounds[get_root_index()].is_valid())
+					return;
+				std::vector<int> candidates;
+				candidates.reserve(2 * n);
+				for (size_t i = 0; i < n; ++i)
+					if (overlaps(bounds[get_root_index()], X[i], d))
+						candidates.push_back(int(i));
+				collides_batch(get_root_index(), 0, candidates.size(), X, d, candidates, result);
+			}
+			/** replace the tree by a tree over the points with indices [0,nr_points) of the provider, which is the same
+			    tree as obtained by inserting the points one by one. The points are sorted along a Morton curve of the cells
+				and the tree is created top down from ranges of equal code prefixes, such that the children of each node
+				are created consecutively. */
+			void build(int nr_points) {
+				std::vector<std::pair<std::uint32_t, int> > codes(nr_points);
+				for (int pi = 0; pi < nr_points; ++pi)
+					codes[pi] = std::make_pair(get_morton_code(provider.get_point(pi)), pi);
+				std::sort(codes.begin(), codes.end());
+				clear();
+				nodes.reserve(nr_points / 2 + 1);
+				bounds.reserve(nr_points / 2 + 1);
+				if (nr_points > 0)
+					build_node(get_root_index(), box, 0, &codes[0], &codes[0] + nr_points);
 			}
 			void insert(const vec2& p, int pi) {
 				int ni = get_root_index();
 				box2 b = box;
 				while (true) {
+					bounds[ni].add_point(p);
 					if (is_leaf(ni)) {
 						const node& n = get_node(ni);
 						if (n.size() < 4) {
 							add_point_to_leaf(pi, ni);
 							return;
 						}
-						split_leaf(ni, b.get_center());
-					}
-					vec2 x = b.get_center();
-					int k = 0;
-					if (p(0) > x(0)) {
-						k += 1;
-						b.ref_min_pnt()(0) = x(0);
+						split_leaf(ni, get_center(b));
 					}
-					else
-						b.ref_max_pnt()(0) = x(0);
-
-					if (p(1) > x(1)) {
-						k += 2;
-						b.ref_min_pnt()(1) = x(1);
-					}
-					else
-						b.ref_max_pnt()(1) = x(1);
-
-					ni = get_node(ni).children[k];
+					vec2 x = get_center(b);
+					unsigned k = get_child_index(p, x);
+					b = get_child_box(b, x, k);
+					ni = get_node(ni).children[0] + k;
 				}
 			}
 		};
@@ -44,6 +44,48 @@ public:
 		}
 		return g;
 	}
+	/** compute conservative bounds lower <= f(p) <= upper of the function over the axis aligned box spanned by the
+	    points min_pnt and max_pnt, for example from interval arithmetic or a Lipschitz constant. Return false if
+		no bounds are known, which is the default. */
+	virtual bool evaluate_bounds(const X* min_pnt, const X* max_pnt, T& lower, T& upper) const {
+		return false;
+	}
+	/** evaluate the function at n points p0, p0+step, p0+2*step, ... of a row, where p0 and step point to
+	    get_nr_independent_variables() coordinates. Point coordinates are accumulated by repeated addition 
+		of step. The default implementation calls evaluate() for each point but reuses one point vector. */
+	virtual void evaluate_row(const X* p0, const X* step, unsigned n, T* values) const {
+		unsigned d = get_nr_independent_variables();
+		pnt_type q(d, p0);
+		for (unsigned i=0; i<n; ++i) {
+			values[i] = evaluate(q);
+			for (unsigned c=0; c<d; ++c)
+				q(c) += step[c];
+		}
+	}
+	/** evaluate the function at n points, whose coordinates are stored consecutively, i.e. the i-th point starts at
+	    points+i*get_nr_independent_variables(). The default implementation calls evaluate() for each point. */
+	virtual void evaluate_batch(const X* points, unsigned n, T* values) const {
+		unsigned d = get_nr_independent_variables();
+		pnt_type q(d);
+		for (unsigned i=0; i<n; ++i) {
+			for (unsigned c=0; c<d; ++c)
+				q(c) = points[i*d+c];
+			values[i] = evaluate(q);
+		}
+	}
+	/** evaluate the gradient at n points stored as in evaluate_batch and store the gradients consecutively in the
+	    same layout. The default implementation calls evaluate_gradient() for each point. */
+	virtual void evaluate_gradient_batch(const X* points, unsigned n, X* gradients) const {
+		unsigned d = get_nr_independent_variables();
+		pnt_type q(d);
+		for (unsigned i=0; i<n; ++i) {
+			for (unsigned c=0; c<d; ++c)
+				q(c) = points[i*d+c];
+			vec_type g = evaluate_gradient(q);
+			for (unsigned c=0; c<d; ++c)
+				gradients[i*d+c] = g(c);
+		}
+	}
 };
 
 /** specialization of a multivariate function to two independent variables,
@@ -66,5 +108,98 @@ public:
 	unsigned int get_nr_independent_variables() const { return 3; }
 };
 
+/** bivariate function implemented by a functor of type F with an inline T operator () (X x, X y) const. Rows and
+    batches are evaluated in one virtual call with loops over the inlined functor, which the compiler can unroll
+	and vectorize. The gradient is approximated with central differences without memory allocation. */
+template <typename X, typename T, typename F>
+class inline_v2_func : public v2_func<X,T>
+{
+public:
+	typedef typename mfunc<X,T>::pnt_type pnt_type;
+	typedef typename mfunc<X,T>::vec_type vec_type;
+	/// functor that implements the function
+	F f;
+	/// construct from functor
+	inline_v2_func(const F& _f = F()) : f(_f) {}
+	/// evaluate functor
+	T evaluate(const pnt_type& p) const { return f(p(0), p(1)); }
+	/// central differences with an epsilon of 1e-5
+	vec_type evaluate_gradient(const pnt_type& p) const {
+		vec_type g(2);
+		evaluate_gradient_batch(&p(0), 1, &g(0));
+		return g;
+	}
+	/// evaluate row in a loop over the functor
+	void evaluate_row(const X* p0, const X* step, unsigned n, T* values) const {
+		X x = p0[0], y = p0[1];
+		for (unsigned i=0; i<n; ++i, x += step[0], y += step[1])
+			values[i] = f(x, y);
+	}
+	/// evaluate points in a loop over the functor
+	void evaluate_batch(const X* points, unsigned n, T* values) const {
+		for (unsigned i=0; i<n; ++i)
+			values[i] = f(points[2*i], points[2*i+1]);
+	}
+	/// central differences in a loop over the functor
+	void evaluate_gradient_batch(const X* points, unsigned n, X* gradients) const {
+		const X epsilon = (X)1e-5, inv_2_eps = (X)(0.5/epsilon);
+		for (unsigned i=0; i<n; ++i) {
+			X x = points[2*i], y = points[2*i+1];
+			gradients[2*i]   = (X)(f(x+epsilon, y) - f(x-epsilon, y))*inv_2_eps;
+			gradients[2*i+1] = (X)(f(x, y+epsilon) - f(x, y-epsilon))*inv_2_eps;
+		}
+	}
+};
+
+/** trivariate function implemented by a functor of type F with an inline T operator () (X x, X y, X z) const. Rows and
+    batches are evaluated in one virtual call with loops over the inlined functor, which the compiler can unroll
+	and vectorize. The gradient is approximated with central differences without memory allocation. */
+template <typename X, typename T, typename F>
+class inline_v3_func : public v3_func<X,T>
+{
+public:
+	typedef typename mfunc<X,T>::pnt_type pnt_type;
+	typedef typename mfunc<X,T>::vec_type vec_type;
+	/// functor that implements the function
+	F f;
+	/// construct from functor
+	inline_v3_func(const F& _f = F()) : f(_f) {}
+	/// evaluate functor
+	T evaluate(const pnt_type& p) const { return f(p(0), p(1), p(2)); }
+	/// central differences with an epsilon of 1e-5
+	vec_type evaluate_gradient(const pnt_type& p) const {
+		vec_type g(3);
+		evaluate_gradient_batch(&p(0), 1, &g(0));
+		return g;
+	}
+	/// evaluate row in a loop over the functor
+	void evaluate_row(const X* p0, const X* step, unsigned n, T* values) const {
+		X x = p0[0], y = p0[1], z = p0[2];
+		if (step[1] == 0 && step[2] == 0) {
+			// rows along the x-axis as used in contouring
+			for (unsigned i=0; i<n; ++i, x += step[0])
+				values[i] = f(x, y, z);
+			return;
+		}
+		for (unsigned i=0; i<n; ++i, x += step[0], y += step[1], z += step[2])
+			values[i] = f(x, y, z);
+	}
+	/// evaluate points in a loop over the functor
+	void evaluate_batch(const X* points, unsigned n, T* values) const {
+		for (unsigned i=0; i<n; ++i)
+			values[i] = f(points[3*i], points[3*i+1], points[3*i+2]);
+	}
+	/// central differences in a loop over the functor
+	void evaluate_gradient_batch(const X* points, unsigned n, X* gradients) const {
+		const X epsilon = (X)1e-5, inv_2_eps = (X)(0.5/epsilon);
+		for (unsigned i=0; i<n; ++i) {
+			X x = points[3*i], y = points[3*i+1], z = points[3*i+2];
+			gradients[3*i]   = (X)(f(x+epsilon, y, z) - f(x-epsilon, y, z))*inv_2_eps;
+			gradients[3*i+1] = (X)(f(x, y+epsilon, z) - f(x, y-epsilon, z))*inv_2_eps;
+			gradients[3*i+2] = (X)(f(x, y, z+epsilon) - f(x, y, z-epsilon))*inv_2_eps;
+		}
+	}
+};
+
 	}
 }
\ No newline at end of file
@@ -3,10 +3,144 @@
 #include <cgv/math/mat.h>
 #include <cgv/math/eig.h>
 #include <cgv/math/point_operations.h>
+#include <cmath>
+#include <algorithm>
 
 namespace cgv {
 	namespace math {
 
+namespace {
+	inline double dot3(const double* a, const double* b) { return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]; }
+	inline void cross3(const double* a, const double* b, double* c)
+	{
+		c[0] = a[1]*b[2] - a[2]*b[1];
+		c[1] = a[2]*b[0] - a[0]*b[2];
+		c[2] = a[0]*b[1] - a[1]*b[0];
+	}
+	/// compute eigenvector of well separated eigenvalue from the largest cross product of two rows of A - lambda*I
+	void eigenvector_of_separated_eigenvalue(const double A[3][3], double lambda, double* v)
+	{
+		double r[3][3] = {
+			{ A[0][0] - lambda, A[0][1], A[0][2] },
+			{ A[1][0], A[1][1] - lambda, A[1][2] },
+			{ A[2][0], A[2][1], A[2][2] - lambda } };
+		double c[3][3];
+		cross3(r[0], r[1], c[0]);
+		cross3(r[0], r[2], c[1]);
+		cross3(r[1], r[2], c[2]);
+		double l[3] = { dot3(c[0], c[0]), dot3(c[1], c[1]), dot3(c[2], c[2]) };
+		int i = l[0] >= l[1] ? (l[0] >= l[2] ? 0 : 2) : (l[1] >= l[2] ? 1 : 2);
+		if (l[i] == 0) {
+			v[0] = 1; v[1] = v[2] = 0;
+			return;
+		}
+		double s = 1/std::sqrt(l[i]);
+		v[0] = s*c[i][0]; v[1] = s*c[i][1]; v[2] = s*c[i][2];
+	}
+	/// compute eigenvector of eigenvalue lambda that is orthogonal to the eigenvector w by solving a 2x2 problem in the orthogonal complement of w
+	void eigenvector_in_orthogonal_complement(const double A[3][3], const double* w, double lambda, double* v)
+	{
+		double u0[3], u1[3];
+		if (std::abs(w[0]) > std::abs(w[1])) {
+			double s = 1/std::sqrt(w[0]*w[0] + w[2]*w[2]);
+			u0[0] = -w[2]*s; u0[1] = 0; u0[2] = w[0]*s;
+		}
+		else {
+			double s = 1/std::sqrt(w[1]*w[1] + w[2]*w[2]);
+			u0[0] = 0; u0[1] = w[2]*s; u0[2] = -w[1]*s;
+		}
+		cross3(w, u0, u1);
+		double Au0[3], Au1[3];
+		for (int i = 0; i < 3; ++i) {
+			Au0[i] = dot3(A[i], u0);
+			Au1[i] = dot3(A[i], u1);
+		}
+		double m00 = dot3(u0, Au0) - lambda, m01 = dot3(u0, Au1), m11 = dot3(u1, Au1) - lambda;
+		// the null space of the singular 2x2 matrix is orthogonal to its row of larger magnitude
+		double c0, c1;
+		if (std::abs(m00) >= std::abs(m11)) {
+			c0 = m01; c1 = -m00;
+		}
+		else {
+			c0 = m11; c1 = -m01;
+		}
+		double l = std::sqrt(c0*c0 + c1*c1);
+		if (l == 0) {
+			v[0] = u0[0]; v[1] = u0[1]; v[2] = u0[2];
+			return;
+		}
+		c0 /= l; c1 /= l;
+		for (int i = 0; i < 3; ++i)
+			v[i] = c0*u0[i] + c1*u1[i];
+	}
+}
+
+void eig_sym_3x3(const double* _A, double* _evals, double* _evecs)
+{
+	// scale matrix to avoid over- and underflow
+	double scale = 0;
+	for (int i = 0; i < 6; ++i)
+		scale = std::max(scale, std::abs(_A[i]));
+	if (scale == 0) {
+		std::fill(_evals, _evals + 3, 0.0);
+		std::fill(_evecs, _evecs + 9, 0.0);
+		_evecs[0] = _evecs[4] = _evecs[8] = 1;
+		return;
+	}
+	double A[3][3] = {
+		{ _A[0]/scale, _A[1]/scale, _A[2]/scale },
+		{ _A[1]/scale, _A[3]/scale, _A[4]/scale },
+		{ _A[2]/scale, _A[4]/scale, _A[5]/scale } };
+	double off_sqr = A[0][1]*A[0][1] + A[0][2]*A[0][2] + A[1][2]*A[1][2];
+	double evals[3], evecs[3][3];
+	if (off_sqr == 0) {
+		// diagonal matrix
+		for (int i = 0; i < 3; ++i) {
+			evals[i] = A[i][i];
+			for (int j = 0; j < 3; ++j)
+				evecs[i][j] = i == j ? 1 : 0;
+		}
+	}
+	else {
+		// eigenvalues of B = (A-q*I)/p are 2*cos(phi+2*pi*k/3) with phi = acos(det(B)/2)/3
+		double q = (A[0][0] + A[1][1] + A[2][2])/3;
+		double b00 = A[0][0] - q, b11 = A[1][1] - q, b22 = A[2][2] - q;
+		double p = std::sqrt((b00*b00 + b11*b11 + b22*b22 + 2*off_sqr)/6);
+		double c00 = b11*b22 - A[1][2]*A[1][2];
+		double c01 = A[0][1]*b22 - A[1][2]*A[0][2];
+		double c02 = A[0][1]*A[1][2] - b11*A[0][2];
+		double half_det = (b00*c00 - A[0][1]*c01 + A[0][2]*c02)/(2*p*p*p);
+		half_det = std::min(std::max(half_det, -1.0), 1.0);
+		double phi = std::acos(half_det)/3;
+		const double two_pi_third = 2.0943951023931954923;
+		double beta_max = 2*std::cos(phi);
+		double beta_min = 2*std::cos(phi + two_pi_third);
+		double beta_mid = -(beta_max + beta_min);
+		evals[0] = q + p*beta_max;
+		evals[1] = q + p*beta_mid;
+		evals[2] = q + p*beta_min;
+		// start with the eigenvalue that is better separated from the others
+		if (half_det >= 0) {
+			eigenvector_of_separated_eigenvalue(A, evals[0], evecs[0]);
+			eigenvector_in_orthogonal_complement(A, evecs[0], evals[1], evecs[1]);
+			cross3(evecs[0], evecs[1], evecs[2]);
+		}
+		else {
+			eigenvector_of_separated_eigenvalue(A, evals[2], evecs[2]);
+			eigenvector_in_orthogonal_complement(A, evecs[2], evals[1], evecs[1]);
+			cross3(evecs[1], evecs[2], evecs[0]);
+		}
+	}
+	// sort descending
+	int order[3] = { 0, 1, 2 };
+	std::sort(order, order + 3, [&evals](int i, int j) { return evals[i] > evals[j]; });
+	for (int i = 0; i < 3; ++i) {
+		_evals[i] = scale*evals[order[i]];
+		for (int j = 0; j < 3; ++j)
+			_evecs[3*i + j] = evecs[order[i]][j];
+	}
+}
+
 void estimate_normal_ls(unsigned nr_points, const float* _points, float* _normal, float* _evals, float* _mean, float* _evecs)
 {
 	cgv::math::mat<float> points;
@@ -18,6 +18,14 @@ namespace cgv {
 
 		/// Weighted version of \c estimate_normal_ls with additional input \c _weights pointing to \c nr_points scalar weights.
 		extern CGV_API void estimate_normal_wls(unsigned nr_points, const float* _points, const float* _weights, float* _normal, float* _evals = 0, float* _mean = 0, float* _evecs = 0);
+
+		//! Compute eigenvalues and eigenvectors of a symmetric 3x3 matrix in closed form.
+		/*! The upper triangle of the matrix is given in \c _A in the order a00, a01, a02, a11, a12, a22. The eigenvalues are
+		    written in descending order to \c _evals and the corresponding normalized eigenvectors as 3 consecutive
+			double tripples to \c _evecs, such that the last eigenvector is the least squares normal of a covariance matrix.
+			The solver computes the eigenvalues with the trigonometric solution of the characteristic polynomial and the
+			eigenvectors from cross products, such that it is much faster than the iterative \c eig_sym in \c eig.h. */
+		extern CGV_API void eig_sym_3x3(const double* _A, double* _evals, double* _evecs);
 	}
 }
 #include <cgv/config/lib_end.h>
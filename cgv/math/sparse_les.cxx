@@ -4,9 +4,17 @@
 namespace cgv {
 	namespace math {
 
+/// implemented in sparse_les_solvers.cxx
+extern void register_builtin_sparse_les_solvers(std::vector<sparse_les_factory_ptr>& factories);
+
 std::vector<sparse_les_factory_ptr>& ref_solver_factories()
 {
 	static std::vector<sparse_les_factory_ptr> facs;
+	static bool builtin_registered = false;
+	if (!builtin_registered) {
+		builtin_registered = true;
+		register_builtin_sparse_les_solvers(facs);
+	}
 	return facs;
 }
 
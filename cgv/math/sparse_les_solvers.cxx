@@ -0,0 +1,637 @@
+#include "sparse_les_solvers.h"
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cgv/os/thread_pool.h>
+
+namespace cgv {
+	namespace math {
+
+/// number of rows processed as one unit of work in parallel loops
+static const int block_size = 4096;
+
+/// call f(begin, end) for consecutive blocks of [0,n), in parallel in the global thread pool if there are enough blocks
+template <typename F>
+static void parallel_blocks(int n, const F& f)
+{
+	int nr_blocks = (n + block_size - 1) / block_size;
+	if (nr_blocks < 4) {
+		for (int b = 0; b < nr_blocks; ++b)
+			f(b*block_size, std::min(n, (b + 1)*block_size));
+		return;
+	}
+	cgv::os::parallel_for(0, nr_blocks, 1, [&](int b) {
+		f(b*block_size, std::min(n, (b + 1)*block_size));
+	});
+}
+
+/// compute the m dot products of m interleaved vector pairs of length n, partial sums are combined in fixed order
+static void parallel_dots(int n, int m, const double* x, const double* y, double* d)
+{
+	int nr_blocks = (n + block_size - 1) / block_size;
+	std::vector<double> partial(size_t(nr_blocks)*m, 0.0);
+	parallel_blocks(n, [&](int begin, int end) {
+		double* p = &partial[size_t(begin / block_size)*m];
+		for (size_t k = size_t(begin)*m; k < size_t(end)*m; k += m)
+			for (int j = 0; j < m; ++j)
+				p[j] += x[k + j] * y[k + j];
+	});
+	for (int j = 0; j < m; ++j)
+		d[j] = 0;
+	for (int b = 0; b < nr_blocks; ++b)
+		for (int j = 0; j < m; ++j)
+			d[j] += partial[size_t(b)*m + j];
+}
+
+/// compute y += a[j]*x for all m interleaved vectors
+static void parallel_axpy(int n, int m, const double* a, const double* x, double* y)
+{
+	parallel_blocks(n, [&](int begin, int end) {
+		for (size_t k = size_t(begin)*m; k < size_t(end)*m; k += m)
+			for (int j = 0; j < m; ++j)
+				y[k + j] += a[j] * x[k + j];
+	});
+}
+
+csr_sparse_les::csr_sparse_les(int _n, int _nr_rhs, int nr_nze) : n(_n), nr_rhs(_nr_rhs)
+{
+	if (nr_nze > 0)
+		triplets.reserve(nr_nze);
+	B.resize(size_t(n)*nr_rhs, 0.0);
+	X.resize(size_t(n)*nr_rhs, 0.0);
+}
+
+void csr_sparse_les::set_mat_entry(int r, int c, double val)
+{
+	triplet t;
+	t.r = r;
+	t.c = c;
+	t.val = val;
+	triplets.push_back(t);
+}
+
+void csr_sparse_les::set_b_entry(int i, int j, double val)
+{
+	B[size_t(i)*nr_rhs + j] = val;
+}
+
+double& csr_sparse_les::ref_b_entry(int i, int j)
+{
+	return B[size_t(i)*nr_rhs + j];
+}
+
+double csr_sparse_les::get_x_entry(int i, int j) const
+{
+	return X[size_t(i)*nr_rhs + j];
+}
+
+bool csr_sparse_les::assemble()
+{
+	// count entries per row
+	row_ptr.assign(n + 1, 0);
+	for (const auto& t : triplets) {
+		if (t.r < 0 || t.r >= n || t.c < 0 || t.c >= n) {
+			std::cerr << "sparse_les: matrix entry (" << t.r << "," << t.c << ") out of range" << std::endl;
+			return false;
+		}
+		++row_ptr[t.r + 1];
+	}
+	for (int i = 0; i < n; ++i)
+		row_ptr[i + 1] += row_ptr[i];
+	// scatter triplet indices into rows in the order they were set
+	std::vector<int> order(triplets.size());
+	std::vector<int> fill(row_ptr.begin(), row_ptr.end() - 1);
+	for (size_t k = 0; k < triplets.size(); ++k)
+		order[fill[triplets[k].r]++] = int(k);
+	// sort each row by column and keep the last set value of duplicates
+	col_idx.resize(triplets.size());
+	values.resize(triplets.size());
+	int nnz = 0;
+	for (int i = 0; i < n; ++i) {
+		int begin = row_ptr[i], end = row_ptr[i + 1];
+		std::stable_sort(order.begin() + begin, order.begin() + end,
+			[this](int k1, int k2) { return triplets[k1].c < triplets[k2].c; });
+		row_ptr[i] = nnz;
+		for (int k = begin; k < end; ++k) {
+			const triplet& t = triplets[order[k]];
+			if (nnz > row_ptr[i] && col_idx[nnz - 1] == t.c)
+				values[nnz - 1] = t.val;
+			else {
+				col_idx[nnz] = t.c;
+				values[nnz] = t.val;
+				++nnz;
+			}
+		}
+	}
+	row_ptr[n] = nnz;
+	col_idx.resize(nnz);
+	values.resize(nnz);
+	return true;
+}
+
+void csr_sparse_les::multiply(const double* x, double* y) const
+{
+	int m = nr_rhs;
+	parallel_blocks(n, [&](int begin, int end) {
+		for (int i = begin; i < end; ++i) {
+			double* yi = y + size_t(i)*m;
+			for (int j = 0; j < m; ++j)
+				yi[j] = 0;
+			for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+				double a = values[k];
+				const double* xk = x + size_t(col_idx[k])*m;
+				for (int j = 0; j < m; ++j)
+					yi[j] += a * xk[j];
+			}
+		}
+	});
+}
+
+void csr_sparse_les::compute_norms(const double* x, double* norms) const
+{
+	parallel_dots(n, nr_rhs, x, x, norms);
+	for (int j = 0; j < nr_rhs; ++j)
+		norms[j] = sqrt(norms[j]);
+}
+
+void csr_sparse_les::analyze_residuals() const
+{
+	std::vector<double> R(B.size()), r_norms(nr_rhs), b_norms(nr_rhs);
+	multiply(&X[0], &R[0]);
+	for (size_t k = 0; k < R.size(); ++k)
+		R[k] -= B[k];
+	compute_norms(&R[0], &r_norms[0]);
+	compute_norms(&B[0], &b_norms[0]);
+	for (int j = 0; j < nr_rhs; ++j)
+		std::cout << "rhs " << j << ": |Ax-b| = " << r_norms[j] << ", |Ax-b|/|b| = "
+			<< (b_norms[j] > 0 ? r_norms[j] / b_norms[j] : r_norms[j]) << std::endl;
+}
+
+iterative_sparse_les::iterative_sparse_les(int _n, int _nr_rhs, int nr_nze) : csr_sparse_les(_n, _nr_rhs, nr_nze)
+{
+	tolerance = 1e-10;
+	max_nr_iterations = -1;
+	nr_iterations = 0;
+}
+
+pcg_sparse_les::pcg_sparse_les(int _n, int _nr_rhs, int nr_nze, Preconditioner _preconditioner)
+	: iterative_sparse_les(_n, _nr_rhs, nr_nze), preconditioner(_preconditioner), active_preconditioner(_preconditioner)
+{
+}
+
+bool pcg_sparse_les::factorize_ic0()
+{
+	// copy lower triangle of A
+	L_ptr.assign(n + 1, 0);
+	L_idx.clear();
+	L_val.clear();
+	for (int i = 0; i < n; ++i) {
+		bool has_diag = false;
+		for (int k = row_ptr[i]; k < row_ptr[i + 1] && col_idx[k] <= i; ++k) {
+			L_idx.push_back(col_idx[k]);
+			L_val.push_back(values[k]);
+			has_diag = col_idx[k] == i;
+		}
+		if (!has_diag)
+			return false;
+		L_ptr[i + 1] = int(L_idx.size());
+	}
+	// row oriented incomplete factorization restricted to the pattern of A
+	for (int i = 0; i < n; ++i) {
+		int diag = L_ptr[i + 1] - 1;
+		for (int p = L_ptr[i]; p < diag; ++p) {
+			int k = L_idx[p];
+			// subtract dot product of rows i and k over their common columns smaller than k
+			double s = L_val[p];
+			int q = L_ptr[i], r = L_ptr[k], r_end = L_ptr[k + 1] - 1;
+			while (q < p && r < r_end) {
+				if (L_idx[q] < L_idx[r])
+					++q;
+				else if (L_idx[q] > L_idx[r])
+					++r;
+				else
+					s -= L_val[q++] * L_val[r++];
+			}
+			L_val[p] = s / L_val[r_end];
+		}
+		double d = L_val[diag];
+		for (int p = L_ptr[i]; p < diag; ++p)
+			d -= L_val[p] * L_val[p];
+		if (d <= 0)
+			return false;
+		L_val[diag] = sqrt(d);
+	}
+	return true;
+}
+
+void pcg_sparse_les::precondition(const double* r, double* z) const
+{
+	int m = nr_rhs;
+	if (active_preconditioner == PC_JACOBI) {
+		parallel_blocks(n, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+				for (int j = 0; j < m; ++j)
+					z[size_t(i)*m + j] = inv_diag[i] * r[size_t(i)*m + j];
+		});
+		return;
+	}
+	// forward substitution with L
+	for (int i = 0; i < n; ++i) {
+		double* zi = z + size_t(i)*m;
+		const double* ri = r + size_t(i)*m;
+		for (int j = 0; j < m; ++j)
+			zi[j] = ri[j];
+		int diag = L_ptr[i + 1] - 1;
+		for (int p = L_ptr[i]; p < diag; ++p) {
+			const double* zk = z + size_t(L_idx[p])*m;
+			for (int j = 0; j < m; ++j)
+				zi[j] -= L_val[p] * zk[j];
+		}
+		for (int j = 0; j < m; ++j)
+			zi[j] /= L_val[diag];
+	}
+	// backward substitution with L^T
+	for (int i = n; i-- > 0; ) {
+		double* zi = z + size_t(i)*m;
+		int diag = L_ptr[i + 1] - 1;
+		for (int j = 0; j < m; ++j)
+			zi[j] /= L_val[diag];
+		for (int p = L_ptr[i]; p < diag; ++p) {
+			double* zk = z + size_t(L_idx[p])*m;
+			for (int j = 0; j < m; ++j)
+				zk[j] -= L_val[p] * zi[j];
+		}
+	}
+}
+
+bool pcg_sparse_les::solve(bool analyze_residual)
+{
+	if (!assemble())
+		return false;
+	int m = nr_rhs;
+	// prepare preconditioner, fall back to jacobi for this solve only if ic0 breaks down
+	active_preconditioner = preconditioner;
+	if (active_preconditioner == PC_IC0 && !factorize_ic0()) {
+		std::cerr << "pcg_sparse_les: incomplete cholesky factorization broke down, using jacobi preconditioner" << std::endl;
+		active_preconditioner = PC_JACOBI;
+	}
+	if (active_preconditioner == PC_JACOBI) {
+		inv_diag.assign(n, 1.0);
+		for (int i = 0; i < n; ++i)
+			for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k)
+				if (col_idx[k] == i && values[k] != 0)
+					inv_diag[i] = 1.0 / values[k];
+	}
+	size_t N = size_t(n)*m;
+	std::vector<double> R(B), Z(N), P(N), Q(N);
+	std::vector<double> b_norms(m), r_norms(m), rz(m), rz_new(m), pq(m), alpha(m), beta(m);
+	std::vector<bool> active(m, true);
+	std::fill(X.begin(), X.end(), 0.0);
+	compute_norms(&B[0], &b_norms[0]);
+	precondition(&R[0], &Z[0]);
+	P = Z;
+	parallel_dots(n, m, &R[0], &Z[0], &rz[0]);
+	int nr_active = 0;
+	for (int j = 0; j < m; ++j)
+		if (b_norms[j] == 0)
+			active[j] = false;
+		else
+			++nr_active;
+	int max_iter = get_iteration_limit();
+	for (nr_iterations = 0; nr_active > 0 && nr_iterations < max_iter; ++nr_iterations) {
+		multiply(&P[0], &Q[0]);
+		parallel_dots(n, m, &P[0], &Q[0], &pq[0]);
+		for (int j = 0; j < m; ++j)
+			alpha[j] = (active[j] && pq[j] != 0) ? rz[j] / pq[j] : 0.0;
+		parallel_axpy(n, m, &alpha[0], &P[0], &X[0]);
+		for (int j = 0; j < m; ++j)
+			alpha[j] = -alpha[j];
+		parallel_axpy(n, m, &alpha[0], &Q[0], &R[0]);
+		// check convergence, a vanishing curvature pq of the search direction cannot be continued
+		compute_norms(&R[0], &r_norms[0]);
+		for (int j = 0; j < m; ++j)
+			if (active[j] && (r_norms[j] <= tolerance*b_norms[j] || pq[j] == 0)) {
+				if (pq[j] == 0 && r_norms[j] > tolerance*b_norms[j])
+					std::cerr << "pcg_sparse_les: break down for rhs " << j << std::endl;
+				active[j] = false;
+				--nr_active;
+			}
+		if (nr_active == 0)
+			break;
+		// update search directions
+		precondition(&R[0], &Z[0]);
+		parallel_dots(n, m, &R[0], &Z[0], &rz_new[0]);
+		for (int j = 0; j < m; ++j) {
+			beta[j] = active[j] ? rz_new[j] / rz[j] : 0.0;
+			rz[j] = rz_new[j];
+		}
+		parallel_blocks(n, [&](int begin, int end) {
+			for (size_t k = size_t(begin)*m; k < size_t(end)*m; k += m)
+				for (int j = 0; j < m; ++j)
+					P[k + j] = Z[k + j] + beta[j] * P[k + j];
+		});
+	}
+	if (analyze_residual)
+		analyze_residuals();
+	for (int j = 0; j < m; ++j)
+		if (r_norms[j] > tolerance*b_norms[j])
+			return false;
+	return nr_active == 0;
+}
+
+bicgstab_sparse_les::bicgstab_sparse_les(int _n, int _nr_rhs, int nr_nze) : iterative_sparse_les(_n, _nr_rhs, nr_nze)
+{
+}
+
+bool bicgstab_sparse_les::solve(bool analyze_residual)
+{
+	if (!assemble())
+		return false;
+	int m = nr_rhs;
+	inv_diag.assign(n, 1.0);
+	for (int i = 0; i < n; ++i)
+		for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k)
+			if (col_idx[k] == i && values[k] != 0)
+				inv_diag[i] = 1.0 / values[k];
+	auto precondition = [&](const std::vector<double>& r, std::vector<double>& z) {
+		parallel_blocks(n, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+				for (int j = 0; j < m; ++j)
+					z[size_t(i)*m + j] = inv_diag[i] * r[size_t(i)*m + j];
+		});
+	};
+	size_t N = size_t(n)*m;
+	std::vector<double> R(B), R_hat(B), P(N, 0.0), V(N, 0.0), Y(N), S(N), Z(N), T(N);
+	std::vector<double> b_norms(m), r_norms(m), rho(m, 1.0), rho_new(m), alpha(m, 1.0), omega(m, 1.0), tmp(m), ts(m), tt(m);
+	std::vector<bool> active(m, true);
+	std::fill(X.begin(), X.end(), 0.0);
+	compute_norms(&B[0], &b_norms[0]);
+	int nr_active = 0;
+	for (int j = 0; j < m; ++j)
+		if (b_norms[j] == 0)
+			active[j] = false;
+		else
+			++nr_active;
+	int max_iter = get_iteration_limit();
+	for (nr_iterations = 0; nr_active > 0 && nr_iterations < max_iter; ++nr_iterations) {
+		parallel_dots(n, m, &R_hat[0], &R[0], &rho_new[0]);
+		for (int j = 0; j < m; ++j) {
+			if (active[j] && rho_new[j] == 0) {
+				std::cerr << "bicgstab_sparse_les: break down for rhs " << j << std::endl;
+				active[j] = false;
+				--nr_active;
+			}
+			tmp[j] = active[j] ? (rho_new[j] / rho[j])*(alpha[j] / omega[j]) : 0.0;
+		}
+		// P = R + beta*(P - omega*V)
+		parallel_blocks(n, [&](int begin, int end) {
+			for (size_t k = size_t(begin)*m; k < size_t(end)*m; k += m)
+				for (int j = 0; j < m; ++j)
+					P[k + j] = R[k + j] + tmp[j] * (P[k + j] - omega[j] * V[k + j]);
+		});
+		precondition(P, Y);
+		multiply(&Y[0], &V[0]);
+		parallel_dots(n, m, &R_hat[0], &V[0], &tmp[0]);
+		for (int j = 0; j < m; ++j)
+			alpha[j] = (active[j] && tmp[j] != 0) ? rho_new[j] / tmp[j] : 0.0;
+		// S = R - alpha*V and X += alpha*Y
+		parallel_blocks(n, [&](int begin, int end) {
+			for (size_t k = size_t(begin)*m; k < size_t(end)*m; k += m)
+				for (int j = 0; j < m; ++j) {
+					S[k + j] = R[k + j] - alpha[j] * V[k + j];
+					X[k + j] += alpha[j] * Y[k + j];
+				}
+		});
+		precondition(S, Z);
+		multiply(&Z[0], &T[0]);
+		parallel_dots(n, m, &T[0], &S[0], &ts[0]);
+		parallel_dots(n, m, &T[0], &T[0], &tt[0]);
+		for (int j = 0; j < m; ++j) {
+			omega[j] = (active[j] && tt[j] != 0) ? ts[j] / tt[j] : 0.0;
+			rho[j] = rho_new[j];
+		}
+		// X += omega*Z and R = S - omega*T
+		parallel_blocks(n, [&](int begin, int end) {
+			for (size_t k = size_t(begin)*m; k < size_t(end)*m; k += m)
+				for (int j = 0; j < m; ++j) {
+					X[k + j] += omega[j] * Z[k + j];
+					R[k + j] = S[k + j] - omega[j] * T[k + j];
+				}
+		});
+		compute_norms(&R[0], &r_norms[0]);
+		for (int j = 0; j < m; ++j)
+			if (active[j] && (r_norms[j] <= tolerance*b_norms[j] || omega[j] == 0)) {
+				if (omega[j] == 0 && r_norms[j] > tolerance*b_norms[j])
+					std::cerr << "bicgstab_sparse_les: stagnation for rhs " << j << std::endl;
+				active[j] = false;
+				--nr_active;
+			}
+	}
+	if (analyze_residual)
+		analyze_residuals();
+	for (int j = 0; j < m; ++j)
+		if (r_norms[j] > tolerance*b_norms[j])
+			return false;
+	return nr_active == 0;
+}
+
+cholesky_sparse_les::cholesky_sparse_les(int _n, int _nr_rhs, int nr_nze) : csr_sparse_les(_n, _nr_rhs, nr_nze)
+{
+}
+
+void cholesky_sparse_les::compute_ordering()
+{
+	// build symmetric adjacency without diagonal
+	std::vector<int> deg(n, 0);
+	for (int i = 0; i < n; ++i)
+		for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k)
+			if (col_idx[k] != i) {
+				++deg[i];
+				++deg[col_idx[k]];
+			}
+	std::vector<int> adj_ptr(n + 1, 0);
+	for (int i = 0; i < n; ++i)
+		adj_ptr[i + 1] = adj_ptr[i] + deg[i];
+	std::vector<int> adj(adj_ptr[n]), fill(adj_ptr.begin(), adj_ptr.end() - 1);
+	for (int i = 0; i < n; ++i)
+		for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k)
+			if (col_idx[k] != i) {
+				adj[fill[i]++] = col_idx[k];
+				adj[fill[col_idx[k]]++] = i;
+			}
+	// Cuthill-McKee breadth first traversal per connected component starting at a vertex of minimum degree
+	std::vector<int> order;
+	order.reserve(n);
+	std::vector<bool> visited(n, false);
+	std::vector<int> by_degree(n);
+	for (int i = 0; i < n; ++i)
+		by_degree[i] = i;
+	std::stable_sort(by_degree.begin(), by_degree.end(), [&deg](int a, int b) { return deg[a] < deg[b]; });
+	for (int s : by_degree) {
+		if (visited[s])
+			continue;
+		size_t head = order.size();
+		order.push_back(s);
+		visited[s] = true;
+		while (head < order.size()) {
+			int v = order[head++];
+			size_t first = order.size();
+			for (int k = adj_ptr[v]; k < adj_ptr[v + 1]; ++k)
+				if (!visited[adj[k]]) {
+					visited[adj[k]] = true;
+					order.push_back(adj[k]);
+				}
+			std::stable_sort(order.begin() + first, order.end(), [&deg](int a, int b) { return deg[a] < deg[b]; });
+		}
+	}
+	perm.assign(order.rbegin(), order.rend());
+}
+
+bool cholesky_sparse_les::factorize()
+{
+	compute_ordering();
+	std::vector<int> inv_perm(n);
+	for (int i = 0; i < n; ++i)
+		inv_perm[perm[i]] = i;
+	// rows of lower triangle of C = P*A*P^T, entry (i,k) of C with k <= i stems from A(perm[i],perm[k])
+	std::vector<int> C_ptr(n + 1, 0);
+	for (int r = 0; r < n; ++r)
+		for (int k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+			int i = inv_perm[r], c = inv_perm[col_idx[k]];
+			if (c <= i)
+				++C_ptr[i + 1];
+		}
+	for (int i = 0; i < n; ++i)
+		C_ptr[i + 1] += C_ptr[i];
+	std::vector<int> C_idx(C_ptr[n]), fill(C_ptr.begin(), C_ptr.end() - 1);
+	std::vector<double> C_val(C_ptr[n]);
+	for (int r = 0; r < n; ++r)
+		for (int k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+			int i = inv_perm[r], c = inv_perm[col_idx[k]];
+			if (c <= i) {
+				C_idx[fill[i]] = c;
+				C_val[fill[i]++] = values[k];
+			}
+		}
+	// elimination tree with path compression
+	std::vector<int> parent(n, -1), ancestor(n, -1);
+	for (int i = 0; i < n; ++i)
+		for (int p = C_ptr[i]; p < C_ptr[i + 1]; ++p)
+			for (int k = C_idx[p]; k != -1 && k < i; ) {
+				int next = ancestor[k];
+				ancestor[k] = i;
+				if (next == -1)
+					parent[k] = i;
+				k = next;
+			}
+	// row pattern of L in row i is the union of the paths from the entries of row i of C up to i in the tree
+	std::vector<int> mark(n, -1), stack(n);
+	auto reach = [&](int i) -> int {
+		int top = n;
+		mark[i] = i;
+		for (int p = C_ptr[i]; p < C_ptr[i + 1]; ++p) {
+			int len = 0;
+			for (int k = C_idx[p]; mark[k] != i; k = parent[k]) {
+				stack[len++] = k;
+				mark[k] = i;
+			}
+			while (len > 0)
+				stack[--top] = stack[--len];
+		}
+		return top;
+	};
+	// symbolic factorization counts the entries of each column
+	std::vector<int> col_count(n, 1);
+	for (int i = 0; i < n; ++i)
+		for (int top = reach(i); top < n; ++top)
+			++col_count[stack[top]];
+	L_ptr.assign(n + 1, 0);
+	for (int i = 0; i < n; ++i)
+		L_ptr[i + 1] = L_ptr[i] + col_count[i];
+	L_idx.resize(L_ptr[n]);
+	L_val.resize(L_ptr[n]);
+	// numeric up-looking factorization computing one row of L per step
+	std::fill(mark.begin(), mark.end(), -1);
+	std::vector<int> col_fill(L_ptr.begin(), L_ptr.end() - 1);
+	std::vector<double> x(n, 0.0);
+	for (int i = 0; i < n; ++i) {
+		int top = reach(i);
+		double d = 0;
+		for (int p = C_ptr[i]; p < C_ptr[i + 1]; ++p) {
+			if (C_idx[p] == i)
+				d += C_val[p];
+			else
+				x[C_idx[p]] += C_val[p];
+		}
+		for (; top < n; ++top) {
+			int k = stack[top];
+			double l_ik = x[k] / L_val[L_ptr[k]];
+			x[k] = 0;
+			for (int q = L_ptr[k] + 1; q < col_fill[k]; ++q)
+				x[L_idx[q]] -= L_val[q] * l_ik;
+			d -= l_ik * l_ik;
+			L_idx[col_fill[k]] = i;
+			L_val[col_fill[k]++] = l_ik;
+		}
+		if (d <= 0) {
+			std::cerr << "cholesky_sparse_les: matrix not positive definite" << std::endl;
+			return false;
+		}
+		L_idx[col_fill[i]] = i;
+		L_val[col_fill[i]++] = sqrt(d);
+	}
+	return true;
+}
+
+bool cholesky_sparse_les::solve(bool analyze_residual)
+{
+	if (!assemble() || !factorize())
+		return false;
+	int m = nr_rhs;
+	// permute right hand sides
+	std::vector<double> Y(size_t(n)*m);
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < m; ++j)
+			Y[size_t(i)*m + j] = B[size_t(perm[i])*m + j];
+	// forward substitution with L stored by columns
+	for (int k = 0; k < n; ++k) {
+		double* yk = &Y[size_t(k)*m];
+		for (int j = 0; j < m; ++j)
+			yk[j] /= L_val[L_ptr[k]];
+		for (int q = L_ptr[k] + 1; q < L_ptr[k + 1]; ++q) {
+			double* yi = &Y[size_t(L_idx[q])*m];
+			for (int j = 0; j < m; ++j)
+				yi[j] -= L_val[q] * yk[j];
+		}
+	}
+	// backward substitution with L^T
+	for (int k = n; k-- > 0; ) {
+		double* yk = &Y[size_t(k)*m];
+		for (int q = L_ptr[k] + 1; q < L_ptr[k + 1]; ++q) {
+			const double* yi = &Y[size_t(L_idx[q])*m];
+			for (int j = 0; j < m; ++j)
+				yk[j] -= L_val[q] * yi[j];
+		}
+		for (int j = 0; j < m; ++j)
+			yk[j] /= L_val[L_ptr[k]];
+	}
+	// undo permutation
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < m; ++j)
+			X[size_t(perm[i])*m + j] = Y[size_t(i)*m + j];
+	if (analyze_residual)
+		analyze_residuals();
+	return true;
+}
+
+/// register the built-in solvers, called on first access to the solver factories
+void register_builtin_sparse_les_solvers(std::vector<sparse_les_factory_ptr>& factories)
+{
+	factories.push_back(sparse_les_factory_ptr(new sparse_les_factory_impl<pcg_ic0_sparse_les>("pcg_ic0", SparseLesCaps(SLC_SYMMETRIC | SLC_NZE_OPTIONAL))));
+	factories.push_back(sparse_les_factory_ptr(new sparse_les_factory_impl<pcg_sparse_les>("pcg_jacobi", SparseLesCaps(SLC_SYMMETRIC | SLC_NZE_OPTIONAL))));
+	factories.push_back(sparse_les_factory_ptr(new sparse_les_factory_impl<cholesky_sparse_les>("cholesky", SparseLesCaps(SLC_SYMMETRIC | SLC_NZE_OPTIONAL))));
+	factories.push_back(sparse_les_factory_ptr(new sparse_les_factory_impl<bicgstab_sparse_les>("bicgstab", SLC_ALL)));
+}
+
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include "sparse_les.h"
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace math {
+
+/** base class of the built-in sparse linear system solvers. Matrix entries are collected as triplets and
+    assembled into a compressed row storage when solve() is called. Setting the same entry several times
+	keeps the last value. Right hand sides and solutions are stored interleaved, such that all right hand
+	sides are processed together in one sweep over the matrix. */
+class CGV_API csr_sparse_les : public sparse_les
+{
+protected:
+	/// matrix entry in coordinate form
+	struct triplet
+	{
+		int r, c;
+		double val;
+	};
+	/// number of unknowns
+	int n;
+	/// number of right hand sides
+	int nr_rhs;
+	/// collected matrix entries
+	std::vector<triplet> triplets;
+	/// row start offsets in compressed row storage with n+1 entries
+	std::vector<int> row_ptr;
+	/// column indices in compressed row storage sorted within each row
+	std::vector<int> col_idx;
+	/// values in compressed row storage
+	std::vector<double> values;
+	/// right hand sides, entry i of j-th right hand side is stored at i*nr_rhs+j
+	std::vector<double> B;
+	/// solutions in the same layout as the right hand sides
+	std::vector<double> X;
+	/// assemble compressed row storage from triplets, return false if an entry is out of range
+	bool assemble();
+	/// compute Y = A*X for nr_rhs interleaved vectors in parallel
+	void multiply(const double* x, double* y) const;
+	/// compute the euclidean norm of each of the nr_rhs interleaved vectors
+	void compute_norms(const double* x, double* norms) const;
+	/// print relative residual of each right hand side to std::cout
+	void analyze_residuals() const;
+public:
+	/// construct solver for n unknowns and nr_rhs right hand sides with an estimate of the number of non zero entries
+	csr_sparse_les(int _n, int _nr_rhs, int nr_nze = -1);
+	/// set entry in row r and column c in the sparse matrix A
+	void set_mat_entry(int r, int c, double val);
+	/// set i-th entry in the j-th right hand side
+	void set_b_entry(int i, int j, double val);
+	/// return reference to i-th entry in j-th right hand side
+	double& ref_b_entry(int i, int j);
+	/// return the i-th component of the j-th solution vector
+	double get_x_entry(int i, int j) const;
+	/// bring the base class versions for a single right hand side into scope
+	using sparse_les::set_b_entry;
+	using sparse_les::ref_b_entry;
+	using sparse_les::get_x_entry;
+};
+
+/// base class of iterative solvers with convergence control
+class CGV_API iterative_sparse_les : public csr_sparse_les
+{
+protected:
+	/// relative residual norm at which iteration stops
+	double tolerance;
+	/// maximum number of iterations, -1 selects max(1000, n)
+	int max_nr_iterations;
+	/// number of iterations used in last solve
+	int nr_iterations;
+	/// return the maximum number of iterations
+	int get_iteration_limit() const { return max_nr_iterations == -1 ? (n > 1000 ? n : 1000) : max_nr_iterations; }
+public:
+	/// construct with default tolerance of 1e-10
+	iterative_sparse_les(int _n, int _nr_rhs, int nr_nze = -1);
+	/// set the relative residual norm at which iteration stops
+	void set_tolerance(double _tolerance) { tolerance = _tolerance; }
+	/// set maximum number of iterations, -1 selects max(1000, n)
+	void set_max_nr_iterations(int _max_nr_iterations) { max_nr_iterations = _max_nr_iterations; }
+	/// return the number of iterations used in the last solve
+	int get_nr_iterations() const { return nr_iterations; }
+};
+
+/** preconditioned conjugate gradient solver for symmetric positive definite matrices. All entries of the
+    symmetric matrix need to be set. Matrix vector products and vector operations run in parallel. */
+class CGV_API pcg_sparse_les : public iterative_sparse_les
+{
+public:
+	/// supported preconditioners
+	enum Preconditioner { PC_JACOBI, PC_IC0 };
+protected:
+	/// selected preconditioner
+	Preconditioner preconditioner;
+	/// preconditioner used in the current solve, which is jacobi if the incomplete cholesky factorization broke down
+	Preconditioner active_preconditioner;
+	/// inverse diagonal for jacobi preconditioner
+	std::vector<double> inv_diag;
+	/// row start offsets of lower triangular incomplete cholesky factor
+	std::vector<int> L_ptr;
+	/// column indices of incomplete cholesky factor with diagonal at the end of each row
+	std::vector<int> L_idx;
+	/// values of incomplete cholesky factor
+	std::vector<double> L_val;
+	/// compute incomplete cholesky factorization without fill-in, return false on break down
+	bool factorize_ic0();
+	/// apply the preconditioner to nr_rhs interleaved vectors
+	void precondition(const double* r, double* z) const;
+public:
+	/// construct with jacobi preconditioner
+	pcg_sparse_les(int _n, int _nr_rhs, int nr_nze = -1, Preconditioner _preconditioner = PC_JACOBI);
+	/// set the preconditioner
+	void set_preconditioner(Preconditioner _preconditioner) { preconditioner = _preconditioner; }
+	/** solve all right hand sides at once. Return false if a right hand side did not converge, including a
+	    break down on a search direction p with p^T A p = 0, which occurs for indefinite matrices. */
+	bool solve(bool analyze_residual = false);
+};
+
+/// pcg solver with incomplete cholesky preconditioner as default, used for factory registration
+class CGV_API pcg_ic0_sparse_les : public pcg_sparse_les
+{
+public:
+	/// construct with incomplete cholesky preconditioner
+	pcg_ic0_sparse_les(int _n, int _nr_rhs, int nr_nze = -1) : pcg_sparse_les(_n, _nr_rhs, nr_nze, PC_IC0) {}
+};
+
+/// jacobi preconditioned BiCGSTAB solver for general square matrices
+class CGV_API bicgstab_sparse_les : public iterative_sparse_les
+{
+protected:
+	/// inverse diagonal used for preconditioning, 1 for zero diagonal entries
+	std::vector<double> inv_diag;
+public:
+	/// construct solver
+	bicgstab_sparse_les(int _n, int _nr_rhs, int nr_nze = -1);
+	/// solve all right hand sides at once
+	bool solve(bool analyze_residual = false);
+};
+
+/** direct solver for symmetric positive definite matrices based on a sparse cholesky factorization
+    L*L^T = P*A*P^T with reverse Cuthill-McKee ordering P. All entries of the symmetric
+	matrix need to be set, as the lower triangle of the permuted matrix is gathered from both triangles of A. */
+class CGV_API cholesky_sparse_les : public csr_sparse_les
+{
+protected:
+	/// permutation with perm[i] being the original index of the i-th unknown in the factorization
+	std::vector<int> perm;
+	/// column start offsets of cholesky factor
+	std::vector<int> L_ptr;
+	/// row indices of cholesky factor with the diagonal first in each column
+	std::vector<int> L_idx;
+	/// values of cholesky factor
+	std::vector<double> L_val;
+	/// compute reverse Cuthill-McKee ordering of the symmetrized matrix pattern
+	void compute_ordering();
+	/// compute symbolic and numeric factorization, return false if matrix is not positive definite
+	bool factorize();
+public:
+	/// construct solver
+	cholesky_sparse_les(int _n, int _nr_rhs, int nr_nze = -1);
+	/// factorize and solve all right hand sides at once
+	bool solve(bool analyze_residual = false);
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
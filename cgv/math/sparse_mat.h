@@ -1,6 +1,10 @@
 #pragma once
 #include <cgv/math/vec.h>
 #include <cgv/math/mat.h>
+#include <vector>
+#include <algorithm>
+#include <cgv/os/thread_pool.h>
+#include <cmath>
 
 namespace cgv {
 namespace math {
@@ -10,13 +14,55 @@ namespace math {
 template <typename T>
 class sparse_mat;
 
+template <typename T>
+std::ostream& operator<<(std::ostream& out, sparse_mat<T>& sm);
+
 template <typename T>
 void Ax(const sparse_mat<T>& A, const vec<T>&v, vec<T>& r);
 
+template <typename T>
+void Atx(const sparse_mat<T>& A, const vec<T>&v, vec<T>& r);
+
+template <typename T>
+bool low_tri_solve(const sparse_mat<T>& L, const vec<T>& b, vec<T>& x);
+
+/// call f(begin,end) on blocks of [0,n) in the global thread pool if the amount of work is large enough
+template <typename F>
+void sparse_parallel_ranges(unsigned n, unsigned work, F f)
+{
+	unsigned nr_blocks = std::min(n, work / 32768);
+	if (nr_blocks < 2) {
+		f(0u, n);
+		return;
+	}
+	cgv::os::parallel_for(0u, nr_blocks, 1u, [&](unsigned b) {
+		f(unsigned((unsigned long long)n*b / nr_blocks), unsigned((unsigned long long)n*(b + 1) / nr_blocks));
+	});
+}
+
+/// sparse dot product of the entries [begin,end) with the gathered entries of v, uses four independent accumulators
+template <typename T>
+T sparse_dot(const unsigned* idx, const T* data, unsigned begin, unsigned end, const T* v)
+{
+	T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	unsigned i = begin;
+	for (; i + 4 <= end; i += 4) {
+		s0 += data[i] * v[idx[i]];
+		s1 += data[i + 1] * v[idx[i + 1]];
+		s2 += data[i + 2] * v[idx[i + 2]];
+		s3 += data[i + 3] * v[idx[i + 3]];
+	}
+	for (; i < end; ++i)
+		s0 += data[i] * v[idx[i]];
+	return (s0 + s1) + (s2 + s3);
+}
 
 
 /*
-* A sparse matrix column compressed form.
+* A sparse matrix stored in column compressed and in row compressed form. The row compressed form is
+* used for A*x and the column compressed form for A^T*x, such that both products run in parallel without
+* write conflicts. Entries can be added as triplets with add_entry(), which are assembled by compress()
+* where entries added several times to the same position are summed up.
 */
 template <typename T>
 class sparse_mat 
@@ -36,7 +82,68 @@ private:
 	//values of matrix entries
 	vec<T> _data;
 
+	//row start indices in row compressed form
+	vec<unsigned> _row_starts;
+	//column indices of row compressed data
+	vec<unsigned> _row_cols;
+	//values of matrix entries in row compressed form
+	vec<T> _row_data;
+
+	//entry in coordinate form
+	struct triplet
+	{
+		unsigned i, j;
+		T v;
+	};
+	//entries added with add_entry that are not compressed yet
+	std::vector<triplet> _triplets;
+
+	//build row compressed form from column compressed form with sorted column indices in each row
+	void build_row_compressed()
+	{
+		unsigned nz = _data.size();
+		_row_starts.zeros(_nrows+1);
+		_row_cols.resize(nz);
+		_row_data.resize(nz);
+		for(unsigned i = 0; i < nz; i++)
+			_row_starts(_rows(i)+1)++;
+		for(unsigned r = 0; r < _nrows; r++)
+			_row_starts(r+1) += _row_starts(r);
+		vec<unsigned> pos(_nrows);
+		for(unsigned r = 0; r < _nrows; r++)
+			pos(r) = _row_starts(r);
+		for(unsigned c = 0; c < _ncols; c++)
+			for(unsigned i = _cols(c); i < _cols(c+1); i++)
+			{
+				unsigned idx = pos(_rows(i))++;
+				_row_cols(idx) = c;
+				_row_data(idx) = _data(i);
+			}
+	}
+
 public:
+	//construct empty matrix
+	sparse_mat() : _nrows(0), _ncols(0)
+	{
+		_cols.zeros(1);
+		_row_starts.zeros(1);
+	}
+
+	//construct empty matrix of given size with an estimate of the number of non zero entries that will be added
+	sparse_mat(unsigned nrows, unsigned ncols, unsigned nnz_estimate = 0) : _nrows(nrows), _ncols(ncols)
+	{
+		_cols.zeros(ncols+1);
+		_row_starts.zeros(nrows+1);
+		_triplets.reserve(nnz_estimate);
+	}
+
+	//construct from coordinate triplets, entries with the same row and column index are summed up
+	sparse_mat(unsigned nrows, unsigned ncols, const std::vector<unsigned>& row_indices,
+		const std::vector<unsigned>& col_indices, const std::vector<T>& values)
+	{
+		assign_triplets(nrows, ncols, row_indices, col_indices, values);
+	}
+
 	sparse_mat(const mat<T>& m, T eps=0)
 	{
 		compress(m,eps);
@@ -60,6 +167,109 @@ public:
 		return _data.size();
 	}
 
+	//add value to entry (i,j), the entry becomes visible after the next call to compress()
+	void add_entry(unsigned i, unsigned j, const T& v)
+	{
+		assert(i < _nrows && j < _ncols);
+		triplet t = { i, j, v };
+		_triplets.push_back(t);
+	}
+
+	//return number of added entries that are not compressed yet
+	unsigned num_pending_entries() const
+	{
+		return (unsigned)_triplets.size();
+	}
+
+	//merge all entries added with add_entry into the compressed forms, duplicate entries are summed up
+	void compress()
+	{
+		if(_triplets.empty())
+			return;
+		for(unsigned c = 0; c < _ncols; c++)
+			for(unsigned i = _cols(c); i < _cols(c+1); i++)
+				add_entry(_rows(i), c, _data(i));
+		std::vector<triplet> S1(_triplets.size()), S2;
+		S2.swap(_triplets);
+		unsigned nz;
+		// stable counting sorts by column and then by row yield row major order
+		std::vector<unsigned> cnt(std::max(_nrows, _ncols)+1);
+		for(size_t k = 0; k < S2.size(); k++)
+			cnt[S2[k].j+1]++;
+		for(unsigned c = 0; c < _ncols; c++)
+			cnt[c+1] += cnt[c];
+		for(size_t k = 0; k < S2.size(); k++)
+			S1[cnt[S2[k].j]++] = S2[k];
+		std::fill(cnt.begin(), cnt.end(), 0u);
+		for(size_t k = 0; k < S1.size(); k++)
+			cnt[S1[k].i+1]++;
+		for(unsigned r = 0; r < _nrows; r++)
+			cnt[r+1] += cnt[r];
+		for(size_t k = 0; k < S1.size(); k++)
+			S2[cnt[S1[k].i]++] = S1[k];
+		// sum up duplicates and fill row compressed form
+		nz = 0;
+		for(size_t k = 0; k < S2.size(); k++)
+			if(k == 0 || S2[k].i != S2[k-1].i || S2[k].j != S2[k-1].j)
+				nz++;
+		_row_starts.zeros(_nrows+1);
+		_row_cols.resize(nz);
+		_row_data.resize(nz);
+		nz = 0;
+		for(size_t k = 0; k < S2.size(); k++)
+		{
+			if(k > 0 && S2[k].i == S2[k-1].i && S2[k].j == S2[k-1].j)
+				_row_data(nz-1) += S2[k].v;
+			else
+			{
+				_row_starts(S2[k].i+1)++;
+				_row_cols(nz) = S2[k].j;
+				_row_data(nz) = S2[k].v;
+				nz++;
+			}
+		}
+		for(unsigned r = 0; r < _nrows; r++)
+			_row_starts(r+1) += _row_starts(r);
+		// build column compressed form
+		_cols.zeros(_ncols+1);
+		_rows.resize(nz);
+		_data.resize(nz);
+		for(unsigned i = 0; i < nz; i++)
+			_cols(_row_cols(i)+1)++;
+		for(unsigned c = 0; c < _ncols; c++)
+			_cols(c+1) += _cols(c);
+		vec<unsigned> pos(_ncols);
+		for(unsigned c = 0; c < _ncols; c++)
+			pos(c) = _cols(c);
+		for(unsigned r = 0; r < _nrows; r++)
+			for(unsigned i = _row_starts(r); i < _row_starts(r+1); i++)
+			{
+				unsigned idx = pos(_row_cols(i))++;
+				_rows(idx) = r;
+				_data(idx) = _row_data(i);
+			}
+	}
+
+	//replace matrix by the given coordinate triplets, entries with the same row and column index are summed up
+	void assign_triplets(unsigned nrows, unsigned ncols, const std::vector<unsigned>& row_indices,
+		const std::vector<unsigned>& col_indices, const std::vector<T>& values)
+	{
+		assert(row_indices.size() == values.size() && col_indices.size() == values.size());
+		_nrows = nrows;
+		_ncols = ncols;
+		_cols.zeros(ncols+1);
+		_rows.resize(0);
+		_data.resize(0);
+		_triplets.clear();
+		_triplets.reserve(values.size());
+		for(size_t k = 0; k < values.size(); k++)
+			add_entry(row_indices[k], col_indices[k], values[k]);
+		if(_triplets.empty())
+			build_row_compressed();
+		else
+			compress();
+	}
+
 	//cast conversion into full matrix
 	operator mat<T>()
 	{
@@ -84,7 +294,7 @@ public:
 		{
 			for(unsigned j =0; j < m.ncols(); j++)
 			{
-				if(m(i,j) > eps)
+				if(std::abs(m(i,j)) > eps)
 					nz++;
 			}
 		}
@@ -100,7 +310,7 @@ public:
 			for(unsigned i =0; i < m.nrows(); i++)
 			{
 			
-				if(m(i,j) > eps)
+				if(std::abs(m(i,j)) > eps)
 				{
 					_data(nz) = m(i,j);
 					_rows(nz) = i;
@@ -109,23 +319,16 @@ public:
 			}
 		}
 		_cols[m.ncols()]=nz;
-		
+		_triplets.clear();
+		build_row_compressed();
 	}
 
 	
 	///matrix vector product
-	vec<T> operator*(const vec<T>& v)
+	vec<T> operator*(const vec<T>& v) const
 	{
-		assert(_ncols == v.size());
 		vec<T> r;
-		r.zeros(_nrows);
-		unsigned c;
-		for(c = 0; c < _ncols;c++)
-			for(unsigned i = _cols(c); i < _cols(c+1);i++)
-				r(_rows(i)) += _data(i)*v(c);
-
-		
-			
+		Ax(*this, v, r);
 		return r;
 	}
 
@@ -134,7 +337,7 @@ public:
 	sparse_mat<T>& operator*=(const T& s)
 	{
 		_data*=s;		
-			
+		_row_data*=s;
 		return *this;
 	}
 
@@ -147,8 +350,8 @@ public:
 
 	sparse_mat<T>& operator/=(const T& s)
 	{
-		_data*=s;		
-			
+		_data/=s;		
+		_row_data/=s;
 		return *this;
 	}
 
@@ -160,53 +363,15 @@ public:
 	}
 
 
-	///transpose matrix
+	///transpose matrix by exchanging the row and column compressed forms
 	void transpose()
 	{
-		vec<unsigned> _colsnew(_nrows+1);
-		_colsnew.zeros();
-		vec<unsigned> _rowsnew(_data.size());
-		vec<T>_datanew(_data.size());
-		vec<unsigned>_colsnew2(_nrows+1);
-		vec<unsigned> _rowsnew2(_data.size());
-		
-		for(unsigned c = 0; c < _ncols; c++)
-			for(unsigned i = _cols[c]; i < _cols[c+1]; i++)
-			{
-				_colsnew(_rows(i))++;
-				_rowsnew(i) = c;
-			}
-
-		unsigned sum = 0;
-		for(unsigned i = 0; i < _colsnew.size();i++)
-		{
-			unsigned temp = _colsnew(i);
-			_colsnew(i) = sum;
-			_colsnew2(i) = sum;
-			
-			sum+=temp;
-
-		}
-
-		_datanew = _data;
-		_cols= _colsnew;
-	
-
-		for(unsigned i = 0; i < _data.size();i++)
-		{
-			unsigned idx =_colsnew(_rows(i));
-
-			_data(idx)= _datanew(i);
-			_rowsnew2(idx)= _rowsnew(i);
-			_colsnew(_rows(i))++;
-		}
-
-		_rows = _rowsnew2;
-		
-		unsigned t = _nrows;
-		_nrows = _ncols;
-		_ncols = t;
-	
+		std::swap(_cols, _row_starts);
+		std::swap(_rows, _row_cols);
+		std::swap(_data, _row_data);
+		std::swap(_nrows, _ncols);
+		for(size_t k = 0; k < _triplets.size(); k++)
+			std::swap(_triplets[k].i, _triplets[k].j);
 	}
 
 
@@ -217,7 +382,7 @@ public:
 
 	friend void Atx<T>(const sparse_mat<T>& A,const vec<T>&v, vec<T>& r);
 
-	friend bool low_tri_solve(const sparse_mat<T>& L,const vec<T>& b, vec<T>& x);
+	friend bool low_tri_solve<T>(const sparse_mat<T>& L,const vec<T>& b, vec<T>& x);
 
 	
 
@@ -235,30 +400,43 @@ std::ostream& operator<<(std::ostream& out,sparse_mat<T>& sm)
 		return out;
 }
 
+//computes r = A*v on the row compressed form in parallel, pending entries of add_entry are ignored
 template <typename T>
 void Ax(const sparse_mat<T>& A, const vec<T>&v, vec<T>& r)
 {
 	assert(A._ncols == v.size());
-	r.zeros(A._nrows);
-	unsigned c;
-	for(c = 0; c < A._ncols;c++)
-		for(unsigned i = A._cols(c); i < A._cols(c+1);i++)
-			r(A._rows(i)) += A._data(i)*v(c);
-
-	
-};
+	r.resize(A._nrows);
+	if(A._nrows == 0)
+		return;
+	const unsigned* starts = A._row_starts.begin();
+	const unsigned* idx = A._row_cols.begin();
+	const T* data = A._row_data.begin();
+	const T* x = v.begin();
+	T* y = r.begin();
+	sparse_parallel_ranges(A._nrows, A._row_data.size(), [=](unsigned begin, unsigned end) {
+		for(unsigned i = begin; i < end; i++)
+			y[i] = sparse_dot(idx, data, starts[i], starts[i+1], x);
+	});
+}
 
 
+//computes r = A^T*v on the column compressed form in parallel, pending entries of add_entry are ignored
 template <typename T>
 void Atx(const sparse_mat<T>& A, const vec<T>&v, vec<T>& r)
 {
 	assert(A._nrows == v.size());
-	r.zeros(A._ncols);
-	unsigned c;
-	for(c = 0; c < A._ncols;c++)
-		for(unsigned i = A._cols(c); i < A._cols(c+1);i++)
-			r(c) += A._data(i)*v(A._rows(i));
-	
+	r.resize(A._ncols);
+	if(A._ncols == 0)
+		return;
+	const unsigned* starts = A._cols.begin();
+	const unsigned* idx = A._rows.begin();
+	const T* data = A._data.begin();
+	const T* x = v.begin();
+	T* y = r.begin();
+	sparse_parallel_ranges(A._ncols, A._data.size(), [=](unsigned begin, unsigned end) {
+		for(unsigned c = begin; c < end; c++)
+			y[c] = sparse_dot(idx, data, starts[c], starts[c+1], x);
+	});
 }
 
 template <typename T>
@@ -284,12 +462,12 @@ bool low_tri_solve(const sparse_mat<T>& L,const vec<T>& b, vec<T>& x)
 	for(unsigned j = 0; j < x.size(); j++)
 	{
 		//not lower triangular or singular
-		if(L._data(L.rows(L._cols(j))) != j )
+		if(L._cols(j) == L._cols(j+1) || L._rows(L._cols(j)) != j || L._data(L._cols(j)) == 0)
 			return false;
 
-		x(j) =x(j) / L._data(_cols(j));
+		x(j) =x(j) / L._data(L._cols(j));
 		for(unsigned i= L._cols(j)+1; i < L._cols(j+1);i++)
-			x(i) = x(i) - L._data(i)*x(j);
+			x(L._rows(i)) = x(L._rows(i)) - L._data(i)*x(j);
 		
 	}
 	return true;
@@ -35,26 +35,27 @@ struct c_slice_info
 {
 	unsigned resx, resy;
 	unsigned nr_vertices;
-	std::vector<bool> flags;
+	/// per voxel 1 if the predicate holds and 0 otherwise
+	std::vector<unsigned char> flags;
 	std::vector<int> indices;
 	///
 	c_slice_info(unsigned int _resx, unsigned int _resy) : resx(_resx), resy(_resy) {
 		unsigned int n = resx*resy;
-		flags.resize(n, false);
+		flags.resize(n, 0);
 		indices.resize(n, -1);
 		nr_vertices = 0;
 	}
 	///
 	void init() {
-		std::fill(flags.begin(), flags.end(), false);
+		std::fill(flags.begin(), flags.end(), (unsigned char)0);
 		std::fill(indices.begin(), indices.end(), -1);
 		nr_vertices = 0;
 	}
 	int linear_index(int x, int y) const { return y*resx + x; }
 	///
-	bool flag(int x, int y) const { return (x>=0) && (y>=0) && flags[linear_index(x, y)]; }
+	bool flag(int x, int y) const { return (x>=0) && (y>=0) && flags[linear_index(x, y)] != 0; }
 	///
-	void set_flag(int x, int y, bool flag) { flags[linear_index(x, y)] = flag; }
+	void set_flag(int x, int y, bool flag) { flags[linear_index(x, y)] = (unsigned char)flag; }
 	///
 	const int& index(int x, int y) const { return indices[linear_index(x, y)]; }
 	void set_index(int x, int y, int idx)		 { 
@@ -77,6 +78,8 @@ private:
 	pnt_type p, minp;
 	unsigned int resx, resy, resz;
 	vec_type d;
+	/// function values of the current row of voxels
+	std::vector<T> row_values;
 	const P& pred;
 protected:
 	const cgv::math::v3_func<X,T>& func;
@@ -104,10 +107,15 @@ public:
 		I[0]->init();
 		// iterate voxels of slice to create slice vertices
 		unsigned i, j;
+		X step[3] = { d(0), 0, 0 };
 		for (j = 0, p(1) = minp(1); j <= resy; ++j, p(1) += d(1)) {
+			// evaluate function on all voxels of the row at once
+			p(0) = minp(0);
+			if (j < resy)
+				func.evaluate_row(&p(0), step, resx, &row_values[0]);
 			for (i = 0, p(0) = minp(0); i <= resx; ++i, p(0) += d(0)) {
 				// set voxel flag
-				I[0]->set_flag(i, j, i < resx && j < resy && pred(func.evaluate(p.to_vec())));
+				I[0]->set_flag(i, j, i < resx && j < resy && pred(row_values[i]));
 				// and check whether assigned vertex is needed
 				bool need_vertex = false;
 				need_vertex = need_vertex || (I[0]->flag(i, j) != I[1]->flag(i, j));     // z(x0,y0)
@@ -155,6 +163,7 @@ public:
 		minp = p = box.get_min_pnt();
 		d = box.get_extent();
 		d(0) /= (resx-1); d(1) /= (resy-1); d(2) /= (resz-1);
+		row_values.resize(resx);
 
 		// prepare progression
 		cgv::utils::progression prog;
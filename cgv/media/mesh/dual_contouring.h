@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <deque>
+#include <cstring>
 #include <cgv/utils/progression.h>
 #include <cgv/math/qem.h>
 #include <cgv/math/mfunc.h>
@@ -27,7 +28,8 @@ struct dc_slice_info
 {
 	unsigned int resx, resy;
 	std::vector<T> values;
-	std::vector<bool> flags;
+	/// per sample 1 if value is above iso value and 0 otherwise
+	std::vector<unsigned char> signs;
 	std::vector<int> indices;
 	typedef cgv::math::qem<T> qem_type;
 	typedef cgv::math::fvec<T,3> pnt_type;
@@ -36,7 +38,7 @@ struct dc_slice_info
 	dc_slice_info(unsigned int _resx, unsigned int _resy) : resx(_resx), resy(_resy) {
 		unsigned int n = resx*resy;
 		values.resize(n);
-		flags.resize(n);
+		signs.resize(n);
 		indices.resize(n);
 		cell_infos.resize(n);
 	}
@@ -51,7 +53,9 @@ struct dc_slice_info
 		}
 	}
 	///
-	bool flag(int x, int y) const             { return flags[y*resx+x]; }
+	bool flag(int x, int y) const             { return signs[y*resx+x] != 0; }
+	/// check whether the signs of row y coincide with the ones in the same row of another slice
+	bool same_signs(const dc_slice_info<T>& other, int y) const { return memcmp(&signs[y*resx], &other.signs[y*resx], resx) == 0; }
 	///
 	const T& value(int x, int y) const        { return values[y*resx+x]; }
 	      T& value(int x, int y)              { return values[y*resx+x]; }
@@ -59,7 +63,7 @@ struct dc_slice_info
 	void set_value(int x, int y, T value, T iso_value) {
 		int i = y*resx+x;
 		values[i] = value;
-		flags[i] = value>iso_value;
+		signs[i] = (unsigned char)(value>iso_value);
 	}
 	///
 	const int& index(int x, int y) const { return indices[y*resx+x]; }
@@ -120,7 +124,7 @@ public:
 			return;
 		}
 		pnt_type p_ref = info_ptr->center(i,j) / X(info_ptr->count(i,j));
-		vec<X> min_pnt = info_ptr->get_qem(i, j).minarg(p_ref.to_vec(), X(0.1), d.length());
+		cgv::math::vec<X> min_pnt = info_ptr->get_qem(i, j).minarg(p_ref.to_vec(), X(0.1), d.length());
 		pnt_type q(min_pnt.size(), min_pnt);
 		info_ptr->index(i,j) = this->new_vertex(q);
 	}
@@ -157,7 +161,7 @@ public:
 
 			q(e) = p_end(e) - (1-alpha)*de;
 			// compute normal at point
-			vec<X> nml_vec = func.evaluate_gradient(q.to_vec());
+			cgv::math::vec<X> nml_vec = func.evaluate_gradient(q.to_vec());
 			n = vec_type(nml_vec.size(), nml_vec);
 			n.normalize();
 
@@ -218,10 +222,13 @@ public:
 	{
 		unsigned int i,j;
 		info_ptr->init();
-		for (j = 0, p(1) = minp(1); j < resy; ++j, p(1) += d(1))
+		X step[3] = { d(0), 0, 0 };
+		for (j = 0, p(1) = minp(1); j < resy; ++j, p(1) += d(1)) {
+			// eval function on row of slice with one call
+			p(0) = minp(0);
+			func.evaluate_row(&p(0), step, resx, &info_ptr->value(0,j));
 			for (i = 0, p(0) = minp(0); i < resx; ++i, p(0)+=d(0)) {
-				// eval function on slice
-				info_ptr->set_value(i,j,func.evaluate(p.to_vec()),iso_value);
+				info_ptr->set_value(i,j,info_ptr->value(i,j),iso_value);
 				// process slice internal edges
 				if (i > 0 && info_ptr->flag(i-1,j) != info_ptr->flag(i,j))
 					process_edge_plane(info_ptr->value(i-1,j),
@@ -238,6 +245,7 @@ public:
 											 prev_info_ptr ? &prev_info_ptr->info(i,j-1) : 0,
 											 (i > 0 && prev_info_ptr) ? &prev_info_ptr->info(i-1,j-1) : 0);
 			}
+		}
 	}
 	/// 
 	void process_slab(dc_slice_info<T> *info_ptr_1, dc_slice_info<T> *info_ptr_2)
@@ -258,7 +266,9 @@ public:
 					compute_cell_vertex(info_ptr_1, i-1,j-1);
 			}
 		// generate the quads of inner edges inside the slab
-		for (j = 1, p(1) = minp(1)+d(1); j < resy-1; ++j, p(1) += d(1))
+		for (j = 1, p(1) = minp(1)+d(1); j < resy-1; ++j, p(1) += d(1)) {
+			if (info_ptr_1->same_signs(*info_ptr_2, j))
+				continue;
 			for (i = 1, p(0) = minp(0)+d(0); i < resx-1; ++i, p(0)+=d(0))
 				if (info_ptr_1->flag(i,j) != info_ptr_2->flag(i,j))
 					generate_quad(info_ptr_1->index(i,j),
@@ -266,6 +276,7 @@ public:
 									  info_ptr_1->index(i-1,j-1),
 									  info_ptr_1->index(i,j-1),
 									  info_ptr_1->flag(i,j));
+		}
 	}
 	/// 
 	void generate_slice_quads(dc_slice_info<T> *info_ptr_1, dc_slice_info<T> *info_ptr_2)
@@ -2,7 +2,11 @@
 
 #include <vector>
 #include <deque>
+#include <cgv/os/thread_pool.h>
+#include <algorithm>
+#include <cstring>
 #include <cgv/utils/progression.h>
+#include <cgv/type/standard_types.h>
 #include <cgv/math/fvec.h>
 #include <cgv/math/mfunc.h>
 #include <cgv/media/axis_aligned_box.h>
@@ -18,34 +22,41 @@ extern CGV_API int get_nr_cube_triangles(int idx);
 extern CGV_API void put_cube_triangle(int idx, int t, int& vi, int& vj, int& vk);
 
 
-/** data structure for the information that is cached per volume slice */
+/** data structure for the information that is cached per volume slice. Corner signs are stored as one byte
+    per sample and classified per row in a loop the compiler vectorizes. After the slice is complete,
+	compute_codes() packs the four corner signs of each cell into a byte, such that the cube index of a cell
+	is composed of two byte reads and rows of empty cells can be skipped eight cells at a time. */
 template <typename T>
 struct slice_info
 {
 	unsigned int resx, resy;
 	std::vector<T> values;
-	std::vector<bool> flags;
+	/// per sample 1 if value is above iso value and 0 otherwise
+	std::vector<unsigned char> signs;
+	/// per cell the 4 bit code of the corner signs
+	std::vector<unsigned char> codes;
 	std::vector<int> indices;
 	///
 	slice_info(unsigned int _resx, unsigned int _resy) : resx(_resx), resy(_resy) {
 		unsigned int n = resx*resy;
 		values.resize(n);
-		flags.resize(n);
+		signs.resize(n);
+		codes.resize(n);
 		indices.resize(4 * n);
 	}
 	///
 	void init() {
-		int n = resx*resy;
-		for (int i = 0; i < 4 * n; ++i)
-			indices[i] = -1;
+		std::fill(indices.begin(), indices.end(), -1);
 	}
 	///
-	bool flag(int x, int y) const { return flags[y*resx + x]; }
+	bool flag(int x, int y) const { return signs[y*resx + x] != 0; }
 	///
 	int get_bit_code(int x, int y, int step = 1) const {
 		int i = y*resx + x;
-		return (flags[i] ? 1 : 0) + (flags[i + step] ? 2 : 0) +
-			(flags[i + step*(resx + 1)] ? 4 : 0) + (flags[i + step*resx] ? 8 : 0);
+		if (step == 1)
+			return codes[i];
+		return signs[i] + (signs[i + step] << 1) +
+			(signs[i + step*(resx + 1)] << 2) + (signs[i + step*resx] << 3);
 	}
 	///
 	const T& value(int x, int y) const { return values[y*resx + x]; }
@@ -54,7 +65,31 @@ struct slice_info
 	void set_value(int x, int y, T value, T iso_value) {
 		int i = y*resx + x;
 		values[i] = value;
-		flags[i] = value > iso_value;
+		signs[i] = (unsigned char)(value > iso_value);
+	}
+	/// compute signs of all values in row y
+	void classify_row(int y, T iso_value) {
+		const T* v = &values[y*resx];
+		unsigned char* s = &signs[y*resx];
+		for (unsigned int i = 0; i < resx; ++i)
+			s[i] = (unsigned char)(v[i] > iso_value);
+	}
+	/// compute the corner sign codes of all cells from the signs
+	void compute_codes() {
+		for (unsigned int y = 0; y + 1 < resy; ++y) {
+			const unsigned char* s0 = &signs[y*resx];
+			const unsigned char* s1 = s0 + resx;
+			unsigned char* c = &codes[y*resx];
+			for (unsigned int i = 0; i + 1 < resx; ++i)
+				c[i] = (unsigned char)(s0[i] | (s0[i + 1] << 1) | (s1[i + 1] << 2) | (s1[i] << 3));
+		}
+	}
+	/// compute the cube indices of the cells in row y between the previous slice and this slice
+	void compute_cube_row(const slice_info<T>& prev, int y, unsigned char* cube_row) const {
+		const unsigned char* c0 = &prev.codes[y*resx];
+		const unsigned char* c1 = &codes[y*resx];
+		for (unsigned int i = 0; i + 1 < resx; ++i)
+			cube_row[i] = (unsigned char)(c0[i] | (c1[i] << 4));
 	}
 	///
 	const int& index(int x, int y, int e) const { return indices[4 * (y*resx + x) + e]; }
@@ -78,17 +113,46 @@ private:
 	pnt_type p;
 	vec_type d;
 	T iso_value;
+	/// callback handler that records the output of one slab of a parallel extraction
+	struct slab_record : public streaming_mesh_callback_handler
+	{
+		/// streaming mesh of the slab used to read back vertex locations when they are created
+		const streaming_mesh<X>* sm;
+		/// locations of all vertices created by the slab
+		std::vector<pnt_type> locations;
+		/// vertex indices of triangles local to the slab
+		std::vector<unsigned int> triangles;
+		/// number of vertices and triangles created per slice
+		std::vector<unsigned int> nr_slice_vertices, nr_slice_triangles;
+		/// number of vertices created to reconstruct the slice before the slab, which are owned by the previous slab
+		unsigned int nr_ghost_vertices;
+		/// vertex indices of the reconstructed slice before the slab and of the last slice of the slab
+		std::vector<int> ghost_indices, boundary_indices;
+		slab_record() : sm(0), nr_ghost_vertices(0) {}
+		void new_vertex(unsigned int vi) { locations.push_back(sm->vertex_location(vi)); }
+		void new_polygon(const std::vector<unsigned int>& vis) { triangles.insert(triangles.end(), vis.begin(), vis.end()); }
+		void before_drop_vertex(unsigned int) {}
+	};
 protected:
 	X epsilon;
 	X grid_epsilon;
+	/// number of threads used for extraction, 1 selects serial extraction and 0 the concurrency of the global thread pool
+	unsigned int nr_threads;
 public:
 	/// construct marching cubes object
-	marching_cubes_base(streaming_mesh_callback_handler* _smcbh, 
-				   const X& _grid_epsilon = 0.01f, 
-				   const X& _epsilon = 1e-6f) : epsilon(_epsilon), grid_epsilon(_grid_epsilon)
+	marching_cubes_base(streaming_mesh_callback_handler* _smcbh,
+				   const X& _grid_epsilon = 0.01f,
+				   const X& _epsilon = 1e-6f) : epsilon(_epsilon), grid_epsilon(_grid_epsilon), nr_threads(1)
 	{
 		base_type::set_callback_handler(_smcbh);
 	}
+	/** set the number of threads used in extract_impl. With more than one thread, the z-range is split into slabs
+	    that are extracted concurrently in the global cgv::os::thread_pool and stitched afterwards, such that the callback handler receives exactly
+		the same calls as in serial extraction. The evaluation function must be thread-safe in this case. Pass 0
+		to use all threads of the pool. */
+	void set_nr_threads(unsigned int _nr_threads) { nr_threads = _nr_threads; }
+	/// return the number of threads used in extraction
+	unsigned int get_nr_threads() const { return nr_threads; }
 	/// construct a new vertex on an edge
 	void construct_vertex(slice_info<T> *info_ptr_1, int i_1, int j_1, int e,
 		slice_info<T> *info_ptr_2, int i_2, int j_2)
@@ -124,7 +188,219 @@ public:
 		info_ptr_1->index(i_1, j_1, e) = vi;
 		this->new_vertex(q);
 	}
+protected:
+	/// evaluate a row of samples with one call to eval.evaluate_row if the evaluator provides this method
+	template <typename Eval>
+	static auto eval_row(const Eval& eval, unsigned int j, unsigned int k, const pnt_type& p0, const X& dx, unsigned int n, T* values, int)
+		-> decltype(eval.evaluate_row(j, k, p0, dx, n, values), void())
+	{
+		eval.evaluate_row(j, k, p0, dx, n, values);
+	}
+	/// evaluate a row of samples one by one
+	template <typename Eval>
+	static void eval_row(const Eval& eval, unsigned int j, unsigned int k, const pnt_type& p0, const X& dx, unsigned int n, T* values, long)
+	{
+		pnt_type q = p0;
+		for (unsigned int i = 0; i < n; ++i, q(0) += dx)
+			values[i] = eval(i, j, k, q);
+	}
+	/// evaluate function on slice k, whose z-coordinate must be set in p, and construct vertices on edges inside of the slice
+	template <typename Eval, typename Valid>
+	void construct_slice(slice_info<T> *info_ptr, unsigned int k, const axis_aligned_box<X, 3>& box,
+		unsigned int resx, unsigned int resy, const Eval& eval, const Valid& valid)
+	{
+		unsigned int i, j;
+		info_ptr->init();
+		for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1)) {
+			// evaluate the row and classify all its samples at once
+			p(0) = box.get_min_pnt()(0);
+			eval_row(eval, j, k, p, d(0), resx, &info_ptr->value(0, j), 0);
+			info_ptr->classify_row(j, iso_value);
+			// construct vertices on edges ending in the row
+			for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0)) {
+				if (!valid(info_ptr->value(i, j)))
+					continue;
+				if (i > 0 && info_ptr->flag(i - 1, j) != info_ptr->flag(i, j) && valid(info_ptr->value(i - 1, j)))
+					construct_vertex(info_ptr, i - 1, j, 0, info_ptr, i, j);
+				if (j > 0 && info_ptr->flag(i, j - 1) != info_ptr->flag(i, j) && valid(info_ptr->value(i, j - 1)))
+					construct_vertex(info_ptr, i, j - 1, 1, info_ptr, i, j);
+			}
+		}
+		info_ptr->compute_codes();
+	}
+	/// construct vertices on edges between previous and new slice
+	template <typename Valid>
+	void construct_slice_connection(slice_info<T> *prev_info_ptr, slice_info<T> *info_ptr, const axis_aligned_box<X, 3>& box,
+		unsigned int resx, unsigned int resy, const Valid& valid)
+	{
+		unsigned int i, j;
+		for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1)) {
+			// skip rows without sign changes
+			if (memcmp(&prev_info_ptr->signs[j*resx], &info_ptr->signs[j*resx], resx) == 0)
+				continue;
+			for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0))
+				if (prev_info_ptr->flag(i, j) != info_ptr->flag(i, j) && valid(prev_info_ptr->value(i, j)) && valid(info_ptr->value(i, j)))
+					construct_vertex(prev_info_ptr, i, j, 2, info_ptr, i, j);
+		}
+	}
+	/// construct triangles in the cubes between previous and new slice
+	void construct_triangles(slice_info<T> *prev_info_ptr, slice_info<T> *info_ptr, unsigned int resx, unsigned int resy)
+	{
+		unsigned int i, j;
+		// cube indices of one row padded with empty cubes to a multiple of eight
+		std::vector<unsigned char> cube_row(resx + 7, 0);
+		for (j = 0; j < resy - 1; ++j) {
+			info_ptr->compute_cube_row(*prev_info_ptr, j, &cube_row.front());
+			for (i = 0; i < resx - 1; ++i) {
+				// skip eight empty cubes at once
+				cgv::type::uint64_type cubes;
+				memcpy(&cubes, &cube_row[i], 8);
+				if (cubes == 0 || cubes == ~cgv::type::uint64_type(0)) {
+					i += 7;
+					continue;
+				}
+				// compute the bit index for the current cube
+				int idx = cube_row[i];
+				// skip empty cubes
+				if (idx == 0 || idx == 255)
+					continue;
+				// set edge vertices
+				int vis[12] = {
+					prev_info_ptr->index(i, j, 0),
+					prev_info_ptr->index(i + 1, j, 1),
+					prev_info_ptr->index(i, j + 1, 0),
+					prev_info_ptr->index(i, j, 1),
+					info_ptr->index(i, j, 0),
+					info_ptr->index(i + 1, j, 1),
+					info_ptr->index(i, j + 1, 0),
+					info_ptr->index(i, j, 1),
+					prev_info_ptr->index(i, j, 2),
+					prev_info_ptr->index(i + 1, j, 2),
+					prev_info_ptr->index(i, j + 1, 2),
+					prev_info_ptr->index(i + 1, j + 1, 2)
+				};
+				// lookup triangles and construct them
+				int n = get_nr_cube_triangles(idx);
+				for (int t = 0; t < n; ++t) {
+					int vi, vj, vk;
+					put_cube_triangle(idx, t, vi, vj, vk);
+					vi = vis[vi];
+					vj = vis[vj];
+					vk = vis[vk];
+					if (vi == -1 || vj == -1 || vk == -1)
+						continue;
+					if ((vi != vj) && (vi != vk) && (vj != vk))
+						base_type::new_triangle(vk, vj, vi);
+				}
+			}
+		}
+	}
+	/// return z-coordinate of slice k accumulated in the same way as in serial extraction
+	X slice_z(const axis_aligned_box<X, 3>& box, unsigned int k) const
+	{
+		X z = box.get_min_pnt()(2);
+		for (unsigned int l = 0; l < k; ++l)
+			z += d(2);
+		return z;
+	}
+	/** extract slices [k_begin,k_end) into a private streaming mesh and record the result. The slice before the
+	    slab is reconstructed from the two preceding slices such that its vertex indices can be mapped to the
+		vertices of the previous slab by slice position. As vertex locations are recorded on creation, the private
+		streaming mesh drops all its vertices after each slice. */
+	template <typename Eval, typename Valid>
+	void extract_slab(slab_record& rec, const axis_aligned_box<X, 3>& box,
+		unsigned int resx, unsigned int resy, unsigned int k_begin, unsigned int k_end,
+		const Eval& eval, const Valid& valid) const
+	{
+		marching_cubes_base<X, T> mc(&rec, grid_epsilon, epsilon);
+		rec.sm = &mc;
+		mc.p = p;
+		mc.d = d;
+		mc.iso_value = iso_value;
+		slice_info<T> slice_info_1(resx, resy), slice_info_2(resx, resy);
+		slice_info<T> *slice_info_ptrs[2] = { &slice_info_1, &slice_info_2 };
+		unsigned int k;
+		if (k_begin > 0) {
+			k = k_begin - 1;
+			if (k > 0) {
+				mc.p(2) = slice_z(box, k - 1);
+				mc.construct_slice(slice_info_ptrs[(k - 1) & 1], k - 1, box, resx, resy, eval, valid);
+			}
+			mc.p(2) = slice_z(box, k);
+			mc.construct_slice(slice_info_ptrs[k & 1], k, box, resx, resy, eval, valid);
+			if (k > 0)
+				mc.construct_slice_connection(slice_info_ptrs[(k - 1) & 1], slice_info_ptrs[k & 1], box, resx, resy, valid);
+			rec.nr_ghost_vertices = mc.get_nr_vertices();
+			rec.ghost_indices = slice_info_ptrs[k & 1]->indices;
+			mc.drop_vertices(mc.get_nr_vertices() - mc.get_nr_dropped_vertices());
+		}
+		for (k = k_begin, mc.p(2) = slice_z(box, k_begin); k < k_end; ++k, mc.p(2) += d(2)) {
+			unsigned int n = mc.get_nr_vertices();
+			size_t t = rec.triangles.size();
+			slice_info<T> *info_ptr = slice_info_ptrs[k & 1];
+			mc.construct_slice(info_ptr, k, box, resx, resy, eval, valid);
+			if (k != 0) {
+				slice_info<T> *prev_info_ptr = slice_info_ptrs[1 - (k & 1)];
+				mc.construct_slice_connection(prev_info_ptr, info_ptr, box, resx, resy, valid);
+				mc.construct_triangles(prev_info_ptr, info_ptr, resx, resy);
+			}
+			rec.nr_slice_vertices.push_back(mc.get_nr_vertices() - n);
+			rec.nr_slice_triangles.push_back(unsigned((rec.triangles.size() - t) / 3));
+			mc.drop_vertices(mc.get_nr_vertices() - mc.get_nr_dropped_vertices());
+		}
+		rec.boundary_indices = slice_info_ptrs[(k_end - 1) & 1]->indices;
+	}
+	/// extract slabs concurrently and replay their output in serial order
+	template <typename Eval, typename Valid>
+	void extract_slabs(const axis_aligned_box<X, 3>& box,
+		unsigned int resx, unsigned int resy, unsigned int resz, unsigned int nr_slabs,
+		const Eval& eval, const Valid& valid, cgv::utils::progression* prog_ptr)
+	{
+		std::vector<unsigned int> K(nr_slabs + 1);
+		for (unsigned int s = 0; s <= nr_slabs; ++s)
+			K[s] = unsigned(size_t(resz)*s / nr_slabs);
+		std::vector<slab_record> records(nr_slabs);
+		cgv::os::parallel_for(0u, nr_slabs, 1u, [&](unsigned int s) {
+			extract_slab(records[s], box, resx, resy, K[s], K[s + 1], eval, valid);
+		});
 
+		// replay slabs in order, mapping vertex indices local to slabs to global ones
+		std::vector<unsigned int> prev_boundary, global;
+		unsigned int nr_vertices[3] = { 0, 0, 0 };
+		for (unsigned int s = 0; s < nr_slabs; ++s) {
+			slab_record& rec = records[s];
+			global.resize(rec.locations.size());
+			// ghost vertices are identified by their position in the reconstructed slice
+			for (size_t l = 0; l < rec.ghost_indices.size(); ++l) {
+				int vi = rec.ghost_indices[l];
+				if (vi != -1 && unsigned(vi) < rec.nr_ghost_vertices)
+					global[vi] = prev_boundary[l];
+			}
+			unsigned int vi = rec.nr_ghost_vertices;
+			const unsigned int* tri = rec.triangles.empty() ? 0 : &rec.triangles.front();
+			for (unsigned int k = K[s]; k < K[s + 1]; ++k) {
+				unsigned int n = base_type::get_nr_vertices();
+				for (unsigned int l = 0; l < rec.nr_slice_vertices[k - K[s]]; ++l, ++vi)
+					global[vi] = base_type::new_vertex(rec.locations[vi]);
+				for (unsigned int l = 0; l < rec.nr_slice_triangles[k - K[s]]; ++l, tri += 3)
+					base_type::new_triangle(global[tri[0]], global[tri[1]], global[tri[2]]);
+				if (prog_ptr)
+					prog_ptr->step();
+				n = base_type::get_nr_vertices() - n;
+				nr_vertices[k % 3] = n;
+				n = nr_vertices[(k + 2) % 3];
+				if (n > 0)
+					base_type::drop_vertices(n);
+			}
+			// keep global indices of the last slice for the next slab and release the stitched slab
+			prev_boundary.assign(rec.boundary_indices.size(), 0);
+			for (size_t l = 0; l < rec.boundary_indices.size(); ++l)
+				if (rec.boundary_indices[l] != -1)
+					prev_boundary[l] = global[rec.boundary_indices[l]];
+			rec = slab_record();
+		}
+	}
+public:
 	/// extract iso surface and send triangles to marching cubes handler
 	template <typename Eval, typename Valid>
 	void extract_impl(const T& _iso_value,
@@ -142,29 +418,26 @@ public:
 		cgv::utils::progression prog;
 		if (show_progress) prog.init("extraction", resz, 10);
 
+		// split z-range into slabs if more than one thread is used, each slab should contain several slices
+		unsigned int nr_slabs = nr_threads == 0 ? cgv::os::thread_pool::get_global().get_concurrency() : nr_threads;
+		nr_slabs = std::min(nr_slabs, resz / 4);
+		if (nr_slabs > 1) {
+			extract_slabs(box, resx, resy, resz, nr_slabs, eval, valid, show_progress ? &prog : 0);
+			return;
+		}
+
 		// construct two slice infos
 		slice_info<T> slice_info_1(resx, resy), slice_info_2(resx, resy);
 		slice_info<T> *slice_info_ptrs[2] = { &slice_info_1, &slice_info_2 };
 
 		// iterate through all slices
 		unsigned int nr_vertices[3] = { 0, 0, 0 };
-		unsigned int i, j, k, n;
+		unsigned int k, n;
 		for (k = 0; k < resz; ++k, p(2) += d(2)) {
 			n = (int)base_type::get_nr_vertices();
 			// evaluate function on next slice and construct slice interior vertices
 			slice_info<T> *info_ptr = slice_info_ptrs[k & 1];
-			info_ptr->init();
-			for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1))
-				for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0)) {
-				T v = eval(i, j, k, p);
-				info_ptr->set_value(i, j, v, iso_value);
-				if (valid(v)) {
-					if (i > 0 && info_ptr->flag(i - 1, j) != info_ptr->flag(i, j) && valid(info_ptr->value(i - 1, j)))
-						construct_vertex(info_ptr, i - 1, j, 0, info_ptr, i, j);
-					if (j > 0 && info_ptr->flag(i, j - 1) != info_ptr->flag(i, j) && valid(info_ptr->value(i, j - 1)))
-						construct_vertex(info_ptr, i, j - 1, 1, info_ptr, i, j);
-				}
-				}
+			construct_slice(info_ptr, k, box, resx, resy, eval, valid);
 			// show progression
 			if (show_progress)
 				prog.step();
@@ -173,50 +446,9 @@ public:
 				// get info of previous slice
 				slice_info<T> *prev_info_ptr = slice_info_ptrs[1 - (k & 1)];
 				// construct vertices on edges between previous and new slice
-				for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1))
-					for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0))
-						if (prev_info_ptr->flag(i, j) != info_ptr->flag(i, j) && valid(prev_info_ptr->value(i, j)) && valid(info_ptr->value(i, j)))
-							construct_vertex(prev_info_ptr, i, j, 2, info_ptr, i, j);
-
+				construct_slice_connection(prev_info_ptr, info_ptr, box, resx, resy, valid);
 				// construct triangles
-				for (j = 0; j < resy - 1; ++j) {
-					for (i = 0; i < resx - 1; ++i) {
-						// compute the bit index for the current cube
-						int idx = prev_info_ptr->get_bit_code(i, j) +
-							16 * info_ptr->get_bit_code(i, j);
-						// skip empty cubes
-						if (idx == 0 || idx == 255)
-							continue;
-						// set edge vertices
-						int vis[12] = {
-							prev_info_ptr->index(i, j, 0),
-							prev_info_ptr->index(i + 1, j, 1),
-							prev_info_ptr->index(i, j + 1, 0),
-							prev_info_ptr->index(i, j, 1),
-							info_ptr->index(i, j, 0),
-							info_ptr->index(i + 1, j, 1),
-							info_ptr->index(i, j + 1, 0),
-							info_ptr->index(i, j, 1),
-							prev_info_ptr->index(i, j, 2),
-							prev_info_ptr->index(i + 1, j, 2),
-							prev_info_ptr->index(i, j + 1, 2),
-							prev_info_ptr->index(i + 1, j + 1, 2)
-						};
-						// lookup triangles and construct them
-						int n = get_nr_cube_triangles(idx);
-						for (int t = 0; t < n; ++t) {
-							int vi, vj, vk;
-							put_cube_triangle(idx, t, vi, vj, vk);
-							vi = vis[vi];
-							vj = vis[vj];
-							vk = vis[vk];
-							if (vi == -1 || vj == -1 || vk == -1)
-								continue;
-							if ((vi != vj) && (vi != vk) && (vj != vk))
-								base_type::new_triangle(vk, vj, vi);
-						}
-					}
-				}
+				construct_triangles(prev_info_ptr, info_ptr, resx, resy);
 			}
 			n = (int)base_type::get_nr_vertices() - n;
 			nr_vertices[k % 3] = n;
@@ -271,6 +503,11 @@ public:
 	T operator () (unsigned i, unsigned j, unsigned k, const pnt_type& p) const {
 		return func.evaluate(p.to_vec());
 	}
+	/// evaluate a row along the x-axis with one virtual call
+	void evaluate_row(unsigned j, unsigned k, const pnt_type& p, const X& dx, unsigned n, T* values) const {
+		X step[3] = { dx, 0, 0 };
+		func.evaluate_row(&p(0), step, n, values);
+	}
 	void extract(const T& _iso_value,
 		const axis_aligned_box<X, 3>& box,
 		unsigned int resx, unsigned int resy, unsigned int resz,
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <cgv/math/fvec.h>
+#include <cgv/math/mfunc.h>
+#include <cgv/media/axis_aligned_box.h>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** wrapper of a trivariate function that restricts the evaluation on a regular sampling grid to a narrow band
+    around the iso surface. The grid is partitioned into cubic blocks of samples. build() classifies the blocks
+	hierarchically from coarse to fine: a region of blocks is skipped if bounds of the function over the region
+	dilated by one sample spacing show that the function does not cross the iso value, and is split into octants
+	otherwise. Bounds are taken from evaluate_bounds() of the wrapped function or, if this is not available, from
+	a Lipschitz constant and the value at the region center.
+
+	Rows of grid samples passed to evaluate_row() are only evaluated in blocks of the narrow band. Samples of
+	skipped blocks get a value with the correct sign. Due to the dilation no edge between samples with different
+	signs touches a skipped sample, such that marching cubes, dual contouring and cuberille produce the same mesh
+	as with the wrapped function. All other methods forward to the wrapped function. */
+template <typename X, typename T>
+class narrow_band_func : public cgv::math::v3_func<X,T>
+{
+public:
+	typedef typename cgv::math::mfunc<X,T>::pnt_type pnt_type;
+	typedef typename cgv::math::mfunc<X,T>::vec_type vec_type;
+	typedef cgv::math::fvec<X,3> fpnt_type;
+	/// classification of blocks
+	enum BlockState { BS_NARROW_BAND, BS_ABOVE, BS_BELOW };
+protected:
+	/// wrapped function
+	const cgv::math::v3_func<X,T>& func;
+	/// Lipschitz constant of the wrapped function used if it does not provide bounds, 0 if unknown
+	X lipschitz_constant;
+	/// number of samples per block along each axis
+	unsigned block_size;
+	/// iso value of the last build
+	T iso_value;
+	/// grid origin and sample spacing of the last build
+	fpnt_type minp, d;
+	/// number of samples along each axis covered by blocks
+	unsigned res[3];
+	/// number of blocks along each axis
+	unsigned nr_blocks[3];
+	/// per block one BlockState
+	std::vector<unsigned char> block_states;
+	/// per block a value with the sign of the block used for the samples of skipped blocks
+	std::vector<T> block_values;
+	/// number of bound computations in the last build
+	size_t nr_bound_evaluations;
+	/// number of blocks in the narrow band
+	size_t nr_narrow_band_blocks;
+	/// number of grid samples evaluated since the last build
+	mutable std::atomic<size_t> nr_sample_evaluations;
+	/// compute index of the block containing sample index i along axis c or -1 if the sample is not covered
+	int block_coordinate(long i, int c) const {
+		return (i < 0 || i >= long(res[c])) ? -1 : int(i / block_size);
+	}
+	/// return the end of the range of samples starting with the i-th of n samples of a row starting at grid index i0 that lie in the same block or outside of the blocks
+	unsigned block_end(long i0, unsigned i, unsigned n) const {
+		long si = i0 + long(i);
+		long end = si < 0 ? 0 : (si >= long(res[0]) ? i0 + long(n) : (si / block_size + 1)*block_size);
+		return unsigned(std::min(long(n), end - i0));
+	}
+	/// return the grid index of coordinate x along axis c
+	long sample_index(X x, int c) const {
+		return long(std::floor((x - minp(c)) / d(c) + X(0.5)));
+	}
+	/// compute bounds over the given box and return whether the function does not cross the iso value inside
+	bool is_outside_band(const fpnt_type& p0, const fpnt_type& p1, unsigned char& state, T& value)
+	{
+		T lower, upper;
+		if (func.evaluate_bounds(&p0(0), &p1(0), lower, upper)) {
+			++nr_bound_evaluations;
+			if (lower > iso_value) {
+				state = BS_ABOVE;
+				value = lower;
+				return true;
+			}
+			if (upper <= iso_value) {
+				state = BS_BELOW;
+				value = upper;
+				return true;
+			}
+			return false;
+		}
+		if (lipschitz_constant <= 0)
+			return false;
+		++nr_bound_evaluations;
+		fpnt_type c = X(0.5)*(p0 + p1);
+		T v = func.evaluate(c.to_vec());
+		T r = T(lipschitz_constant*X(0.5)*(p1 - p0).length());
+		if (v - r > iso_value) {
+			state = BS_ABOVE;
+			value = v;
+			return true;
+		}
+		if (v + r <= iso_value) {
+			state = BS_BELOW;
+			value = v;
+			return true;
+		}
+		return false;
+	}
+	/// classify the region of blocks [b0,b1) recursively
+	void classify(const unsigned* b0, const unsigned* b1)
+	{
+		// compute region of samples dilated by one sample spacing
+		fpnt_type p0, p1;
+		for (int c = 0; c < 3; ++c) {
+			p0(c) = minp(c) + (X(b0[c]*block_size) - 1)*d(c);
+			p1(c) = minp(c) + X(std::min(b1[c]*block_size, res[c]))*d(c);
+		}
+		unsigned char state;
+		T value;
+		if (is_outside_band(p0, p1, state, value)) {
+			for (unsigned k = b0[2]; k < b1[2]; ++k)
+				for (unsigned j = b0[1]; j < b1[1]; ++j)
+					for (unsigned i = b0[0]; i < b1[0]; ++i) {
+						size_t bi = (size_t(k)*nr_blocks[1] + j)*nr_blocks[0] + i;
+						block_states[bi] = state;
+						block_values[bi] = value;
+					}
+			return;
+		}
+		// split region into up to eight octants
+		unsigned m[3];
+		bool is_single_block = true;
+		for (int c = 0; c < 3; ++c) {
+			m[c] = b0[c] + (b1[c] - b0[c] + 1) / 2;
+			if (b1[c] - b0[c] > 1)
+				is_single_block = false;
+		}
+		if (is_single_block) {
+			++nr_narrow_band_blocks;
+			return;
+		}
+		for (int o = 0; o < 8; ++o) {
+			unsigned c0[3], c1[3];
+			bool empty = false;
+			for (int c = 0; c < 3; ++c) {
+				c0[c] = (o & (1 << c)) ? m[c] : b0[c];
+				c1[c] = (o & (1 << c)) ? b1[c] : m[c];
+				if (c0[c] >= c1[c])
+					empty = true;
+			}
+			if (!empty)
+				classify(c0, c1);
+		}
+	}
+public:
+	/// construct from function to be wrapped, Lipschitz constant (0 if unknown) and number of samples per block along each axis
+	narrow_band_func(const cgv::math::v3_func<X,T>& _func, X _lipschitz_constant = 0, unsigned _block_size = 8) :
+		func(_func), lipschitz_constant(_lipschitz_constant), block_size(std::max(1u, _block_size)), iso_value(0),
+		nr_bound_evaluations(0), nr_narrow_band_blocks(0), nr_sample_evaluations(0)
+	{
+		res[0] = res[1] = res[2] = 0;
+		nr_blocks[0] = nr_blocks[1] = nr_blocks[2] = 0;
+	}
+	/// set the Lipschitz constant of the wrapped function, which is used if it does not provide bounds
+	void set_lipschitz_constant(X _lipschitz_constant) { lipschitz_constant = _lipschitz_constant; }
+	/// return the Lipschitz constant
+	X get_lipschitz_constant() const { return lipschitz_constant; }
+	/// set the number of samples per block along each axis
+	void set_block_size(unsigned _block_size) { block_size = std::max(1u, _block_size); }
+	/// return the number of samples per block along each axis
+	unsigned get_block_size() const { return block_size; }
+	/** classify the blocks of the grid with resx x resy x resz samples in the given box for the given iso value.
+	    Samples with index resx, resy or resz that are evaluated by cuberille are covered as well. */
+	void build(const T& _iso_value, const axis_aligned_box<X,3>& box, unsigned resx, unsigned resy, unsigned resz)
+	{
+		iso_value = _iso_value;
+		minp = box.get_min_pnt();
+		d = box.get_extent();
+		d(0) /= (resx - 1); d(1) /= (resy - 1); d(2) /= (resz - 1);
+		res[0] = resx + 1; res[1] = resy + 1; res[2] = resz + 1;
+		for (int c = 0; c < 3; ++c)
+			nr_blocks[c] = (res[c] + block_size - 1) / block_size;
+		size_t n = size_t(nr_blocks[0])*nr_blocks[1]*nr_blocks[2];
+		block_states.assign(n, BS_NARROW_BAND);
+		block_values.assign(n, iso_value);
+		nr_bound_evaluations = 0;
+		nr_narrow_band_blocks = 0;
+		nr_sample_evaluations = 0;
+		unsigned b0[3] = { 0, 0, 0 };
+		classify(b0, nr_blocks);
+	}
+	/// return the number of blocks along axis c
+	unsigned get_nr_blocks(int c) const { return nr_blocks[c]; }
+	/// return the number of blocks in the narrow band
+	size_t get_nr_narrow_band_blocks() const { return nr_narrow_band_blocks; }
+	/// return the state of the block with the given block coordinates
+	BlockState get_block_state(unsigned i, unsigned j, unsigned k) const {
+		return BlockState(block_states[(size_t(k)*nr_blocks[1] + j)*nr_blocks[0] + i]);
+	}
+	/// return the number of bound computations in the last build
+	size_t get_nr_bound_evaluations() const { return nr_bound_evaluations; }
+	/// return the number of grid samples evaluated with the wrapped function since the last build
+	size_t get_nr_sample_evaluations() const { return nr_sample_evaluations; }
+	/// forward to wrapped function
+	T evaluate(const pnt_type& p) const { return func.evaluate(p); }
+	/// forward to wrapped function
+	vec_type evaluate_gradient(const pnt_type& p) const { return func.evaluate_gradient(p); }
+	/// forward to wrapped function
+	bool evaluate_bounds(const X* min_pnt, const X* max_pnt, T& lower, T& upper) const { return func.evaluate_bounds(min_pnt, max_pnt, lower, upper); }
+	/// forward to wrapped function
+	void evaluate_batch(const X* points, unsigned n, T* values) const { func.evaluate_batch(points, n, values); }
+	/// forward to wrapped function
+	void evaluate_gradient_batch(const X* points, unsigned n, X* gradients) const { func.evaluate_gradient_batch(points, n, gradients); }
+	/** evaluate rows along the x-axis of the grid of the last build only in blocks of the narrow band, other rows are
+	    forwarded to the wrapped function. Sample coordinates are accumulated in the same way as in the wrapped
+		function, such that evaluated samples get identical values. */
+	void evaluate_row(const X* p0, const X* step, unsigned n, T* values) const
+	{
+		int by = -1, bz = -1;
+		long i0 = 0;
+		if (step[1] == 0 && step[2] == 0 && !block_states.empty()) {
+			by = block_coordinate(sample_index(p0[1], 1), 1);
+			bz = block_coordinate(sample_index(p0[2], 2), 2);
+			i0 = sample_index(p0[0], 0);
+		}
+		if (by == -1 || bz == -1) {
+			func.evaluate_row(p0, step, n, values);
+			nr_sample_evaluations += n;
+			return;
+		}
+		const unsigned char* states = &block_states[(size_t(bz)*nr_blocks[1] + by)*nr_blocks[0]];
+		const T* block_vals = &block_values[(size_t(bz)*nr_blocks[1] + by)*nr_blocks[0]];
+		X q[3] = { p0[0], p0[1], p0[2] };
+		unsigned i = 0;
+		while (i < n) {
+			// determine range [i,e) of samples in the same block
+			int bx = block_coordinate(i0 + long(i), 0);
+			unsigned e = block_end(i0, i, n);
+			if (bx != -1 && states[bx] != BS_NARROW_BAND)
+				std::fill(values + i, values + e, block_vals[bx]);
+			else {
+				// extend range over following narrow band blocks
+				while (e < n) {
+					bx = block_coordinate(i0 + long(e), 0);
+					if (bx != -1 && states[bx] != BS_NARROW_BAND)
+						break;
+					e = block_end(i0, e, n);
+				}
+				func.evaluate_row(q, step, e - i, values + i);
+				nr_sample_evaluations += e - i;
+			}
+			for (; i < e; ++i)
+				q[0] += step[0];
+		}
+	}
+};
+
+		}
+	}
+}
@@ -1,6 +1,9 @@
 #include "obj_loader.h"
 #include <cgv/utils/file.h>
 #include <cgv/type/standard_types.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 
 using namespace cgv::utils::file;
 using namespace cgv::type;
@@ -104,26 +107,117 @@ const char* get_bin_extension<float>()
 	return  ".bin_objf";
 }
 
+/// sections of the binary cache of an obj file
+enum ObjCacheSection {
+	OCS_VERTICES, OCS_NORMALS, OCS_TEXCOORDS, OCS_COLORS,
+	OCS_VERTEX_INDICES, OCS_NORMAL_INDICES, OCS_TEXCOORD_INDICES, OCS_FACES,
+	OCS_GROUPS, OCS_MTL_LIBS, OCS_COUNT
+};
+
+/// header of the binary cache of an obj file, which is followed by the sections in the order of ObjCacheSection
+struct obj_cache_header
+{
+	/// magic characters "CGVOBJ" followed by two zeros
+	char magic[8];
+	/// version of the cache format
+	uint32_type version;
+	/// size of a coordinate, used to reject caches written for another coordinate type
+	uint32_type coordinate_size;
+	/// size of color_type and face_info, used to reject caches written with other memory layouts
+	uint32_type color_size, face_info_size;
+	/// size and last write time of the obj file from which the cache was written
+	uint64_type obj_file_size;
+	int64_type obj_file_write_time;
+	/// per section the number of elements, which is the number of groups and material libraries for the string sections
+	uint64_type section_sizes[OCS_COUNT];
+	/// per section the byte offset, which is a multiple of obj_cache_alignment
+	uint64_type section_offsets[OCS_COUNT];
+	/// whether a default material was created while reading the obj file
+	uint32_type have_default_material;
+	/// zero padding
+	uint32_type padding;
+};
+
+/// alignment of the sections in the binary cache
+const uint64_type obj_cache_alignment = 64;
+
+/// version of the binary cache format
+const uint32_type obj_cache_version = 2;
+
+/// round offset up to a multiple of the section alignment
+inline uint64_type align_obj_cache_offset(uint64_type offset)
+{
+	return (offset + obj_cache_alignment - 1) & ~(obj_cache_alignment - 1);
+}
+
+/// reference a section of the mapping in place or copy it if this is not possible
+template <typename X>
+void map_obj_cache_section(cgv::data::mapped_vector<X>& V, const cgv::data::mapped_file_ptr& mapping, const obj_cache_header& header, int section)
+{
+	size_t offset = size_t(header.section_offsets[section]), n = size_t(header.section_sizes[section]);
+	if (n == 0 || !V.map(mapping, offset, n)) {
+		V.resize(n);
+		if (n > 0)
+			memcpy(reinterpret_cast<char*>(V.data()), mapping->get_data() + offset, n*sizeof(X));
+	}
+}
+
+/// read count strings with 16 bit length from the string section of the mapping and return false if the section ends before
+bool read_obj_cache_strings(const cgv::data::mapped_file_ptr& mapping, const obj_cache_header& header, int section, size_t count, std::vector<std::string>& strings)
+{
+	const char* ptr = mapping->get_data() + header.section_offsets[section];
+	const char* end = mapping->get_data() + mapping->get_size();
+	for (size_t i = 0; i < count; ++i) {
+		uint16_type length;
+		if (end - ptr < (std::ptrdiff_t)sizeof(uint16_type))
+			return false;
+		memcpy(&length, ptr, sizeof(uint16_type));
+		ptr += sizeof(uint16_type);
+		if (end - ptr < (std::ptrdiff_t)length)
+			return false;
+		strings.push_back(std::string(ptr, length));
+		ptr += length;
+	}
+	return true;
+}
+
+/// return number of bytes written by write_string_bin, which truncates strings to 16 bit length
+inline uint64_type obj_cache_string_size(const std::string& s)
+{
+	return sizeof(uint16_type) + std::min(s.size(), size_t(0xFFFF));
+}
+
+/// write zeros until the file position reaches the given offset
+bool write_obj_cache_padding(FILE* fp, uint64_type& position, uint64_type offset)
+{
+	static const char zeros[obj_cache_alignment] = { 0 };
+	size_t n = size_t(offset - position);
+	position = offset;
+	return n == 0 || fwrite(zeros, 1, n, fp) == n;
+}
+
 /// overloads reading to support binary file format
 template <typename T>
 bool obj_loader_generic<T>::read_obj(const std::string& file_name)
 {
 	// check if binary file exists
 	std::string bin_fn = drop_extension(file_name) + get_bin_extension<T>();
-	if (exists(bin_fn) &&
-		get_last_write_time(bin_fn) > get_last_write_time(file_name) &&
-		read_obj_bin(bin_fn)) {
+	if (exists(bin_fn) && read_obj_bin(bin_fn, file_name)) {
 			this->path_name = get_path(file_name);
 			if (!this->path_name.empty())
 				this->path_name += "/";
 			return true;
 	}
 	
+	// release mappings of a previously read binary file, which might be overwritten below
 	vertices.clear();
 	normals.clear();
 	texcoords.clear(); 
 	faces.clear(); 
 	colors.clear();
+	vertex_indices.clear();
+	normal_indices.clear();
+	texcoord_indices.clear();
 
 	if (!obj_reader_generic<T>::read_obj(file_name))
 		return false;
@@ -142,108 +236,67 @@ bool obj_loader_generic<T>::read_obj(const std::string& file_name)
 			colors[i] *= 1.0f/255;
 		}
 	}
-	write_obj_bin(bin_fn);
+	write_obj_bin(bin_fn, file_name);
 	return true;
 }
 
 template <typename T>
-bool obj_loader_generic<T>::read_obj_bin(const std::string& file_name)
+bool obj_loader_generic<T>::read_obj_bin(const std::string& file_name, const std::string& obj_file_name)
 {
-	// open binary file
-	FILE* fp = fopen(file_name.c_str(), "rb");
-	if (!fp)
+	// map binary file and validate header
+	cgv::data::mapped_file_ptr mapping(new cgv::utils::mapped_file());
+	if (!mapping->open(file_name))
 		return false;
-
-	// read element count
-	uint32_type v, n, t, f, h, g, m;
-	if (1!=fread(&v, sizeof(uint32_type), 1, fp) ||
-		1!=fread(&n, sizeof(uint32_type), 1, fp) ||
-		1!=fread(&t, sizeof(uint32_type), 1, fp) ||
-		1!=fread(&f, sizeof(uint32_type), 1, fp) ||
-		1!=fread(&h, sizeof(uint32_type), 1, fp) ||
-		1!=fread(&g, sizeof(uint32_type), 1, fp) ||
-		1!=fread(&m, sizeof(uint32_type), 1, fp)) {
-		fclose(fp);
+	obj_cache_header header;
+	if (mapping->get_size() < sizeof(obj_cache_header))
 		return false;
-	}
-
-	bool has_colors = false;
-	if (v > 0x7FFFFFFF) {
-		v = 0xFFFFFFFF - v;
-		has_colors = true;
-	}
-
-	// reserve space
-	vertices.resize(v);
-	if (has_colors)
-		colors.resize(v);
-
-	vertex_indices.resize(h);
-	if (v != fread(&vertices[0], sizeof(v3d_type), v, fp) ||
-		h > 0 && h != fread(&vertex_indices[0], sizeof(unsigned), h, fp) )
-	{
-		fclose(fp);
+	memcpy(&header, mapping->get_data(), sizeof(obj_cache_header));
+	if (memcmp(header.magic, "CGVOBJ\0\0", 8) != 0 ||
+		header.version != obj_cache_version ||
+		header.coordinate_size != sizeof(T) ||
+		header.color_size != sizeof(color_type) ||
+		header.face_info_size != sizeof(face_info))
 		return false;
-	}
-	if (has_colors) {
-		if (v != fread(&colors[0], sizeof(color_type), v, fp))
-		{
-			fclose(fp);
-			return false;
-		}
-	}
-	if (n > 0) {
-		normals.resize(n);
-		normal_indices.resize(h);
-		if (n != fread(&normals[0], sizeof(v3d_type), n, fp) ||
-			h > 0 && h != fread(&normal_indices[0], sizeof(unsigned), h, fp) )
-		{
-			fclose(fp);
-			return false;
-		}
-	}
-	if (t > 0) {
-		texcoords.resize(t);
-		texcoord_indices.resize(h);
-		if (t != fread(&texcoords[0], sizeof(v2d_type), t, fp) ||
-			h > 0 && h != fread(&texcoord_indices[0], sizeof(unsigned), h, fp) )
-		{
-			fclose(fp);
-			return false;
-		}
-	}
-	faces.resize(f); 
-	if (f > 0 && f != fread(&faces[0], sizeof(face_info), f, fp))
-	{
-		fclose(fp);
+	if (!obj_file_name.empty() &&
+		(header.obj_file_size != uint64_type(cgv::utils::file::size(obj_file_name)) ||
+		 header.obj_file_write_time != get_last_write_time(obj_file_name)))
 		return false;
-	}
-	groups.resize(g);
-	for (unsigned gi=0; gi<g; ++gi) {
-		if (!read_string_bin(groups[gi].name, fp) ||
-			!read_string_bin(groups[gi].parameters, fp))
-		{
-			fclose(fp);
+	const size_t element_sizes[OCS_GROUPS] = {
+		sizeof(v3d_type), sizeof(v3d_type), sizeof(v2d_type), sizeof(color_type),
+		sizeof(unsigned), sizeof(unsigned), sizeof(unsigned), sizeof(face_info)
+	};
+	for (int s = 0; s < OCS_COUNT; ++s) {
+		uint64_type nr_bytes = s < OCS_GROUPS ? header.section_sizes[s] * element_sizes[s] : 0;
+		if (header.section_offsets[s] % obj_cache_alignment != 0 ||
+			header.section_offsets[s] > mapping->get_size() ||
+			nr_bytes > mapping->get_size() - header.section_offsets[s])
 			return false;
-		}
 	}
-	if (1 != fread(&this->have_default_material, sizeof(bool), 1, fp))
-	{
-		fclose(fp);
+	std::vector<std::string> group_strings, mtl_lib_names;
+	if (!read_obj_cache_strings(mapping, header, OCS_GROUPS, 2*size_t(header.section_sizes[OCS_GROUPS]), group_strings) ||
+		!read_obj_cache_strings(mapping, header, OCS_MTL_LIBS, size_t(header.section_sizes[OCS_MTL_LIBS]), mtl_lib_names))
 		return false;
+
+	// use sections in place
+	map_obj_cache_section(vertices, mapping, header, OCS_VERTICES);
+	map_obj_cache_section(normals, mapping, header, OCS_NORMALS);
+	map_obj_cache_section(texcoords, mapping, header, OCS_TEXCOORDS);
+	map_obj_cache_section(colors, mapping, header, OCS_COLORS);
+	map_obj_cache_section(vertex_indices, mapping, header, OCS_VERTEX_INDICES);
+	map_obj_cache_section(normal_indices, mapping, header, OCS_NORMAL_INDICES);
+	map_obj_cache_section(texcoord_indices, mapping, header, OCS_TEXCOORD_INDICES);
+	map_obj_cache_section(faces, mapping, header, OCS_FACES);
+
+	groups.resize(group_strings.size()/2);
+	for (size_t gi = 0; gi < groups.size(); ++gi) {
+		groups[gi].name = group_strings[2*gi];
+		groups[gi].parameters = group_strings[2*gi+1];
 	}
+	this->have_default_material = header.have_default_material != 0;
 	if (this->have_default_material)
 		materials.push_back(obj_material());
-	
-	for (unsigned mi=0; mi<m; ++mi) {
-		std::string s;
-		if (!read_string_bin(s, fp)) {
-			fclose(fp);
-			return false;
-		}
-		obj_reader_generic<T>::read_mtl(s);
-	}
-	fclose(fp);
+	for (size_t mi = 0; mi < mtl_lib_names.size(); ++mi)
+		obj_reader_generic<T>::read_mtl(mtl_lib_names[mi]);
 	return true;
 }
 
@@ -256,6 +309,7 @@ void obj_loader_generic<T>::clear()
 	vertices.clear(); 
 	normals.clear(); 
 	texcoords.clear(); 
+	colors.clear();
 
 	vertex_indices.clear();
 	normal_indices.clear();
@@ -267,99 +321,87 @@ void obj_loader_generic<T>::clear()
 }
 
 template <typename T>
-bool obj_loader_generic<T>::write_obj_bin(const std::string& file_name) const
+bool obj_loader_generic<T>::write_obj_bin(const std::string& file_name, const std::string& obj_file_name) const
 {
-	// open binary file
-	FILE* fp = fopen(file_name.c_str(), "wb");
-	if (!fp)
-		return false;
-
-
-
-	// read element count
-	uint32_type v = (unsigned) vertices.size(), 
-		        n = (unsigned) normals.size(),
-				t = (unsigned) texcoords.size(), 
-				f = (unsigned) faces.size(),
-				h = (unsigned) vertex_indices.size(), 
-				g = (unsigned) groups.size(),
-				m = (unsigned) this->mtl_lib_files.size();
-	uint32_type v_write = v;
-	bool has_colors = (colors.size() == vertices.size());
-	if (has_colors)
-		v_write = 0xFFFFFFFF - v;
-
-	if (1!=fwrite(&v_write, sizeof(uint32_type), 1, fp) ||
-		1!=fwrite(&n, sizeof(uint32_type), 1, fp) ||
-		1!=fwrite(&t, sizeof(uint32_type), 1, fp) ||
-		1!=fwrite(&f, sizeof(uint32_type), 1, fp) ||
-		1!=fwrite(&h, sizeof(uint32_type), 1, fp) ||
-		1!=fwrite(&g, sizeof(uint32_type), 1, fp) ||
-		1!=fwrite(&m, sizeof(uint32_type), 1, fp)) {
-		fclose(fp);
-		return false;
-	}
-
-	if (v != fwrite(&vertices[0], sizeof(v3d_type), v, fp) ||
-		h > 0 && h != fwrite(&vertex_indices[0], sizeof(unsigned), h, fp) )
-	{
-		fclose(fp);
-		return false;
-	}
-
-	if (has_colors) {
-		if (v != fwrite(&colors[0], sizeof(color_type), v, fp) )
-		{
-			fclose(fp);
-			return false;
-		}
-	}
-	if (n > 0) {
-		if (n != fwrite(&normals[0], sizeof(v3d_type), n, fp) ||
-			h > 0 && h != fwrite(&normal_indices[0], sizeof(unsigned), h, fp) )
-		{
-			fclose(fp);
-			return false;
-		}
-	}
-	if (t > 0) {
-		if (t != fwrite(&texcoords[0], sizeof(v2d_type), t, fp) ||
-			h > 0 && h != fwrite(&texcoord_indices[0], sizeof(unsigned), h, fp) )
-		{
-			fclose(fp);
-			return false;
-		}
-	}
-	if (f > 0 && f != fwrite(&faces[0], sizeof(face_info), f, fp))
-	{
-		fclose(fp);
-		return false;
+	obj_cache_header header;
+	memset(&header, 0, sizeof(obj_cache_header));
+	memcpy(header.magic, "CGVOBJ\0\0", 8);
+	header.version = obj_cache_version;
+	header.coordinate_size = sizeof(T);
+	header.color_size = sizeof(color_type);
+	header.face_info_size = sizeof(face_info);
+	if (!obj_file_name.empty()) {
+		header.obj_file_size = uint64_type(cgv::utils::file::size(obj_file_name));
+		header.obj_file_write_time = get_last_write_time(obj_file_name);
 	}
-	for (unsigned gi=0; gi<g; ++gi) {
-		if (!write_string_bin(groups[gi].name, fp) ||
-			!write_string_bin(groups[gi].parameters, fp))
-		{
-			fclose(fp);
-			return false;
-		}
+	header.have_default_material = this->have_default_material ? 1 : 0;
+
+	// compute section layout
+	const void* section_data[OCS_GROUPS] = {
+		vertices.data(), normals.data(), texcoords.data(), colors.data(),
+		vertex_indices.data(), normal_indices.data(), texcoord_indices.data(), faces.data()
+	};
+	const size_t element_sizes[OCS_GROUPS] = {
+		sizeof(v3d_type), sizeof(v3d_type), sizeof(v2d_type), sizeof(color_type),
+		sizeof(unsigned), sizeof(unsigned), sizeof(unsigned), sizeof(face_info)
+	};
+	header.section_sizes[OCS_VERTICES] = vertices.size();
+	header.section_sizes[OCS_NORMALS] = normals.size();
+	header.section_sizes[OCS_TEXCOORDS] = texcoords.size();
+	header.section_sizes[OCS_COLORS] = colors.size();
+	header.section_sizes[OCS_VERTEX_INDICES] = vertex_indices.size();
+	header.section_sizes[OCS_NORMAL_INDICES] = normal_indices.size();
+	header.section_sizes[OCS_TEXCOORD_INDICES] = texcoord_indices.size();
+	header.section_sizes[OCS_FACES] = faces.size();
+	header.section_sizes[OCS_GROUPS] = groups.size();
+	header.section_sizes[OCS_MTL_LIBS] = this->mtl_lib_files.size();
+	uint64_type section_bytes[OCS_COUNT];
+	for (int s = 0; s < OCS_GROUPS; ++s)
+		section_bytes[s] = header.section_sizes[s] * element_sizes[s];
+	section_bytes[OCS_GROUPS] = section_bytes[OCS_MTL_LIBS] = 0;
+	for (size_t gi = 0; gi < groups.size(); ++gi)
+		section_bytes[OCS_GROUPS] += obj_cache_string_size(groups[gi].name) + obj_cache_string_size(groups[gi].parameters);
+	std::set<std::string>::const_iterator mi = this->mtl_lib_files.begin();
+	for (; mi != this->mtl_lib_files.end(); ++mi)
+		section_bytes[OCS_MTL_LIBS] += obj_cache_string_size(*mi);
+	uint64_type offset = align_obj_cache_offset(sizeof(obj_cache_header));
+	for (int s = 0; s < OCS_COUNT; ++s) {
+		header.section_offsets[s] = offset;
+		offset = align_obj_cache_offset(offset + section_bytes[s]);
 	}
 
-	if (1 != fwrite(&this->have_default_material, sizeof(bool), 1, fp))
-	{
-		fclose(fp);
+	// write into temporary file that replaces the binary file at the end, such that mappings of the old file stay valid
+	std::string tmp_file_name = file_name + ".tmp";
+	FILE* fp = fopen(tmp_file_name.c_str(), "wb");
+	if (!fp)
 		return false;
+	uint64_type position = sizeof(obj_cache_header);
+	bool success = fwrite(&header, sizeof(obj_cache_header), 1, fp) == 1;
+	for (int s = 0; success && s < OCS_GROUPS; ++s) {
+		success = write_obj_cache_padding(fp, position, header.section_offsets[s]);
+		size_t n = size_t(header.section_sizes[s]);
+		if (success && n > 0)
+			success = fwrite(section_data[s], element_sizes[s], n, fp) == n;
+		position += section_bytes[s];
 	}
-
-	std::set<std::string>::const_iterator mi = this->mtl_lib_files.begin();
-	for (; mi != this->mtl_lib_files.end(); ++mi) {
-		if (!write_string_bin(*mi, fp)) 
-		{
-			fclose(fp);
-			return false;
-		}
+	if (success)
+		success = write_obj_cache_padding(fp, position, header.section_offsets[OCS_GROUPS]);
+	for (size_t gi = 0; success && gi < groups.size(); ++gi)
+		success = write_string_bin(groups[gi].name, fp) && write_string_bin(groups[gi].parameters, fp);
+	position += section_bytes[OCS_GROUPS];
+	if (success)
+		success = write_obj_cache_padding(fp, position, header.section_offsets[OCS_MTL_LIBS]);
+	for (mi = this->mtl_lib_files.begin(); success && mi != this->mtl_lib_files.end(); ++mi)
+		success = write_string_bin(*mi, fp);
+	if (fclose(fp) != 0)
+		success = false;
+	if (success) {
+		::remove(file_name.c_str());
+		success = ::rename(tmp_file_name.c_str(), file_name.c_str()) == 0;
 	}
-	fclose(fp);
-	return true;
+	if (!success)
+		::remove(tmp_file_name.c_str());
+	return success;
 }
 
 template <typename T>
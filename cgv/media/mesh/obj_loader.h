@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 #include <cgv/math/fvec.h>
+#include <cgv/data/mapped_vector.h>
 
 #include <cgv/media/lib_begin.h>
 
@@ -41,7 +42,11 @@ struct group_info
 
 /** implements the virtual interface of the obj_reader and stores all 
 	read information. The read information is automatically stored in 
-	binary form to accelerate the second loading of the same obj file. */
+	binary form to accelerate the second loading of the same obj file.
+	The binary cache is memory mapped and its sections are used in place,
+	such that loading an unchanged obj file the second time does not copy
+	the vertex attributes, indices and faces. A cache is only used if the
+	size and last write time of the obj file match the values stored in it. */
 template <typename T>
 class CGV_API obj_loader_generic : public obj_reader_generic<T>
 {
@@ -51,16 +56,16 @@ public:
 	typedef typename obj_reader_generic<T>::v2d_type v2d_type;
 	typedef typename obj_reader_generic<T>::color_type color_type;
 	
-	std::vector<v3d_type> vertices; 
-    std::vector<v3d_type> normals; 
-    std::vector<v2d_type> texcoords;
-	std::vector<color_type> colors;
+	cgv::data::mapped_vector<v3d_type> vertices; 
+    cgv::data::mapped_vector<v3d_type> normals; 
+    cgv::data::mapped_vector<v2d_type> texcoords;
+	cgv::data::mapped_vector<color_type> colors;
 
-	std::vector<unsigned> vertex_indices;
-	std::vector<unsigned> normal_indices;
-	std::vector<unsigned> texcoord_indices;
+	cgv::data::mapped_vector<unsigned> vertex_indices;
+	cgv::data::mapped_vector<unsigned> normal_indices;
+	cgv::data::mapped_vector<unsigned> texcoord_indices;
 	
-	std::vector<face_info> faces; 
+	cgv::data::mapped_vector<face_info> faces; 
 	std::vector<group_info> groups;
 	std::vector<cgv::media::illum::obj_material> materials;
 protected:
@@ -85,10 +90,12 @@ protected:
 public:
 	/// overloads reading to support binary file format
 	bool read_obj(const std::string& file_name);
-	/// read a binary version of an obj file
-	bool read_obj_bin(const std::string& file_name);
-	/// write the information from the last read obj file in binary format
-	bool write_obj_bin(const std::string& file_name) const;
+	/** map a binary version of an obj file. If the name of the obj file is given, the binary file is rejected
+	    if it has been written for another size or last write time of the obj file. */
+	bool read_obj_bin(const std::string& file_name, const std::string& obj_file_name = "");
+	/** write the information from the last read obj file in binary format. If the name of the obj file is
+	    given, its size and last write time are stored to detect outdated binary files. */
+	bool write_obj_bin(const std::string& file_name, const std::string& obj_file_name = "") const;
 	/// use this after reading to show status information about the number of read entities
 	void show_stats() const;
 	/// prepare for reading another file
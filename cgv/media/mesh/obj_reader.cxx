@@ -5,6 +5,8 @@
 #include <cgv/utils/advanced_scan.h>
 #include <cgv/utils/tokenizer.h>
 #include <cgv/base/import.h>
+#include <cgv/os/thread_pool.h>
+#include <cstring>
 
 using namespace cgv::math;
 using namespace cgv::type;
@@ -22,9 +24,10 @@ namespace cgv {
 			bool is_double_impl(const char* begin, const char* end, float& value)
 			{
 				double valued;
-				bool res = cgv::utils::is_double(begin, end, valued);
+				if (!cgv::utils::is_double(begin, end, valued))
+					return false;
 				value = (float)valued;
-				return res;
+				return true;
 			}
 
 			bool is_double_impl(const char* begin, const char* end, double& value)
@@ -32,6 +35,190 @@ namespace cgv {
 				return cgv::utils::is_double(begin, end, value);
 			}
 
+			/// parse the numbers of the tokens first to first+count-1 into v if all tokens are present and stop at the first token that is not a number
+			template <typename T>
+			static void parse_numbers(const char* const* t, const char* const* te, unsigned n, unsigned first, unsigned count, T* v)
+			{
+				if (n < first + count)
+					return;
+				for (unsigned i = 0; i < count; ++i)
+					if (!is_double_impl(t[first + i], te[first + i], v[i]))
+						return;
+			}
+
+			/// same as atoi on the given range of characters without leading white spaces
+			static int parse_int(const char* begin, const char* end)
+			{
+				const char* p = begin;
+				bool negative = p < end && *p == '-';
+				if (p < end && (*p == '-' || *p == '+'))
+					++p;
+				int value = 0;
+				for (; p < end && is_digit(*p); ++p)
+					value = 10*value + (*p - '0');
+				return negative ? -value : value;
+			}
+
+			/// flags of face corners parsed by parse_corner
+			enum ObjCornerFlags { OCF_BARE = 1, OCF_TEXCOORD = 2, OCF_NORMAL = 4 };
+
+			/** parse a face corner of the form v, v/t, v//n or v/t/n into flags and vertex, texcoord and normal index.
+			    Corners are split into runs of non slash characters and single slashes like with a tokenizer with
+				separator "/". */
+			static void parse_corner(const char* begin, const char* end, int* corner)
+			{
+				const char* piece_begin[5];
+				const char* piece_end[5];
+				unsigned n = 0;
+				for (const char* p = begin; p < end && n < 5; ++n) {
+					piece_begin[n] = p;
+					if (*p == '/')
+						++p;
+					else
+						while (p < end && *p != '/')
+							++p;
+					piece_end[n] = p;
+				}
+				corner[0] = 0;
+				corner[1] = n > 0 ? parse_int(piece_begin[0], piece_end[0]) : 0;
+				corner[2] = corner[3] = 0;
+				if (n == 1) {
+					corner[0] = OCF_BARE;
+					return;
+				}
+				if (n < 3)
+					return;
+				unsigned j = 2;
+				if (piece_end[2] - piece_begin[2] != 1 || *piece_begin[2] != '/') {
+					corner[0] |= OCF_TEXCOORD;
+					corner[2] = parse_int(piece_begin[2], piece_end[2]);
+					++j;
+				}
+				if (n >= j + 2) {
+					corner[0] |= OCF_NORMAL;
+					corner[3] = parse_int(piece_begin[j + 1], piece_end[j + 1]);
+				}
+			}
+
+			/// return the next token separated by blanks and tabs in [p,end) and advance p behind it
+			static bool next_token(const char*& p, const char* end, const char*& token_begin, const char*& token_end)
+			{
+				while (p < end && (*p == ' ' || *p == '\t'))
+					++p;
+				if (p == end)
+					return false;
+				token_begin = p;
+				while (p < end && *p != ' ' && *p != '\t')
+					++p;
+				token_end = p;
+				return true;
+			}
+
+			/// kinds of lines recorded in an obj_chunk
+			enum ObjLineKind { OLK_VERTEX, OLK_VERTEX_COLOR, OLK_NORMAL, OLK_TEXCOORD, OLK_COLOR, OLK_FACE, OLK_OTHER };
+
+			/// lines of an obj file parsed concurrently to other chunks, which are replayed in file order
+			template <typename T>
+			struct obj_chunk
+			{
+				/// range of complete lines
+				const char* begin, * end;
+				/// per vertex attribute, face or other line one ObjLineKind
+				std::vector<unsigned char> kinds;
+				/// coordinates and color components of vertex attribute lines
+				std::vector<T> values;
+				/// per face the number of corners followed by flags, vertex, texcoord and normal index per corner
+				std::vector<int> face_data;
+				/// ranges of group, usemtl and mtllib lines
+				std::vector<std::pair<const char*, const char*> > other_lines;
+				/// parse the lines of the chunk, allocated memory of the previous chunk is reused
+				void parse();
+			};
+
+			template <typename T>
+			void obj_chunk<T>::parse()
+			{
+				kinds.clear();
+				values.clear();
+				face_data.clear();
+				other_lines.clear();
+				const char* t[8], * te[8];
+				const char* p = begin;
+				while (p < end) {
+					const char* line_begin = p;
+					const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+					if (line_end == 0)
+						line_end = p = end;
+					else
+						p = line_end + 1;
+					while (line_end > line_begin && is_space(line_end[-1]))
+						--line_end;
+					const char* q = line_begin;
+					if (!next_token(q, line_end, t[0], te[0]))
+						continue;
+					switch (*t[0]) {
+					case 'v': {
+						unsigned n = 1;
+						while (n < 8 && next_token(q, line_end, t[n], te[n]))
+							++n;
+						T v[4] = { 0, 0, 0, 1 };
+						unsigned off = 0, nr_values = 3;
+						if (te[0] - t[0] == 1) {
+							parse_numbers(t, te, n, 1, 3, v);
+							values.insert(values.end(), v, v + 3);
+							if (n < 7) {
+								kinds.push_back(OLK_VERTEX);
+								break;
+							}
+							kinds.push_back(OLK_VERTEX_COLOR);
+							v[0] = v[1] = v[2] = 0;
+							off = 3;
+						}
+						else {
+							switch (t[0][1]) {
+							case 'n': kinds.push_back(OLK_NORMAL); break;
+							case 't': kinds.push_back(OLK_TEXCOORD); nr_values = 2; break;
+							case 'c': kinds.push_back(OLK_COLOR); break;
+							default: continue;
+							}
+						}
+						if (kinds.back() == OLK_TEXCOORD)
+							parse_numbers(t, te, n, 1, 2, v);
+						else
+							parse_numbers(t, te, n, 1 + off, 3, v);
+						if (kinds.back() == OLK_COLOR || kinds.back() == OLK_VERTEX_COLOR) {
+							if (n > 4 + off)
+								is_double_impl(t[4 + off], te[4 + off], v[3]);
+							nr_values = 4;
+						}
+						values.insert(values.end(), v, v + nr_values);
+						break;
+					}
+					case 'f': {
+						kinds.push_back(OLK_FACE);
+						size_t count_index = face_data.size();
+						face_data.push_back(0);
+						while (next_token(q, line_end, t[1], te[1])) {
+							size_t corner_index = face_data.size();
+							face_data.resize(corner_index + 4);
+							parse_corner(t[1], te[1], &face_data[corner_index]);
+							++face_data[count_index];
+						}
+						break;
+					}
+					case 'g':
+						kinds.push_back(OLK_OTHER);
+						other_lines.push_back(std::make_pair(line_begin, line_end));
+						break;
+					default:
+						if ((te[0] - t[0] == 6) && (std::strncmp(t[0], "usemtl", 6) == 0 || std::strncmp(t[0], "mtllib", 6) == 0)) {
+							kinds.push_back(OLK_OTHER);
+							other_lines.push_back(std::make_pair(line_begin, line_end));
+						}
+					}
+				}
+			}
+
 ///
 template <typename T>
 bool obj_reader_generic<T>::is_double(const char* begin, const char* end, crd_type& value)
@@ -174,6 +361,59 @@ void obj_reader_generic<T>::process_material(const cgv::media::illum::obj_materi
 {
 }
 
+template <typename T>
+void obj_reader_generic<T>::select_default_group_and_material()
+{
+	if (group_index == -1) {
+		group_index = 0;
+		nr_groups = 1;
+		process_group("main","");
+		group_index_lut["main"] = group_index;
+	}
+	if (material_index == -1) {
+		obj_material m;
+		m.set_name("default");
+		material_index = 0;
+		nr_materials = 1;
+		process_material(m, 0);
+		material_index_lut[m.get_name()] = material_index;
+		have_default_material = true;
+	}
+}
+
+template <typename T>
+void obj_reader_generic<T>::parse_line(const std::vector<token>& tokens)
+{
+	if (tokens.size() == 0)
+		return;
+	if (tokens[0][0] == 'g') {
+		if (tokens.size() > 1) {
+			std::string name = to_string(tokens[1]);
+			std::string parameters;
+			if (tokens.size() > 2)
+				parameters.assign(tokens[2].begin, tokens.back().end - tokens[2].begin);
+
+			std::map<std::string,unsigned>::iterator it = 
+				group_index_lut.find(name);
+
+			if (it != group_index_lut.end())
+				group_index = it->second;
+			else {
+				group_index = nr_groups;
+				++nr_groups;
+				process_group(name, parameters);
+				group_index_lut[name] = group_index;
+			}
+		}
+	}
+	else if (to_string(tokens[0]) == "usemtl")
+		parse_material(tokens);
+	else if (to_string(tokens[0]) == "mtllib") {
+		if (tokens.size() > 1)
+			read_mtl(to_string(tokens[1]));
+	}
+}
+
 template <typename T>
 bool obj_reader_generic<T>::read_obj(const std::string& file_name)
 {
@@ -185,94 +425,78 @@ bool obj_reader_generic<T>::read_obj(const std::string& file_name)
 	if (!path_name.empty())
 		path_name += "/";
 
-	std::vector<line> lines;
-	split_to_lines(content,lines);
-	
 	minus = 1;
 	material_index = -1;
 	group_index = -1;
 	nr_groups = 0;
 	nr_normals = nr_texcoords = 0;
-	std::map<std::string,unsigned> group_index_lut;
+	group_index_lut.clear();
+
+	// parse windows of chunks concurrently and replay each window in file order, which keeps the memory of the parsed elements bounded
+	const size_t chunk_size = 1 << 20;
+	std::vector<obj_chunk<crd_type> > chunks(4 * cgv::os::thread_pool::get_global().get_concurrency());
+	const char* begin = content.data();
+	const char* end = begin + content.size();
+	const char* p = begin;
 	std::vector<token> tokens;
-	for (unsigned li=0; li<lines.size(); ++li) {
-		if(li % 1000 == 0)
-			printf("%d Percent done.\r", (int)(100.0*li/(lines.size()-1)) );
-
-		tokenizer(lines[li]).bite_all(tokens);
-		if (tokens.size() == 0)
-			continue;
-
-		switch (tokens[0][0]) {
-		case 'v' :
-			if (tokens[0].size() == 1) {
-				process_vertex(parse_v3d(tokens));
-				if (tokens.size() >= 7)
-					process_color(parse_color(tokens, 3));
+	while (p < end) {
+		unsigned nr_chunks = 0;
+		for (; nr_chunks < chunks.size() && p < end; ++nr_chunks) {
+			const char* chunk_end = end;
+			if (size_t(end - p) > chunk_size) {
+				chunk_end = static_cast<const char*>(std::memchr(p + chunk_size, '\n', end - p - chunk_size));
+				chunk_end = chunk_end ? chunk_end + 1 : end;
 			}
-			else {
-				switch (tokens[0][1]) {
-				case 'n' :
-					process_normal(parse_v3d(tokens));
+			chunks[nr_chunks].begin = p;
+			chunks[nr_chunks].end = p = chunk_end;
+		}
+		cgv::os::parallel_for(0u, nr_chunks, 1u, [&](unsigned ci) { chunks[ci].parse(); });
+
+		for (unsigned ci = 0; ci < nr_chunks; ++ci) {
+			const obj_chunk<crd_type>& c = chunks[ci];
+			const crd_type* v = c.values.data();
+			const int* f = c.face_data.data();
+			size_t oi = 0;
+			for (unsigned char kind : c.kinds) {
+				switch (kind) {
+				case OLK_VERTEX:
+					process_vertex(v3d_type(v[0], v[1], v[2]));
+					v += 3;
+					break;
+				case OLK_VERTEX_COLOR:
+					process_vertex(v3d_type(v[0], v[1], v[2]));
+					process_color(color_type((float)v[3], (float)v[4], (float)v[5], (float)v[6]));
+					v += 7;
+					break;
+				case OLK_NORMAL:
+					process_normal(v3d_type(v[0], v[1], v[2]));
 					++nr_normals;
+					v += 3;
 					break;
-				case 't' : 
-					process_texcoord(parse_v2d(tokens));
+				case OLK_TEXCOORD:
+					process_texcoord(v2d_type(v[0], v[1]));
 					++nr_texcoords;
+					v += 2;
 					break;
-				case 'c' : 
-					process_color(parse_color(tokens));
+				case OLK_COLOR:
+					process_color(color_type((float)v[0], (float)v[1], (float)v[2], (float)v[3]));
+					v += 4;
+					break;
+				case OLK_FACE:
+					select_default_group_and_material();
+					parse_face(f[0], f + 1);
+					f += 1 + 4*f[0];
+					break;
+				case OLK_OTHER:
+					tokens.clear();
+					tokenizer(token(c.other_lines[oi].first, c.other_lines[oi].second)).bite_all(tokens);
+					parse_line(tokens);
+					++oi;
 					break;
 				}
 			}
-			break;
-		case 'f' :
-			if (group_index == -1) {
-				group_index = 0;
-				nr_groups = 1;
-				process_group("main","");
-				group_index_lut["main"] = group_index;
-			}
-			if (material_index == -1) {
-				obj_material m;
-				m.set_name("default");
-				material_index = 0;
-				nr_materials = 1;
-				process_material(m, 0);
-				material_index_lut[m.get_name()] = material_index;
-				have_default_material = true;
-			}
-			parse_face(tokens); 
-			break;
-		case 'g' : 
-			if (tokens.size() > 1) {
-				std::string name = to_string(tokens[1]);
-				std::string parameters;
-				if (tokens.size() > 2)
-					parameters.assign(tokens[2].begin, tokens.back().end - tokens[2].begin);
-
-				std::map<std::string,unsigned>::iterator it = 
-					group_index_lut.find(name);
-
-				if (it != group_index_lut.end())
-					group_index = it->second;
-				else {
-					group_index = nr_groups;
-					++nr_groups;
-					process_group(name, parameters);
-					group_index_lut[name] = group_index;
-				}
-			}
-			break;
-		default:
-			if (to_string(tokens[0]) == "usemtl")
-				parse_material(tokens);
-			else if (to_string(tokens[0]) == "mtllib") {
-				if (tokens.size() > 1)
-					read_mtl(to_string(tokens[1]));
-			}
 		}
-		tokens.clear();
+		printf("%d Percent done.\r", (int)(100.0*(p - begin)/(end - begin)));
 	}
 	printf("\n");
 	return true;
@@ -391,52 +615,55 @@ void obj_reader_generic<T>::parse_material(const std::vector<token>& tokens)
 template <typename T>
 void obj_reader_generic<T>::parse_face(const std::vector<token>& tokens)
 {
-	std::vector<int> vertex_indices;
-	std::vector<int> normal_indices;
-	std::vector<int> texcoord_indices;
-
-	for(unsigned i = 1; i < tokens.size(); i++)	{ 
-		std::vector<token> smaller_tokens;
-		tokenizer(tokens[i]).set_sep("/").bite_all(smaller_tokens);
-		if (smaller_tokens.size() < 1)
-			continue;
-		int vi = atoi(to_string(smaller_tokens[0]).c_str());
+	std::vector<int> corners(4*tokens.size());
+	unsigned nr_corners = 0;
+	for (unsigned i = 1; i < tokens.size(); i++)
+		parse_corner(tokens[i].begin, tokens[i].end, &corners[4*nr_corners++]);
+	parse_face(nr_corners, corners.data());
+}
+
+template <typename T>
+void obj_reader_generic<T>::parse_face(unsigned nr_corners, const int* corners)
+{
+	face_vertex_indices.clear();
+	face_normal_indices.clear();
+	face_texcoord_indices.clear();
+	for (unsigned i = 0; i < nr_corners; ++i, corners += 4) {
+		int vi = corners[1];
 		if (vi > 0)
 			vi -= minus;
-		vertex_indices.push_back(vi);
-		if (smaller_tokens.size() == 1) {
+		face_vertex_indices.push_back(vi);
+		if (corners[0] & OCF_BARE) {
 			if ((int)nr_normals > vi)
-				normal_indices.push_back(vi);
+				face_normal_indices.push_back(vi);
 			if ((int)nr_texcoords > vi)
-				texcoord_indices.push_back(vi);
+				face_texcoord_indices.push_back(vi);
 			continue;
 		}
-		if (smaller_tokens.size() < 3)
-			continue;
-		unsigned j = 2;
-		if (smaller_tokens[j] != "/") {
-			int ti = atoi(to_string(smaller_tokens[j]).c_str());
+		if (corners[0] & OCF_TEXCOORD) {
+			int ti = corners[2];
 			if (ti > 0)
 				ti -= minus;
 			if ((int)nr_texcoords > ti)
-				texcoord_indices.push_back(ti);
-			++j;
+				face_texcoord_indices.push_back(ti);
+		}
+		if (corners[0] & OCF_NORMAL) {
+			int ni = corners[3];
+			if (ni > 0)
+				ni -= minus;
+			if ((int)nr_normals > ni)
+				face_normal_indices.push_back(ni);
 		}
-		if (smaller_tokens.size() < j+2)
-			continue;
-		int ni = atoi(to_string(smaller_tokens[j+1]).c_str());
-		if (ni > 0)
-			ni -= minus;
-		if ((int)nr_normals > ni)
-			normal_indices.push_back(ni);
 	}
+	if (face_vertex_indices.empty())
+		return;
 	int* nml_ptr = 0;
-	if (normal_indices.size() == vertex_indices.size())
-		nml_ptr = &normal_indices[0];
+	if (face_normal_indices.size() == face_vertex_indices.size())
+		nml_ptr = &face_normal_indices[0];
 	int* tex_ptr = 0;
-	if (texcoord_indices.size() == vertex_indices.size())
-		tex_ptr = &texcoord_indices[0];
-	process_face((unsigned) vertex_indices.size(), &vertex_indices[0], tex_ptr, nml_ptr);
+	if (face_texcoord_indices.size() == face_vertex_indices.size())
+		tex_ptr = &face_texcoord_indices[0];
+	process_face((unsigned)face_vertex_indices.size(), &face_vertex_indices[0], tex_ptr, nml_ptr);
 }
 
 
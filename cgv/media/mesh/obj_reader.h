@@ -41,8 +41,14 @@ private:
 	unsigned nr_materials;
 	/// mapping from material names to material indices
 	std::map<std::string,unsigned> material_index_lut;
+	/// mapping from group names to group indices
+	std::map<std::string,unsigned> group_index_lut;
+	/// vertex, normal and texture coordinate indices of the face passed to process_face
+	std::vector<int> face_vertex_indices, face_normal_indices, face_texcoord_indices;
 	///
 	static bool is_double(const char* begin, const char* end, crd_type& value);
+	/// select group "main" and material "default" if no group or material has been selected before the first face
+	void select_default_group_and_material();
 protected:
 	/**@name helpers for reading*/
 	//@{
@@ -57,7 +63,11 @@ protected:
 	bool have_default_material;
 	std::set<std::string> mtl_lib_files;
 	void parse_face(const std::vector<cgv::utils::token>& tokens);
+	/// process a face given per corner by flags and vertex, texcoord and normal index as computed by the chunk parser of read_obj
+	void parse_face(unsigned nr_corners, const int* corners);
 	void parse_material(const std::vector<cgv::utils::token>& tokens);
+	/// process the tokens of a group, usemtl or mtllib line
+	void parse_line(const std::vector<cgv::utils::token>& tokens);
 	//@}
 	/**@name status info during reading*/
 	//@{
@@ -98,7 +108,8 @@ public:
 	obj_reader_generic();
 	/// clear the reader such that a new file can be read
 	virtual void clear();
-	/// read an obj file
+	/** read an obj file. The file is split into chunks of lines that are parsed concurrently without memory
+	    allocations per line. The parsed elements are passed to the virtual process methods in file order. */
 	virtual bool read_obj(const std::string& file_name);
 	/// read a material file
 	virtual bool read_mtl(const std::string& file_name);
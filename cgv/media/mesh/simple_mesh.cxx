@@ -20,6 +20,26 @@ void simple_mesh_base::sort_faces(std::vector<idx_type>& perm, bool by_group, bo
 		cgv::math::bucket_sort(material_indices, get_nr_materials(), perm);
 }
 
+/// mix the bits of a 64 bit key such that all bits of the hash depend on all bits of the key
+inline cgv::type::uint64_type mix_hash(cgv::type::uint64_type h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+/// return a power of two number of slots for an open addressing hash table that stays at most half full with n entries
+inline size_t get_hash_table_size(size_t n)
+{
+	size_t size = 16;
+	while (size < 2 * n)
+		size *= 2;
+	return size;
+}
+
 /// merge the three indices into one index into a vector of unique index triples
 void simple_mesh_base::merge_indices(std::vector<idx_type>& indices, std::vector<vec3i>& unique_triples, bool* include_tex_coords_ptr, bool* include_normals_ptr) const
 {
@@ -31,25 +51,35 @@ void simple_mesh_base::merge_indices(std::vector<idx_type>& indices, std::vector
 	if (include_normals_ptr)
 		*include_normals_ptr = include_normals = (normal_indices.size() > 0) && *include_normals_ptr;
 
-	std::map<std::tuple<idx_type, idx_type, idx_type>, idx_type> corner_to_index;
-	for (idx_type ci = 0; ci < position_indices.size(); ++ci) {
+	// open addressing hash table with linear probing that stores per slot the offset of a unique triple plus one, 
+	// sized for the case that all corners are unique
+	idx_type nr_corners = idx_type(position_indices.size());
+	idx_type first_triple = idx_type(unique_triples.size());
+	std::vector<idx_type> slots(get_hash_table_size(nr_corners), 0);
+	size_t mask = slots.size() - 1;
+	indices.reserve(indices.size() + nr_corners);
+	for (idx_type ci = 0; ci < nr_corners; ++ci) {
 		// construct corner
 		vec3i c(position_indices[ci], 
 			    (include_tex_coords && ci < tex_coord_indices.size()) ? tex_coord_indices[ci] : 0, 
 			    (include_normals && ci < normal_indices.size()) ? normal_indices[ci] : 0);
-		std::tuple<idx_type, idx_type, idx_type> triple(c(0),c(1),c(2));
-		// look corner up in map
-		auto iter = corner_to_index.find(triple);
-		// determine vertex index
+		// look corner up in hash table
+		size_t si = size_t(mix_hash(((cgv::type::uint64_type(c(0)) << 32) | c(1)) ^ mix_hash(c(2)))) & mask;
 		idx_type vi;
-		if (iter == corner_to_index.end()) {
-			vi = idx_type(unique_triples.size());
-			corner_to_index[triple] = vi;
-			unique_triples.push_back(c);
+		while (true) {
+			idx_type s = slots[si];
+			if (s == 0) {
+				// determine vertex index of new corner
+				vi = idx_type(unique_triples.size());
+				slots[si] = vi - first_triple + 1;
+				unique_triples.push_back(c);
+				break;
+			}
+			vi = first_triple + s - 1;
+			if (unique_triples[vi] == c)
+				break;
+			si = (si + 1) & mask;
 		}
-		else
-			vi = iter->second;
-
 		indices.push_back(vi);
 	}
 }
@@ -89,28 +119,27 @@ void simple_mesh_base::extract_triangle_element_buffer(
 /// extract element array buffers for edges in wireframe
 void simple_mesh_base::extract_wireframe_element_buffer(const std::vector<idx_type>& vertex_indices, std::vector<idx_type>& edge_element_buffer) const
 {
-	// map stores for each halfedge the number of times it has been seen before
-	std::map<std::tuple<idx_type, idx_type>, idx_type> halfedge_to_count;
+	// open addressing hash table with linear probing over the edges seen before, where an edge is stored with 
+	// sorted vertex indices in one 64 bit key and there are at most as many edges as corners
+	const cgv::type::uint64_type empty_key = cgv::type::uint64_type(-1);
+	std::vector<cgv::type::uint64_type> slots(get_hash_table_size(position_indices.size()), empty_key);
+	size_t mask = slots.size() - 1;
 	for (idx_type fi = 0; fi < faces.size(); ++fi) {
 		idx_type last_vi = vertex_indices.at(end_corner(fi) - 1);
 		for (idx_type ci = begin_corner(fi); ci < end_corner(fi); ++ci) {
-			// construct halfedge with sorted vertex indices
+			// construct key of edge with sorted vertex indices
 			idx_type vi = vertex_indices.at(ci);
-			std::tuple<idx_type, idx_type> halfedge(last_vi, vi);
-			if (vi < last_vi)
-				std::swap(std::get<0>(halfedge), std::get<1>(halfedge));
-
-			// lookup corner in map
-			auto iter = halfedge_to_count.find(halfedge);
-
-			// determine vertex index
-			if (iter == halfedge_to_count.end()) {
-				halfedge_to_count[halfedge] = 1;
+			cgv::type::uint64_type key = vi < last_vi ? 
+				(cgv::type::uint64_type(vi) << 32) | last_vi : (cgv::type::uint64_type(last_vi) << 32) | vi;
+			// look edge up and add it if it has not been seen before
+			size_t si = size_t(mix_hash(key)) & mask;
+			while (slots[si] != empty_key && slots[si] != key)
+				si = (si + 1) & mask;
+			if (slots[si] == empty_key) {
+				slots[si] = key;
 				edge_element_buffer.push_back(last_vi);
 				edge_element_buffer.push_back(vi);
 			}
-			else
-				++halfedge_to_count[halfedge];
 			last_vi = vi;
 		}
 	}
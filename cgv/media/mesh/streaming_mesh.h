@@ -87,7 +87,7 @@ public:
 	}
 	/// construct a new triangle by calling the new polygon method of the callback handler
 	void new_triangle(unsigned int vi, unsigned int vj, unsigned int vk) {
-		static std::vector<unsigned int> vis(3);
+		static thread_local std::vector<unsigned int> vis(3);
 		vis[0] = vi;
 		vis[1] = vj;
 		vis[2] = vk;
@@ -97,7 +97,7 @@ public:
 	}
 	/// construct a new quad by calling the new polygon method of the callback handler
 	void new_quad(unsigned int vi, unsigned int vj, unsigned int vk, unsigned int vl) {
-		static std::vector<unsigned int> vis(4);
+		static thread_local std::vector<unsigned int> vis(4);
 		vis[0] = vi;
 		vis[1] = vj;
 		vis[2] = vk;
@@ -0,0 +1,199 @@
+#include "thread_pool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace cgv {
+	namespace os {
+
+/// pool whose worker is the current thread
+static thread_local thread_pool* current_pool = 0;
+/// worker index of the current thread in current_pool
+static thread_local int current_worker_index = -1;
+
+struct thread_pool::implementation
+{
+	/// task queue of one worker
+	struct queue
+	{
+		std::mutex m;
+		std::deque<task_type> tasks;
+	};
+	/// one queue per worker
+	std::vector<std::unique_ptr<queue> > queues;
+	/// worker threads
+	std::vector<std::thread> threads;
+	/// number of tasks in all queues
+	std::atomic<unsigned> nr_pending_tasks;
+	/// round robin counter used to distribute tasks spawned from outside the pool
+	std::atomic<unsigned> next_queue;
+	/// mutex and condition used to put idle workers to sleep
+	std::mutex sleep_mutex;
+	std::condition_variable wake_up;
+	/// set to true on destruction
+	bool stop_request;
+	implementation() : nr_pending_tasks(0), next_queue(0), stop_request(false) {}
+	/// pop task from the back of the given queue or steal one from the front of another queue
+	bool pop_task(int qi, task_type& task)
+	{
+		unsigned n = unsigned(queues.size());
+		if (qi >= 0) {
+			queue& q = *queues[qi];
+			std::lock_guard<std::mutex> lock(q.m);
+			if (!q.tasks.empty()) {
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+				--nr_pending_tasks;
+				return true;
+			}
+		}
+		unsigned start = qi >= 0 ? unsigned(qi) + 1 : next_queue.load();
+		for (unsigned k = 0; k < n; ++k) {
+			queue& q = *queues[(start + k) % n];
+			std::lock_guard<std::mutex> lock(q.m);
+			if (!q.tasks.empty()) {
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				--nr_pending_tasks;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+thread_pool::thread_pool(int nr_workers)
+{
+	if (nr_workers < 0)
+		nr_workers = std::max(1, int(std::thread::hardware_concurrency())) - 1;
+	impl = new implementation();
+	for (int wi = 0; wi < nr_workers; ++wi)
+		impl->queues.push_back(std::unique_ptr<implementation::queue>(new implementation::queue()));
+	for (int wi = 0; wi < nr_workers; ++wi)
+		impl->threads.push_back(std::thread(&thread_pool::work, this, unsigned(wi)));
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(impl->sleep_mutex);
+		impl->stop_request = true;
+	}
+	impl->wake_up.notify_all();
+	for (size_t i = 0; i < impl->threads.size(); ++i)
+		impl->threads[i].join();
+	delete impl;
+}
+
+/// return the global pool that is constructed on first use
+thread_pool& thread_pool::get_global()
+{
+	// the global pool is never destructed because joining threads during unloading of a shared library can dead lock
+	static thread_pool* global_pool = new thread_pool();
+	return *global_pool;
+}
+
+unsigned thread_pool::get_nr_workers() const
+{
+	return unsigned(impl->threads.size());
+}
+
+int thread_pool::get_current_worker_index() const
+{
+	return current_pool == this ? current_worker_index : -1;
+}
+
+void thread_pool::work(unsigned wi)
+{
+	current_pool = this;
+	current_worker_index = int(wi);
+	task_type task;
+	for (;;) {
+		if (impl->pop_task(int(wi), task)) {
+			task();
+			task = task_type();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(impl->sleep_mutex);
+		impl->wake_up.wait(lock, [this]() { return impl->stop_request || impl->nr_pending_tasks > 0; });
+		if (impl->stop_request)
+			return;
+	}
+}
+
+void thread_pool::spawn(const task_type& task)
+{
+	unsigned n = unsigned(impl->queues.size());
+	if (n == 0) {
+		task();
+		return;
+	}
+	int qi = get_current_worker_index();
+	if (qi == -1)
+		qi = int(impl->next_queue++ % n);
+	{
+		implementation::queue& q = *impl->queues[qi];
+		std::lock_guard<std::mutex> lock(q.m);
+		q.tasks.push_back(task);
+		++impl->nr_pending_tasks;
+	}
+	// acquire sleep mutex to not miss a worker that is about to wait
+	{
+		std::lock_guard<std::mutex> lock(impl->sleep_mutex);
+	}
+	impl->wake_up.notify_one();
+}
+
+bool thread_pool::run_pending_task()
+{
+	task_type task;
+	if (!impl->pop_task(get_current_worker_index(), task))
+		return false;
+	task();
+	return true;
+}
+
+task_group::task_group(thread_pool& _pool) : pool(_pool), nr_open_tasks(0), has_error(false)
+{
+}
+
+task_group::~task_group()
+{
+	while (nr_open_tasks > 0)
+		if (!pool.run_pending_task())
+			std::this_thread::yield();
+}
+
+void task_group::run(const thread_pool::task_type& task)
+{
+	++nr_open_tasks;
+	pool.spawn([this, task]() {
+		try {
+			task();
+		}
+		catch (...) {
+			if (!has_error.exchange(true))
+				error = std::current_exception();
+		}
+		--nr_open_tasks;
+	});
+}
+
+void task_group::wait()
+{
+	while (nr_open_tasks > 0)
+		if (!pool.run_pending_task())
+			std::this_thread::yield();
+	if (has_error) {
+		std::exception_ptr e = error;
+		error = std::exception_ptr();
+		has_error = false;
+		std::rethrow_exception(e);
+	}
+}
+
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace os {
+
+/** pool of worker threads that execute tasks. Each worker owns a double ended queue of tasks. Tasks
+    spawned from a worker are pushed to the back of its own queue and popped from there again, such that
+	recently spawned and cache hot tasks are executed first. Idle workers steal tasks from the front of
+	the queues of other workers. Tasks spawned from threads outside of the pool are distributed round
+	robin over the worker queues. Threads waiting for tasks of a task_group help executing pending
+	tasks, such that task groups and parallel loops can be nested without blocking the pool.
+
+	The global pool returned by get_global() has one worker less than the hardware concurrency
+	because the calling thread participates in parallel loops. */
+class CGV_API thread_pool
+{
+public:
+	/// type of tasks
+	typedef std::function<void()> task_type;
+protected:
+	/// hidden implementation with queues and threads
+	struct implementation;
+	/// pointer to implementation
+	implementation* impl;
+	/// execution loop of the wi-th worker
+	void work(unsigned wi);
+private:
+	/// pools can not be copied
+	thread_pool(const thread_pool&);
+	/// pools can not be assigned
+	thread_pool& operator = (const thread_pool&);
+public:
+	/// construct pool with given number of worker threads, -1 selects one less than the hardware concurrency
+	thread_pool(int nr_workers = -1);
+	/// wait for all workers to finish their current task and join them, tasks still in the queues are discarded
+	~thread_pool();
+	/// return the global pool that is constructed on first use
+	static thread_pool& get_global();
+	/// return the number of worker threads
+	unsigned get_nr_workers() const;
+	/// return the number of threads that execute tasks in a parallel loop, i.e. the number of workers plus the calling thread
+	unsigned get_concurrency() const { return get_nr_workers() + 1; }
+	/// return the index of the calling worker thread of this pool or -1 if the caller is not a worker of this pool
+	int get_current_worker_index() const;
+	/// add a task to the pool, which is executed in one of the workers, or the calling thread if the pool has no workers; the task must not throw, use task_group or submit to propagate exceptions
+	void spawn(const task_type& task);
+	/// execute one pending task in the calling thread, return false if no task was pending
+	bool run_pending_task();
+	/// add a task that returns a value and return a future to it, waiting for the future inside of a task can block the pool, use task_group there
+	template <typename F>
+	std::future<typename std::result_of<F()>::type> submit(F f)
+	{
+		typedef typename std::result_of<F()>::type result_type;
+		std::shared_ptr<std::packaged_task<result_type()> > task(new std::packaged_task<result_type()>(f));
+		std::future<result_type> result = task->get_future();
+		spawn([task]() { (*task)(); });
+		return result;
+	}
+};
+
+/** group of tasks whose completion can be waited for. The waiting thread executes pending tasks of the pool
+    in the meantime. The first exception thrown by a task of the group is rethrown in wait(). */
+class CGV_API task_group
+{
+protected:
+	/// pool that executes the tasks
+	thread_pool& pool;
+	/// number of spawned tasks that did not complete yet
+	std::atomic<unsigned> nr_open_tasks;
+	/// first exception thrown by a task
+	std::exception_ptr error;
+	/// flag used to store only the first exception
+	std::atomic<bool> has_error;
+private:
+	/// task groups can not be copied
+	task_group(const task_group&);
+	/// task groups can not be assigned
+	task_group& operator = (const task_group&);
+public:
+	/// construct task group for the given pool
+	task_group(thread_pool& _pool = thread_pool::get_global());
+	/// waits for all tasks but ignores exceptions
+	~task_group();
+	/// return the pool of this group
+	thread_pool& get_pool() const { return pool; }
+	/// spawn a task in the group
+	void run(const thread_pool::task_type& task);
+	/// wait for completion of all tasks of the group and rethrow the first exception thrown by one of them
+	void wait();
+};
+
+/** call f(i) for all i in [begin, end) concurrently in the given pool and the calling thread. Blocks of grain
+    consecutive indices are handed out dynamically to balance the load. f needs to be safe to be called
+	concurrently for different indices. */
+template <typename I, typename F>
+void parallel_for(thread_pool& pool, I begin, I end, I grain, const F& f)
+{
+	if (end <= begin)
+		return;
+	if (grain < 1)
+		grain = 1;
+	I nr_blocks = (end - begin + grain - 1) / grain;
+	unsigned nr_tasks = unsigned(std::min(I(pool.get_concurrency()), nr_blocks));
+	if (nr_tasks < 2) {
+		for (I i = begin; i < end; ++i)
+			f(i);
+		return;
+	}
+	std::atomic<I> next_block(0);
+	auto worker = [&]() {
+		for (I b = next_block++; b < nr_blocks; b = next_block++) {
+			I block_end = b + 1 == nr_blocks ? end : begin + (b + 1)*grain;
+			for (I i = begin + b*grain; i < block_end; ++i)
+				f(i);
+		}
+	};
+	task_group tg(pool);
+	for (unsigned t = 1; t < nr_tasks; ++t)
+		tg.run(worker);
+	worker();
+	tg.wait();
+}
+
+/// call f(i) for all i in [begin, end) concurrently in the global pool, see parallel_for with pool argument
+template <typename I, typename F>
+void parallel_for(I begin, I end, I grain, const F& f)
+{
+	parallel_for(thread_pool::get_global(), begin, end, grain, f);
+}
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
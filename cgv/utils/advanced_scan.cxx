@@ -1,8 +1,89 @@
 #include "advanced_scan.h"
+#include <string.h>
+#include <thread>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CGV_UTILS_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define CGV_UTILS_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace cgv {
 	namespace utils {
 
+/// return index of the lowest set bit of a non zero mask
+static inline unsigned lowest_bit_index(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return unsigned(index);
+#else
+	return unsigned(__builtin_ctz(mask));
+#endif
+}
+
+/** return pointer to the first of the n <= 8 characters in chars in the range or end if there is none. 
+    With SSE2 16 characters are compared to all n characters at once. */
+static inline const char* find_first_of_chars(const char* begin, const char* end, const char* chars, unsigned n)
+{
+	if (n == 0)
+		return end;
+	const char* p = begin;
+#ifdef CGV_UTILS_SCAN_SSE2
+	__m128i C[8];
+	for (unsigned i = 0; i < n; ++i)
+		C[i] = _mm_set1_epi8(chars[i]);
+	for (; end - p >= 16; p += 16) {
+		__m128i b = _mm_loadu_si128((const __m128i*)p);
+		__m128i m = _mm_cmpeq_epi8(b, C[0]);
+		for (unsigned i = 1; i < n; ++i)
+			m = _mm_or_si128(m, _mm_cmpeq_epi8(b, C[i]));
+		unsigned mask = unsigned(_mm_movemask_epi8(m));
+		if (mask != 0)
+			return p + lowest_bit_index(mask);
+	}
+#endif
+	for (; p < end; ++p)
+		for (unsigned i = 0; i < n; ++i)
+			if (*p == chars[i])
+				return p;
+	return end;
+}
+
+const char* find_newline(const char* begin, const char* end)
+{
+	const char* p = begin;
+#ifdef CGV_UTILS_SCAN_AVX2
+	const __m256i N = _mm256_set1_epi8('\n');
+	for (; end - p >= 32; p += 32) {
+		unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), N)));
+		if (mask != 0)
+			return p + lowest_bit_index(mask);
+	}
+#endif
+#ifdef CGV_UTILS_SCAN_SSE2
+	static const char newline = '\n';
+	return find_first_of_chars(p, end, &newline, 1);
+#else
+	p = (const char*)memchr(p, '\n', end - p);
+	return p ? p : end;
+#endif
+}
+
+/// flags of the character classes used by split_to_tokens
+enum TokenCharFlags {
+	TCF_WHITESPACE = 1, TCF_SEPARATOR = 2, TCF_OPEN_PARENTHESIS = 4
+};
+
 void split_to_tokens(
 			const char* begin, const char* end,
 			std::vector<token>& tokens,
@@ -12,26 +93,46 @@ void split_to_tokens(
 			const std::string& whitespaces,
 			unsigned int max_nr_tokens)
 {
+	// classify characters with a lookup table of TokenCharFlags and collect the characters that end a run of 
+	// plain characters for a vectorized search if there are not too many
+	unsigned char char_flags[256];
+	char close_char[256];
+	char special_chars[8];
+	unsigned nr_special_chars = 0;
+	memset(char_flags, 0, sizeof(char_flags));
+	const std::string* char_sets[3] = { &whitespaces, &separators, &open_parenthesis };
+	for (unsigned si = 0; si < 3; ++si) {
+		const std::string& char_set = *char_sets[si];
+		for (size_t i = char_set.size(); i > 0; --i) {
+			unsigned char c = (unsigned char)char_set[i-1];
+			if (char_flags[c] == 0 && nr_special_chars++ < 8)
+				special_chars[nr_special_chars-1] = char(c);
+			char_flags[c] |= (unsigned char)(TCF_WHITESPACE << si);
+			if (si == 2)
+				close_char[c] = i-1 < close_parenthesis.size() ? close_parenthesis[i-1] : 0;
+		}
+	}
+
 	const char* b = begin;
 	const char* p = b;
-	size_t pos;
 	bool last_is_sep = false;
 	while (p < end) {
-		bool is_sep = false;
-		bool is_whitespace = false;
-		bool create_token = false;
-		if (p == end || (is_whitespace = is_element(*p, whitespaces)))
-			create_token = true;
-		else {
-			is_sep=is_element(*p, separators);
-			if (is_sep) {
-				if (!(last_is_sep && merge_separators))
-					create_token = true;
-			}
+		unsigned char flags = char_flags[(unsigned char)*p];
+		if (flags == 0 && !last_is_sep) {
+			// skip run of plain characters inside of a token
+			if (tokens.size() >= max_nr_tokens)
+				break;
+			if (nr_special_chars <= 8)
+				p = find_first_of_chars(p + 1, end, special_chars, nr_special_chars);
 			else
-				if (last_is_sep)
-					create_token = true;
+				do ++p; while (p < end && char_flags[(unsigned char)*p] == 0);
+			if (p == end && p > b)
+				tokens.push_back(token(b, p));
+			continue;
 		}
+		bool is_whitespace = (flags & TCF_WHITESPACE) != 0;
+		bool is_sep = !is_whitespace && (flags & TCF_SEPARATOR) != 0;
+		bool create_token = is_whitespace || (is_sep ? !(last_is_sep && merge_separators) : last_is_sep);
 		last_is_sep = is_sep;
 		if (create_token) {
 			if (p > b)
@@ -41,15 +142,16 @@ void split_to_tokens(
 			else
 				b = p;
 		}
-		else if ((pos = open_parenthesis.find_first_of(*p)) != std::string::npos) {
+		else if ((flags & TCF_OPEN_PARENTHESIS) != 0) {
+			char c = close_char[(unsigned char)*p];
 			b = ++p;
-			while (p != end && *p != close_parenthesis[pos])
+			while (p != end && *p != c)
 				++p;
 			tokens.push_back(token(b,p));
 			b = p+1;
+			if (p == end)
+				break;
 		}
-		if (p == end)
-			break;
 		++p;
 		if (tokens.size() >= max_nr_tokens)
 			break;
@@ -57,29 +159,39 @@ void split_to_tokens(
 			if (p > b)
 				tokens.push_back(token(b,p));
 		}
-	};
+	}
 }
 
 void split_to_lines(const char* global_begin, const char* global_end, 
 						  std::vector<line>& lines, 
 						  bool truncate_trailing_spaces)
 {
-	const char* ptr = global_begin;
-	while (ptr < global_end) {
-		const char* begin = ptr;
-		while (ptr < global_end && *ptr != '\n' )
-			++ptr;
-		const char* end = ptr;
-		if (truncate_trailing_spaces) {
-			while (end > begin && is_space(end[-1]))
-				--end;
-		}
-		else
-			if (end > begin && end[-1] == '\r')
-				--end;
-		lines.push_back(line(begin,end));
-		++ptr;
+	for_each_line(global_begin, global_end, [&lines](const line& l) { lines.push_back(l); }, truncate_trailing_spaces);
+}
+
+/// minimal number of characters per range in split_to_line_ranges
+static const size_t min_line_range_size = 1 << 20;
+
+void split_to_line_ranges(const char* begin, const char* end, std::vector<token>& ranges, unsigned nr_ranges)
+{
+	ranges.clear();
+	if (nr_ranges == 0)
+		nr_ranges = std::max(1u, std::thread::hardware_concurrency());
+	size_t size = end - begin;
+	nr_ranges = unsigned(std::min(size_t(nr_ranges), std::max(size_t(1), size / min_line_range_size)));
+	const char* b = begin;
+	for (unsigned i = 1; i < nr_ranges && b < end; ++i) {
+		const char* e = begin + size / nr_ranges * i;
+		if (e < b)
+			continue;
+		e = find_newline(e, end);
+		if (e < end)
+			++e;
+		ranges.push_back(token(b, e));
+		b = e;
 	}
+	if (b < end)
+		ranges.push_back(token(b, end));
 }
 
 bool balanced_find_content(
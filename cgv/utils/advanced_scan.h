@@ -125,6 +125,37 @@ inline void split_to_lines(const std::string& s,
 	split_to_lines(&s[0],&s[0]+s.size(),lines,truncate_trailing_spaces); 
 }
 
+/// return pointer to the first newline character in the text range or end if there is none; uses SSE2 or AVX2 if available
+extern CGV_API const char* find_newline(const char* begin, const char* end);
+
+/** this function calls f(const line&) for each line of the text range in order without 
+    storing the lines. The lines are the same as the ones generated by split_to_lines. */
+template <typename F>
+void for_each_line(const char* begin, const char* end, F f, bool truncate_trailing_spaces = true)
+{
+	while (begin < end) {
+		const char* line_end = find_newline(begin, end);
+		const char* e = line_end;
+		if (truncate_trailing_spaces) {
+			while (e > begin && is_space(e[-1]))
+				--e;
+		}
+		else
+			if (e > begin && e[-1] == '\r')
+				--e;
+		f(line(begin, e));
+		begin = line_end + 1;
+	}
+}
+
+/** split a text range into at most nr_ranges ranges of whole lines with similar size, where 0 
+    selects the number of hardware threads. Ranges start at the beginning of the text or after a 
+	 newline and are at least one megabyte long, such that short texts result in a single range. 
+	 The ranges can be split into lines concurrently, for example with cgv::os::parallel_for. */
+extern CGV_API void split_to_line_ranges(const char* begin, const char* end, 
+											  std::vector<token>& ranges, 
+											  unsigned nr_ranges = 0);
+
 /** the input range must begin with an open parenthesis. The function
     finds the matching closing parenthesis and returns a token with the
 	 content inside the parentheses.
@@ -0,0 +1,128 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
+namespace cgv {
+	namespace utils {
+
+mapped_file::mapped_file() : file(0), mapping(0), data(0), data_size(0), copy_on_write(true)
+{
+}
+
+mapped_file::mapped_file(const std::string& file_name, bool _copy_on_write) : file(0), mapping(0), data(0), data_size(0), copy_on_write(true)
+{
+	open(file_name, _copy_on_write);
+}
+
+mapped_file::~mapped_file()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool mapped_file::open(const std::string& file_name, bool _copy_on_write)
+{
+	close();
+	copy_on_write = _copy_on_write;
+	HANDLE h_file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (h_file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(h_file, &size) || size.QuadPart == 0) {
+		CloseHandle(h_file);
+		return false;
+	}
+	HANDLE h_mapping = CreateFileMappingA(h_file, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+	if (!h_mapping) {
+		CloseHandle(h_file);
+		return false;
+	}
+	void* view = MapViewOfFile(h_mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		CloseHandle(h_mapping);
+		CloseHandle(h_file);
+		return false;
+	}
+	file = h_file;
+	mapping = h_mapping;
+	data = (char*)view;
+	data_size = size_t(size.QuadPart);
+	return true;
+}
+
+void mapped_file::close()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle((HANDLE)mapping);
+	if (file)
+		CloseHandle((HANDLE)file);
+	data = 0;
+	mapping = 0;
+	file = 0;
+	data_size = 0;
+}
+
+void mapped_file::advise_sequential(size_t, size_t) const
+{
+}
+
+#else
+
+bool mapped_file::open(const std::string& file_name, bool _copy_on_write)
+{
+	close();
+	copy_on_write = _copy_on_write;
+	int fd = ::open(file_name.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	int prot = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+	void* view = mmap(0, size_t(st.st_size), prot, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after the descriptor has been closed
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+	data = (char*)view;
+	data_size = size_t(st.st_size);
+	return true;
+}
+
+void mapped_file::close()
+{
+	if (data)
+		munmap(data, data_size);
+	data = 0;
+	data_size = 0;
+}
+
+void mapped_file::advise_sequential(size_t offset, size_t length) const
+{
+	if (!data || offset >= data_size)
+		return;
+	// madvise requires a page aligned start address
+	size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+	size_t begin = offset - offset % page_size;
+	if (length > data_size - offset)
+		length = data_size - offset;
+	madvise(data + begin, offset + length - begin, MADV_SEQUENTIAL);
+}
+
+#endif
+
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace utils {
+/**
+* read only view of a whole file mapped into the address space of the process.
+*
+* By default the view is mapped copy-on-write: the pages can be written through
+* the pointer returned by get_data(), but modified pages are copied privately by the
+* operating system and never written back to the file. Untouched pages are shared with
+* the file system cache such that opening a file is O(1) and the resident memory only
+* grows with the pages that are actually accessed.
+*/
+class CGV_API mapped_file
+{
+protected:
+	/// file handle
+	void* file;
+	/// handle of the file mapping object (only used on windows)
+	void* mapping;
+	/// pointer to the mapped view
+	char* data;
+	/// size of the mapped view in bytes
+	size_t data_size;
+	/// whether the view was mapped copy-on-write
+	bool copy_on_write;
+private:
+	/// copying a mapping is not allowed
+	mapped_file(const mapped_file&);
+	/// assigning a mapping is not allowed
+	mapped_file& operator = (const mapped_file&);
+public:
+	/// construct without mapping a file
+	mapped_file();
+	/// construct and map the given file
+	mapped_file(const std::string& file_name, bool _copy_on_write = true);
+	/// unmap the file
+	~mapped_file();
+	/// map the given file, if a file is mapped already it is unmapped first; return whether successful
+	bool open(const std::string& file_name, bool _copy_on_write = true);
+	/// unmap the file
+	void close();
+	/// return whether a file is mapped
+	bool is_open() const { return data != 0; }
+	/// return whether pages are writable through copy-on-write
+	bool is_copy_on_write() const { return copy_on_write; }
+	/// return size of the mapped file in bytes
+	size_t get_size() const { return data_size; }
+	/// return pointer to the first byte of the mapped view
+	char* get_data() { return data; }
+	/// return const pointer to the first byte of the mapped view
+	const char* get_data() const { return data; }
+	/// hint the operating system that the given byte range will be accessed sequentially
+	void advise_sequential(size_t offset = 0, size_t length = size_t(-1)) const;
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
@@ -44,6 +44,18 @@ extern CGV_API bool is_integer(const std::string& s, int& value);
 extern CGV_API bool is_double(const char* begin, const char* end, double& value);
 /// check if the passed string defines a double value. If yes, store the value in the passed reference.
 extern CGV_API bool is_double(const std::string& s, double& value);
+/** parse an integer of the form [+-]digits at the beginning of the text range (begin,end( and return the pointer
+    behind the last parsed character. If no integer is found or it does not fit into an int, begin is returned and
+	value is not changed. */
+extern CGV_API const char* from_chars(const char* begin, const char* end, int& value);
+/** parse a floating point number of the form [+-]digits[.digits][(e|E)[+-]digits], where the digits before or after
+    the dot can be omitted, or one of inf, infinity and nan at the beginning of the text range (begin,end( and return
+	the pointer behind the last parsed character. If no number is found, begin is returned and value is not changed.
+	Parsing does not depend on the locale, does not allocate memory and is correctly rounded. Values out of range
+	become infinity or zero. */
+extern CGV_API const char* from_chars(const char* begin, const char* end, double& value);
+/// same as from_chars for doubles but correctly rounded to float
+extern CGV_API const char* from_chars(const char* begin, const char* end, float& value);
 extern CGV_API bool is_year(const char* begin, const char* end, unsigned short& year, bool short_allowed = true);
 extern CGV_API bool is_year(const std::string& s, unsigned short& year, bool short_allowed = true);
 extern CGV_API bool is_day(const char* begin, const char* end, unsigned char& day);
@@ -1,6 +1,7 @@
 #include "gl_implicit_surface_drawable_base.h"
 #include <cgv/media/mesh/marching_cubes.h>
 #include <cgv/media/mesh/dual_contouring.h>
+#include <cgv/media/mesh/narrow_band_func.h>
 
 #include <cgv/render/drawable.h>
 #include <cgv/render/shader_program.h>
@@ -43,6 +44,10 @@ gl_implicit_surface_drawable_base::gl_implicit_surface_drawable_base() : box(dve
 	sm_ptr = 0;
 	epsilon = 1e-8;
 	grid_epsilon = 0.01;
+	narrow_band = false;
+	lipschitz_constant = 0;
+	block_size = 8;
+	nr_sample_evaluations = 0;
 	ix=iy=iz=0;
 	show_mini_box = false;
 	material.set_diffuse_reflectance(rgb(0.3f,0.1f,0.7f));
@@ -178,6 +183,39 @@ double gl_implicit_surface_drawable_base::get_grid_epsilon() const
 }
 
 
+void gl_implicit_surface_drawable_base::enable_narrow_band(bool do_enable)
+{
+	narrow_band = do_enable;
+	post_rebuild();
+}
+
+bool gl_implicit_surface_drawable_base::is_narrow_band_enabled() const
+{
+	return narrow_band;
+}
+
+void gl_implicit_surface_drawable_base::set_lipschitz_constant(double _lipschitz_constant)
+{
+	lipschitz_constant = _lipschitz_constant;
+	post_rebuild();
+}
+
+double gl_implicit_surface_drawable_base::get_lipschitz_constant() const
+{
+	return lipschitz_constant;
+}
+
+void gl_implicit_surface_drawable_base::set_block_size(unsigned int _block_size)
+{
+	block_size = _block_size;
+	post_rebuild();
+}
+
+unsigned int gl_implicit_surface_drawable_base::get_block_size() const
+{
+	return block_size;
+}
+
 void gl_implicit_surface_drawable_base::set_box(const dbox3& _box)
 {
 	box = _box;
@@ -199,6 +237,11 @@ unsigned int gl_implicit_surface_drawable_base::get_nr_vertices_of_last_extracti
 	return nr_vertices;
 }
 
+size_t gl_implicit_surface_drawable_base::get_nr_sample_evaluations_of_last_extraction() const
+{
+	return nr_sample_evaluations;
+}
+
 
 void gl_implicit_surface_drawable_base::add_normal(const dvec3& p, const dvec3& n, std::vector<float>& nml_gradient_geometry) const
 {
@@ -361,10 +404,17 @@ void gl_implicit_surface_drawable_base::surface_extraction()
 {
 	nr_faces = 0;
 	nr_vertices = 0;
+	// in narrow band mode classify blocks of the sampling grid and extract from the wrapped function
+	cgv::media::mesh::narrow_band_func<double,double> nb_func(*func_ptr, lipschitz_constant, block_size);
+	const F* extraction_func_ptr = func_ptr;
+	if (narrow_band) {
+		nb_func.build(0, box, res, res, res);
+		extraction_func_ptr = &nb_func;
+	}
 	switch (contouring_type) {
 	case MARCHING_CUBES :
 		{
-			cgv::media::mesh::marching_cubes<double,double> mc(*func_ptr,this,grid_epsilon,epsilon);
+			cgv::media::mesh::marching_cubes<double,double> mc(*extraction_func_ptr,this,grid_epsilon,epsilon);
 			sm_ptr = &mc;
 			mc.extract(0,box,res,res,res,res>40);
 			nr_vertices = mc.get_nr_vertices();
@@ -373,7 +423,7 @@ void gl_implicit_surface_drawable_base::surface_extraction()
 		break;
 	case DUAL_CONTOURING :
 		{
-			cgv::media::mesh::dual_contouring<double,double> dc(*func_ptr,this,consistency_threshold, max_nr_iters, epsilon);
+			cgv::media::mesh::dual_contouring<double,double> dc(*extraction_func_ptr,this,consistency_threshold, max_nr_iters, epsilon);
 			sm_ptr = &dc;
 			dc.extract(0,box,res,res,res,res>40);
 			nr_vertices = dc.get_nr_vertices();
@@ -381,6 +431,7 @@ void gl_implicit_surface_drawable_base::surface_extraction()
 		}
 		break;
 	}
+	nr_sample_evaluations = narrow_band ? nb_func.get_nr_sample_evaluations() : size_t(res)*res*res;
 }
 
 void gl_implicit_surface_drawable_base::build_display_list()
@@ -78,6 +78,14 @@ protected: //@<
 	double epsilon;
 	//@>
 	double grid_epsilon;
+	/// whether to evaluate the function only in a narrow band around the surface
+	bool narrow_band;
+	/// Lipschitz constant of the function used to skip blocks in narrow band mode if the function provides no bounds, 0 if unknown
+	double lipschitz_constant;
+	/// number of samples per block along each axis in narrow band mode
+	unsigned int block_size;
+	/// number of function evaluations on the sampling grid in last extraction
+	size_t nr_sample_evaluations;
 
 	//@>
 	int nr_faces;
@@ -142,11 +150,24 @@ public:
 	void set_grid_epsilon(double _grid_epsilon);
 	double get_grid_epsilon() const;
 
+	/** enable evaluation of the function only in blocks of the sampling grid, which can contain the surface according
+	    to the bounds provided by the function or the Lipschitz constant. The extracted mesh is the same as without. */
+	void enable_narrow_band(bool do_enable = true);
+	bool is_narrow_band_enabled() const;
+
+	void set_lipschitz_constant(double _lipschitz_constant);
+	double get_lipschitz_constant() const;
+
+	void set_block_size(unsigned int _block_size);
+	unsigned int get_block_size() const;
+
 	void set_box(const dbox3& _box);
 	const dbox3& get_box() const;
 
 	unsigned int get_nr_triangles_of_last_extraction() const;
 	unsigned int get_nr_vertices_of_last_extraction() const;
+	/// return the number of function evaluations on the sampling grid in the last extraction
+	size_t get_nr_sample_evaluations_of_last_extraction() const;
 
 	/// use this as callback to ask for a re-tesselation of the implicit surface
 	void post_rebuild();
@@ -2,14 +2,21 @@
 
 #include <vector>
 #include "point_cloud.h"
+#include "kd_tree.h"
 
 #include "lib_begin.h"
 
-/** uses ann to provide a data structure to build a knn neighbor graph */
+/** provides a kd-tree over the points of a point cloud to build a knn neighbor graph. The name stems from
+    the previously used ann library, which has been replaced by the header only kd_tree that references the
+	points of the point cloud without copying them. All queries are thread-safe. Indices returned by the
+	queries are point indices of the point cloud. */
 class CGV_API ann_tree : public point_cloud_types
 {
+public:
+	/// type of underlying kd-tree
+	typedef kd_tree<Crd, 3> tree_type;
 protected:
-	void* ann_impl;
+	tree_type tree;
 	const point_cloud* pc;
 	Cnt k;
 public:
@@ -31,6 +38,10 @@ public:
 	Idx find_closest(const Pnt& p) const;
 	/// knn query that returns pointers to points
 	void find_closest_points(const Pnt& p, Idx k, std::vector<const Pnt*>& knn) const;
+	/// find indices of all points within the given radius around p sorted by increasing distance
+	void find_points_in_radius(const Pnt& p, Crd radius, std::vector<Idx>& N) const;
+	/// give access to the underlying kd-tree
+	const tree_type& get_tree() const { return tree; }
 };
 
 #include <cgv/config/lib_end.h>
\ No newline at end of file
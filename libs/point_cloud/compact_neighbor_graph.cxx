@@ -0,0 +1,166 @@
+#include "compact_neighbor_graph.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+using namespace std;
+
+compact_neighbor_graph::compact_neighbor_graph()
+{
+}
+
+void compact_neighbor_graph::clear()
+{
+	offsets.clear();
+	neighbor_indices.clear();
+	reverse_indices.clear();
+}
+
+size_t compact_neighbor_graph::get_memory_usage() const
+{
+	return offsets.size()*sizeof(Off) + (neighbor_indices.size() + reverse_indices.size())*sizeof(Idx);
+}
+
+int compact_neighbor_graph::find(Idx vi, Idx vj) const
+{
+	neighbor_range Ni = neighbors(vi);
+	for (Idx j = 0; j < (Idx)Ni.size(); ++j) {
+		if (Ni[j] == vj)
+			return j;
+	}
+	return -1;
+}
+
+void compact_neighbor_graph::collect_cycle(Idx vi, Idx ni, std::vector<graph_location>& cycle, int max_cycle_length) const
+{
+	graph_location gl0(vi, ni);
+	cycle.push_back(gl0);
+	graph_location gl = gl0;
+	do {
+		gl = next(gl);
+		if (gl.ni == -1 || gl == gl0)
+			break;
+		cycle.push_back(gl);
+		if (max_cycle_length != -1 && (int)cycle.size() >= max_cycle_length)
+			break;
+	} while (true);
+}
+
+graph_location compact_neighbor_graph::follow_edge(const graph_location& gl) const
+{
+	Off he = offsets[gl.vi] + gl.ni;
+	Idx vj = neighbor_indices[he];
+	Idx nj = reverse_indices.empty() ? find(vj, gl.vi) : reverse_indices[he];
+	return graph_location(vj, nj, !gl.outwards);
+}
+
+graph_location compact_neighbor_graph::follow_wedge(const graph_location& gl) const
+{
+	assert(!gl.outwards);
+	if (gl.ni == -1)
+		return gl;
+	return graph_location(gl.vi, (gl.ni + 1) % get_nr_neighbors(gl.vi), true);
+}
+
+void compact_neighbor_graph::compress(const neighbor_graph& ng)
+{
+	clear();
+	Idx n = (Idx)ng.size();
+	offsets.resize(n + 1);
+	offsets[0] = 0;
+	for (Idx i = 0; i < n; ++i)
+		offsets[i + 1] = offsets[i] + Off(ng[i].size());
+	neighbor_indices.resize(offsets[n]);
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx i) {
+		std::copy(ng[i].begin(), ng[i].end(), neighbor_indices.begin() + offsets[i]);
+	});
+}
+
+void compact_neighbor_graph::expand(neighbor_graph& ng) const
+{
+	ng.clear();
+	Idx n = (Idx)size();
+	ng.resize(n);
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx i) {
+		neighbor_range Ni = neighbors(i);
+		ng[i].assign(Ni.begin(), Ni.end());
+	});
+	ng.nr_half_edges = get_nr_half_edges();
+}
+
+void compact_neighbor_graph::symmetrize()
+{
+	Idx n = (Idx)size();
+	destruct_reverse_index();
+	// count incoming edges per vertex
+	vector<atomic<Cnt> > in_degree(n);
+	for (Idx i = 0; i < n; ++i)
+		in_degree[i] = 0;
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx i) {
+		neighbor_range Ni = neighbors(i);
+		for (size_t j = 0; j < Ni.size(); ++j)
+			++in_degree[Ni[j]];
+	});
+	vector<Off> rev_offsets(n + 1);
+	rev_offsets[0] = 0;
+	for (Idx i = 0; i < n; ++i)
+		rev_offsets[i + 1] = rev_offsets[i] + in_degree[i];
+	// scatter sources of edges into reverse edge lists, in_degree is reused as fill counter
+	vector<Idx> sources(rev_offsets[n]);
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx i) {
+		neighbor_range Ni = neighbors(i);
+		for (size_t j = 0; j < Ni.size(); ++j)
+			sources[rev_offsets[Ni[j]] + --in_degree[Ni[j]]] = i;
+	});
+	// sort reverse lists and remove the sources already contained in the neighbor list by marking them with -1
+	vector<Off> new_offsets(n + 1);
+	new_offsets[0] = 0;
+	parallel_for(Idx(0), n, Idx(1024), [&](Idx j) {
+		vector<Idx>::iterator rev_begin = sources.begin() + rev_offsets[j];
+		vector<Idx>::iterator rev_end = sources.begin() + rev_offsets[j + 1];
+		std::sort(rev_begin, rev_end);
+		neighbor_range Nj = neighbors(j);
+		static thread_local vector<Idx> sorted_Nj;
+		sorted_Nj.assign(Nj.begin(), Nj.end());
+		std::sort(sorted_Nj.begin(), sorted_Nj.end());
+		Cnt nr_added = 0;
+		vector<Idx>::const_iterator iter = sorted_Nj.begin();
+		for (vector<Idx>::iterator rev_iter = rev_begin; rev_iter != rev_end; ++rev_iter) {
+			while (iter != sorted_Nj.end() && *iter < *rev_iter)
+				++iter;
+			if (iter != sorted_Nj.end() && *iter == *rev_iter)
+				*rev_iter = -1;
+			else
+				++nr_added;
+		}
+		new_offsets[j + 1] = Off(Nj.size()) + nr_added;
+	});
+	for (Idx j = 0; j < n; ++j)
+		new_offsets[j + 1] += new_offsets[j];
+	// fill symmetrized neighbor lists
+	vector<Idx> new_neighbor_indices(new_offsets[n]);
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx j) {
+		neighbor_range Nj = neighbors(j);
+		vector<Idx>::iterator dst = std::copy(Nj.begin(), Nj.end(), new_neighbor_indices.begin() + new_offsets[j]);
+		for (Off r = rev_offsets[j]; r < rev_offsets[j + 1]; ++r)
+			if (sources[r] != -1)
+				*dst++ = sources[r];
+	});
+	offsets.swap(new_offsets);
+	neighbor_indices.swap(new_neighbor_indices);
+}
+
+void compact_neighbor_graph::compute_reverse_index()
+{
+	Idx n = (Idx)size();
+	reverse_indices.resize(neighbor_indices.size());
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx i) {
+		for (Off he = offsets[i]; he < offsets[i + 1]; ++he)
+			reverse_indices[he] = find(neighbor_indices[he], i);
+	});
+}
+
+void compact_neighbor_graph::destruct_reverse_index()
+{
+	std::vector<Idx>().swap(reverse_indices);
+}
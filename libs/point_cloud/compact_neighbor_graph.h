@@ -0,0 +1,119 @@
+#pragma once
+
+#include "neighbor_graph.h"
+
+#include "lib_begin.h"
+
+/** Compressed sparse row representation of a knn-neighbor graph. The neighbors of all vertices are stored
+    in one flat array and an offset array of size n+1 gives the range of each vertex. An optional reverse index
+	stores for each half-edge the position of the opposite half-edge in the neighbor list of its target vertex,
+	such that follow_edge runs in constant time. Compared to neighbor_graph, the per vertex heap allocation and
+	vector header are avoided, which roughly halves the memory for k = 12..30 and keeps traversals cache friendly.
+	The graph cannot be edited in place, use expand() to obtain an editable neighbor_graph. */
+class CGV_API compact_neighbor_graph
+{
+public:
+	/// index type
+	typedef graph_location::Idx Idx;
+	/// count type
+	typedef graph_location::Cnt Cnt;
+	/// type of half-edge offsets, which is 64 bit as n*k can exceed 32 bit for large point clouds
+	typedef cgv::type::uint64_type Off;
+protected:
+	/// offsets of the neighbor lists in the flat neighbor array, has one entry more than there are vertices
+	std::vector<Off> offsets;
+	/// flat array of neighbor indices
+	std::vector<Idx> neighbor_indices;
+	/// per half-edge index of the reverse half-edge within the neighbor list of the target or -1 if not contained
+	std::vector<Idx> reverse_indices;
+public:
+	/// construct empty graph
+	compact_neighbor_graph();
+	/// remove all vertices and edges
+	void clear();
+	/// return number of vertices
+	size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	/// check whether graph is empty
+	bool empty() const { return size() == 0; }
+	/// return total number of half-edges
+	Off get_nr_half_edges() const { return Off(neighbor_indices.size()); }
+	/// return number of bytes used by the graph
+	size_t get_memory_usage() const;
+
+	/**@name queries*/
+	//@{
+	/// return the number of neighbors of vi
+	Cnt get_nr_neighbors(Idx vi) const { return Cnt(offsets[vi + 1] - offsets[vi]); }
+	/// return view of the neighbors of vi
+	neighbor_range neighbors(Idx vi) const { const Idx* b = neighbor_indices.data(); return neighbor_range(b + offsets[vi], b + offsets[vi + 1]); }
+	/// same as neighbors
+	neighbor_range operator [] (Idx vi) const { return neighbors(vi); }
+	/// find index of vj in neighbors of vi and return -1 if not found
+	int find(Idx vi, Idx vj) const;
+	/// check if the directed edge from vi to vj is contained in the neighbor graph
+	bool is_directed_edge(Idx vi, Idx vj) const { return find(vi, vj) != -1; }
+	/// collect a closed loop starting it outward direction at vi towards neighbor ni, stops at the first missing reverse edge
+	void collect_cycle(Idx vi, Idx ni, std::vector<graph_location>& cycle, int max_cycle_length = -1) const;
+	//@}
+
+	/**@name graph location based navigation*/
+	//@{
+	/// return index of the vertex the location points to
+	Idx vi(const graph_location& gl) const { return neighbor_indices[offsets[gl.vi] + gl.ni]; }
+	/// toggle outwards flag
+	graph_location inv(const graph_location& gl) const { return graph_location(gl.vi, gl.ni, !gl.outwards); }
+	/// move to neighbor along edge and toggle outwards flag, constant time if reverse index is available; the neighbor index of the result is -1 if the reverse edge is missing
+	graph_location follow_edge(const graph_location& gl) const;
+	/// cycle around corner of vertex (goes to next neighbor and toggles outwards flag), passes through locations with invalid neighbor index -1
+	graph_location follow_wedge(const graph_location& gl) const;
+	/// follow edge and then follow wedge
+	graph_location next(const graph_location& gl) const { return follow_wedge(follow_edge(gl)); }
+	//@}
+
+	/**@name construction */
+	//@{
+	/** build a knn neighbor graph for n points in parallel from a data structure that provides the thread-safe method
+	    extract_neighbors(i, k, vector<Idx>&), which may return less than k neighbors, e.g. if n <= k. */
+	template <typename knn_info>
+	void build(Cnt n, Cnt k, const knn_info& knn, cgv::utils::statistics* he_stats = 0) {
+		clear();
+		// extract neighbors into slots of k entries per vertex and count them
+		std::vector<Cnt> counts(n);
+		neighbor_indices.resize(size_t(n)*k);
+		parallel_for(Idx(0), Idx(n), Idx(1024), [&](Idx i) {
+			static thread_local std::vector<Idx> Ni;
+			knn.extract_neighbors(i, k, Ni);
+			counts[i] = std::min(Cnt(Ni.size()), k);
+			std::copy(Ni.begin(), Ni.begin() + counts[i], neighbor_indices.begin() + size_t(i)*k);
+		});
+		// compute offsets by prefix sum and close gaps of vertices with less than k neighbors
+		offsets.resize(size_t(n) + 1);
+		offsets[0] = 0;
+		for (Cnt i = 0; i < n; ++i) {
+			if (offsets[i] != Off(i)*k)
+				std::copy(neighbor_indices.begin() + size_t(i)*k, neighbor_indices.begin() + size_t(i)*k + counts[i], neighbor_indices.begin() + offsets[i]);
+			offsets[i + 1] = offsets[i] + counts[i];
+		}
+		neighbor_indices.resize(offsets[n]);
+		if (he_stats) {
+			he_stats->init();
+			for (Cnt i = 0; i < n; ++i)
+				he_stats->update(counts[i]);
+		}
+	}
+	/// construct from a neighbor graph
+	void compress(const neighbor_graph& ng);
+	/// copy to an editable neighbor graph
+	void expand(neighbor_graph& ng) const;
+	/// ensure the graph to be symmetric by appending missing reverse edges in the same order as neighbor_graph::symmetrize; invalidates reverse index
+	void symmetrize();
+	/// compute the reverse index of all half-edges in parallel
+	void compute_reverse_index();
+	/// check whether reverse index is available
+	bool has_reverse_index() const { return !reverse_indices.empty() || neighbor_indices.empty(); }
+	/// deallocate reverse index
+	void destruct_reverse_index();
+	//@}
+};
+
+#include <cgv/config/lib_end.h>
@@ -0,0 +1,188 @@
+#include "depth_sorter.h"
+#include "parallel_for.h"
+#include "sort_keys.h"
+#include <chrono>
+#include <cmath>
+
+typedef std::chrono::high_resolution_clock clock_type;
+
+static double milliseconds_since(const clock_type::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+depth_sorter::depth_sorter() : has_order(false), job_incremental(false), job_sort_time(0), job_done(false), job_running(false), view_dir_epsilon(1e-5f), repair_angle(0.1f)
+{
+}
+
+depth_sorter::~depth_sorter()
+{
+	if (job_running)
+		job_future.wait();
+}
+
+bool depth_sorter::insertion_sort(std::vector<cgv::type::uint32_type>& keys, std::vector<Idx>& values, size_t max_nr_moves)
+{
+	size_t n = keys.size(), nr_moves = 0;
+	for (size_t i = 1; i < n; ++i) {
+		cgv::type::uint32_type k = keys[i];
+		if (keys[i - 1] <= k)
+			continue;
+		Idx v = values[i];
+		size_t j = i;
+		do {
+			keys[j] = keys[j - 1];
+			values[j] = values[j - 1];
+			--j;
+		} while (j > 0 && keys[j - 1] > k);
+		keys[j] = k;
+		values[j] = v;
+		nr_moves += i - j;
+		if (nr_moves > max_nr_moves)
+			return false;
+	}
+	return true;
+}
+
+void depth_sorter::radix_sort(std::vector<cgv::type::uint32_type>& keys, std::vector<Idx>& values,
+	std::vector<cgv::type::uint32_type>& tmp_keys, std::vector<Idx>& tmp_values)
+{
+	// three passes over 11 bit digits with per block histograms, such that blocks are scattered concurrently and the sort stays stable
+	const unsigned nr_bits = 11, nr_buckets = 1 << nr_bits;
+	size_t n = keys.size();
+	tmp_keys.resize(n);
+	tmp_values.resize(n);
+	size_t nr_blocks = std::max(size_t(1), std::min(size_t(get_nr_worker_threads()), n / 65536));
+	std::vector<size_t> H(nr_blocks*nr_buckets);
+	for (unsigned shift = 0; shift < 32; shift += nr_bits) {
+		parallel_for(size_t(0), nr_blocks, size_t(1), [&](size_t b) {
+			size_t* h = &H[b*nr_buckets];
+			std::fill(h, h + nr_buckets, size_t(0));
+			for (size_t i = n*b / nr_blocks; i < n*(b + 1) / nr_blocks; ++i)
+				++h[(keys[i] >> shift) & (nr_buckets - 1)];
+		});
+		// exclusive prefix sum in bucket major order, skip pass if all keys fall into the same bucket
+		size_t sum = 0;
+		bool trivial = false;
+		for (unsigned d = 0; d < nr_buckets; ++d) {
+			size_t bucket_begin = sum;
+			for (size_t b = 0; b < nr_blocks; ++b) {
+				size_t cnt = H[b*nr_buckets + d];
+				H[b*nr_buckets + d] = sum;
+				sum += cnt;
+			}
+			if (sum - bucket_begin == n)
+				trivial = true;
+		}
+		if (trivial)
+			continue;
+		parallel_for(size_t(0), nr_blocks, size_t(1), [&](size_t b) {
+			size_t* h = &H[b*nr_buckets];
+			for (size_t i = n*b / nr_blocks; i < n*(b + 1) / nr_blocks; ++i) {
+				size_t pos = h[(keys[i] >> shift) & (nr_buckets - 1)]++;
+				tmp_keys[pos] = keys[i];
+				tmp_values[pos] = values[i];
+			}
+		});
+		keys.swap(tmp_keys);
+		values.swap(tmp_values);
+	}
+}
+
+void depth_sorter::sort_job()
+{
+	clock_type::time_point start = clock_type::now();
+	size_t n = depth_keys.size();
+	job_keys.resize(n);
+	if (job_incremental) {
+		// gather keys in previous order and repair it if the points moved only few positions in the order
+		job_values = order_slots;
+		for (size_t i = 0; i < n; ++i)
+			job_keys[i] = depth_keys[job_values[i]];
+		job_incremental = insertion_sort(job_keys, job_values, 2 * n);
+	}
+	else {
+		job_values.resize(n);
+		for (size_t i = 0; i < n; ++i)
+			job_values[i] = Idx(i);
+		std::copy(depth_keys.begin(), depth_keys.end(), job_keys.begin());
+	}
+	if (!job_incremental)
+		radix_sort(job_keys, job_values, tmp_keys, tmp_values);
+	job_order.resize(n);
+	for (size_t i = 0; i < n; ++i)
+		job_order[i] = indices[job_values[i]];
+	job_sort_time = milliseconds_since(start);
+	job_done = true;
+}
+
+void depth_sorter::finish_job()
+{
+	if (!job_running)
+		return;
+	job_future.get();
+	job_running = false;
+	order.swap(job_order);
+	order_slots.swap(job_values);
+	order_view_dir = job_view_dir;
+	has_order = true;
+	stats.sort_time = job_sort_time;
+	stats.nr_points = order.size();
+	stats.last_sort_incremental = job_incremental;
+	if (job_incremental)
+		++stats.nr_incremental_sorts;
+	else
+		++stats.nr_full_sorts;
+}
+
+void depth_sorter::invalidate()
+{
+	if (job_running) {
+		job_future.get();
+		job_running = false;
+	}
+	has_order = false;
+	order.clear();
+	order_slots.clear();
+}
+
+void depth_sorter::set_indices(const std::vector<Idx>& _indices)
+{
+	invalidate();
+	indices = _indices;
+}
+
+void depth_sorter::update(const Pnt* points, const Pnt& view_dir)
+{
+	stats.wait_time = 0;
+	if (job_running) {
+		if (!job_done)
+			return;
+		finish_job();
+	}
+	if (has_order && (order_view_dir - view_dir).length() <= view_dir_epsilon)
+		return;
+
+	// compute keys in render thread and repair previous order in the worker if the view direction changed only little
+	clock_type::time_point start = clock_type::now();
+	job_incremental = has_order &&
+		dot(order_view_dir, view_dir) >= std::cos(repair_angle)*order_view_dir.length()*view_dir.length();
+	depth_keys.resize(indices.size());
+	parallel_for(size_t(0), indices.size(), size_t(16384), [&](size_t i) {
+		depth_keys[i] = float_to_key(-dot(points[indices[i]], view_dir));
+	});
+	stats.key_time = milliseconds_since(start);
+
+	// sort in a task of the global thread pool, whose nested parallel loops are executed by the other workers
+	job_view_dir = view_dir;
+	job_done = false;
+	job_running = true;
+	job_future = cgv::os::thread_pool::get_global().submit([this]() { sort_job(); });
+
+	// without a previous ordering wait for the result
+	if (!has_order) {
+		start = clock_type::now();
+		finish_job();
+		stats.wait_time = milliseconds_since(start);
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+#include <future>
+#include <atomic>
+#include <cgv/math/fvec.h>
+#include <cgv/type/standard_types.h>
+
+#include "lib_begin.h"
+
+/// timing counters of the depth sorter, all times in milliseconds
+struct depth_sort_statistics
+{
+	/// number of sorted points
+	size_t nr_points;
+	/// time spent in the render thread to compute the sort keys of the last sort
+	double key_time;
+	/// time spent in the thread pool for the last sort
+	double sort_time;
+	/// time the render thread waited for a sort to complete in the last call to update()
+	double wait_time;
+	/// whether the last sort repaired the previous order by insertion instead of a full radix sort
+	bool last_sort_incremental;
+	/// number of full radix sorts
+	unsigned nr_full_sorts;
+	/// number of sorts that repaired the previous order
+	unsigned nr_incremental_sorts;
+	/// set all counters to zero
+	depth_sort_statistics() : nr_points(0), key_time(0), sort_time(0), wait_time(0), last_sort_incremental(false), nr_full_sorts(0), nr_incremental_sorts(0) {}
+};
+
+/** computes back to front orderings of a subset of points in a task of the global thread pool. The render thread calls update()
+    once per frame with the current view direction. This takes over a completed ordering and starts a new sort if
+	the view direction has changed. The render thread only computes the sort keys in a sequential pass over
+	the points, such that the points are not accessed concurrently to modifications of the point cloud. Keys are sorted with a parallel radix sort
+	or, for small changes of the view direction, the previous order is repaired with an insertion sort whose
+	cost is bounded by a multiple of the number of points. */
+class CGV_API depth_sorter
+{
+public:
+	/// index type used in the orderings
+	typedef cgv::type::uint32_type Idx;
+	/// point type
+	typedef cgv::math::fvec<float, 3> Pnt;
+protected:
+	/// indices of the points to be sorted
+	std::vector<Idx> indices;
+	/// latest completed ordering
+	std::vector<Idx> order;
+	/// latest completed ordering as positions in the index vector
+	std::vector<Idx> order_slots;
+	/// view direction of the latest completed ordering
+	Pnt order_view_dir;
+	/// whether the latest ordering is complete and valid
+	bool has_order;
+	/// sort keys of the points in the order of the index vector, computed by the render thread
+	std::vector<cgv::type::uint32_type> depth_keys;
+	/// keys and positions in the index vector processed by the worker
+	std::vector<cgv::type::uint32_type> job_keys;
+	std::vector<Idx> job_values;
+	/// ordering computed by the worker
+	std::vector<Idx> job_order;
+	/// temporary buffers of radix sort
+	std::vector<cgv::type::uint32_type> tmp_keys;
+	std::vector<Idx> tmp_values;
+	/// view direction of the running job
+	Pnt job_view_dir;
+	/// whether the running job starts from the previous order, reset by the worker if the repair failed
+	bool job_incremental;
+	/// time used by the worker for the running job
+	double job_sort_time;
+	/// completion of the running job, which is executed in the global thread pool
+	std::future<void> job_future;
+	/// set by the worker when the job is finished
+	std::atomic<bool> job_done;
+	/// whether a job has been started and not been taken over yet
+	bool job_running;
+	/// minimal change of the view direction that triggers a new sort
+	float view_dir_epsilon;
+	/// maximal angle between view directions in radians up to which the previous order is repaired
+	float repair_angle;
+	/// timing counters
+	depth_sort_statistics stats;
+	/// sort the job keys and values in a task of the thread pool
+	void sort_job();
+	/// wait for the running job and take over its result
+	void finish_job();
+public:
+	/// construct sorter
+	depth_sorter();
+	/// wait for running job
+	~depth_sorter();
+	/// set the indices of the points to be sorted, waits for a running job and discards the current ordering
+	void set_indices(const std::vector<Idx>& _indices);
+	/// return the indices of the points to be sorted
+	const std::vector<Idx>& get_indices() const { return indices; }
+	/// discard the current ordering, e.g. after the points changed
+	void invalidate();
+	/** take over a completed ordering and start a new sort if the view direction changed. If no ordering is
+	    available, wait for the sort such that get_order() is valid afterwards. The points are only read in
+		this call. */
+	void update(const Pnt* points, const Pnt& view_dir);
+	/// return the latest completed ordering from back to front
+	const std::vector<Idx>& get_order() const { return order; }
+	/// set the minimal change of the view direction that triggers a new sort
+	void set_view_dir_epsilon(float eps) { view_dir_epsilon = eps; }
+	/// set the maximal angle in radians up to which the previous order is repaired instead of sorted from scratch
+	void set_repair_angle(float angle) { repair_angle = angle; }
+	/// return timing counters
+	const depth_sort_statistics& get_statistics() const { return stats; }
+	/// sort values by keys in ascending order with a stable parallel radix sort, the temporary vectors are resized as needed
+	static void radix_sort(std::vector<cgv::type::uint32_type>& keys, std::vector<Idx>& values,
+		std::vector<cgv::type::uint32_type>& tmp_keys, std::vector<Idx>& tmp_values);
+	/// sort values by keys with insertion sort if this takes at most max_nr_moves element moves and return false otherwise, leaving a permutation of the input
+	static bool insertion_sort(std::vector<cgv::type::uint32_type>& keys, std::vector<Idx>& values, size_t max_nr_moves);
+};
+
+#include <cgv/config/lib_end.h>
@@ -49,6 +49,19 @@ bool gl_point_cloud_drawable::read(const std::string& _file_name)
 		cerr << "point cloud " << _file_name << " not found" << endl;
 		return false;
 	}
+	ooc_pc.close();
+	if (cgv::utils::to_lower(get_extension(fn)) == "opc") {
+		if (!ooc_pc.open(fn)) {
+			cerr << "could not open out of core point cloud " << fn << endl;
+			return false;
+		}
+		// show the points of the root node until the first update selects the nodes for the view
+		ooc_pc.extract_root_points(pc);
+		show_point_begin = 0;
+		show_point_end = pc.get_nr_points();
+		post_redraw();
+		return true;
+	}
 	if (!pc.read(fn)) {
 		cerr << "could not read point cloud " << fn << endl;
 		return false;
@@ -93,6 +106,13 @@ bool gl_point_cloud_drawable::append(const std::string& _file_name, bool add_com
 
 bool gl_point_cloud_drawable::write(const std::string& fn)
 {
+	if (cgv::utils::to_lower(get_extension(fn)) == "opc") {
+		if (!octree_point_cloud::build(pc, fn)) {
+			cerr << "could not write out of core point cloud " << fn << endl;
+			return false;
+		}
+		return true;
+	}
 	if (!pc.write(fn)) {
 		cerr << "could not write point cloud " << fn << endl;
 		return false;
@@ -222,39 +242,51 @@ void gl_point_cloud_drawable::draw_points(context& ctx)
 	GLint offset = GLint(show_point_begin / show_point_step);
 
 	if (sort_points && ensure_view_pointer()) {
-		struct sort_pred {
-			const point_cloud& pc;
-			const Pnt& view_dir;
-			bool operator () (GLuint i, GLuint j) const {
-				return dot(pc.pnt(i), view_dir) > dot(pc.pnt(j), view_dir);
-			}
-			sort_pred(const point_cloud& _pc, const Pnt& _view_dir) : pc(_pc), view_dir(_view_dir) {}
-		};
-		Pnt view_dir = view_ptr->get_view_dir();
-		std::vector<GLuint> indices;
-		if (pc.has_components() && use_these_component_colors) {
-			unsigned nr = 0;
-			for (unsigned ci = 0; ci < pc.get_nr_components(); ++ci) {
-				if ((*use_these_component_colors)[ci][3] > 0.0f) {
-					unsigned off = unsigned(pc.components[ci].index_of_first_point);
-					for (unsigned i = 0; i < pc.components[ci].nr_points; ++i)
-						indices.push_back((GLuint)(off + i));
-				}
-			}
+		// pass point subset to sorter only if it changed
+		std::vector<size_t> subset;
+		subset.push_back(pc.get_nr_points());
+		subset.push_back(size_t(&pc.pnt(0)));
+		bool per_component = pc.has_components() && use_these_component_colors;
+		if (per_component) {
+			for (unsigned ci = 0; ci < pc.get_nr_components(); ++ci)
+				subset.push_back((*use_these_component_colors)[ci][3] > 0.0f ? 1 : 0);
 		}
 		else {
-			indices.resize(n);
-			size_t i;
-			for (i = 0; i < indices.size(); ++i)
-				indices[i] = (GLuint)(show_point_step*i) + offset;
+			subset.push_back(n);
+			subset.push_back(show_point_step);
+			subset.push_back(size_t(offset));
+		}
+		if (subset != sorted_subset) {
+			std::vector<depth_sorter::Idx> indices;
+			if (per_component) {
+				for (unsigned ci = 0; ci < pc.get_nr_components(); ++ci) {
+					if ((*use_these_component_colors)[ci][3] > 0.0f) {
+						unsigned off = unsigned(pc.components[ci].index_of_first_point);
+						for (unsigned i = 0; i < pc.components[ci].nr_points; ++i)
+							indices.push_back((GLuint)(off + i));
+					}
+				}
+			}
+			else {
+				indices.resize(n);
+				size_t i;
+				for (i = 0; i < indices.size(); ++i)
+					indices[i] = (GLuint)(show_point_step*i) + offset;
+			}
+			point_sorter.set_indices(indices);
+			sorted_subset.swap(subset);
 		}
-		std::sort(indices.begin(), indices.end(), sort_pred(pc, view_dir));
+		// take over latest ordering and sort in background if view changed
+		Pnt view_dir = view_ptr->get_view_dir();
+		point_sorter.update(&pc.pnt(0), view_dir);
+		const std::vector<depth_sorter::Idx>& indices = point_sorter.get_order();
 
 		glDepthFunc(GL_ALWAYS);
 		size_t nn = indices.size() / nr_draw_calls;
 		for (unsigned i = 1; i<nr_draw_calls; ++i)
 			glDrawElements(GL_POINTS, GLsizei(nn), GL_UNSIGNED_INT, &indices[(i - 1)*nn]);
-		glDrawElements(GL_POINTS, GLsizei(indices.size() - (nr_draw_calls - 1)*nn), GL_UNSIGNED_INT, &indices[(nr_draw_calls - 1)*nn]);
+		if (!indices.empty())
+			glDrawElements(GL_POINTS, GLsizei(indices.size() - (nr_draw_calls - 1)*nn), GL_UNSIGNED_INT, &indices[(nr_draw_calls - 1)*nn]);
 		glDepthFunc(GL_LESS);
 	}
 	else {
@@ -313,6 +345,35 @@ bool gl_point_cloud_drawable::init(cgv::render::context& ctx)
 	return true;
 }
 
+bool gl_point_cloud_drawable::update_out_of_core_points(cgv::render::context& ctx)
+{
+	if (!ooc_pc.is_open() || !ensure_view_pointer())
+		return false;
+	dmat4 P = ctx.get_projection_matrix();
+	dmat4 MVP = P * ctx.get_modelview_matrix();
+	HMat mvp;
+	for (unsigned i = 0; i < 4; ++i)
+		for (unsigned j = 0; j < 4; ++j)
+			mvp(i, j) = Crd(MVP(i, j));
+	Crd projection_factor = Crd(0.5 * P(1, 1) * ctx.get_height());
+	bool changed = ooc_pc.update(Pnt(view_ptr->get_eye()), projection_factor, &mvp);
+	if (changed) {
+		ooc_pc.extract_rendered_points(pc);
+		show_point_begin = 0;
+		show_point_end = pc.get_nr_points();
+		sorted_subset.clear();
+	}
+	// keep refining while chunks are being loaded
+	if (ooc_pc.has_pending_loads())
+		post_redraw();
+	return changed;
+}
+
+void gl_point_cloud_drawable::init_frame(cgv::render::context& ctx)
+{
+	update_out_of_core_points(ctx);
+}
+
 void gl_point_cloud_drawable::clear(cgv::render::context& ctx)
 {
 	s_renderer.clear(ctx);
@@ -5,6 +5,8 @@
 #include <cgv/render/view.h>
 
 #include "point_cloud.h"
+#include "depth_sorter.h"
+#include "octree_point_cloud.h"
 
 #include <cgv_gl/surfel_renderer.h>
 #include <cgv_gl/normal_renderer.h>
@@ -48,8 +50,16 @@ protected:
 	unsigned show_point_step;
 	std::size_t show_point_begin, show_point_end;
 	unsigned nr_draw_calls;
+	// back to front ordering used if sort_points is enabled
+	depth_sorter point_sorter;
+	// description of the point subset given to the sorter used to detect changes
+	std::vector<size_t> sorted_subset;
+	// out of core point cloud whose rendered nodes are streamed into pc if an octree file is opened
+	octree_point_cloud ooc_pc;
 	cgv::render::view* view_ptr;
 	bool ensure_view_pointer();
+	/// update the nodes of an out of core point cloud for the current view and return whether pc has been replaced by the rendered points
+	bool update_out_of_core_points(cgv::render::context& ctx);
 	void set_arrays(cgv::render::context& ctx, size_t offset = 0, size_t count = -1);
 
 public:
@@ -64,8 +74,15 @@ public:
 	void draw_boxes(cgv::render::context& ctx);
 	void draw_points(cgv::render::context& ctx);
 	void draw_normals(cgv::render::context& ctx);
+	/// return timing counters of the point sorting
+	const depth_sort_statistics& get_depth_sort_statistics() const { return point_sorter.get_statistics(); }
+
+	/// return out of core point cloud, which is opened by reading *.opc files
+	octree_point_cloud& ref_out_of_core_point_cloud() { return ooc_pc; }
 
 	bool init(cgv::render::context& ctx);
+	/// update the nodes of an out of core point cloud for the current view
+	void init_frame(cgv::render::context& ctx);
 	void draw(cgv::render::context& ctx);
 	void clear(cgv::render::context& ctx);
 };
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cgv/math/fvec.h>
+#include <cgv/type/standard_types.h>
+
+/** header only kd-tree over an array of D-dimensional points that is referenced and not copied. The tree
+    only stores a permutation of the point indices and the split planes. Leaves hold up to a fixed number of
+	points whose squared distances are evaluated in fixed size batches such that the compiler can vectorize
+	the distance computation. All queries are const and only use caller provided or stack memory, such that
+	they can be issued concurrently from several threads. Returned indices refer to the point array. */
+template <typename T, int D = 3>
+class kd_tree
+{
+public:
+	/// index type
+	typedef cgv::type::int32_type Idx;
+	/// point type
+	typedef cgv::math::fvec<T, D> point_type;
+	/// pair of point index and squared distance as returned by the queries
+	typedef std::pair<Idx, T> result_type;
+	/// maximum number of points in a leaf
+	static const Idx max_leaf_size = 16;
+protected:
+	/// node of the tree, for leaves dim is -1 and [begin,end) is the range in the index permutation
+	struct node
+	{
+		/// split dimension or -1 for leaves
+		int dim;
+		/// maximum coordinate of left child in split dimension
+		T low;
+		/// minimum coordinate of right child in split dimension
+		T high;
+		/// index of left child node, the right child follows the left subtree, or begin of leaf range
+		Idx first;
+		/// index of right child node or end of leaf range
+		Idx second;
+	};
+	/// referenced points
+	const point_type* points;
+	/// permutation of point indices such that each leaf references a contiguous range
+	std::vector<Idx> indices;
+	/// nodes of the tree with the root at index 0
+	std::vector<node> nodes;
+	/// bounding box of all points
+	point_type box_min, box_max;
+	/// bounded list of nearest neighbors sorted by increasing distance
+	struct knn_result_set
+	{
+		result_type* R;
+		Idx capacity;
+		Idx count;
+		knn_result_set(result_type* _R, Idx _capacity) : R(_R), capacity(_capacity), count(0) {}
+		T worst() const { return count < capacity ? std::numeric_limits<T>::max() : R[capacity - 1].second; }
+		void add(Idx i, T d)
+		{
+			Idx j = count < capacity ? count++ : capacity - 1;
+			for (; j > 0 && R[j - 1].second > d; --j)
+				R[j] = R[j - 1];
+			R[j] = result_type(i, d);
+		}
+	};
+	/// unbounded list of neighbors within a fixed squared radius
+	struct radius_result_set
+	{
+		std::vector<result_type>& R;
+		T radius2;
+		radius_result_set(std::vector<result_type>& _R, T _radius2) : R(_R), radius2(_radius2) {}
+		T worst() const { return radius2; }
+		void add(Idx i, T d) { R.push_back(result_type(i, d)); }
+	};
+	/// compute the bounding box of the points in the given range of the index permutation
+	void compute_box(Idx begin, Idx end, point_type& mn, point_type& mx) const
+	{
+		mn = mx = points[indices[begin]];
+		for (Idx i = begin + 1; i < end; ++i) {
+			const point_type& p = points[indices[i]];
+			for (int c = 0; c < D; ++c) {
+				if (p[c] < mn[c])
+					mn[c] = p[c];
+				else if (p[c] > mx[c])
+					mx[c] = p[c];
+			}
+		}
+	}
+	/// recursively build the subtree over the given range and return its node index
+	Idx build_node(Idx begin, Idx end)
+	{
+		Idx ni = Idx(nodes.size());
+		nodes.push_back(node());
+		if (end - begin <= max_leaf_size) {
+			nodes[ni].dim = -1;
+			nodes[ni].first = begin;
+			nodes[ni].second = end;
+			return ni;
+		}
+		// split at median of dimension with largest extent
+		point_type mn, mx;
+		compute_box(begin, end, mn, mx);
+		int dim = 0;
+		for (int c = 1; c < D; ++c)
+			if (mx[c] - mn[c] > mx[dim] - mn[dim])
+				dim = c;
+		Idx mid = begin + (end - begin) / 2;
+		const point_type* P = points;
+		std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end,
+			[P, dim](Idx i, Idx j) { return P[i][dim] < P[j][dim]; });
+		T low = points[indices[begin]][dim];
+		for (Idx i = begin + 1; i < mid; ++i)
+			low = std::max(low, points[indices[i]][dim]);
+		nodes[ni].dim = dim;
+		nodes[ni].low = low;
+		nodes[ni].high = points[indices[mid]][dim];
+		Idx left = build_node(begin, mid);
+		Idx right = build_node(mid, end);
+		nodes[ni].first = left;
+		nodes[ni].second = right;
+		return ni;
+	}
+	/// evaluate squared distances of all points in a leaf and add the ones closer than the current worst distance
+	template <typename result_set>
+	void search_leaf(result_set& rs, const point_type& q, Idx begin, Idx end) const
+	{
+		T d[max_leaf_size];
+		Idx n = end - begin;
+		const Idx* I = &indices[begin];
+		for (Idx i = 0; i < n; ++i) {
+			const point_type& p = points[I[i]];
+			T s = 0;
+			for (int c = 0; c < D; ++c) {
+				T e = p[c] - q[c];
+				s += e*e;
+			}
+			d[i] = s;
+		}
+		for (Idx i = 0; i < n; ++i)
+			if (d[i] < rs.worst())
+				rs.add(I[i], d[i]);
+	}
+	/// recursive search, mindist is the squared distance of q to the cell of the node and dists its per dimension contributions
+	template <typename result_set>
+	void search_node(result_set& rs, const point_type& q, Idx ni, T mindist, T* dists) const
+	{
+		const node& n = nodes[ni];
+		if (n.dim == -1) {
+			search_leaf(rs, q, n.first, n.second);
+			return;
+		}
+		int dim = n.dim;
+		T diff_low = q[dim] - n.low;
+		T diff_high = q[dim] - n.high;
+		Idx best, other;
+		T cut;
+		if (diff_low + diff_high < 0) {
+			best = n.first;
+			other = n.second;
+			cut = diff_high*diff_high;
+		}
+		else {
+			best = n.second;
+			other = n.first;
+			cut = diff_low*diff_low;
+		}
+		search_node(rs, q, best, mindist, dists);
+		T old_dist = dists[dim];
+		mindist += cut - old_dist;
+		if (mindist < rs.worst()) {
+			dists[dim] = cut;
+			search_node(rs, q, other, mindist, dists);
+			dists[dim] = old_dist;
+		}
+	}
+	/// start search at root
+	template <typename result_set>
+	void search(result_set& rs, const point_type& q) const
+	{
+		if (nodes.empty())
+			return;
+		T dists[D];
+		T mindist = 0;
+		for (int c = 0; c < D; ++c) {
+			T e = 0;
+			if (q[c] < box_min[c])
+				e = box_min[c] - q[c];
+			else if (q[c] > box_max[c])
+				e = q[c] - box_max[c];
+			dists[c] = e*e;
+			mindist += dists[c];
+		}
+		search_node(rs, q, 0, mindist, dists);
+	}
+public:
+	/// construct empty tree
+	kd_tree() : points(0) {}
+	/// remove all nodes, the points are not touched
+	void clear()
+	{
+		points = 0;
+		std::vector<Idx>().swap(indices);
+		std::vector<node>().swap(nodes);
+	}
+	/// check whether tree has been built
+	bool empty() const { return nodes.empty(); }
+	/// return number of points in the tree
+	size_t size() const { return indices.size(); }
+	/// build tree over n points, the point array must stay valid while the tree is used
+	void build(const point_type* _points, Idx n)
+	{
+		indices.resize(n);
+		for (Idx i = 0; i < n; ++i)
+			indices[i] = i;
+		build(_points, indices);
+	}
+	/// build tree over a subset of the points given by their indices
+	void build(const point_type* _points, const std::vector<Idx>& point_indices)
+	{
+		std::vector<Idx> I(point_indices);
+		clear();
+		points = _points;
+		indices.swap(I);
+		if (indices.empty())
+			return;
+		nodes.reserve(4 * indices.size() / max_leaf_size + 1);
+		compute_box(0, Idx(indices.size()), box_min, box_max);
+		build_node(0, Idx(indices.size()));
+	}
+	/// find the k nearest neighbors of q sorted by increasing distance and return their number, which is smaller than k if the tree contains less points
+	Idx find_knn(const point_type& q, Idx k, result_type* result) const
+	{
+		knn_result_set rs(result, k);
+		if (k > 0)
+			search(rs, q);
+		return rs.count;
+	}
+	/// find the k nearest neighbors of q, resizes indices and optionally squared distances to the number of found neighbors
+	void find_knn(const point_type& q, Idx k, std::vector<Idx>& knn, std::vector<T>* sqr_dists = 0) const
+	{
+		std::vector<result_type> R(k);
+		Idx n = find_knn(q, k, R.empty() ? 0 : &R.front());
+		knn.resize(n);
+		if (sqr_dists)
+			sqr_dists->resize(n);
+		for (Idx i = 0; i < n; ++i) {
+			knn[i] = R[i].first;
+			if (sqr_dists)
+				(*sqr_dists)[i] = R[i].second;
+		}
+	}
+	/// return index of closest point or -1 if tree is empty
+	Idx find_closest(const point_type& q) const
+	{
+		result_type r;
+		return find_knn(q, 1, &r) == 1 ? r.first : -1;
+	}
+	/// find all points with distance smaller than radius, if sorted is true, result is sorted by increasing distance
+	void find_in_radius(const point_type& q, T radius, std::vector<result_type>& result, bool sorted = true) const
+	{
+		result.clear();
+		radius_result_set rs(result, radius*radius);
+		search(rs, q);
+		if (sorted)
+			std::sort(result.begin(), result.end(), [](const result_type& a, const result_type& b) { return a.second < b.second; });
+	}
+};
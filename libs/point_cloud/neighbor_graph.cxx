@@ -1,6 +1,6 @@
 #include "neighbor_graph.h"
-#include <cgv/utils/progression.h>
 #include <algorithm>
+#include <atomic>
 
 using namespace std;
 
@@ -81,16 +81,47 @@ bool neighbor_graph::is_directed_edge(Idx vi, Idx vj) const
 
 void neighbor_graph::symmetrize()
 {
-	cgv::utils::progression prog("symmetrize neighbor graph", (unsigned)size(), 10);
-	for (Idx i = 0; i < (Idx) size(); ++i) {
-		prog.step();
-		vector<Idx>& ni = at(i);
-		for (Idx j = 0; j < (Idx)ni.size(); ++j) {
-			vector<Idx>& nj = at(ni[j]);
-			if (std::find(nj.begin(),nj.end(),i) == nj.end()) {
-				nj.push_back(i);
-				++nr_half_edges;
-			}
+	Idx n = (Idx)size();
+	// count incoming edges per vertex
+	vector<atomic<Cnt> > in_degree(n);
+	for (Idx i = 0; i < n; ++i)
+		in_degree[i] = 0;
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx i) {
+		const vector<Idx>& Ni = (*this)[i];
+		for (size_t j = 0; j < Ni.size(); ++j)
+			++in_degree[Ni[j]];
+	});
+	// compute offsets of reverse edge lists
+	vector<Cnt> offsets(n + 1);
+	offsets[0] = 0;
+	for (Idx i = 0; i < n; ++i)
+		offsets[i + 1] = offsets[i] + in_degree[i];
+	// scatter sources of edges into reverse edge lists, in_degree is reused as fill counter
+	vector<Idx> sources(offsets[n]);
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx i) {
+		const vector<Idx>& Ni = (*this)[i];
+		for (size_t j = 0; j < Ni.size(); ++j)
+			sources[offsets[Ni[j]] + --in_degree[Ni[j]]] = i;
+	});
+	// sort reverse edges and append the ones not contained in the sorted neighbor list
+	vector<Cnt> nr_added(n);
+	parallel_for(Idx(0), n, Idx(1024), [&](Idx j) {
+		vector<Idx>& Nj = (*this)[j];
+		vector<Idx>::iterator rev_begin = sources.begin() + offsets[j];
+		vector<Idx>::iterator rev_end = sources.begin() + offsets[j + 1];
+		std::sort(rev_begin, rev_end);
+		vector<Idx> sorted_Nj(Nj);
+		std::sort(sorted_Nj.begin(), sorted_Nj.end());
+		size_t old_size = Nj.size();
+		vector<Idx>::const_iterator iter = sorted_Nj.begin();
+		for (vector<Idx>::iterator rev_iter = rev_begin; rev_iter != rev_end; ++rev_iter) {
+			while (iter != sorted_Nj.end() && *iter < *rev_iter)
+				++iter;
+			if (iter == sorted_Nj.end() || *iter != *rev_iter)
+				Nj.push_back(*rev_iter);
 		}
-	}
+		nr_added[j] = Cnt(Nj.size() - old_size);
+	});
+	for (Idx j = 0; j < n; ++j)
+		nr_half_edges += nr_added[j];
 }
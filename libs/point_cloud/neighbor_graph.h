@@ -4,6 +4,7 @@
 #include <iostream>
 #include <cgv/utils/statistics.h>
 #include <cgv/type/standard_types.h>
+#include "parallel_for.h"
 
 #include "lib_begin.h"
 
@@ -27,6 +28,32 @@ struct graph_location
 	}
 };
 
+/// light weight view of the neighbor indices of one vertex that is independent of the graph representation
+struct neighbor_range
+{
+	typedef graph_location::Idx Idx;
+	/// pointer to first neighbor index
+	const Idx* first;
+	/// pointer behind last neighbor index
+	const Idx* last;
+	/// construct from pointer range
+	neighbor_range(const Idx* _first = 0, const Idx* _last = 0) : first(_first), last(_last) {}
+	/// construct from neighbor vector
+	neighbor_range(const std::vector<Idx>& N) : first(N.empty() ? 0 : &N.front()), last(N.empty() ? 0 : &N.front() + N.size()) {}
+	/// return number of neighbors
+	size_t size() const { return last - first; }
+	/// check for empty range
+	bool empty() const { return first == last; }
+	/// return index of j-th neighbor
+	const Idx& operator [] (size_t j) const { return first[j]; }
+	/// return index of last neighbor
+	const Idx& back() const { return last[-1]; }
+	/// return pointer to first neighbor index
+	const Idx* begin() const { return first; }
+	/// return pointer behind last neighbor index
+	const Idx* end() const { return last; }
+};
+
 /** Data structure used to store a knn-neighbor graph. */
 struct CGV_API neighbor_graph : public std::vector<std::vector<graph_location::Idx> >
 {
@@ -43,6 +70,8 @@ struct CGV_API neighbor_graph : public std::vector<std::vector<graph_location::I
 	
 	/**@name queries*/
 	//@{
+	/// return view of the neighbors of vi
+	neighbor_range neighbors(Idx vi) const { return neighbor_range(at(vi)); }
 	/// find index of vj in neighbors of  vi and return -1 if not found
 	int find(Idx vi, Idx vj) const;
 	/// check if the directed edge from  vi to vj is contained in the neighbor graph
@@ -67,24 +96,24 @@ struct CGV_API neighbor_graph : public std::vector<std::vector<graph_location::I
 
 	/**@name construction */
 	//@{
-	/// build a knn neighbor graph for n points from a data structure that provides the method extract_neighbors(i, k, vector<Idx>&).
+	/** build a knn neighbor graph for n points from a data structure that provides the method extract_neighbors(i, k, vector<Idx>&).
+	    The point range is processed in parallel such that extract_neighbors needs to support concurrent calls. As the 
+		neighbors of each point are extracted independently, the resulting graph does not depend on the number of threads. */
 	template <typename knn_info>
 	void build(Cnt n, Cnt k, const knn_info& knn, cgv::utils::statistics* he_stats = 0) {
-		if (he_stats)
-			he_stats->init();
 		clear();
 		resize(n);
-		nr_half_edges = 0;
-		for (Idx i = 0; i < (Idx)n; ++i) {
-			if (i % 10000 == 0)
-				std::cout << "build ng " << i << " nr half edges = " << nr_half_edges << std::endl;
-			knn.extract_neighbors(i, k, at(i));
-			if (he_stats)
+		parallel_for(Idx(0), Idx(n), Idx(1024), [&](Idx i) { knn.extract_neighbors(i, k, (*this)[i]); });
+		nr_half_edges = n*k;
+		if (he_stats) {
+			he_stats->init();
+			for (Idx i = 0; i < (Idx)n; ++i)
 				he_stats->update(k);
-			nr_half_edges += k;
 		}
 	}
-	/// ensure the neighbor graph to be symmetric
+	/** ensure the neighbor graph to be symmetric by appending all missing reverse edges in the order of increasing
+	    source vertex indices. Reverse edges are collected in parallel into a sorted compressed row structure and 
+		merged with the sorted neighbor lists, which avoids the linear search per edge. */
 	void symmetrize();
 	//@}
 };
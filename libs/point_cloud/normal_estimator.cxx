@@ -3,8 +3,88 @@
 #include <cmath>
 #include <cgv/math/functions.h>
 #include <algorithm>
+#include "parallel_for.h"
 
-normal_estimator::normal_estimator(point_cloud& _pc, neighbor_graph& _ng) : pc(_pc), ng(_ng) 
+/// number of lanes over which the moments of a neighborhood are accumulated, which allows the compiler to vectorize the accumulation
+static const unsigned nr_lanes = 8;
+
+/// neighborhood of a point in structure of arrays layout with positions relative to the point and padded to a multiple of nr_lanes with zero weights
+struct neighborhood_buffer
+{
+	std::vector<float> x, y, z, w;
+	/// resize to n entries plus padding and return the padded size
+	unsigned resize(unsigned n)
+	{
+		unsigned m = (n + nr_lanes - 1) / nr_lanes * nr_lanes;
+		x.resize(m); y.resize(m); z.resize(m); w.resize(m);
+		std::fill(x.begin() + n, x.end(), 0.0f);
+		std::fill(y.begin() + n, y.end(), 0.0f);
+		std::fill(z.begin() + n, z.end(), 0.0f);
+		std::fill(w.begin() + n, w.end(), 0.0f);
+		return m;
+	}
+};
+
+/// return the neighborhood buffer of the calling thread, which is reused for all points processed by the thread
+static neighborhood_buffer& ref_neighborhood_buffer()
+{
+	static thread_local neighborhood_buffer buffer;
+	return buffer;
+}
+
+/// gather reference point vi with weight one and its neighbors relative to the reference point and return the padded size
+static unsigned gather_neighborhood(const point_cloud& pc, point_cloud_types::Idx vi, const neighbor_range& Ni, neighborhood_buffer& nb)
+{
+	unsigned ni = (unsigned)Ni.size();
+	unsigned m = nb.resize(ni + 1);
+	const point_cloud_types::Pnt& pi = pc.pnt(vi);
+	nb.x[0] = nb.y[0] = nb.z[0] = 0;
+	nb.w[0] = 1;
+	for (unsigned j = 0; j < ni; ++j) {
+		const point_cloud_types::Pnt& pj = pc.pnt(Ni[j]);
+		nb.x[j + 1] = pj(0) - pi(0);
+		nb.y[j + 1] = pj(1) - pi(1);
+		nb.z[j + 1] = pj(2) - pi(2);
+	}
+	return m;
+}
+
+/// compute the weighted least squares normal of a gathered neighborhood of padded size m, equivalent to cgv::math::estimate_normal_wls
+static void estimate_normal(const neighborhood_buffer& nb, unsigned m, point_cloud_types::Nml& nml)
+{
+	// accumulate weighted zeroth, first and second moments in independent lanes
+	float s[10][nr_lanes] = {};
+	const float* x = &nb.x[0], *y = &nb.y[0], *z = &nb.z[0], *w = &nb.w[0];
+	for (unsigned j = 0; j < m; j += nr_lanes) {
+		for (unsigned l = 0; l < nr_lanes; ++l) {
+			float wj = w[j + l], wx = wj*x[j + l], wy = wj*y[j + l], wz = wj*z[j + l];
+			s[0][l] += wj;
+			s[1][l] += wx;
+			s[2][l] += wy;
+			s[3][l] += wz;
+			s[4][l] += wx*x[j + l];
+			s[5][l] += wx*y[j + l];
+			s[6][l] += wx*z[j + l];
+			s[7][l] += wy*y[j + l];
+			s[8][l] += wy*z[j + l];
+			s[9][l] += wz*z[j + l];
+		}
+	}
+	double S[10];
+	for (unsigned i = 0; i < 10; ++i) {
+		S[i] = 0;
+		for (unsigned l = 0; l < nr_lanes; ++l)
+			S[i] += s[i][l];
+	}
+	// covariance matrix relative to weighted mean
+	double iw = 1.0 / S[0], mx = S[1]*iw, my = S[2]*iw, mz = S[3]*iw;
+	double C[6] = { S[4]*iw - mx*mx, S[5]*iw - mx*my, S[6]*iw - mx*mz, S[7]*iw - my*my, S[8]*iw - my*mz, S[9]*iw - mz*mz };
+	double evals[3], evecs[9];
+	cgv::math::eig_sym_3x3(C, evals, evecs);
+	nml = point_cloud_types::Nml(float(evecs[6]), float(evecs[7]), float(evecs[8]));
+}
+
+normal_estimator::normal_estimator(point_cloud& _pc, neighbor_graph& _ng) : pc(_pc), ng(_ng), cng(0) 
 {
 	normal_quality_exp = 5.0f;
 
@@ -42,7 +122,7 @@ normal_estimator::Crd normal_estimator::compute_normal_quality(const Pnt& p1, co
 normal_estimator::Crd normal_estimator::estimate_scale(Idx vi) const
 {
 	const Pnt& pi = pc.pnt(vi);
-	const std::vector<Idx> &Ni = ng.at(vi);
+	neighbor_range Ni = neighbors(vi);
 	unsigned ni = (unsigned)Ni.size();
 	return length(pc.pnt(Ni[ni/2]) - pi)*localization_scale;
 }
@@ -66,7 +146,7 @@ void normal_estimator::smooth_normals()
 	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
 		const Pnt& pi = pc.pnt(vi);
 		const Nml& nml_i = pc.nml(vi);
-		const std::vector<Idx> &Ni = ng.at(vi);
+		neighbor_range Ni = neighbors(vi);
 		unsigned ni = (unsigned) Ni.size();
 		Crd l0 = estimate_scale(vi);
 		Crd l0_sqr = l0*l0;
@@ -110,7 +190,7 @@ void normal_estimator::smooth_normals()
 void normal_estimator::compute_weights(Idx vi, std::vector<Crd>& weights, std::vector<Pnt>* points_ptr) const
 {
 	const Pnt& pi = pc.pnt(vi);
-	const std::vector<Idx> &Ni = ng.at(vi);
+	neighbor_range Ni = neighbors(vi);
 	unsigned ni = (unsigned)Ni.size();
 	weights.resize(ni + 1);
 	weights[0] = 1;
@@ -138,16 +218,21 @@ void normal_estimator::compute_weighted_normals(bool reorient)
 		pc.create_normals();
 		reorient = false;
 	}
-	std::vector<Crd> weights;
-	std::vector<Pnt> points;
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-		compute_weights(vi, weights, &points);
+	parallel_for(Idx(0), (Idx)pc.get_nr_points(), Idx(256), [&](Idx vi) {
+		neighborhood_buffer& nb = ref_neighborhood_buffer();
+		neighbor_range Ni = neighbors(vi);
+		unsigned ni = (unsigned)Ni.size();
+		unsigned m = gather_neighborhood(pc, vi, Ni, nb);
+		Crd l0 = estimate_scale(vi);
+		Crd l0_sqr = l0*l0;
+		for (unsigned j = 1; j <= ni; ++j)
+			nb.w[j] = exp(-(nb.x[j]*nb.x[j] + nb.y[j]*nb.y[j] + nb.z[j]*nb.z[j]) / l0_sqr);
 		Nml new_nml;
-		cgv::math::estimate_normal_wls((unsigned)points.size(), points[0], &weights[0], new_nml);
+		estimate_normal(nb, m, new_nml);
 		if (reorient && (dot(new_nml,pc.nml(vi)) < 0))
 			new_nml = -new_nml;
 		pc.nml(vi) = new_nml;
-	}
+	});
 }
 
 /// recompute normals from neighbor graph and distance and normal weights
@@ -155,7 +240,7 @@ void normal_estimator::compute_bilateral_weights(Idx vi, std::vector<Crd>& weigh
 {
 	const Pnt& pi = pc.pnt(vi);
 	const Nml& nml_i = pc.nml(vi);
-	const std::vector<Idx> &Ni = ng.at(vi);
+	neighbor_range Ni = neighbors(vi);
 	unsigned ni = (unsigned)Ni.size();
 	weights.resize(ni + 1);
 	weights[0] = 1;
@@ -185,24 +270,30 @@ void normal_estimator::compute_bilateral_weighted_normals(bool reorient)
 	if (!pc.has_normals())
 		compute_weighted_normals(reorient);
 
-	std::vector<Crd> weights;
-	std::vector<Pnt> points;
-
-	// copy current normals
+	// compute new normals into separate vector as weights depend on current normals
 	std::vector<Nml> NS;
 	NS.resize(pc.get_nr_points());
 	Idx i, n = (Idx) pc.get_nr_points();
-	for (i = 0; i < n; ++i)
-		NS[i] = pc.nml(i);
-
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-
-		compute_bilateral_weights(vi, weights, &points);
 
-		cgv::math::estimate_normal_wls((unsigned)points.size(), points[0], &weights[0], NS[vi]);
-		if (reorient && (dot(NS[vi],pc.nml(vi)) < 0))
+	parallel_for(Idx(0), n, Idx(256), [&](Idx vi) {
+		neighborhood_buffer& nb = ref_neighborhood_buffer();
+		const Pnt& pi = pc.pnt(vi);
+		const Nml& nml_i = pc.nml(vi);
+		neighbor_range Ni = neighbors(vi);
+		unsigned ni = (unsigned)Ni.size();
+		unsigned m = gather_neighborhood(pc, vi, Ni, nb);
+		Crd l0 = estimate_scale(vi);
+		Crd l0_sqr = l0*l0;
+		for (unsigned j = 0; j < ni; ++j) {
+			Idx vj = Ni[j];
+			Crd w_x = exp(-(nb.x[j+1]*nb.x[j+1] + nb.y[j+1]*nb.y[j+1] + nb.z[j+1]*nb.z[j+1]) / l0_sqr);
+			Crd w_n = compute_normal_quality(pi, nml_i, pc.pnt(vj), pc.nml(vj), l0);
+			nb.w[j+1] = w_x*w_n;
+		}
+		estimate_normal(nb, m, NS[vi]);
+		if (reorient && (dot(NS[vi],nml_i) < 0))
 			NS[vi] = -NS[vi];
-	}
+	});
 	for (i = 0; i < n; ++i)
 		pc.nml(i) = NS[i];
 }
@@ -213,83 +304,55 @@ void normal_estimator::compute_plane_bilateral_weighted_normals(bool reorient)
 	if (!pc.has_normals())
 		compute_weighted_normals(reorient);
 
-	std::vector<Crd> weights;
-	std::vector<Pnt> points;
-
-	// copy current normals
+	// compute new normals into separate vector as weights depend on current normals
 	std::vector<Nml> NS;
 	NS.resize(pc.get_nr_points());
 	Idx i, n = (Idx) pc.get_nr_points();
-	for (i = 0; i < n; ++i)
-		NS[i] = pc.nml(i);
 
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-		const Pnt& pi = pc.pnt(vi);
-		const Nml& nml_i = pc.nml(vi);
-		const std::vector<Idx> &Ni = ng.at(vi);
+	parallel_for(Idx(0), n, Idx(256), [&](Idx vi) {
+		neighborhood_buffer& nb = ref_neighborhood_buffer();
+		neighbor_range Ni = neighbors(vi);
 		unsigned ni = (unsigned) Ni.size();
-		weights.resize(ni+1);
-		points.resize(ni+1);
-		weights[0] = 1;
-		points[0] = pi;
+		unsigned m = gather_neighborhood(pc, vi, Ni, nb);
 		Crd l0 = estimate_scale(vi);
 		Crd l0_sqr = l0*l0;
 		Crd err0_sqr = l0_sqr*noise_to_sampling_ratio*noise_to_sampling_ratio;
 		for (unsigned j=0; j < ni; ++j) {
-			Idx vj = Ni[j];
-			Dir dij = pc.pnt(vj)-pc.pnt(vi);
-			Crd lij_sqr = sqr_length(dij);
+			const Nml& nml_j = pc.nml(Ni[j]);
+			Crd lij_sqr = nb.x[j+1]*nb.x[j+1] + nb.y[j+1]*nb.y[j+1] + nb.z[j+1]*nb.z[j+1];
 			Crd w_x = exp(-lij_sqr/l0_sqr);
-			Crd errij = dot(pc.nml(vj),dij)*dot(pc.nml(vj),dij);
+			Crd errij = nml_j(0)*nb.x[j+1] + nml_j(1)*nb.y[j+1] + nml_j(2)*nb.z[j+1];
+			errij *= errij;
 			Crd w_n = exp(-errij/err0_sqr);
-			Crd w   = w_x*w_n;
-			weights[j+1] = w;
-			points[j+1] = pc.pnt(vj);
+			nb.w[j+1] = w_x*w_n;
 		}
-		cgv::math::estimate_normal_wls((unsigned)points.size(), points[0], &weights[0], NS[vi]);
+		estimate_normal(nb, m, NS[vi]);
 		if (reorient && (dot(NS[vi],pc.nml(vi)) < 0))
 			NS[vi] = -NS[vi];
-	}
+	});
 	for (i = 0; i < n; ++i)
 		pc.nml(i) = NS[i];
 }
 
-#include <cgv/math/union_find.h>
-#include <limits>
+#include <atomic>
+#include "sort_keys.h"
 
-struct neighbor_info 
-{
-	struct {
-		unsigned  vj : 31;
-		bool flip : 1;
-	};
-	neighbor_info(unsigned _vj = 0, bool _flip = false) : vj(_vj), flip(_flip) {}
-};
+/// value of an atomic key slot without key
+static const cgv::type::uint64_type no_key = cgv::type::uint64_type(-1);
 
-struct edge_info 
+/// atomically replace the key in the slot by the given key if the slot is empty or holds a smaller key
+static void atomic_max_key(std::atomic<cgv::type::uint64_type>& slot, cgv::type::uint64_type key)
 {
-	unsigned vi;
-	struct {
-		unsigned  vj : 31;
-		bool flip : 1;
-	};
-	edge_info(unsigned _vi, unsigned _vj, bool _flip) : vi(_vi), vj(_vj), flip(_flip) {}
-};
+	cgv::type::uint64_type current = slot.load();
+	while ((current == no_key || current < key) && !slot.compare_exchange_weak(current, key));
+}
 
-struct weighted_edge_info 
+/// atomically replace the key in the slot by the given key if the slot holds a larger key
+static void atomic_min_key(std::atomic<cgv::type::uint64_type>& slot, cgv::type::uint64_type key)
 {
-	unsigned vi;
-	struct {
-		unsigned  vj : 31;
-		bool flip : 1;
-	};
-	float w;
-	weighted_edge_info(unsigned _vi, unsigned _vj, float signed_w) : vi(_vi), vj(_vj), w(fabs(signed_w)), flip(signed_w < 0) {}
-	bool operator < (const weighted_edge_info& ei) const 
-	{
-		return w < ei.w;
-	}
-};
+	cgv::type::uint64_type current = slot.load();
+	while (current > key && !slot.compare_exchange_weak(current, key));
+}
 
 /// orient normals towards given point
 void normal_estimator::orient_normals(const Pnt& view_point)
@@ -304,86 +367,136 @@ void normal_estimator::orient_normals(const Pnt& view_point)
 }
 
 
-/// recompute normals from neighbor graph and distance and normal weights
+/** compute a consistent normal orientation from a maximum spanning forest of the symmetrized neighbor graph.
+    Edges are weighted with the absolute dot product of the normal at one end reflected at the plane orthogonal to
+	the edge and the normal at the other end, and the sign of this dot product tells whether the normals need to be
+	flipped relative to each other. The forest is computed with Boruvka's algorithm in parallel: in each round all
+	components select their heaviest outgoing edge concurrently and are merged by pointer jumping. Ties are broken
+	by edge index. Instead of building the tree and traversing it, each vertex keeps whether its normal is flipped
+	relative to the representative of its component, which is updated during the merges. Finally in each component
+	the normal of the point with the smallest x-coordinate is oriented towards negative x and the relative flips are
+	applied. */
 void normal_estimator::orient_normals()
 {
+	typedef cgv::type::uint64_type Key;
 	if (!pc.has_normals())
 		compute_weighted_normals(false);
-	std::cout << "orienting normals\n=================" << std::endl;
-
-	// compute weighted edges and initial point with smallest x-component
-	std::cout << "computing weighted edges" << std::endl;
-	std::vector<weighted_edge_info> E;
-	Crd min_x = std::numeric_limits<Crd>::max();
-	Idx vi, v0 = 0;
-	for (vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
+	Idx n = (Idx)pc.get_nr_points();
+	if (n == 0)
+		return;
+
+	// compute offsets of directed edges and signed edge weights
+	std::vector<Idx> offsets(n + 1);
+	offsets[0] = 0;
+	for (Idx vi = 0; vi < n; ++vi)
+		offsets[vi + 1] = offsets[vi] + (Idx)neighbors(vi).size();
+	std::vector<float> signed_weights(offsets[n]);
+	parallel_for(Idx(0), n, Idx(1024), [&](Idx vi) {
 		const Pnt& pi = pc.pnt(vi);
-		if (pi[0] < min_x) {
-			min_x = pi(0);
-			v0 = vi;
-		}
 		const Nml& nml_i = pc.nml(vi);
-		const std::vector<Idx> &Ni = ng.at(vi);
-		unsigned ni = (unsigned) Ni.size();
-		for (unsigned j=0; j < ni; ++j) {
+		neighbor_range Ni = neighbors(vi);
+		unsigned ni = (unsigned)Ni.size();
+		for (unsigned j = 0; j < ni; ++j) {
 			Idx vj = Ni[j];
-			const Pnt& pj = pc.pnt(vj);
-			const Nml& nml_j = pc.nml(vj);
-			Dir d = normalize(pj-pi);
-			Dir nml_ip = nml_i - 2*dot(nml_i,d)*d;
-			E.push_back(weighted_edge_info(vi,vj,dot(nml_ip, nml_j)));
+			Dir d = normalize(pc.pnt(vj) - pi);
+			Dir nml_ip = nml_i - 2*dot(nml_i, d)*d;
+			signed_weights[offsets[vi] + j] = dot(nml_ip, pc.nml(vj));
 		}
-	}
-
-	std::cout << "construct MST" << std::endl;
-	// compute MST as simple neighborgraph
-	cgv::math::union_find uf(pc.get_nr_points());
-	std::sort(E.begin(), E.end());
-	std::vector<std::vector<neighbor_info> > MST(pc.get_nr_points());
-	for (vi = 1; vi < (Idx)pc.get_nr_points(); ) {
-		if (E.empty()) {
-			std::cerr << "warning: impossible to build MST over neighbor graph " << pc.get_nr_points()-vi <<  " unreachable vertices" << std::endl;
-			break;
-		}
-		const weighted_edge_info& wei = E.back();
-		if (uf.find(wei.vi) != uf.find(wei.vj)) {
-			uf.unite(wei.vi,wei.vj);
-			MST[wei.vi].push_back(neighbor_info(wei.vj, wei.flip));
-			MST[wei.vj].push_back(neighbor_info(wei.vi, wei.flip));
-			++vi;
-		}
-		E.pop_back();
-	}
-	E.clear();
-
-	/*
-	for (vi = 0; vi < n; ++vi) {
-		(*ng)[vi].clear();
-		for (unsigned i=0;i<MST[vi].size(); ++i)
-			(*ng)[vi].push_back(MST[vi][i].vj);
-	}*/
-
-	std::cout << "flipping edges starting at v0=" << v0 << std::endl;
-	unsigned nr = 0;
-	// flip starting with v0
-	std::vector<edge_info> Q;
-	Q.push_back(edge_info(v0,-1,pc.nml(v0)(0)>0));
-	if (pc.nml(v0)(0)>0)
-		pc.nml(v0) = -pc.nml(v0);
-	while (!Q.empty()) {
-		edge_info ei = Q.back();
-		Q.pop_back();
-		const std::vector<neighbor_info>& ni = MST[ei.vi];
-		for (unsigned i=0; i<ni.size(); ++i) {
-			unsigned vj = ni[i].vj;
-			if (vj == ei.vj)
-				continue;
-			if (ni[i].flip != ei.flip) {
-				pc.nml(vj) = -pc.nml(vj);
-				++nr;
+	});
+
+	// per vertex the representative of its component and whether its normal is flipped relative to the representative
+	std::vector<Idx> comp(n);
+	std::vector<unsigned char> flip_to_rep(n, 0);
+	// per representative the key of the heaviest outgoing edge, the representative it is merged into and the relative flip
+	std::vector<std::atomic<Key> > best(n);
+	std::vector<Idx> parent(n), next_parent(n);
+	std::vector<unsigned char> parent_flip(n), next_parent_flip(n);
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx vi) { comp[vi] = vi; });
+	for (;;) {
+		// select heaviest outgoing edge of each component, keys order edges by weight and edge index
+		parallel_for(Idx(0), n, Idx(4096), [&](Idx vi) { best[vi] = no_key; });
+		parallel_for(Idx(0), n, Idx(1024), [&](Idx vi) {
+			Idx ci = comp[vi];
+			neighbor_range Ni = neighbors(vi);
+			unsigned ni = (unsigned)Ni.size();
+			Key best_i = no_key;
+			for (unsigned j = 0; j < ni; ++j) {
+				Idx cj = comp[Ni[j]];
+				if (cj == ci)
+					continue;
+				Idx e = offsets[vi] + j;
+				float w = fabs(signed_weights[e]);
+				Key key = (Key(float_to_key(w)) << 32) | e;
+				if (best_i == no_key || key > best_i)
+					best_i = key;
+				atomic_max_key(best[cj], key);
 			}
-			Q.push_back(edge_info(vj,ei.vi,ei.flip ^ ni[i].flip));
+			if (best_i != no_key)
+				atomic_max_key(best[ci], best_i);
+		});
+		// link each component to the component at the other end of its selected edge
+		std::atomic<bool> merged(false);
+		parallel_for(Idx(0), n, Idx(4096), [&](Idx c) {
+			parent[c] = c;
+			parent_flip[c] = 0;
+			if (comp[c] != c || best[c] == no_key)
+				return;
+			Idx e = Idx(best[c] & 0xffffffff);
+			Idx vi = Idx(std::upper_bound(offsets.begin(), offsets.end(), e) - offsets.begin() - 1);
+			Idx vj = neighbors(vi)[e - offsets[vi]];
+			Idx other = comp[vi] == c ? vj : vi;
+			parent[c] = comp[other];
+			parent_flip[c] = flip_to_rep[vi] ^ flip_to_rep[vj] ^ (signed_weights[e] < 0 ? 1 : 0);
+			merged = true;
+		});
+		if (!merged)
+			break;
+		// the links form trees except for pairs of components that selected the same edge, where the smaller one becomes the root
+		parallel_for(Idx(0), n, Idx(4096), [&](Idx c) {
+			Idx p = parent[c];
+			bool is_root = p == c || (parent[p] == c && c < p);
+			next_parent[c] = is_root ? c : p;
+			next_parent_flip[c] = is_root ? 0 : parent_flip[c];
+		});
+		parent.swap(next_parent);
+		parent_flip.swap(next_parent_flip);
+		// pointer jumping to the roots while accumulating relative flips
+		for (;;) {
+			std::atomic<bool> changed(false);
+			parallel_for(Idx(0), n, Idx(4096), [&](Idx c) {
+				Idx p = parent[c];
+				next_parent[c] = parent[p];
+				next_parent_flip[c] = parent_flip[c] ^ parent_flip[p];
+				if (parent[p] != p)
+					changed = true;
+			});
+			parent.swap(next_parent);
+			parent_flip.swap(next_parent_flip);
+			if (!changed)
+				break;
 		}
+		parallel_for(Idx(0), n, Idx(4096), [&](Idx vi) {
+			Idx c = comp[vi];
+			flip_to_rep[vi] ^= parent_flip[c];
+			comp[vi] = parent[c];
+		});
 	}
-	std::cout << "flipped " << nr << " edges" << std::endl;
+
+	// find point with smallest x-coordinate in each component, ties are resolved by the smaller index
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx vi) { best[vi] = no_key; });
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx vi) {
+		atomic_min_key(best[comp[vi]], (Key(float_to_key(pc.pnt(vi)(0))) << 32) | vi);
+	});
+	// orient the normal of this point towards negative x by flipping the representative accordingly
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx c) {
+		if (comp[c] != c)
+			return;
+		Idx v0 = Idx(best[c] & 0xffffffff);
+		parent_flip[c] = flip_to_rep[v0] ^ (pc.nml(v0)(0) > 0 ? 1 : 0);
+	});
+	// apply flips relative to the representatives
+	parallel_for(Idx(0), n, Idx(4096), [&](Idx vi) {
+		if ((flip_to_rep[vi] ^ parent_flip[comp[vi]]) != 0)
+			pc.nml(vi) = -pc.nml(vi);
+	});
 }
@@ -2,6 +2,7 @@
 
 #include "point_cloud.h"
 #include "neighbor_graph.h"
+#include "compact_neighbor_graph.h"
 
 #include "lib_begin.h"
 
@@ -17,6 +18,10 @@ class CGV_API normal_estimator : public point_cloud_types
 protected:
 	point_cloud& pc;
 	neighbor_graph& ng;
+	/// optional compact representation of the neighbor graph that is used instead of ng if set
+	const compact_neighbor_graph* cng;
+	/// return neighbors of vi from the compact graph if available or from ng otherwise
+	neighbor_range neighbors(Idx vi) const { return cng ? cng->neighbors(vi) : ng.neighbors(vi); }
 public:
 	Crd normal_quality_exp;
 
@@ -32,6 +37,8 @@ public:
 public:
 	/// construct from point cloud and neighbor graph
 	normal_estimator(point_cloud& _pc, neighbor_graph& _ng);
+	/// use a compact neighbor graph instead of the neighbor graph passed to the constructor, pass 0 to switch back
+	void set_compact_neighbor_graph(const compact_neighbor_graph* _cng) { cng = _cng; }
 	/// smooth normals with bilateral weights
 	void smooth_normals();
 	/// fill the given vector with the weights to the reference point and the neighbors
@@ -44,7 +51,7 @@ public:
 	void compute_bilateral_weighted_normals(bool reorient);
 	/// recompute normals from neighbor graph and distance and normal weights
 	void compute_plane_bilateral_weighted_normals(bool reorient);
-	/// try to compute consistent normal orientation
+	/// compute consistent normal orientation in parallel from a maximum spanning forest of the neighbor graph, where each component is oriented separately
 	void orient_normals();
 	/// orient normals towards given point
 	void orient_normals(const Pnt& view_point);
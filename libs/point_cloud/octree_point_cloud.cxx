@@ -0,0 +1,495 @@
+#include "octree_point_cloud.h"
+#include "parallel_for.h"
+#include <cgv/utils/file.h>
+#include <algorithm>
+#include <queue>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+
+/// number of bits per axis of the Morton codes used to sort the points
+static const unsigned nr_key_bits = 21;
+
+/// spread the lower 21 bits of x such that there are two zero bits between consecutive bits
+static cgv::type::uint64_type spread_bits(cgv::type::uint64_type x)
+{
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+/// encode unit vector in octahedral coordinates quantized to 16 bits
+static void encode_normal(const point_cloud_types::Nml& n, cgv::type::int16_type* q)
+{
+	float s = std::abs(n(0)) + std::abs(n(1)) + std::abs(n(2));
+	float x = s > 0 ? n(0) / s : 0, y = s > 0 ? n(1) / s : 0;
+	if (n(2) < 0) {
+		float x1 = (1 - std::abs(y))*(x < 0 ? -1 : 1);
+		float y1 = (1 - std::abs(x))*(y < 0 ? -1 : 1);
+		x = x1;
+		y = y1;
+	}
+	q[0] = cgv::type::int16_type(std::floor(x*32767 + 0.5f));
+	q[1] = cgv::type::int16_type(std::floor(y*32767 + 0.5f));
+}
+
+/// decode normal from octahedral coordinates
+static point_cloud_types::Nml decode_normal(const cgv::type::int16_type* q)
+{
+	float x = q[0] / 32767.0f, y = q[1] / 32767.0f;
+	float z = 1 - std::abs(x) - std::abs(y);
+	if (z < 0) {
+		float x1 = (1 - std::abs(y))*(x < 0 ? -1 : 1);
+		float y1 = (1 - std::abs(x))*(y < 0 ? -1 : 1);
+		x = x1;
+		y = y1;
+	}
+	return normalize(point_cloud_types::Nml(x, y, z));
+}
+
+/// return number of bytes per point in a chunk
+static size_t get_chunk_bytes_per_point(cgv::type::uint32_type flags)
+{
+	return 3 * sizeof(cgv::type::uint16_type) +
+		((flags & octree_point_cloud::OPC_HAS_NMLS) ? 2 * sizeof(cgv::type::int16_type) : 0) +
+		((flags & octree_point_cloud::OPC_HAS_CLRS) ? 3 : 0);
+}
+
+/// return number of bytes of a chunk including the padding to a multiple of 8 bytes
+static size_t get_chunk_size(cgv::type::uint32_type flags, size_t nr_points)
+{
+	return (get_chunk_bytes_per_point(flags) * nr_points + 7) / 8 * 8;
+}
+
+/// helper that writes the nodes of the octree recursively
+struct octree_builder : public point_cloud_types
+{
+	typedef cgv::type::uint64_type Key;
+	const point_cloud& pc;
+	FILE* fp;
+	cgv::type::uint32_type flags;
+	unsigned max_leaf_points;
+	unsigned lod_depth;
+	/// bounding box of all points
+	Box box;
+	/// extent of the cube that is subdivided
+	Crd cube_extent;
+	/// Morton codes and point indices sorted by Morton code
+	std::vector<std::pair<Key, Cnt> > keys;
+	/// buffer used to partition key ranges
+	std::vector<std::pair<Key, Cnt> > tmp;
+	/// nodes of the octree
+	std::vector<octree_point_cloud::octree_node> nodes;
+	/// number of bytes written to the file
+	cgv::type::uint64_type offset;
+	/// buffer of a chunk
+	std::vector<char> buffer;
+
+	octree_builder(const point_cloud& _pc, FILE* _fp, unsigned _max_leaf_points, unsigned _lod_depth) :
+		pc(_pc), fp(_fp), max_leaf_points(std::max(1u, _max_leaf_points)), lod_depth(_lod_depth), offset(0)
+	{
+		flags = (pc.has_normals() ? octree_point_cloud::OPC_HAS_NMLS : 0) + (pc.has_colors() ? octree_point_cloud::OPC_HAS_CLRS : 0);
+	}
+	/// sort points along a Morton curve
+	void compute_keys()
+	{
+		// compute box from the points as the cached box of the point cloud is not updated by all modifications
+		Cnt n = pc.get_nr_points();
+		box.invalidate();
+		for (Cnt i = 0; i < n; ++i)
+			box.add_point(pc.pnt(i));
+		const Box& B = box;
+		cube_extent = std::max(B.get_extent()(0), std::max(B.get_extent()(1), B.get_extent()(2)));
+		if (cube_extent <= 0)
+			cube_extent = 1;
+		double scale = double((1u << nr_key_bits) - 1) / cube_extent;
+		keys.resize(n);
+		parallel_for(Idx(0), Idx(n), Idx(4096), [&](Idx i) {
+			Key key = 0;
+			for (int c = 0; c < 3; ++c) {
+				double x = (pc.pnt(i)(c) - B.get_min_pnt()(c))*scale;
+				Key k = Key(std::min(std::max(x, 0.0), double((1u << nr_key_bits) - 1)));
+				key |= spread_bits(k) << (2 - c);
+			}
+			keys[i] = std::make_pair(key, Cnt(i));
+		});
+		std::sort(keys.begin(), keys.end());
+	}
+	/// write the chunk of the points with the keys [b,e) and store its location in the given node
+	bool write_chunk(octree_point_cloud::octree_node& node, size_t b, size_t e)
+	{
+		size_t n = e - b;
+		node.nr_points = Cnt(n);
+		node.data_offset = offset;
+		node.box.invalidate();
+		for (size_t i = b; i < e; ++i)
+			node.box.add_point(pc.pnt(keys[i].second));
+		size_t size = get_chunk_size(flags, n);
+		buffer.assign(size, 0);
+		cgv::type::uint16_type* q = reinterpret_cast<cgv::type::uint16_type*>(&buffer[0]);
+		Pnt scale;
+		for (int c = 0; c < 3; ++c)
+			scale(c) = node.box.get_extent()(c) > 0 ? 65535 / node.box.get_extent()(c) : 0;
+		for (size_t i = b; i < e; ++i)
+			for (int c = 0; c < 3; ++c)
+				*q++ = cgv::type::uint16_type(std::min(65535.0f, std::floor((pc.pnt(keys[i].second)(c) - node.box.get_min_pnt()(c))*scale(c) + 0.5f)));
+		if (flags & octree_point_cloud::OPC_HAS_NMLS) {
+			cgv::type::int16_type* qn = reinterpret_cast<cgv::type::int16_type*>(q);
+			for (size_t i = b; i < e; ++i, qn += 2)
+				encode_normal(pc.nml(keys[i].second), qn);
+			q = reinterpret_cast<cgv::type::uint16_type*>(qn);
+		}
+		if (flags & octree_point_cloud::OPC_HAS_CLRS) {
+			cgv::type::uint8_type* qc = reinterpret_cast<cgv::type::uint8_type*>(q);
+			for (size_t i = b; i < e; ++i)
+				for (int c = 0; c < 3; ++c)
+					*qc++ = color_component_to_byte(pc.clr(keys[i].second)[c]);
+		}
+		if (size > 0 && fwrite(&buffer[0], 1, size, fp) != size)
+			return false;
+		offset += size;
+		return true;
+	}
+	/// build the node ni from the points with the keys [b,e) on the given level of the octree
+	bool build_node(Cnt ni, size_t b, size_t e, unsigned level)
+	{
+		unsigned sel_level = std::min(nr_key_bits, level + lod_depth);
+		nodes[ni].spacing = cube_extent / Crd(1u << sel_level);
+		nodes[ni].first_child = 0;
+		nodes[ni].child_mask = 0;
+		// leaves keep all points
+		if (e - b <= max_leaf_points || level >= nr_key_bits)
+			return write_chunk(nodes[ni], b, e);
+		// select first point in each grid cell and move selected points to the front
+		unsigned shift = 3 * (nr_key_bits - sel_level);
+		tmp.resize(e - b);
+		size_t nr_selected = 0, nr_remaining = 0;
+		for (size_t i = b; i < e; ++i)
+			if (i == b || (keys[i].first >> shift) != (keys[i - 1].first >> shift))
+				keys[b + nr_selected++] = keys[i];
+			else
+				tmp[nr_remaining++] = keys[i];
+		std::copy(tmp.begin(), tmp.begin() + nr_remaining, keys.begin() + b + nr_selected);
+		if (!write_chunk(nodes[ni], b, b + nr_selected))
+			return false;
+		// split remaining points into octants, which are consecutive in Morton order
+		unsigned child_shift = 3 * (nr_key_bits - 1 - level);
+		size_t ranges[9];
+		size_t i = b + nr_selected;
+		for (unsigned c = 0; c < 8; ++c) {
+			ranges[c] = i;
+			while (i < e && ((keys[i].first >> child_shift) & 7) == c)
+				++i;
+		}
+		ranges[8] = e;
+		Cnt first_child = Cnt(nodes.size());
+		for (unsigned c = 0; c < 8; ++c)
+			if (ranges[c + 1] > ranges[c]) {
+				nodes[ni].child_mask |= 1 << c;
+				nodes.push_back(octree_point_cloud::octree_node());
+			}
+		nodes[ni].first_child = first_child;
+		Cnt ci = first_child;
+		for (unsigned c = 0; c < 8; ++c)
+			if (ranges[c + 1] > ranges[c])
+				if (!build_node(ci++, ranges[c], ranges[c + 1], level + 1))
+					return false;
+		return true;
+	}
+};
+
+unsigned octree_point_cloud::octree_node::get_nr_children() const
+{
+	unsigned n = 0;
+	for (unsigned c = 0; c < 8; ++c)
+		if (child_mask & (1 << c))
+			++n;
+	return n;
+}
+
+octree_point_cloud::octree_point_cloud() : header()
+{
+	cache_memory = 0;
+	memory_budget = size_t(512) * 1024 * 1024;
+	max_screen_space_error = 2.0f;
+	max_nr_pending_loads = 4;
+}
+
+octree_point_cloud::~octree_point_cloud()
+{
+	close();
+}
+
+bool octree_point_cloud::build(const point_cloud& pc, const std::string& file_name, unsigned max_leaf_points, unsigned lod_depth)
+{
+	if (pc.get_nr_points() == 0)
+		return false;
+	FILE* fp = fopen(file_name.c_str(), "wb");
+	if (!fp)
+		return false;
+	octree_builder ob(pc, fp, max_leaf_points, lod_depth);
+	octree_file_header h = octree_file_header();
+	bool success = fwrite(&h, sizeof(h), 1, fp) == 1;
+	ob.offset = sizeof(h);
+	if (success) {
+		ob.compute_keys();
+		ob.nodes.push_back(octree_node());
+		success = ob.build_node(0, 0, ob.keys.size(), 0);
+	}
+	if (success) {
+		memcpy(h.magic, "OPC1", 4);
+		h.flags = ob.flags;
+		h.nr_nodes = Cnt(ob.nodes.size());
+		h.lod_depth = lod_depth;
+		h.nr_points = pc.get_nr_points();
+		h.node_table_offset = ob.offset;
+		h.box = ob.box;
+		success = fwrite(&ob.nodes[0], sizeof(octree_node), ob.nodes.size(), fp) == ob.nodes.size() &&
+			fseek(fp, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, fp) == 1;
+	}
+	return fclose(fp) == 0 && success;
+}
+
+bool octree_point_cloud::convert(const std::string& input_file_name, const std::string& output_file_name, unsigned max_leaf_points, unsigned lod_depth)
+{
+	point_cloud pc;
+	pc.set_memory_mapping(true);
+	if (!pc.read(input_file_name))
+		return false;
+	return build(pc, output_file_name, max_leaf_points, lod_depth);
+}
+
+bool octree_point_cloud::open(const std::string& file_name)
+{
+	close();
+	cgv::data::mapped_file_ptr f(new cgv::utils::mapped_file());
+	if (!f->open(file_name, false) || f->get_size() < sizeof(octree_file_header))
+		return false;
+	const octree_file_header& h = *reinterpret_cast<const octree_file_header*>(f->get_data());
+	if (memcmp(h.magic, "OPC1", 4) != 0 || h.nr_nodes == 0 ||
+		h.node_table_offset + sizeof(octree_node)*h.nr_nodes > f->get_size())
+		return false;
+	const octree_node* table = reinterpret_cast<const octree_node*>(f->get_data() + h.node_table_offset);
+	// children are stored after their parent, which excludes cycles in corrupt files
+	for (Cnt ni = 0; ni < h.nr_nodes; ++ni)
+		if (table[ni].data_offset + get_chunk_size(h.flags, table[ni].nr_points) > h.node_table_offset ||
+			(table[ni].child_mask != 0 && (table[ni].first_child <= ni || table[ni].first_child + table[ni].get_nr_children() > h.nr_nodes)))
+			return false;
+	header = h;
+	nodes.assign(table, table + h.nr_nodes);
+	// accumulate subtree boxes from the leaves upwards, which works in reverse order as children follow their parents
+	subtree_boxes.resize(nodes.size());
+	for (Cnt ni = Cnt(nodes.size()); ni-- > 0; ) {
+		subtree_boxes[ni] = nodes[ni].box;
+		Cnt nr_children = nodes[ni].get_nr_children();
+		for (Cnt ci = nodes[ni].first_child; ci < nodes[ni].first_child + nr_children; ++ci)
+			subtree_boxes[ni].add_axis_aligned_box(subtree_boxes[ci]);
+	}
+	cache.resize(nodes.size());
+	file = f;
+	return true;
+}
+
+void octree_point_cloud::close()
+{
+	for (auto& pl : pending_loads)
+		pl.second.wait();
+	pending_loads.clear();
+	rendered_nodes.clear();
+	lru_list.clear();
+	cache.clear();
+	cache_memory = 0;
+	nodes.clear();
+	subtree_boxes.clear();
+	file.clear();
+	header = octree_file_header();
+}
+
+void octree_point_cloud::decode_chunk(Cnt ni, chunk& c) const
+{
+	const octree_node& node = nodes[ni];
+	size_t n = node.nr_points;
+	const cgv::type::uint16_type* q = reinterpret_cast<const cgv::type::uint16_type*>(file->get_data() + node.data_offset);
+	Pnt scale = node.box.get_extent() * (1.0f / 65535);
+	c.P.resize(n);
+	for (size_t i = 0; i < n; ++i, q += 3)
+		c.P[i] = node.box.get_min_pnt() + Pnt(q[0]*scale(0), q[1]*scale(1), q[2]*scale(2));
+	if (has_normals()) {
+		const cgv::type::int16_type* qn = reinterpret_cast<const cgv::type::int16_type*>(q);
+		c.N.resize(n);
+		for (size_t i = 0; i < n; ++i, qn += 2)
+			c.N[i] = decode_normal(qn);
+		q = reinterpret_cast<const cgv::type::uint16_type*>(qn);
+	}
+	if (has_colors()) {
+		const cgv::type::uint8_type* qc = reinterpret_cast<const cgv::type::uint8_type*>(q);
+		c.C.resize(n);
+		for (size_t i = 0; i < n; ++i, qc += 3)
+			c.C[i] = Clr(byte_to_color_component(qc[0]), byte_to_color_component(qc[1]), byte_to_color_component(qc[2]));
+	}
+}
+
+size_t octree_point_cloud::get_chunk_memory_size(Cnt ni) const
+{
+	return nodes[ni].nr_points * (sizeof(Pnt) + (has_normals() ? sizeof(Nml) : 0) + (has_colors() ? sizeof(Clr) : 0));
+}
+
+octree_point_cloud::Crd octree_point_cloud::compute_screen_space_error(Cnt ni, const Pnt& eye, Crd projection_factor) const
+{
+	const Box& B = subtree_boxes[ni];
+	Crd sqr_dist = 0;
+	for (int c = 0; c < 3; ++c) {
+		Crd d = std::max(B.get_min_pnt()(c) - eye(c), std::max(Crd(0), eye(c) - B.get_max_pnt()(c)));
+		sqr_dist += d*d;
+	}
+	Crd dist = std::max(std::sqrt(sqr_dist), Crd(1e-3)*nodes[ni].spacing);
+	return nodes[ni].spacing * projection_factor / dist;
+}
+
+/// check whether a box is potentially visible by testing its corners against the planes of the clip space
+static bool is_box_visible(const point_cloud_types::Box& B, const point_cloud_types::HMat& mvp)
+{
+	int outside[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 8; ++i) {
+		point_cloud_types::Pnt p = B.get_corner(i);
+		point_cloud_types::HVec h = mvp * point_cloud_types::HVec(p(0), p(1), p(2), 1.0f);
+		for (int c = 0; c < 3; ++c) {
+			if (h(c) < -h(3))
+				++outside[2 * c];
+			if (h(c) > h(3))
+				++outside[2 * c + 1];
+		}
+	}
+	for (int j = 0; j < 6; ++j)
+		if (outside[j] == 8)
+			return false;
+	return true;
+}
+
+void octree_point_cloud::touch_chunk(Cnt ni)
+{
+	lru_list.splice(lru_list.end(), lru_list, cache[ni].lru_position);
+}
+
+void octree_point_cloud::collect_pending_loads()
+{
+	for (auto pl = pending_loads.begin(); pl != pending_loads.end(); ) {
+		if (pl->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++pl;
+			continue;
+		}
+		cache_entry& ce = cache[pl->first];
+		ce.data = pl->second.get();
+		ce.lru_position = lru_list.insert(lru_list.end(), pl->first);
+		cache_memory += ce.data->get_memory_size();
+		pl = pending_loads.erase(pl);
+	}
+}
+
+void octree_point_cloud::evict_chunks()
+{
+	auto li = lru_list.begin();
+	while (cache_memory > memory_budget && li != lru_list.end()) {
+		Cnt ni = *li;
+		if (std::binary_search(rendered_nodes.begin(), rendered_nodes.end(), ni)) {
+			++li;
+			continue;
+		}
+		cache_memory -= cache[ni].data->get_memory_size();
+		cache[ni].data.reset();
+		li = lru_list.erase(li);
+	}
+}
+
+bool octree_point_cloud::update(const Pnt& eye, Crd projection_factor, const HMat* modelview_projection)
+{
+	if (!is_open())
+		return false;
+	collect_pending_loads();
+	// refine nodes with largest screen space error first
+	std::vector<Cnt> selection;
+	std::priority_queue<std::pair<Crd, Cnt> > queue;
+	queue.push(std::make_pair(compute_screen_space_error(0, eye, projection_factor), Cnt(0)));
+	size_t used_memory = 0;
+	while (!queue.empty()) {
+		Crd error = queue.top().first;
+		Cnt ni = queue.top().second;
+		queue.pop();
+		const octree_node& node = nodes[ni];
+		if (modelview_projection && !is_box_visible(subtree_boxes[ni], *modelview_projection))
+			continue;
+		size_t size = get_chunk_memory_size(ni);
+		if (used_memory + size > memory_budget)
+			break;
+		used_memory += size;
+		if (!cache[ni].data) {
+			// request chunk and refine the node once it is available
+			if (pending_loads.find(ni) == pending_loads.end() && pending_loads.size() < max_nr_pending_loads) {
+				const octree_point_cloud* self = this;
+				pending_loads[ni] = cgv::os::thread_pool::get_global().submit([self, ni]() {
+					std::shared_ptr<chunk> c(new chunk());
+					self->decode_chunk(ni, *c);
+					return chunk_ptr(c);
+				});
+			}
+			continue;
+		}
+		touch_chunk(ni);
+		selection.push_back(ni);
+		if (error <= max_screen_space_error || node.child_mask == 0)
+			continue;
+		Cnt nr_children = node.get_nr_children();
+		for (Cnt ci = node.first_child; ci < node.first_child + nr_children; ++ci)
+			queue.push(std::make_pair(compute_screen_space_error(ci, eye, projection_factor), ci));
+	}
+	std::sort(selection.begin(), selection.end());
+	bool changed = selection != rendered_nodes;
+	rendered_nodes.swap(selection);
+	evict_chunks();
+	return changed;
+}
+
+/// copy the points of the given chunks into a point cloud
+static void copy_chunks(const std::vector<const octree_point_cloud::chunk*>& chunks, bool has_normals, bool has_colors, point_cloud& pc)
+{
+	size_t n = 0;
+	for (const octree_point_cloud::chunk* c : chunks)
+		n += c->P.size();
+	pc.clear();
+	pc.resize(unsigned(n));
+	if (has_normals)
+		pc.create_normals();
+	if (has_colors)
+		pc.create_colors();
+	size_t i = 0;
+	for (const octree_point_cloud::chunk* c : chunks) {
+		if (c->P.empty())
+			continue;
+		std::copy(c->P.begin(), c->P.end(), &pc.pnt(point_cloud::Idx(i)));
+		if (has_normals)
+			std::copy(c->N.begin(), c->N.end(), &pc.nml(point_cloud::Idx(i)));
+		if (has_colors)
+			std::copy(c->C.begin(), c->C.end(), &pc.clr(point_cloud::Idx(i)));
+		i += c->P.size();
+	}
+}
+
+void octree_point_cloud::extract_rendered_points(point_cloud& pc) const
+{
+	std::vector<const chunk*> chunks;
+	for (Cnt ni : rendered_nodes)
+		chunks.push_back(cache[ni].data.get());
+	copy_chunks(chunks, has_normals(), has_colors(), pc);
+}
+
+void octree_point_cloud::extract_root_points(point_cloud& pc) const
+{
+	chunk root;
+	decode_chunk(0, root);
+	copy_chunks(std::vector<const chunk*>(1, &root), has_normals(), has_colors(), pc);
+}
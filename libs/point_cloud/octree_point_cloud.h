@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <future>
+#include <string>
+#include "point_cloud.h"
+
+#include "lib_begin.h"
+
+/** out of core point cloud stored in an octree file (*.opc) whose nodes are loaded on demand.
+
+    The file starts with an octree_file_header followed by the point chunks of all nodes and the node table. Each
+	node stores a subsample of the points in its box, where the points of inner nodes are selected on a regular
+	grid with 2^lod_depth cells per axis and are not repeated in the descendants. Rendering the points of a node
+	together with all its ancestors therefore yields the full point density inside the node. Node chunks are
+	compressed by quantizing positions to 16 bits per coordinate relative to the bounding box of the node,
+	normals to two 16 bit octahedral coordinates and colors to 8 bits per channel.
+
+	The file is memory mapped read only. update() selects the nodes to be rendered from coarse to fine in the order
+	of decreasing screen space error until the error is below a threshold or the memory budget is exhausted.
+	Missing chunks are decoded asynchronously in the global thread pool and kept in a least recently used cache
+	whose size is bounded by the memory budget. */
+class CGV_API octree_point_cloud : public point_cloud_types
+{
+public:
+	/// file header of octree files
+	struct octree_file_header
+	{
+		/// magic characters "OPC" followed by the version number
+		char magic[4];
+		/// combination of OPC_HAS_NMLS and OPC_HAS_CLRS
+		cgv::type::uint32_type flags;
+		/// number of nodes
+		cgv::type::uint32_type nr_nodes;
+		/// number of grid cells per axis of the level of detail subsampling is 2^lod_depth
+		cgv::type::uint32_type lod_depth;
+		/// total number of points
+		cgv::type::uint64_type nr_points;
+		/// byte offset of the node table
+		cgv::type::uint64_type node_table_offset;
+		/// bounding box of all points
+		Box box;
+	};
+	/// node of the octree as stored in the node table
+	struct octree_node
+	{
+		/// bounding box of the points of the node, which is used to dequantize positions
+		Box box;
+		/// distance of the cells of the subsampling grid on the level of the node, leaves contain all remaining points
+		Crd spacing;
+		/// number of points in the chunk of the node
+		Cnt nr_points;
+		/// byte offset of the chunk in the file
+		cgv::type::uint64_type data_offset;
+		/// index of the first child, the children are stored consecutively
+		Cnt first_child;
+		/// bit i is set if the i-th octant has a child
+		cgv::type::uint32_type child_mask;
+		/// return number of children
+		unsigned get_nr_children() const;
+	};
+	/// decoded points of a node
+	struct chunk
+	{
+		std::vector<Pnt> P;
+		std::vector<Nml> N;
+		std::vector<Clr> C;
+		/// return the number of bytes used by the decoded points
+		size_t get_memory_size() const { return P.size()*sizeof(Pnt) + N.size()*sizeof(Nml) + C.size()*sizeof(Clr); }
+	};
+	typedef std::shared_ptr<const chunk> chunk_ptr;
+	/// flags stored in the file header
+	enum FileFlags { OPC_HAS_NMLS = 1, OPC_HAS_CLRS = 2 };
+protected:
+	/// mapping of the opened file
+	cgv::data::mapped_file_ptr file;
+	/// header of the opened file
+	octree_file_header header;
+	/// node table of the opened file
+	std::vector<octree_node> nodes;
+	/// per node the union of the boxes of the node and all its descendants, which bounds all points rendered when the node is refined
+	std::vector<Box> subtree_boxes;
+	/// entry of the chunk cache
+	struct cache_entry
+	{
+		/// decoded chunk, empty if the chunk is not cached
+		chunk_ptr data;
+		/// position in the least recently used list
+		std::list<Cnt>::iterator lru_position;
+	};
+	/// per node a cache entry
+	std::vector<cache_entry> cache;
+	/// cached nodes from least to most recently used
+	std::list<Cnt> lru_list;
+	/// number of bytes used by cached chunks
+	size_t cache_memory;
+	/// chunks that are decoded in the thread pool
+	std::map<Cnt, std::future<chunk_ptr> > pending_loads;
+	/// nodes selected for rendering in the last update
+	std::vector<Cnt> rendered_nodes;
+	/// maximal number of bytes of decoded chunks
+	size_t memory_budget;
+	/// maximal screen space error in pixels up to which nodes are refined
+	Crd max_screen_space_error;
+	/// maximal number of chunks decoded concurrently
+	unsigned max_nr_pending_loads;
+	/// return number of bytes a decoded chunk of the given node uses
+	size_t get_chunk_memory_size(Cnt ni) const;
+	/// return the screen space error of a node in pixels, measured at the closest point of its subtree box
+	Crd compute_screen_space_error(Cnt ni, const Pnt& eye, Crd projection_factor) const;
+	/// insert finished chunks into the cache
+	void collect_pending_loads();
+	/// evict least recently used chunks that are not rendered until the cache fits into the memory budget
+	void evict_chunks();
+	/// mark chunk of the given node as most recently used
+	void touch_chunk(Cnt ni);
+public:
+	/// construct without opened file, default memory budget is 512 MB
+	octree_point_cloud();
+	/// wait for pending loads
+	~octree_point_cloud();
+
+	/**@name file io*/
+	//@{
+	/** write the points of a point cloud into an octree file, where nodes with up to max_leaf_points points become
+	    leaves and inner nodes keep one point per cell of a grid with 2^lod_depth cells per axis. The build is not
+		out of core: the points are sorted in memory with a 16 byte Morton key per point plus a partition buffer of
+		the same size and are accessed randomly in the input point cloud, such that 32 bytes per point need to fit
+		into memory and the input should fit as well to avoid paging. */
+	static bool build(const point_cloud& pc, const std::string& file_name, unsigned max_leaf_points = 20000, unsigned lod_depth = 6);
+	/** convert a point cloud file in one of the formats supported by point_cloud::read into an octree file. Binary
+	    point clouds are memory mapped, but build() still needs memory for its sort keys. */
+	static bool convert(const std::string& input_file_name, const std::string& output_file_name, unsigned max_leaf_points = 20000, unsigned lod_depth = 6);
+	/// map octree file and read node table; return whether successful
+	bool open(const std::string& file_name);
+	/// wait for pending loads, clear the cache and unmap the file
+	void close();
+	/// return whether a file is opened
+	bool is_open() const { return !nodes.empty(); }
+	//@}
+
+	/**@name access to the octree*/
+	//@{
+	/// return the file header
+	const octree_file_header& get_header() const { return header; }
+	/// return whether the points have normals
+	bool has_normals() const { return (header.flags & OPC_HAS_NMLS) != 0; }
+	/// return whether the points have colors
+	bool has_colors() const { return (header.flags & OPC_HAS_CLRS) != 0; }
+	/// return the number of nodes
+	Cnt get_nr_nodes() const { return Cnt(nodes.size()); }
+	/// return a node, the root has index 0
+	const octree_node& get_node(Cnt ni) const { return nodes[ni]; }
+	/// return the union of the boxes of a node and all its descendants
+	const Box& get_subtree_box(Cnt ni) const { return subtree_boxes[ni]; }
+	/// decode the chunk of a node from the file, this does not use the cache and can be called concurrently
+	void decode_chunk(Cnt ni, chunk& c) const;
+	//@}
+
+	/**@name streaming*/
+	//@{
+	/// set the maximal number of bytes of decoded chunks
+	void set_memory_budget(size_t nr_bytes) { memory_budget = nr_bytes; }
+	/// return the maximal number of bytes of decoded chunks
+	size_t get_memory_budget() const { return memory_budget; }
+	/// set the screen space error in pixels below which nodes are not refined
+	void set_max_screen_space_error(Crd error) { max_screen_space_error = error; }
+	/// return the screen space error in pixels below which nodes are not refined
+	Crd get_max_screen_space_error() const { return max_screen_space_error; }
+	/// set the maximal number of chunks that are decoded concurrently
+	void set_max_nr_pending_loads(unsigned n) { max_nr_pending_loads = n; }
+	/** select the nodes to be rendered for the given eye point and request missing chunks. The projection factor
+	    converts sizes at unit distance to pixels, i.e. viewport height / (2*tan(fovy/2)). If a modelview projection
+		matrix is given, nodes whose subtree box is outside of the view frustum are skipped. Return whether the rendered nodes changed. */
+	bool update(const Pnt& eye, Crd projection_factor, const HMat* modelview_projection = 0);
+	/// return whether chunks are being decoded, such that further updates will refine the selection
+	bool has_pending_loads() const { return !pending_loads.empty(); }
+	/// return the nodes selected for rendering in the last update, all of them are in the cache
+	const std::vector<Cnt>& get_rendered_nodes() const { return rendered_nodes; }
+	/// return the cached chunk of a rendered node
+	const chunk& get_chunk(Cnt ni) const { return *cache[ni].data; }
+	/// return the number of bytes used by cached chunks
+	size_t get_cache_memory() const { return cache_memory; }
+	/// return the number of cached chunks
+	size_t get_nr_cached_chunks() const { return lru_list.size(); }
+	/// copy the points of the rendered nodes into a point cloud
+	void extract_rendered_points(point_cloud& pc) const;
+	/// decode the points of the root node into a point cloud, which span the bounding box of all points and can be shown before the first update
+	void extract_root_points(point_cloud& pc) const;
+	//@}
+};
+
+#include <cgv/config/lib_end.h>
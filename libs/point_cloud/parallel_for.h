@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cgv/os/thread_pool.h>
+
+/// return the number of threads used by the parallel algorithms of the point cloud library
+inline unsigned get_nr_worker_threads()
+{
+	return cgv::os::thread_pool::get_global().get_concurrency();
+}
+
+/// parallel loops of the point cloud library run in the global thread pool of cgv::os
+using cgv::os::parallel_for;
@@ -7,6 +7,9 @@
 #include <cgv/utils/advanced_scan.h>
 #include <cgv/media/mesh/obj_reader.h>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include "parallel_for.h"
 
 #pragma warning(disable:4996)
 
@@ -18,12 +21,12 @@ using namespace cgv::media::mesh;
 class point_cloud_obj_loader : public obj_reader, public point_cloud_types
 {
 protected:
-	std::vector<Pnt>& P;
-	std::vector<Nml>& N;
-	std::vector<Clr>& C;
+	cgv::data::mapped_vector<Pnt>& P;
+	cgv::data::mapped_vector<Nml>& N;
+	cgv::data::mapped_vector<Clr>& C;
 public:
 	///
-	point_cloud_obj_loader(std::vector<Pnt>& _P, std::vector<Nml>& _N, std::vector<Clr>& _C) : P(_P), N(_N), C(_C) {}
+	point_cloud_obj_loader(cgv::data::mapped_vector<Pnt>& _P, cgv::data::mapped_vector<Nml>& _N, cgv::data::mapped_vector<Clr>& _C) : P(_P), N(_N), C(_C) {}
 	/// overide this function to process a vertex
 	void process_vertex(const v3d_type& p)
 	{
@@ -99,6 +102,7 @@ point_cloud::point_cloud()
 	has_comp_clrs = false;
 
 	no_normals_contained = false;
+	use_memory_mapping = false;
 	box_out_of_date = false;
 	pixel_range_out_of_date = false;
 }
@@ -114,6 +118,7 @@ point_cloud::point_cloud(const string& file_name)
 	has_comp_clrs = false;
 
 	no_normals_contained = false;
+	use_memory_mapping = false;
 	box_out_of_date = false;
 	pixel_range_out_of_date = false;
 
@@ -144,6 +149,7 @@ void point_cloud::clear()
 	has_comps = false;
 	has_comp_trans = false;
 	has_comp_clrs = false;
+	mapped_file_name.clear();
 
 	box_out_of_date = true;
 	pixel_range_out_of_date = true;
@@ -266,15 +272,15 @@ void point_cloud::clip(const Box clip_box)
 /// permute points
 void point_cloud::permute(std::vector<Idx>& perm, bool permute_component_indices)
 {
-	cgv::math::permute_vector(P, perm);
+	cgv::math::permute_array(P.size(), P.data(), &perm.front());
 	if (has_normals())
-		cgv::math::permute_vector(N, perm);
+		cgv::math::permute_array(N.size(), N.data(), &perm.front());
 	if (has_colors())
-		cgv::math::permute_vector(C, perm);
+		cgv::math::permute_array(C.size(), C.data(), &perm.front());
 	if (has_texture_coordinates())
-		cgv::math::permute_vector(T, perm);
+		cgv::math::permute_array(T.size(), T.data(), &perm.front());
 	if (has_pixel_coordinates())
-		cgv::math::permute_vector(I, perm);
+		cgv::math::permute_array(I.size(), I.data(), &perm.front());
 	if (permute_component_indices && has_components())
 		cgv::math::permute_vector(component_indices, perm);
 }
@@ -378,13 +384,29 @@ void point_cloud::resize(unsigned nr_points)
 	P.resize(nr_points);
 }
 
+/// return whether any per point container references a memory mapped file
+bool point_cloud::is_memory_mapped() const
+{
+	return P.is_mapped() || N.is_mapped() || C.is_mapped() || T.is_mapped() || I.is_mapped();
+}
+
+/// copy all memory mapped per point containers into owned memory and release the file mapping
+void point_cloud::detach_from_file()
+{
+	P.detach();
+	N.detach();
+	C.detach();
+	T.detach();
+	I.detach();
+	mapped_file_name.clear();
+}
 
 bool point_cloud::read(const string& _file_name)
 {
 	string ext = to_lower(get_extension(_file_name));
 	bool success = false;
 	if (ext == "bpc")
-		success = read_bin(_file_name);
+		success = (use_memory_mapping && read_bin_mapped(_file_name)) || read_bin(_file_name);
 	if (ext == "xyz")
 		success = read_xyz(_file_name);
 	if (ext == "pct")
@@ -545,6 +567,9 @@ bool point_cloud::read_component_transformations(const std::string& file_name)
 bool point_cloud::write(const string& _file_name)
 {
 	string ext = to_lower(get_extension(_file_name));
+	// overwriting the mapped file would invalidate the mapping
+	if (is_memory_mapped() && _file_name == mapped_file_name)
+		detach_from_file();
 	if (ext == "bpc")
 		return write_bin(_file_name);
 	if (ext == "apc" || ext == "pnt")
@@ -625,6 +650,151 @@ bool point_cloud::read_pct(const std::string& file_name)
 }
 
 
+namespace {
+
+/// per chunk containers filled by the parallel ascii parsers
+struct ascii_chunk : public point_cloud_types
+{
+	std::vector<Pnt> P;
+	std::vector<Nml> N;
+	std::vector<Clr> C;
+	/// whether a line of the chunk specified a color
+	bool has_colors;
+	ascii_chunk() : has_colors(false) {}
+};
+
+static inline bool is_ascii_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/// locale independent scan of a floating point number starting at p, return pointer behind number or 0 if no number found
+static const char* scan_float(const char* p, const char* e, float& v)
+{
+	const char* q = cgv::utils::from_chars(p, e, v);
+	return q == p ? 0 : q;
+}
+
+/// scan up to max_n whitespace separated floats from a line and return the number of successfully scanned values
+static unsigned scan_floats(const char* p, const char* e, float* values, unsigned max_n)
+{
+	unsigned n = 0;
+	while (n < max_n) {
+		while (p < e && is_ascii_space(*p))
+			++p;
+		if (p == e)
+			break;
+		p = scan_float(p, e, values[n]);
+		if (!p)
+			break;
+		++n;
+	}
+	return n;
+}
+
+/// clamp a parsed color value to the byte range before conversion, such that out of range values saturate
+static inline cgv::type::uint8_type clamp_to_byte(float v)
+{
+	return cgv::type::uint8_type(std::max(0.0f, std::min(255.0f, v)));
+}
+
+/// line parser of the xyz format: x y z [r g b [I]] with byte colors
+struct xyz_line_parser : public point_cloud_types
+{
+	void operator () (const char* b, const char* e, ascii_chunk& chunk) const
+	{
+		float v[7];
+		unsigned n = scan_floats(b, e, v, 7);
+		if (n < 3)
+			return;
+		chunk.P.push_back(Pnt(v[0], v[1], v[2]));
+		// points without color get white such that colors stay aligned with points
+		if (n >= 6) {
+			chunk.C.push_back(Clr(byte_to_color_component(clamp_to_byte(v[3])), byte_to_color_component(clamp_to_byte(v[4])), byte_to_color_component(clamp_to_byte(v[5]))));
+			chunk.has_colors = true;
+		}
+		else
+			chunk.C.push_back(Clr(byte_to_color_component(255), byte_to_color_component(255), byte_to_color_component(255)));
+	}
+};
+
+/// line parser of the points and ascii formats: x y z [nx ny nz [r g b] ] with float colors
+struct points_line_parser : public point_cloud_types
+{
+	/// whether lines with six numbers specify a color instead of a normal
+	bool no_normals_contained;
+	/// whether only lines with 3, 6 or 9 numbers are accepted
+	bool strict;
+	points_line_parser(bool _no_normals_contained, bool _strict) : no_normals_contained(_no_normals_contained), strict(_strict) {}
+	void operator () (const char* b, const char* e, ascii_chunk& chunk) const
+	{
+		float v[9];
+		unsigned n = scan_floats(b, e, v, 9);
+		if (strict && n != 3 && n != 6 && n != 9)
+			return;
+		if (n >= 3)
+			chunk.P.push_back(Pnt(v[0], v[1], v[2]));
+		if (n >= 6 && n < 9 && no_normals_contained)
+			chunk.C.push_back(Clr(float_to_color_component(v[3]), float_to_color_component(v[4]), float_to_color_component(v[5])));
+		else if (n >= 6)
+			chunk.N.push_back(Nml(v[3], v[4], v[5]));
+		if (n >= 9)
+			chunk.C.push_back(Clr(float_to_color_component(v[6]), float_to_color_component(v[7]), float_to_color_component(v[8])));
+	}
+};
+
+/// call the line parser for all lines of the given text range and store results in the given chunk
+template <typename L>
+void parse_ascii_chunk(const char* begin, const char* end, ascii_chunk* chunk, const L* line_parser)
+{
+	const char* line_begin = begin;
+	while (line_begin < end) {
+		const char* line_end = (const char*)memchr(line_begin, '\n', end - line_begin);
+		if (!line_end)
+			line_end = end;
+		(*line_parser)(line_begin, line_end, *chunk);
+		line_begin = line_end + 1;
+	}
+}
+
+/// split text into newline aligned chunks, parse chunks in parallel and return the per chunk results in text order
+template <typename L>
+void parse_ascii_parallel(const char* begin, const char* end, const L& line_parser, std::vector<ascii_chunk>& chunks)
+{
+	// use one chunk per thread but avoid chunks smaller than 1MB
+	size_t nr_chunks = get_nr_worker_threads();
+	nr_chunks = std::max(size_t(1), std::min(nr_chunks, size_t(end - begin) / (1 << 20)));
+	chunks.resize(nr_chunks);
+	std::vector<const char*> splits(nr_chunks + 1, end);
+	splits[0] = begin;
+	for (size_t i = 1; i < nr_chunks; ++i) {
+		const char* p = std::max(splits[i - 1], begin + (end - begin) * i / nr_chunks);
+		const char* nl = p < end ? (const char*)memchr(p, '\n', end - p) : 0;
+		splits[i] = nl ? nl + 1 : end;
+	}
+	parallel_for(size_t(0), nr_chunks, size_t(1), [&](size_t i) {
+		parse_ascii_chunk(splits[i], splits[i + 1], &chunks[i], &line_parser);
+	});
+}
+
+/// concatenate per chunk results to the containers of the point cloud
+template <typename T>
+void append_ascii_chunks(cgv::data::mapped_vector<T>& V, std::vector<ascii_chunk>& chunks, std::vector<T> ascii_chunk::*member)
+{
+	size_t n = V.size();
+	for (size_t i = 0; i < chunks.size(); ++i)
+		n += (chunks[i].*member).size();
+	size_t offset = V.size();
+	V.resize(n);
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		std::vector<T>& chunk_V = chunks[i].*member;
+		std::copy(chunk_V.begin(), chunk_V.end(), V.begin() + offset);
+		offset += chunk_V.size();
+		std::vector<T>().swap(chunk_V);
+	}
+}
+} // namespace
+
 /// read ascii file with lines of the form x y z r g b I colors and intensity values, where intensity values are ignored
 bool point_cloud::read_xyz(const std::string& file_name)
 {
@@ -634,46 +804,15 @@ bool point_cloud::read_xyz(const std::string& file_name)
 		return false;
 	std::cout << "read data from disk "; watch.add_time();
 	clear();
-	vector<line> lines;
-	split_to_lines(content, lines);
-	std::cout << "split data into " << lines.size() << " lines. ";	watch.add_time();
-
-	bool do_parse = false;
-	unsigned i;
-	for (i = 0; i<lines.size(); ++i) {
-		if (lines[i].empty())
-			continue;
-
-		if (true) {
-			Pnt p;
-			int c[3], I;
-			char tmp = lines[i].end[0];
-			content[lines[i].end - content.c_str()] = 0;
-			sscanf(lines[i].begin, "%f %f %f %d %d %d %d", &p[0], &p[1], &p[2], c, c + 1, c + 2, &I);
-			content[lines[i].end - content.c_str()] = tmp;
-			P.push_back(p);
-			C.push_back(Clr(byte_to_color_component(c[0]), byte_to_color_component(c[1]), byte_to_color_component(c[2])));
-		}
-		else {
-
-			vector<token> numbers;
-			tokenizer(lines[i]).bite_all(numbers);
-			double values[7];
-			unsigned n = min(7, (int)numbers.size());
-			unsigned j;
-			for (j = 0; j < n; ++j) {
-				if (!is_double(numbers[j].begin, numbers[j].end, values[j]))
-					break;
-			}
-			if (j >= 3)
-				P.push_back(Pnt((Crd)values[0], (Crd)values[1], (Crd)values[2]));
-			if (j >= 6)
-				C.push_back(Clr(float_to_color_component(values[3]), float_to_color_component(values[4]), float_to_color_component(values[5])));
-		}
-		if ((P.size() % 100000) == 0)
-			cout << "read " << P.size() << " points" << endl;
-	}
-	watch.add_time();
+	std::vector<ascii_chunk> chunks;
+	parse_ascii_parallel(content.c_str(), content.c_str() + content.size(), xyz_line_parser(), chunks);
+	bool has_colors = false;
+	for (size_t i = 0; i < chunks.size(); ++i)
+		has_colors = has_colors || chunks[i].has_colors;
+	append_ascii_chunks(P, chunks, &ascii_chunk::P);
+	if (has_colors)
+		append_ascii_chunks(C, chunks, &ascii_chunk::C);
+	std::cout << "parsed " << P.size() << " points in " << chunks.size() << " chunks "; watch.add_time();
 	return true;
 }
 
@@ -683,38 +822,27 @@ bool point_cloud::read_points(const std::string& file_name)
 	if (!cgv::utils::file::read(file_name, content, true))
 		return false;
 	clear();
-	vector<line> lines;
-	split_to_lines(content, lines);
-	bool do_parse = false;
-	unsigned i;
-	for (i=0; i<lines.size(); ++i) {
-		if (do_parse) {
-			if (lines[i].empty())
-				continue;
-			vector<token> numbers;
-			tokenizer(lines[i]).bite_all(numbers);
-			double values[9];
-			unsigned n = min(9,(int)numbers.size());
-			unsigned j;
-			for (j=0; j<n; ++j) {
-				if (!is_double(numbers[j].begin, numbers[j].end, values[j]))
-					break;
-			}
-			if (j >= 3)
-				P.push_back(Pnt((Crd)values[0],(Crd)values[1],(Crd)values[2]));
-			if (j >= 6)
-				N.push_back(Nml((Crd)values[3],(Crd)values[4],(Crd)values[5]));
-			if (j >= 9)
-				C.push_back(Clr(float_to_color_component(values[6]), float_to_color_component(values[7]), float_to_color_component(values[8])));
-
-			if ( (P.size() % 10000) == 0)
-				cout << "read " << P.size() << " points" << endl;
-		}
-		if (lines[i] == "#Data:") {
-			do_parse = true;
-			cout << "starting to parse after line " << i << endl;
+	// find the line following the "#Data:" marker
+	const char* begin = content.c_str();
+	const char* end = begin + content.size();
+	const char* data_begin = end;
+	unsigned li = 0;
+	for (const char* line_begin = begin; line_begin < end; ++li) {
+		const char* line_end = (const char*)memchr(line_begin, '\n', end - line_begin);
+		if (!line_end)
+			line_end = end;
+		if (line(line_begin, line_end) == "#Data:") {
+			data_begin = line_end;
+			cout << "starting to parse after line " << li << endl;
+			break;
 		}
+		line_begin = line_end + 1;
 	}
+	std::vector<ascii_chunk> chunks;
+	parse_ascii_parallel(data_begin, end, points_line_parser(false, false), chunks);
+	append_ascii_chunks(P, chunks, &ascii_chunk::P);
+	append_ascii_chunks(N, chunks, &ascii_chunk::N);
+	append_ascii_chunks(C, chunks, &ascii_chunk::C);
 	return true;
 }
 
@@ -911,6 +1039,137 @@ bool point_cloud::read_bin(const string& file_name)
 	}
 	return fclose(fp) == 0 && success;
 }
+
+namespace {
+
+/// reference n elements at the given offset of the mapping or copy them if the section is not aligned, advance offset and return false if file is too short
+template <typename T>
+bool map_bin_section(cgv::data::mapped_vector<T>& V, const cgv::data::mapped_file_ptr& mapping, size_t& offset, size_t n)
+{
+	if (offset + n * sizeof(T) > mapping->get_size())
+		return false;
+	if (!V.map(mapping, offset, n)) {
+		V.resize(n);
+		if (n > 0)
+			memcpy(reinterpret_cast<char*>(V.data()), mapping->get_data() + offset, n * sizeof(T));
+	}
+	offset += n * sizeof(T);
+	return true;
+}
+
+/// copy n elements at the given offset of the mapping into a vector, advance offset and return false if file is too short
+template <typename T>
+bool copy_bin_section(std::vector<T>& V, const cgv::data::mapped_file_ptr& mapping, size_t& offset, size_t n)
+{
+	if (offset + n * sizeof(T) > mapping->get_size())
+		return false;
+	V.resize(n);
+	if (n > 0)
+		memcpy(reinterpret_cast<char*>(&V[0]), mapping->get_data() + offset, n * sizeof(T));
+	offset += n * sizeof(T);
+	return true;
+}
+} // namespace
+
+bool point_cloud::read_bin_mapped(const string& file_name)
+{
+	cgv::data::mapped_file_ptr mapping(new cgv::utils::mapped_file());
+	if (!mapping->open(file_name))
+		return false;
+	const char* data = mapping->get_data();
+	size_t offset = 2 * sizeof(Cnt);
+	if (mapping->get_size() < offset)
+		return false;
+	Cnt n = reinterpret_cast<const Cnt*>(data)[0];
+	Cnt m = reinterpret_cast<const Cnt*>(data)[1];
+	cgv::type::uint32_type flags = 0;
+	if (n == 0) {
+		n = m;
+		if (mapping->get_size() < offset + sizeof(flags))
+			return false;
+		memcpy(&flags, data + offset, sizeof(flags));
+		offset += sizeof(flags);
+	}
+	else {
+		flags += (m >= 2 * n) ? BPC_HAS_CLRS : 0;
+		if (flags & BPC_HAS_CLRS)
+			m = m - 2 * n;
+		flags += (m > 0) ? BPC_HAS_NMLS : 0;
+	}
+	clear();
+	bool success = map_bin_section(P, mapping, offset, n);
+	if (success && (flags & BPC_HAS_NMLS))
+		success = map_bin_section(N, mapping, offset, m);
+	if (success && (flags & BPC_HAS_CLRS)) {
+		bool byte_colors_in_file = (flags & BPC_HAS_BYTE_CLRS) != 0;
+#ifdef BYTE_COLORS
+		bool byte_colors_in_pc = true;
+#else
+		bool byte_colors_in_pc = false;
+#endif
+		if (byte_colors_in_file == byte_colors_in_pc)
+			success = map_bin_section(C, mapping, offset, n);
+		else if (byte_colors_in_file) {
+			std::vector<cgv::media::color<cgv::type::uint8_type> > tmp;
+			success = copy_bin_section(tmp, mapping, offset, n);
+			if (success) {
+				C.resize(n);
+				for (size_t i = 0; i < n; ++i)
+					C[i] = Clr(byte_to_color_component(tmp[i][0]), byte_to_color_component(tmp[i][1]), byte_to_color_component(tmp[i][2]));
+			}
+		}
+		else {
+			std::vector<cgv::media::color<float> > tmp;
+			success = copy_bin_section(tmp, mapping, offset, n);
+			if (success) {
+				C.resize(n);
+				for (size_t i = 0; i < n; ++i)
+					C[i] = Clr(float_to_color_component(tmp[i][0]), float_to_color_component(tmp[i][1]), float_to_color_component(tmp[i][2]));
+			}
+		}
+	}
+	if (success && (flags & BPC_HAS_TCS))
+		success = map_bin_section(T, mapping, offset, n);
+	if (success && (flags & BPC_HAS_PIXCRDS))
+		success = map_bin_section(I, mapping, offset, n);
+	if (success && (flags & BPC_HAS_COMPS)) {
+		cgv::type::uint32_type nr_comps;
+		success = offset + sizeof(nr_comps) <= mapping->get_size();
+		if (success) {
+			memcpy(&nr_comps, data + offset, sizeof(nr_comps));
+			offset += sizeof(nr_comps);
+			success = offset + nr_comps * sizeof(component_info) <= mapping->get_size();
+		}
+		if (success) {
+			// only extract the point ranges from the stored component infos
+			component_info tmp;
+			size_t first_offset = (const char*)&tmp.index_of_first_point - (const char*)&tmp;
+			size_t nr_offset = (const char*)&tmp.nr_points - (const char*)&tmp;
+			components.resize(nr_comps);
+			for (unsigned i = 0; i < nr_comps; ++i) {
+				const char* record = data + offset + i * sizeof(component_info);
+				memcpy(&components[i].index_of_first_point, record + first_offset, sizeof(size_t));
+				memcpy(&components[i].nr_points, record + nr_offset, sizeof(size_t));
+			}
+			offset += nr_comps * sizeof(component_info);
+			component_indices.resize(n);
+			for (unsigned i = 0; i < nr_comps; ++i)
+				for (size_t j = components[i].index_of_first_point; j < components[i].index_of_first_point + components[i].nr_points && j < n; ++j)
+					component_indices[j] = i;
+			if (flags & BPC_HAS_COMP_CLRS)
+				success = copy_bin_section(component_colors, mapping, offset, nr_comps);
+			if (success && (flags & BPC_HAS_COMP_TRANS))
+				success = copy_bin_section(component_rotations, mapping, offset, nr_comps) &&
+				          copy_bin_section(component_translations, mapping, offset, nr_comps);
+		}
+	}
+	if (!success) {
+		clear();
+		return false;
+	}
+	mapped_file_name = file_name;
+	return true;
+}
 
 bool point_cloud::read_obj(const string& _file_name) 
 {
@@ -945,19 +1204,346 @@ static PlyProperty vert_props[] = { /* list of property information for a vertex
   {"intensity", Uint8, Uint8, offsetof(PlyVertex,red), 0, 0, 0, 0},
 };
 
-typedef struct PlyFace {
-  unsigned char nverts;
-  int *verts;
-} PlyFace;
-
-static PlyProperty face_props[] = { /* list of property information for a face */
-{"vertex_indices", Int32, Int32, offsetof(PlyFace,verts), 1, Uint8, Uint8, offsetof(PlyFace,nverts)},
+namespace {
+
+/// scalar types of ply properties
+enum PlyScalarType { PST_INT8, PST_UINT8, PST_INT16, PST_UINT16, PST_INT32, PST_UINT32, PST_FLOAT32, PST_FLOAT64, PST_UNDEF };
+
+/// return the scalar type of a ply type name
+PlyScalarType get_ply_scalar_type(const std::string& name)
+{
+	static const char* names[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+	static const char* sized_names[] = { "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+	for (int t = 0; t < PST_UNDEF; ++t)
+		if (name == names[t] || name == sized_names[t])
+			return PlyScalarType(t);
+	return PST_UNDEF;
+}
+
+/// return the size of a ply scalar type in bytes
+size_t get_ply_scalar_size(PlyScalarType t)
+{
+	static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+	return sizes[t];
+}
+
+/// return whether the host stores scalars in the byte order of binary little endian ply files
+bool is_little_endian_host()
+{
+	cgv::type::uint16_type one = 1;
+	return *reinterpret_cast<const cgv::type::uint8_type*>(&one) == 1;
+}
+
+/// vertex properties decoded by the binary ply reader
+enum PlyVertexProperty { PVP_X, PVP_Y, PVP_Z, PVP_NX, PVP_NY, PVP_NZ, PVP_RED, PVP_GREEN, PVP_BLUE, PVP_INTENSITY, PVP_COUNT };
+
+/// layout of the vertex element of a binary little endian ply file
+struct ply_vertex_layout
+{
+	/// byte offset of the vertex data in the file
+	size_t data_offset;
+	/// number of vertices
+	size_t nr_vertices;
+	/// number of bytes per vertex
+	size_t stride;
+	/// per decoded property the byte offset within a vertex or -1 if the property is not present
+	int offsets[PVP_COUNT];
+	/// per decoded property its scalar type
+	PlyScalarType types[PVP_COUNT];
+	/// return whether a property is present
+	bool has(int p) const { return offsets[p] >= 0; }
+	/// return whether the vertex data consists of tightly packed float coordinates only
+	bool is_packed_float_positions() const {
+		return stride == 3 * sizeof(float) && !has(PVP_NX) && !has(PVP_RED) && !has(PVP_INTENSITY) &&
+			offsets[PVP_X] == 0 && offsets[PVP_Y] == 4 && offsets[PVP_Z] == 8 &&
+			types[PVP_X] == PST_FLOAT32 && types[PVP_Y] == PST_FLOAT32 && types[PVP_Z] == PST_FLOAT32;
+	}
+	/// return whether normals are present
+	bool has_normals() const { return has(PVP_NX) && has(PVP_NY) && has(PVP_NZ); }
+	/// return whether rgb colors are present
+	bool has_rgb() const { return has(PVP_RED) && has(PVP_GREEN) && has(PVP_BLUE); }
+	/// return whether colors are present either as rgb or as intensity
+	bool has_colors() const { return has_rgb() || has(PVP_INTENSITY); }
 };
 
-static char* propNames[] = { "vertex", "face" };
+/** compile the vertex layout from the ply header at the beginning of [begin,end). Return false if the header is
+    incomplete, the file is not binary little endian or the vertex element cannot be located because it contains
+	lists or is preceded by non empty elements with lists. */
+bool parse_ply_vertex_layout(const char* begin, const char* end, ply_vertex_layout& L)
+{
+	static const char* property_names[] = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue", "intensity" };
+	std::fill(L.offsets, L.offsets + PVP_COUNT, -1);
+	std::fill(L.types, L.types + PVP_COUNT, PST_UNDEF);
+	L.data_offset = L.nr_vertices = L.stride = 0;
+	if (!is_little_endian_host())
+		return false;
+	bool is_binary_little_endian = false;
+	bool vertex_found = false;
+	bool in_vertex = false;
+	// size of the elements preceding the vertex element
+	size_t preceding_size = 0;
+	// number, size and list flag of the current element
+	size_t elem_count = 0, elem_stride = 0;
+	bool elem_has_list = false;
+	const char* line_begin = begin;
+	for (unsigned li = 0; ; ++li) {
+		const char* line_end = std::find(line_begin, end, '\n');
+		if (line_end == end)
+			return false;
+		std::string line(line_begin, line_end);
+		line_begin = line_end + 1;
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		std::istringstream is(line);
+		std::string keyword;
+		is >> keyword;
+		if (li == 0) {
+			if (keyword != "ply")
+				return false;
+			continue;
+		}
+		if (keyword == "format") {
+			std::string format;
+			is >> format;
+			is_binary_little_endian = format == "binary_little_endian";
+		}
+		else if (keyword == "element" || keyword == "end_header") {
+			// close current element
+			if (in_vertex) {
+				L.stride = elem_stride;
+				vertex_found = true;
+				in_vertex = false;
+			}
+			else if (!vertex_found) {
+				if (elem_has_list && elem_count > 0)
+					return false;
+				preceding_size += elem_count * elem_stride;
+			}
+			if (keyword == "end_header")
+				break;
+			std::string name;
+			is >> name >> elem_count;
+			if (is.fail())
+				return false;
+			elem_stride = 0;
+			elem_has_list = false;
+			if (name == "vertex" && !vertex_found) {
+				in_vertex = true;
+				L.nr_vertices = elem_count;
+			}
+		}
+		else if (keyword == "property") {
+			std::string type_name, name;
+			is >> type_name;
+			if (type_name == "list") {
+				if (in_vertex)
+					return false;
+				elem_has_list = true;
+				continue;
+			}
+			is >> name;
+			PlyScalarType type = get_ply_scalar_type(type_name);
+			if (type == PST_UNDEF)
+				return false;
+			if (in_vertex) {
+				for (int p = 0; p < PVP_COUNT; ++p)
+					if (name == property_names[p]) {
+						L.offsets[p] = int(elem_stride);
+						L.types[p] = type;
+					}
+			}
+			elem_stride += get_ply_scalar_size(type);
+		}
+	}
+	if (!is_binary_little_endian || !vertex_found || !L.has(PVP_X) || !L.has(PVP_Y) || !L.has(PVP_Z))
+		return false;
+	L.data_offset = (line_begin - begin) + preceding_size;
+	return true;
+}
+
+/// load a scalar from a possibly unaligned address
+template <typename T>
+inline T load_ply_scalar(const char* ptr)
+{
+	T v;
+	memcpy(&v, ptr, sizeof(T));
+	return v;
+}
+
+/// convert a ply scalar to a color component, integer types are interpreted as bytes
+template <typename T>
+inline point_cloud::ClrComp ply_to_color_component(T v) { return point_cloud::byte_to_color_component(cgv::type::uint8_type(std::min(std::max(double(v), 0.0), 255.0))); }
+inline point_cloud::ClrComp ply_to_color_component(cgv::type::uint8_type v) { return point_cloud::byte_to_color_component(v); }
+inline point_cloud::ClrComp ply_to_color_component(cgv::type::uint16_type v) { return point_cloud::byte_to_color_component(cgv::type::uint8_type(v >> 8)); }
+inline point_cloud::ClrComp ply_to_color_component(float v) { return point_cloud::float_to_color_component(v); }
+inline point_cloud::ClrComp ply_to_color_component(double v) { return point_cloud::float_to_color_component(v); }
+
+/// decode the c-th coordinate of n vectors from a column of scalars of type T
+template <typename T, typename V>
+void decode_ply_coordinates(const char* src, size_t stride, size_t n, V* dst, int c)
+{
+	for (size_t i = 0; i < n; ++i, src += stride)
+		dst[i][c] = point_cloud::Crd(load_ply_scalar<T>(src));
+}
+
+/// decode the c-th component of n colors from a column of scalars of type T
+template <typename T>
+void decode_ply_color_components(const char* src, size_t stride, size_t n, point_cloud::Clr* dst, int c)
+{
+	for (size_t i = 0; i < n; ++i, src += stride)
+		dst[i][c] = ply_to_color_component(load_ply_scalar<T>(src));
+}
+
+/// decode the c-th coordinate of n vectors from a column of scalars of the given type
+template <typename V>
+void decode_ply_coordinates(PlyScalarType type, const char* src, size_t stride, size_t n, V* dst, int c)
+{
+	switch (type) {
+	case PST_INT8:    decode_ply_coordinates<cgv::type::int8_type>(src, stride, n, dst, c); break;
+	case PST_UINT8:   decode_ply_coordinates<cgv::type::uint8_type>(src, stride, n, dst, c); break;
+	case PST_INT16:   decode_ply_coordinates<cgv::type::int16_type>(src, stride, n, dst, c); break;
+	case PST_UINT16:  decode_ply_coordinates<cgv::type::uint16_type>(src, stride, n, dst, c); break;
+	case PST_INT32:   decode_ply_coordinates<cgv::type::int32_type>(src, stride, n, dst, c); break;
+	case PST_UINT32:  decode_ply_coordinates<cgv::type::uint32_type>(src, stride, n, dst, c); break;
+	case PST_FLOAT32: decode_ply_coordinates<float>(src, stride, n, dst, c); break;
+	case PST_FLOAT64: decode_ply_coordinates<double>(src, stride, n, dst, c); break;
+	default: break;
+	}
+}
+
+/// decode the c-th component of n colors from a column of scalars of the given type
+void decode_ply_color_components(PlyScalarType type, const char* src, size_t stride, size_t n, point_cloud::Clr* dst, int c)
+{
+	switch (type) {
+	case PST_INT8:    decode_ply_color_components<cgv::type::int8_type>(src, stride, n, dst, c); break;
+	case PST_UINT8:   decode_ply_color_components<cgv::type::uint8_type>(src, stride, n, dst, c); break;
+	case PST_INT16:   decode_ply_color_components<cgv::type::int16_type>(src, stride, n, dst, c); break;
+	case PST_UINT16:  decode_ply_color_components<cgv::type::uint16_type>(src, stride, n, dst, c); break;
+	case PST_INT32:   decode_ply_color_components<cgv::type::int32_type>(src, stride, n, dst, c); break;
+	case PST_UINT32:  decode_ply_color_components<cgv::type::uint32_type>(src, stride, n, dst, c); break;
+	case PST_FLOAT32: decode_ply_color_components<float>(src, stride, n, dst, c); break;
+	case PST_FLOAT64: decode_ply_color_components<double>(src, stride, n, dst, c); break;
+	default: break;
+	}
+}
+
+/// decode n consecutive vertices column by column, normals and colors are only decoded if the pointers are not null
+void decode_ply_vertices(const ply_vertex_layout& L, const char* src, size_t n, point_cloud::Pnt* P, point_cloud::Nml* N, point_cloud::Clr* C)
+{
+	if (P)
+		for (int c = 0; c < 3; ++c)
+			decode_ply_coordinates(L.types[PVP_X + c], src + L.offsets[PVP_X + c], L.stride, n, P, c);
+	if (N)
+		for (int c = 0; c < 3; ++c)
+			decode_ply_coordinates(L.types[PVP_NX + c], src + L.offsets[PVP_NX + c], L.stride, n, N, c);
+	if (C) {
+		if (L.has_rgb()) {
+			for (int c = 0; c < 3; ++c)
+				decode_ply_color_components(L.types[PVP_RED + c], src + L.offsets[PVP_RED + c], L.stride, n, C, c);
+		}
+		else {
+			decode_ply_color_components(L.types[PVP_INTENSITY], src + L.offsets[PVP_INTENSITY], L.stride, n, C, 0);
+			for (size_t i = 0; i < n; ++i)
+				C[i][2] = C[i][1] = C[i][0];
+		}
+	}
+}
+
+/// number of vertices decoded or encoded by one task of the binary ply reader and writer
+const size_t ply_block_size = 16384;
+
+/// decode n vertices in parallel blocks into the arrays starting at vertex index first
+void decode_ply_vertices_parallel(const ply_vertex_layout& L, const char* src, size_t first, size_t n, point_cloud::Pnt* P, point_cloud::Nml* N, point_cloud::Clr* C)
+{
+	size_t nr_blocks = (n + ply_block_size - 1) / ply_block_size;
+	parallel_for(size_t(0), nr_blocks, size_t(1), [&](size_t b) {
+		size_t i = first + b * ply_block_size;
+		decode_ply_vertices(L, src + b * ply_block_size * L.stride, std::min(ply_block_size, n - b * ply_block_size),
+			P ? P + i : 0, N ? N + i : 0, C ? C + i : 0);
+	});
+}
+} // namespace
+
+bool point_cloud::read_ply_binary(const string& file_name)
+{
+	ply_vertex_layout L;
+	if (use_memory_mapping) {
+		cgv::data::mapped_file_ptr mapping(new cgv::utils::mapped_file());
+		if (mapping->open(file_name)) {
+			const char* data = mapping->get_data();
+			size_t size = mapping->get_size();
+			if (!parse_ply_vertex_layout(data, data + size, L) || L.data_offset + L.nr_vertices * L.stride > size)
+				return false;
+			clear();
+			has_nmls = L.has_normals();
+			has_clrs = L.has_colors();
+			bool positions_mapped = L.is_packed_float_positions() && P.map(mapping, L.data_offset, L.nr_vertices);
+			if (!positions_mapped)
+				P.resize(L.nr_vertices);
+			if (has_nmls)
+				N.resize(L.nr_vertices);
+			if (has_clrs)
+				C.resize(L.nr_vertices);
+			decode_ply_vertices_parallel(L, data + L.data_offset, 0, L.nr_vertices, positions_mapped ? 0 : P.data(), N.data(), C.data());
+			if (positions_mapped)
+				mapped_file_name = file_name;
+			return true;
+		}
+	}
+	FILE* fp = fopen(file_name.c_str(), "rb");
+	if (!fp)
+		return false;
+	// read until the end of the header is contained in the buffer
+	std::vector<char> buffer;
+	static const char end_header[] = "end_header";
+	size_t size = 0;
+	while (true) {
+		buffer.resize(size + 4096);
+		size_t nr_read = fread(&buffer[size], 1, 4096, fp);
+		size += nr_read;
+		const char* header_end = std::search(&buffer[0], &buffer[0] + size, end_header, end_header + sizeof(end_header) - 1);
+		if (std::find(header_end, (const char*)&buffer[0] + size, '\n') != &buffer[0] + size)
+			break;
+		if (nr_read == 0 || size > (1 << 20)) {
+			fclose(fp);
+			return false;
+		}
+	}
+	if (!parse_ply_vertex_layout(&buffer[0], &buffer[0] + size, L) || fseek(fp, long(L.data_offset), SEEK_SET) != 0) {
+		fclose(fp);
+		return false;
+	}
+	clear();
+	has_nmls = L.has_normals();
+	has_clrs = L.has_colors();
+	P.resize(L.nr_vertices);
+	if (has_nmls)
+		N.resize(L.nr_vertices);
+	if (has_clrs)
+		C.resize(L.nr_vertices);
+	// read and decode vertices in blocks of several decoding tasks
+	size_t nr_block_vertices = 16 * ply_block_size;
+	buffer.resize(nr_block_vertices * L.stride);
+	bool success = true;
+	for (size_t i = 0; i < L.nr_vertices; i += nr_block_vertices) {
+		size_t n = std::min(nr_block_vertices, L.nr_vertices - i);
+		if (fread(&buffer[0], L.stride, n, fp) != n) {
+			std::cerr << "ply file " << file_name << " is truncated!" << std::endl;
+			success = false;
+			break;
+		}
+		decode_ply_vertices_parallel(L, &buffer[0], i, n, P.data(), N.data(), C.data());
+	}
+	fclose(fp);
+	if (!success)
+		clear();
+	return success;
+}
 
 bool point_cloud::read_ply(const string& _file_name) 
 {
+	if (read_ply_binary(_file_name))
+		return true;
 	PlyFile* ply_in =  open_ply_for_read(const_cast<char*>(_file_name.c_str()));
 	if (!ply_in)
 		return false;
@@ -1038,74 +1624,63 @@ bool point_cloud::read_ply(const string& _file_name)
 
 bool point_cloud::write_ply(const std::string& file_name) const
 {
-	PlyFile* ply_out = open_ply_for_write(file_name.c_str(), 2, propNames, PLY_BINARY_LE);
-	if (!ply_out) 
+	FILE* fp = fopen(file_name.c_str(), "wb");
+	if (!fp)
 		return false;
-	describe_element_ply (ply_out, "vertex", (int)P.size());
-	for (int p=0; p<10; ++p) 
-		describe_property_ply (ply_out, &vert_props[p]);
-	describe_element_ply (ply_out, "face", 0);
-	describe_property_ply (ply_out, &face_props[0]);
-	header_complete_ply(ply_out);
-
-	put_element_setup_ply (ply_out, "vertex");
-
-	for (int j = 0; j < (int)P.size(); j++) {
-		PlyVertex vertex;
-		vertex.x = P[j][0];
-		vertex.y = P[j][1];
-		vertex.z = P[j][2];
-		if (N.size() == P.size()) {
-			vertex.nx = N[j][0];
-			vertex.ny = N[j][1];
-			vertex.nz = N[j][2];
-		}
-		else {
-			vertex.nx = 0.0f;
-			vertex.ny = 0.0f;
-			vertex.nz = 1.0f;
-		}
-		if (C.size() == P.size()) {
-			vertex.red = (unsigned char)(C[j][0]*255);
-			vertex.green = (unsigned char)(C[j][1]*255);
-			vertex.blue = (unsigned char)(C[j][2]*255);
-		}
-		else {
-			vertex.red   = 255;
-			vertex.green = 255;
-			vertex.blue  = 255;
-		}
-		vertex.alpha = 255;
-		put_element_ply(ply_out, (void *)&vertex);
+	size_t n = P.size();
+	bool write_nmls = has_normals() && N.size() == n;
+	bool write_clrs = has_colors() && C.size() == n;
+	std::string header = "ply\nformat binary_little_endian 1.0\nelement vertex " + std::to_string(n) + "\n";
+	header += "property float x\nproperty float y\nproperty float z\n";
+	if (write_nmls)
+		header += "property float nx\nproperty float ny\nproperty float nz\n";
+	if (write_clrs)
+		header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+	header += "element face 0\nproperty list uchar int vertex_indices\n";
+	// pad the header with a comment such that the float positions can be memory mapped in place by read_ply_binary
+	const std::string end_header = "\nend_header\n";
+	header += "comment padding" + end_header;
+	header.insert(header.size() - end_header.size(), (4 - header.size() % 4) % 4, ' ');
+	bool success = fwrite(header.c_str(), 1, header.size(), fp) == header.size();
+	// encode and write vertices in blocks of several encoding tasks
+	size_t stride = 3 * sizeof(float) + (write_nmls ? 3 * sizeof(float) : 0) + (write_clrs ? 3 : 0);
+	size_t nr_block_vertices = 16 * ply_block_size;
+	std::vector<char> buffer(std::min(n, nr_block_vertices) * stride);
+	for (size_t i = 0; success && i < n; i += nr_block_vertices) {
+		size_t m = std::min(nr_block_vertices, n - i);
+		parallel_for(size_t(0), (m + ply_block_size - 1) / ply_block_size, size_t(1), [&](size_t b) {
+			size_t end = std::min(m, (b + 1) * ply_block_size);
+			for (size_t j = b * ply_block_size; j < end; ++j) {
+				char* dst = &buffer[j * stride];
+				float v[3] = { float(P[i + j][0]), float(P[i + j][1]), float(P[i + j][2]) };
+				memcpy(dst, v, sizeof(v));
+				dst += sizeof(v);
+				if (write_nmls) {
+					float nv[3] = { float(N[i + j][0]), float(N[i + j][1]), float(N[i + j][2]) };
+					memcpy(dst, nv, sizeof(nv));
+					dst += sizeof(nv);
+				}
+				if (write_clrs)
+					for (int c = 0; c < 3; ++c)
+						*dst++ = char(color_component_to_byte(C[i + j][c]));
+			}
+		});
+		success = fwrite(&buffer[0], stride, m, fp) == m;
 	}
-	put_element_setup_ply (ply_out, "face");
-	close_ply (ply_out);
-	free_ply (ply_out);
-	return true;
+	return fclose(fp) == 0 && success;
 }
 
 bool point_cloud::read_ascii(const string& file_name)
 {
-	ifstream is(file_name.c_str());
-	if (is.fail()) 
+	string content;
+	if (!cgv::utils::file::read(file_name, content, true))
 		return false;
 	clear();
-	while (!is.eof()) {
-		char buffer[4096];
-		is.getline(buffer,4096);
-		float x, y, z, nx, ny, nz, r, g, b;
-		unsigned int n = sscanf(buffer, "%f %f %f %f %f %f %f %f %f", &x, &y, &z, &nx, &ny, &nz, &r, &g, &b);
-		if (n == 3 || n == 6 || n == 9)
-			P.push_back(Pnt(x,y,z));
-		if (n == 6) {
-			if (no_normals_contained)
-				C.push_back(Clr(float_to_color_component(nx), float_to_color_component(ny), float_to_color_component(nz)));
-			else
-				N.push_back(Nml(nx,ny,nz));
-		}
-		if (n == 9)
-			C.push_back(Clr(float_to_color_component(r), float_to_color_component(g), float_to_color_component(b)));
-	}
+	std::vector<ascii_chunk> chunks;
+	parse_ascii_parallel(content.c_str(), content.c_str() + content.size(), points_line_parser(no_normals_contained, true), chunks);
+	append_ascii_chunks(P, chunks, &ascii_chunk::P);
+	append_ascii_chunks(N, chunks, &ascii_chunk::N);
+	append_ascii_chunks(C, chunks, &ascii_chunk::C);
 	return true;
 }
 
@@ -7,6 +7,7 @@
 #include <cgv/math/quaternion.h>
 #include <cgv/media/color.h>
 #include <cgv/media/axis_aligned_box.h>
+#include <cgv/data/mapped_vector.h>
 
 #include "lib_begin.h"
 
@@ -105,20 +106,21 @@ public:
 
 
 /** simple point cloud data structure with dynamic containers for positions, normals and colors. 
-    Normals and colors are optional and can be dynamically allocated and deallocated. */
+    Normals and colors are optional and can be dynamically allocated and deallocated. 
+	The per point containers can alternatively reference a memory mapped binary file (see read_bin). */
 class CGV_API point_cloud : public point_cloud_types
 {	
 protected:
 	/// container for point positions
-	std::vector<Pnt> P;
+	cgv::data::mapped_vector<Pnt> P;
 	/// container for point normals
-	std::vector<Nml> N;
+	cgv::data::mapped_vector<Nml> N;
 	/// container for point colors
-	std::vector<Clr> C;
+	cgv::data::mapped_vector<Clr> C;
 	/// container for point texture coordinates 
-	std::vector<TexCrd> T;
+	cgv::data::mapped_vector<TexCrd> T;
 	/// container for point pixel coordinates 
-	std::vector<PixCrd> I;
+	cgv::data::mapped_vector<PixCrd> I;
 
 	/// container to store  one component index per point
 	std::vector<unsigned> component_indices;
@@ -159,6 +161,10 @@ private:
 protected:
 	/// when true, second vector is interpreted as normals when reading an ascii format
 	bool no_normals_contained;
+	/// when true, binary files are memory mapped and the per point containers reference the mapping instead of copies
+	bool use_memory_mapping;
+	/// name of the currently memory mapped file or empty if no file is mapped
+	std::string mapped_file_name;
 	/// flag that tells whether normals are allocated
 	bool has_nmls;
 	/// flag that tells whether colors are allocated
@@ -189,19 +195,29 @@ protected:
 	/*! Binary format has 8 bytes header encoding two 32-bit unsigned ints n and m.
 	    n is the number of points. In case no colors are provided m is the number of normals, i.e. m=0 in case no normals are provided.
 		In case colors are present there must be the same number n of colors as points and m is set to 2*n+nr_normals. This is a hack
-		resulting from the extension of the format with colors. */
+		resulting from the extension of the format with colors. 
+		If memory mapping is enabled, the file is mapped copy-on-write and all suitably aligned sections are used in place, such 
+		that reading is O(1) and only touched pages are loaded or copied. */
 	bool read_bin(const std::string& file_name);
+	/// map binary file and reference its sections from the per point containers; return false if the file cannot be mapped
+	bool read_bin_mapped(const std::string& file_name);
 	//! read a ply format.
 	/*! Ignores all but the vertex elements and from the vertex elements the properties x,y,z,nx,ny,nz:Float32 and red,green,blue,alpha:Uint8.
-	    Colors are transformed to 32-bit floats in the range [0,1] and alpha components are ignored. */
+	    Colors are transformed to 32-bit floats in the range [0,1] and alpha components are ignored. Binary little endian
+		files are read with read_ply_binary and all other files with the property based reader of ply.c. */
 	bool read_ply(const std::string& file_name);
+	/** read the vertex element of a binary little endian ply file with a fixed vertex layout compiled from the header.
+	    Properties of any scalar type are converted column wise in parallel blocks, colors can also be given by an
+		intensity property. If memory mapping is enabled, the file is mapped and tightly packed float positions are
+		referenced in place. Return false without reading if the file is not supported, e.g. for ascii files. */
+	bool read_ply_binary(const std::string& file_name);
 	/// write ascii format, see read_ascii for format description
 	bool write_ascii(const std::string& file_name, bool write_nmls = true) const;
 	/// write binary format, see read_bin for format description
 	bool write_bin(const std::string& file_name) const;
 	/// write obj format, see read_obj for format description
 	bool write_obj(const std::string& file_name) const;
-	/// write ply format, see read_ply for format description
+	/// write binary little endian ply format with float positions and normals and byte colors, the latter two only if present
 	bool write_ply(const std::string& file_name) const;
 public:
 	/// construct empty point cloud
@@ -235,6 +251,18 @@ public:
 	void resize(unsigned nr_points);
 	//@}
 
+	/**@name memory mapping */
+	//@{
+	/// enable or disable memory mapping of binary files in subsequent read calls
+	void set_memory_mapping(bool enable) { use_memory_mapping = enable; }
+	/// return whether binary files are memory mapped when read
+	bool get_memory_mapping() const { return use_memory_mapping; }
+	/// return whether any per point container references a memory mapped file
+	bool is_memory_mapped() const;
+	/// copy all memory mapped per point containers into owned memory and release the file mapping
+	void detach_from_file();
+	//@}
+
 	/**@name file io*/
 	//@{
 	//! determine format from extension and read with corresponding read method 
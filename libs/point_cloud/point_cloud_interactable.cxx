@@ -19,10 +19,10 @@
 
 #define FILE_OPEN_TITLE "Open Point Cloud"
 #define FILE_APPEND_TITLE "Append Point Cloud"
-#define FILE_OPEN_FILTER "Point Clouds (apc,bpc):*.apc;*.bpc|Mesh Files (obj,ply,pct):*.obj;*.ply;*.pct|All Files:*.*"
+#define FILE_OPEN_FILTER "Point Clouds (apc,bpc,opc):*.apc;*.bpc;*.opc|Mesh Files (obj,ply,pct):*.obj;*.ply;*.pct|All Files:*.*"
 
 #define FILE_SAVE_TITLE "Save Point Cloud"
-#define FILE_SAVE_FILTER "Point Clouds (apc,bpc):*.apc;*.bpc|Mesh Files (obj,ply):*.obj;*.ply|All Files:*.*"
+#define FILE_SAVE_FILTER "Point Clouds (apc,bpc,opc):*.apc;*.bpc;*.opc|Mesh Files (obj,ply):*.obj;*.ply|All Files:*.*"
 
 void point_cloud_interactable::update_file_name(const std::string& ffn, bool append)
 {
@@ -156,24 +156,42 @@ void point_cloud_interactable::build_neighbor_graph()
 		return;
 	}
 
-	ng.clear();
+	clear_neighbor_graph();
 	ensure_tree_ds();
 	cgv::utils::statistics he_stats;
-	ng.build(pc.get_nr_points(), k, *tree_ds, &he_stats);
-	if (do_symmetrize)
-		ng.symmetrize();
+	size_t nr_half_edges;
+	if (use_compact_neighbor_graph) {
+		cng.build(Cnt(pc.get_nr_points()), k, *tree_ds, &he_stats);
+		if (do_symmetrize)
+			cng.symmetrize();
+		ne.set_compact_neighbor_graph(&cng);
+		nr_half_edges = size_t(cng.get_nr_half_edges());
+	}
+	else {
+		ng.build(pc.get_nr_points(), k, *tree_ds, &he_stats);
+		if (do_symmetrize)
+			ng.symmetrize();
+		nr_half_edges = ng.nr_half_edges;
+	}
 	on_point_cloud_change_callback(PCC_NEIGHBORGRAPH_CREATE);
 
 	std::cout << "half edge statistics " << he_stats << std::endl;
 	std::cout << "v " << pc.get_nr_points()
-		<< ", he = " << ng.nr_half_edges
-		<< " ==> " << (float)ng.nr_half_edges / ((unsigned)(pc.get_nr_points())) << " half edges per vertex" << std::endl;
+		<< ", he = " << nr_half_edges
+		<< " ==> " << (float)nr_half_edges / ((unsigned)(pc.get_nr_points())) << " half edges per vertex" << std::endl;
+}
+
+void point_cloud_interactable::clear_neighbor_graph()
+{
+	ng.clear();
+	cng.clear();
+	ne.set_compact_neighbor_graph(0);
 }
 
 void point_cloud_interactable::build_neighbor_graph_componentwise()
 {
 	// prepare neighbor graph data structure
-	ng.clear();
+	clear_neighbor_graph();
 	ng.resize(pc.get_nr_points());
 
 	// iterate components
@@ -189,9 +207,7 @@ void point_cloud_interactable::build_neighbor_graph_componentwise()
 			Idx i = l + offset;
 			std::vector<Idx>& Ni = ng[i];
 			T->extract_neighbors(i, k, Ni);
-			for (auto& ni : Ni) 
-				ni += offset;
-			ng.nr_half_edges += k;
+			ng.nr_half_edges += Cnt(Ni.size());
 		}
 		delete T;
 		std::cout << "*"; std::cout.flush();
@@ -257,7 +273,7 @@ bool point_cloud_interactable::get_picked_point(int x, int y, unsigned& index)
 
 void point_cloud_interactable::compute_normals()
 {
-	if (ng.empty())
+	if (!has_neighbor_graph())
 		build_neighbor_graph();
 	ne.compute_weighted_normals(reorient_normals && pc.has_normals());
 	on_point_cloud_change_callback(PCC_NORMALS);
@@ -265,7 +281,7 @@ void point_cloud_interactable::compute_normals()
 }
 void point_cloud_interactable::recompute_normals()
 {
-	if (ng.empty())
+	if (!has_neighbor_graph())
 		build_neighbor_graph();
 	if (!pc.has_normals())
 		compute_normals();
@@ -285,7 +301,7 @@ void point_cloud_interactable::toggle_normal_orientations()
 }
 void point_cloud_interactable::orient_normals()
 {
-	if (ng.empty())
+	if (!has_neighbor_graph())
 		build_neighbor_graph();
 	if (!pc.has_normals())
 		compute_normals();
@@ -296,7 +312,7 @@ void point_cloud_interactable::orient_normals()
 void point_cloud_interactable::orient_normals_to_view_point()
 {
 	if (ensure_view_pointer()) {
-		if (ng.empty())
+		if (!has_neighbor_graph())
 			build_neighbor_graph();
 		Pnt view_point = view_ptr->get_eye();
 		ne.orient_normals(view_point);
@@ -339,6 +355,7 @@ point_cloud_interactable::point_cloud_interactable() : ne(pc, ng)
 	show_neighbor_graph = false;
 	k = 30;
 	do_symmetrize = false;
+	use_compact_neighbor_graph = false;
 	reorient_normals = true;
 }
 void point_cloud_interactable::auto_set_view()
@@ -369,6 +386,7 @@ bool point_cloud_interactable::self_reflect(cgv::reflect::reflection_handler& sr
 		srh.reflect_member("use_component_colors", use_component_colors) &&
 		srh.reflect_member("use_component_transformations", use_component_transformations) &&
 		srh.reflect_member("do_auto_view", do_auto_view) &&
+		srh.reflect_member("use_memory_mapping", pc.use_memory_mapping) &&
 		srh.reflect_member("data_path", data_path) &&
 		srh.reflect_member("file_name", new_file_name) &&
 		srh.reflect_member("directory_name", directory_name) &&
@@ -384,6 +402,7 @@ bool point_cloud_interactable::self_reflect(cgv::reflect::reflection_handler& sr
 		srh.reflect_member("show_neighbor_graph", show_neighbor_graph) &&
 		srh.reflect_member("k", k) &&
 		srh.reflect_member("do_symmetrize", do_symmetrize) &&
+		srh.reflect_member("use_compact_neighbor_graph", use_compact_neighbor_graph) &&
 		srh.reflect_member("reorient_normals", reorient_normals))
 		return true;
 	return false;
@@ -421,12 +440,13 @@ void point_cloud_interactable::draw_graph(cgv::render::context& ctx)
 	glColor3f(0.5f, 0.5f, 0.5f);
 	glLineWidth(normal_style.line_width);
 	glBegin(GL_LINES);
-	for (unsigned int vi = 0; vi<ng.size(); ++vi) {
-		const std::vector<Idx> &Ni = ng[vi];
+	unsigned int n = unsigned(cng.empty() ? ng.size() : cng.size());
+	for (unsigned int vi = 0; vi<n; ++vi) {
+		neighbor_range Ni = neighbors(vi);
 		for (unsigned int j = 0; j<Ni.size(); ++j) {
 			unsigned int vj = Ni[j];
 			// check for symmetric case and only draw once
-			if (ng.is_directed_edge(vj, vi)) {
+			if (cng.empty() ? ng.is_directed_edge(vj, vi) : cng.is_directed_edge(vj, vi)) {
 				if (vi < vj) {
 					draw_edge_color(vi, j, true, true);
 					glArrayElement(vi);
@@ -468,7 +488,9 @@ void point_cloud_interactable::init_frame(cgv::render::context& ctx)
 			}
 		}
 	}
-	gl_point_cloud_drawable::init_frame(ctx);
+	// streamed points of an out of core point cloud replace pc, such that derived data is out of date
+	if (update_out_of_core_points(ctx))
+		on_point_cloud_change_callback(PCC_POINTS_RESIZE);
 }
 void point_cloud_interactable::draw(cgv::render::context& ctx)
 {
@@ -688,13 +710,15 @@ void point_cloud_interactable::on_point_cloud_change_callback(PointCloudChangeEv
 			surfel_style.illumination_mode = cgv::render::IM_OFF;
 		update_member(&surfel_style.illumination_mode);
 	}
+	if ((pcc_event & PCC_POINTS_MASK) != 0)
+		point_sorter.invalidate();
 	if (((pcc_event & PCC_POINTS_MASK) == PCC_POINTS_RESIZE) || ((pcc_event & PCC_POINTS_MASK) == PCC_NEW_POINT_CLOUD)) {
 		tree_ds_out_of_date = true;
 		if (tree_ds) {
 			delete tree_ds;
 			tree_ds = 0;
 		}
-		ng.clear();
+		clear_neighbor_graph();
 		show_point_end = pc.get_nr_points();
 		show_point_begin = 0;
 
@@ -796,6 +820,7 @@ void point_cloud_interactable::create_gui()
 			"save=true;save_title='" FILE_SAVE_TITLE "';save_filter='" FILE_SAVE_FILTER "'"
 		);
 		add_gui("directory_name", directory_name, "directory", "w=170;title='Select Data Directory';tooltip='read all point clouds from a directory'");
+		add_member_control(this, "memory map binary files", pc.use_memory_mapping, "check");
 		align("\b");
 		end_tree_node(data_path);
 	}
@@ -856,6 +881,7 @@ void point_cloud_interactable::create_gui()
 	if (show) {
 		add_member_control(this, "k", k, "value_slider", "min=3;max=50;log=true;ticks=true");
 		add_member_control(this, "symmetrize", do_symmetrize, "toggle");
+		add_member_control(this, "compact", use_compact_neighbor_graph, "toggle");
 		cgv::signal::connect_copy(add_button("build")->click, cgv::signal::rebind(this, &point_cloud_interactable::build_neighbor_graph));
 		end_tree_node(show_neighbor_graph);
 	}
@@ -8,6 +8,7 @@
 #include "gl_point_cloud_drawable.h"
 #include "ann_tree.h"
 #include "neighbor_graph.h"
+#include "compact_neighbor_graph.h"
 #include "normal_estimator.h"
 
 #include "lib_begin.h"
@@ -128,8 +129,18 @@ protected:
 	unsigned k;
 	/// whether to symmetric neighbor graph after build
 	bool do_symmetrize;
+	/// whether to build the neighbor graph in the compact representation, which is used for normal estimation and drawing
+	bool use_compact_neighbor_graph;
 	/// knn-neighbor graph built with tree_ds
 	neighbor_graph ng;
+	/// compact knn-neighbor graph built with tree_ds if use_compact_neighbor_graph is set
+	compact_neighbor_graph cng;
+	/// check whether a neighbor graph has been built in one of the two representations
+	bool has_neighbor_graph() const { return !ng.empty() || !cng.empty(); }
+	/// return neighbors of vi from the representation that has been built
+	neighbor_range neighbors(Idx vi) const { return cng.empty() ? ng.neighbors(vi) : cng.neighbors(vi); }
+	/// clear both representations of the neighbor graph
+	void clear_neighbor_graph();
 	/// build the neighbor graph
 	void build_neighbor_graph();
 	/// build the neighbor graph
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstring>
+#include <cgv/type/standard_types.h>
+
+/// map float to unsigned integer with the same order, such that floats can be sorted with integer keys
+inline cgv::type::uint32_type float_to_key(float f)
+{
+	cgv::type::uint32_type u;
+	std::memcpy(&u, &f, sizeof(float));
+	return (u & 0x80000000u) != 0 ? ~u : (u | 0x80000000u);
+}
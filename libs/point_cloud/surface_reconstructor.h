@@ -243,8 +243,10 @@ struct CGV_API surface_reconstructor : public point_cloud_types
 	/// whether to print debug information on grow events
 	bool debug_events;
 	double valid_length_scale;
+	/// type of priority queue of grow events
+	typedef cgv::data::dynamic_priority_queue<grow_event> grow_queue;
 	/// store all grow events
-	cgv::data::dynamic_priority_queue<grow_event> grow_events;
+	grow_queue grow_events;
 	/// store for each vertex the index of its first grow event or -1 if non present
 	std::vector<int> first_grow_event;
 	/// statistics over the quality of the grow event triangles
@@ -262,16 +264,27 @@ struct CGV_API surface_reconstructor : public point_cloud_types
 	bool is_valid_edge_grow_event(const grow_event& ge, unsigned int& nr_insert, unsigned int& nr_remove) const;
 	bool validate_event(grow_event& ge) const;
 	void add_grow_event(const grow_event& ge);
+	void add_grow_event(const grow_event& ge, grow_queue& Q);
 	/// check corner grow event and insert to queue
 	bool consider_corner_grow_event(unsigned int vi,unsigned int j, unsigned int k);
+	bool consider_corner_grow_event(unsigned int vi,unsigned int j, unsigned int k, grow_queue& Q);
 	/// check edge grow event and insert to queue
 	bool consider_edge_grow_event(unsigned int vi,unsigned int j, unsigned int k, Direction dir);
+	bool consider_edge_grow_event(unsigned int vi,unsigned int j, unsigned int k, Direction dir, grow_queue& Q);
 	/// determine all grow events of the given vi
 	void consider_grow_events(unsigned int vi);
+	void consider_grow_events(unsigned int vi, grow_queue& Q);
 	/// build priority queue of events
 	void build_grow_queue(const std::vector<unsigned int>& T);
 	/// remove the grow events of a given vertex
 	void remove_grow_events(unsigned int vi);
+	void remove_grow_events(unsigned int vi, grow_queue& Q);
+	/// remove the top event of Q from the event list of its vertex and from Q
+	void pop_grow_event(grow_queue& Q);
+	/// check whether a grow event is still valid and can be performed without self intersections
+	bool can_perform_grow_event(grow_event& ge) const;
+	/// perform the top event of Q, update the events of all influenced vertices in Q and add the new triangle to T
+	void perform_grow_event(grow_queue& Q, std::vector<unsigned int>& T);
 	///
 	unsigned int insert_directed_edge(unsigned int vi, unsigned int vj);
 	///
@@ -286,6 +299,27 @@ struct CGV_API surface_reconstructor : public point_cloud_types
 	unsigned int grow_all(std::vector<unsigned int>& T);
 	//@}
 
+	/**@name parallel region growing */
+	//@{
+	/// per vertex the index of the spatial partition it belongs to
+	std::vector<unsigned int> vertex_partition;
+	/// per vertex the stamp of the last search of is_partition_interior(), only accessed by the thread growing the partition of the vertex
+	std::vector<unsigned int> vertex_visit_stamp;
+	/// assign vertices to nr_partitions slabs with equal numbers of points along the largest extent of the point cloud
+	void compute_vertex_partition(unsigned int nr_partitions);
+	/** check whether all vertices up to the given graph distance from vi belong to the partition of vi. Only neighborhoods
+	    of vertices in this partition are read, such that the check can run concurrently to the growing of other partitions. */
+	bool is_partition_interior(unsigned int vi, unsigned int distance, unsigned int& stamp, std::vector<unsigned int>& front);
+	/** perform the events of Q till no more events are left. Events, whose update can read or modify vertices of other
+	    partitions, are skipped and their vertex is added to seam_vertices. */
+	void grow_partition(grow_queue& Q, std::vector<unsigned int>& T, std::vector<unsigned int>& seam_vertices);
+	/** initialize the triangle counts from the triangles in T, grow all partitions in parallel with one event queue per
+	    partition and finally grow from the seam vertices between partitions with the serial algorithm. The new triangles
+		are appended to T, sorted by partition and followed by the seam triangles. nr_partitions 0 selects two partitions
+		per thread. Returns the number of new triangles. */
+	unsigned int grow_all_parallel(std::vector<unsigned int>& T, unsigned int nr_partitions = 0);
+	//@}
+
 
 	/**@name neighbor graph filters */
 	//@{
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <set>
 #include "surface_reconstructor.h"
+#include "parallel_for.h"
 #include <cgv/math/functions.h>
 #include <cgv/utils/progression.h>
 
@@ -290,42 +291,64 @@ bool surface_reconstructor::validate_event(grow_event& ge) const
 }
 
 void surface_reconstructor::add_grow_event(const grow_event& ge)
+{
+	add_grow_event(ge, grow_events);
+}
+
+void surface_reconstructor::add_grow_event(const grow_event& ge, grow_queue& Q)
 {
 	if (debug_events) {
 		std::cout << "add event " << ge << std::endl;
 	}
-	unsigned int gi = grow_events.insert(ge);
-	if (ge.vi != grow_events[gi].vi) {
-		std::cout << "ups add event of wrong vertex " << grow_events[gi].vi << " instead of " << ge.vi << std::endl;
+	unsigned int gi = Q.insert(ge);
+	if (ge.vi != Q[gi].vi) {
+		std::cout << "ups add event of wrong vertex " << Q[gi].vi << " instead of " << ge.vi << std::endl;
 	}
-	if (first_grow_event[ge.vi] != -1 && ge.vi != grow_events[first_grow_event[ge.vi]].vi) {
-		std::cout << "ups add event of wrong vertex " << grow_events[first_grow_event[ge.vi]].vi << " instead of " << ge.vi << std::endl;
+	if (first_grow_event[ge.vi] != -1 && ge.vi != Q[first_grow_event[ge.vi]].vi) {
+		std::cout << "ups add event of wrong vertex " << Q[first_grow_event[ge.vi]].vi << " instead of " << ge.vi << std::endl;
 	}
-	grow_events[gi].next_grow_event_of_vertex = first_grow_event[ge.vi];
+	Q[gi].next_grow_event_of_vertex = first_grow_event[ge.vi];
 	first_grow_event[ge.vi] = gi;
 }
 
 /// check corner grow event and insert to queue
 bool surface_reconstructor::consider_corner_grow_event(
 	unsigned int vi,unsigned int j, unsigned int k)
+{
+	return consider_corner_grow_event(vi, j, k, grow_events);
+}
+
+bool surface_reconstructor::consider_corner_grow_event(
+	unsigned int vi,unsigned int j, unsigned int k, grow_queue& Q)
 {
 	grow_event ge(vi,j,k,CORNER_GROW_EVENT);
 	if (validate_event(ge))
-		add_grow_event(ge);
+		add_grow_event(ge, Q);
 	return true;
 }
 
 /// check edge grow event and insert to queue
 bool surface_reconstructor::consider_edge_grow_event(
 	unsigned int vi,unsigned int j, unsigned int k, Direction dir)
+{
+	return consider_edge_grow_event(vi, j, k, dir, grow_events);
+}
+
+bool surface_reconstructor::consider_edge_grow_event(
+	unsigned int vi,unsigned int j, unsigned int k, Direction dir, grow_queue& Q)
 {
 	grow_event ge(vi,j,k,EDGE_GROW_EVENT,dir);
 	if (validate_event(ge))
-		add_grow_event(ge);
+		add_grow_event(ge, Q);
 	return true;
 }
 
 void surface_reconstructor::consider_grow_events(unsigned int vi)
+{
+	consider_grow_events(vi, grow_events);
+}
+
+void surface_reconstructor::consider_grow_events(unsigned int vi, grow_queue& Q)
 {
 	unsigned int vj, j;
 	neighbor_graph& NG = *ng;
@@ -348,7 +371,7 @@ void surface_reconstructor::consider_grow_events(unsigned int vi)
 	do {
 		if (is_face_corner(vi,j)) {
 			if (!last_is_face_corner) {
-				consider_corner_grow_event(vi,block_end,j);
+				consider_corner_grow_event(vi,block_end,j,Q);
 				// check backward if we also have to consider an edge event
 				if (j != (block_end+1)%n) {
 					// check forward if we also have to consider an edge event
@@ -356,7 +379,7 @@ void surface_reconstructor::consider_grow_events(unsigned int vi)
 					unsigned int k = (j+n-1)%n;
 					int jk = NG.find(vj,Ni[k]);
 					if (jk == -1 || !is_face_corner(vj,jk))
-						consider_edge_grow_event(vi,k,j,BACKWARD);
+						consider_edge_grow_event(vi,k,j,BACKWARD,Q);
 				}
 			}
 			block_end = (j+1)%n;
@@ -373,7 +396,7 @@ void surface_reconstructor::consider_grow_events(unsigned int vi)
 					unsigned int nj = (unsigned int) Nj.size();
 					int jk = NG.find(vj,Ni[k]);
 					if (jk == -1 || !is_face_corner(vj,(jk+nj-1)%nj))
-						consider_edge_grow_event(vi,j,k,FORWARD);
+						consider_edge_grow_event(vi,j,k,FORWARD,Q);
 				}
 			}
 			last_is_face_corner = false;
@@ -415,6 +438,11 @@ void surface_reconstructor::build_grow_queue(const std::vector<unsigned int>& T)
 
 /// remove the grow events of a given vertex
 void surface_reconstructor::remove_grow_events(unsigned int vi)
+{
+	remove_grow_events(vi, grow_events);
+}
+
+void surface_reconstructor::remove_grow_events(unsigned int vi, grow_queue& Q)
 {
 	if (debug_events)
 		std::cout << "remove " << vi << " events:";
@@ -422,14 +450,14 @@ void surface_reconstructor::remove_grow_events(unsigned int vi)
 	int nr = 0;
 	while (gi != -1) {
 		int gj = gi;
-		gi = grow_events[gi].next_grow_event_of_vertex;
-		if (vi != grow_events[gj].vi) {
-			std::cout << "ups removed event of wrong vertex " << grow_events[gj].vi << " instead of " << vi << std::endl;
+		gi = Q[gi].next_grow_event_of_vertex;
+		if (vi != Q[gj].vi) {
+			std::cout << "ups removed event of wrong vertex " << Q[gj].vi << " instead of " << vi << std::endl;
 		}
 		if (debug_events) {
-			std::cout << " " << grow_events[gj];
+			std::cout << " " << Q[gj];
 		}
-		grow_events.remove(gj);
+		Q.remove(gj);
 	}
 	if (debug_events)
 		std::cout << std::endl;
@@ -544,6 +572,39 @@ void surface_reconstructor::connect_to_fan(unsigned int vi,unsigned int vj, unsi
 	remove_directed_edges(vi, (j+1)%n, k);
 }
 
+/// remove the top event of Q from the event list of its vertex and from Q
+void surface_reconstructor::pop_grow_event(grow_queue& Q)
+{
+	// ensure that we remove top event from the event list of its vertex
+	const grow_event& ge = Q[Q.top()];
+	int* ge_idx_ref = &first_grow_event[ge.vi];
+	bool found = false;
+	while (*ge_idx_ref != -1) {
+		if (*ge_idx_ref == Q.top()) {
+			*ge_idx_ref = ge.next_grow_event_of_vertex;
+			found = true;
+			break;
+		}
+		else {
+			ge_idx_ref = &Q[*ge_idx_ref].next_grow_event_of_vertex;
+		}
+	}
+	if (!found) {
+		std::cout << "UPS could not find top event" << std::endl;
+	}
+	// before poping it
+	Q.pop();
+}
+
+/// check whether a grow event is still valid and can be performed without self intersections
+bool surface_reconstructor::can_perform_grow_event(grow_event& ge) const
+{
+	return validate_event(ge) &&
+		( !perform_intersection_tests ||
+		   can_create_triangle_without_self_intersections(
+			   ge.vi,ng->at(ge.vi)[ge.j],ng->at(ge.vi)[ge.k]) );
+}
+
 /// perform grow event
 void surface_reconstructor::perform_next_grow_event(std::vector<unsigned int>& T)
 {
@@ -551,38 +612,18 @@ void surface_reconstructor::perform_next_grow_event(std::vector<unsigned int>& T
 		std::cout << "ATTEMPT TO PERFORM EMPTY GROW EVENT" << std::endl;
 	}
 
-	while (true) {
-		grow_event& ge = grow_events[grow_events.top()];
-		if (!validate_event(ge) || 
-			 ( perform_intersection_tests &&
-				  !can_create_triangle_without_self_intersections(
-				  ge.vi,ng->at(ge.vi)[ge.j],ng->at(ge.vi)[ge.k]) ) ) {
-		   // ensure that we remove top event from the event list of its vertex
-			unsigned int vi = ge.vi;
-			int* ge_idx_ref = &first_grow_event[vi];
-			bool found = false;
-			while (*ge_idx_ref != -1) {
-				if (*ge_idx_ref == grow_events.top()) {
-					*ge_idx_ref = ge.next_grow_event_of_vertex;
-					found = true;
-					break;
-				}
-				else {
-					ge_idx_ref = &grow_events[*ge_idx_ref].next_grow_event_of_vertex;
-				}
-			}
-			if (!found) {
-				std::cout << "UPS could not find top event" << std::endl;
-			}
-			// before poping it
-			grow_events.pop();
-			if (grow_events.empty())
-				return;
-		}
-		else
-			break;
+	while (!can_perform_grow_event(grow_events[grow_events.top()])) {
+		pop_grow_event(grow_events);
+		if (grow_events.empty())
+			return;
 	}
-	const grow_event& ge = grow_events[grow_events.top()];
+	perform_grow_event(grow_events, T);
+}
+
+/// perform the top event of Q, update the events of all influenced vertices in Q and add the new triangle to T
+void surface_reconstructor::perform_grow_event(grow_queue& Q, std::vector<unsigned int>& T)
+{
+	const grow_event& ge = Q[Q.top()];
 	neighbor_graph& NG = *ng;
 	unsigned int vi = ge.vi;
 	const std::vector<Idx> &Ni = NG[vi];
@@ -633,8 +674,8 @@ void surface_reconstructor::perform_next_grow_event(std::vector<unsigned int>& T
 	// update priority queue
 	for (std::set<unsigned int>::const_iterator iter = VI.begin(); iter != VI.end(); ++iter) {
 		unsigned int vi = *iter;
-		remove_grow_events(vi);
-		consider_grow_events(vi);
+		remove_grow_events(vi, Q);
+		consider_grow_events(vi, Q);
 	}
 	// add new triangle
 	T.push_back(vi);
@@ -652,3 +693,134 @@ unsigned int surface_reconstructor::grow_all(std::vector<unsigned int>& T)
 	}
 	return iter;
 }
+
+/// assign vertices to nr_partitions slabs with equal numbers of points along the largest extent of the point cloud
+void surface_reconstructor::compute_vertex_partition(unsigned int nr_partitions)
+{
+	unsigned int n = (unsigned int) pc->get_nr_points();
+	unsigned int c = pc->box().get_max_extent_coord_index();
+	std::vector<Idx> order(n);
+	for (unsigned int vi=0; vi<n; ++vi)
+		order[vi] = vi;
+	std::sort(order.begin(), order.end(), [this, c](Idx vi, Idx vj) { return pc->pnt(vi)(c) < pc->pnt(vj)(c); });
+	vertex_partition.resize(n);
+	for (unsigned int r=0; r<n; ++r)
+		vertex_partition[order[r]] = (unsigned int)(size_t(r)*nr_partitions/n);
+}
+
+/// check whether all vertices up to the given graph distance from vi belong to the partition of vi
+bool surface_reconstructor::is_partition_interior(unsigned int vi, unsigned int distance, unsigned int& stamp, std::vector<unsigned int>& front)
+{
+	unsigned int p = vertex_partition[vi];
+	++stamp;
+	front.clear();
+	front.push_back(vi);
+	vertex_visit_stamp[vi] = stamp;
+	size_t begin = 0;
+	for (unsigned int d=0; d<distance; ++d) {
+		size_t end = front.size();
+		for (size_t l=begin; l<end; ++l) {
+			// only neighborhoods of vertices in partition p are read
+			const std::vector<Idx> &Nl = ng->at(front[l]);
+			for (unsigned int j=0; j<Nl.size(); ++j) {
+				unsigned int vj = Nl[j];
+				if (vertex_partition[vj] != p)
+					return false;
+				if (vertex_visit_stamp[vj] != stamp) {
+					vertex_visit_stamp[vj] = stamp;
+					front.push_back(vj);
+				}
+			}
+		}
+		begin = end;
+	}
+	return true;
+}
+
+/// perform the events of Q till no more events are left
+void surface_reconstructor::grow_partition(grow_queue& Q, std::vector<unsigned int>& T, std::vector<unsigned int>& seam_vertices)
+{
+	unsigned int stamp = 0;
+	std::vector<unsigned int> front;
+	while (!Q.empty()) {
+		grow_event& ge = Q[Q.top()];
+		// validation reads the neighborhoods of vi and its neighbors and the update of the events of the
+		// influenced vertices reads neighborhoods up to a graph distance of three from vi
+		if (!is_partition_interior(ge.vi, 3, stamp, front)) {
+			seam_vertices.push_back(ge.vi);
+			pop_grow_event(Q);
+		}
+		else if (!can_perform_grow_event(ge))
+			pop_grow_event(Q);
+		else
+			perform_grow_event(Q, T);
+	}
+}
+
+/// grow all partitions in parallel and afterwards grow from the seam vertices
+unsigned int surface_reconstructor::grow_all_parallel(std::vector<unsigned int>& T, unsigned int nr_partitions)
+{
+	if (directed_edge_info.empty()) {
+		std::cout << "growing only possible after construction of directed edge info" << std::endl;
+		return 0;
+	}
+	if (!ng || !pc)
+		return 0;
+	unsigned int n = (unsigned int) ng->size();
+	if (nr_partitions == 0)
+		nr_partitions = 2*get_nr_worker_threads();
+	size_t nr_indices = T.size();
+
+	init_nr_triangles();
+	for (unsigned int i=0; i<T.size(); i+=3)
+		count_triangle(T[i],T[i+1],T[i+2]);
+	grow_events.clear();
+	first_grow_event.resize(n);
+	std::fill(first_grow_event.begin(),first_grow_event.end(),-1);
+
+	compute_vertex_partition(nr_partitions);
+	vertex_visit_stamp.resize(n);
+	std::fill(vertex_visit_stamp.begin(),vertex_visit_stamp.end(),0);
+	std::vector<std::vector<unsigned int> > partition_vertices(nr_partitions);
+	for (unsigned int vi=0; vi<n; ++vi)
+		partition_vertices[vertex_partition[vi]].push_back(vi);
+
+	// build one event queue per partition, which only reads the neighbor graph
+	std::vector<grow_queue> queues(nr_partitions);
+	std::vector<std::vector<unsigned int> > partition_T(nr_partitions), seam_vertices(nr_partitions);
+	parallel_for(0u, nr_partitions, 1u, [&](unsigned int p) {
+		const std::vector<unsigned int>& V = partition_vertices[p];
+		for (unsigned int l=0; l<V.size(); ++l) {
+			unsigned int vi = V[l];
+			consider_grow_events(vi, queues[p]);
+			// vertices adjacent to other partitions are reconsidered after growing the partitions
+			const std::vector<Idx> &Ni = ng->at(vi);
+			for (unsigned int j=0; j<Ni.size(); ++j)
+				if (vertex_partition[Ni[j]] != p) {
+					seam_vertices[p].push_back(vi);
+					break;
+				}
+		}
+	});
+
+	// grow partitions concurrently
+	parallel_for(0u, nr_partitions, 1u, [&](unsigned int p) {
+		grow_partition(queues[p], partition_T[p], seam_vertices[p]);
+	});
+
+	// collect triangles and seam vertices in partition order
+	std::vector<unsigned int> seams;
+	for (unsigned int p=0; p<nr_partitions; ++p) {
+		T.insert(T.end(), partition_T[p].begin(), partition_T[p].end());
+		seams.insert(seams.end(), seam_vertices[p].begin(), seam_vertices[p].end());
+	}
+	std::sort(seams.begin(), seams.end());
+	seams.erase(std::unique(seams.begin(), seams.end()), seams.end());
+
+	// grow from the seams with the serial algorithm
+	std::fill(first_grow_event.begin(),first_grow_event.end(),-1);
+	for (unsigned int l=0; l<seams.size(); ++l)
+		consider_grow_events(seams[l]);
+	grow_all(T);
+	return (unsigned int) ((T.size() - nr_indices)/3);
+}
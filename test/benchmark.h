@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <iostream>
+
+/** helpers shared by the benchmark applications in the test directory. Benchmarks time their variants with
+    seconds_since() and compare the results of the variants with check(), such that main() can return
+	get_exit_code() and fails if a variant computes a different result. */
+
+/// clock used to time benchmarks
+typedef std::chrono::high_resolution_clock clock_type;
+
+/// return the number of seconds passed since the given time point
+inline double seconds_since(const clock_type::time_point& start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+/// return reference to the number of failed checks
+inline unsigned& ref_nr_failed_checks()
+{
+	static unsigned nr_failed_checks = 0;
+	return nr_failed_checks;
+}
+
+/// print the description of a failed check if the condition does not hold and return the condition
+inline bool check(bool condition, const std::string& description)
+{
+	if (!condition) {
+		std::cerr << "check failed: " << description << std::endl;
+		++ref_nr_failed_checks();
+	}
+	return condition;
+}
+
+/// return the exit code of a benchmark, which is 1 if a check failed and 0 otherwise
+inline int get_exit_code()
+{
+	return ref_nr_failed_checks() == 0 ? 0 : 1;
+}
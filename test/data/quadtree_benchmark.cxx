@@ -0,0 +1,67 @@
+#include <cgv/data/quadtree.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstdlib>
+
+typedef cgv::data::quadtree<float> quadtree_type;
+typedef quadtree_type::vec2 vec2;
+typedef quadtree_type::box2 box2;
+
+struct point_array : public quadtree_type::point_provider
+{
+	std::vector<vec2> points;
+	const vec2& get_point(int i) const { return points[i]; }
+};
+
+/// compare incremental insertion with bulk loading and single with batched collision queries of n points in the unit square
+int main(int argc, char** argv)
+{
+	unsigned n = argc > 1 ? atoi(argv[1]) : 1000000;
+	unsigned nr_queries = 4 * n;
+	float d = 0.5f / std::sqrt(float(n));
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	point_array pa;
+	for (unsigned i = 0; i < n; ++i)
+		pa.points.push_back(vec2(uniform(rng), uniform(rng)));
+	std::vector<vec2> X(nr_queries);
+	for (unsigned i = 0; i < nr_queries; ++i)
+		X[i] = vec2(uniform(rng), uniform(rng));
+	box2 box(vec2(0.0f, 0.0f), vec2(1.0f, 1.0f));
+
+	clock_type::time_point start = clock_type::now();
+	quadtree_type incremental(pa, box);
+	for (unsigned i = 0; i < n; ++i)
+		incremental.insert(pa.points[i], int(i));
+	double t_insert = seconds_since(start);
+	start = clock_type::now();
+	quadtree_type bulk(pa, box);
+	bulk.build(int(n));
+	double t_build = seconds_since(start);
+	std::cout << "insert " << n / t_insert * 1e-6 << " Mpoints/s, bulk load " << n / t_build * 1e-6 << " Mpoints/s, speedup " << t_insert / t_build << std::endl;
+	check(incremental.get_nr_nodes() == bulk.get_nr_nodes(), "bulk loading generates as many nodes as incremental insertion");
+
+	std::vector<char> single(nr_queries);
+	start = clock_type::now();
+	for (unsigned i = 0; i < nr_queries; ++i)
+		single[i] = incremental.collides(X[i], d);
+	double t_single = seconds_since(start);
+	bool* batched = new bool[nr_queries];
+	start = clock_type::now();
+	bulk.collides(nr_queries, &X[0], d, batched);
+	double t_batched = seconds_since(start);
+	unsigned nr_different = 0, nr_collisions = 0;
+	for (unsigned i = 0; i < nr_queries; ++i) {
+		if ((single[i] != 0) != batched[i])
+			++nr_different;
+		if (batched[i])
+			++nr_collisions;
+	}
+	delete [] batched;
+	std::cout << "single queries " << nr_queries / t_single * 1e-6 << " Mqueries/s, batched queries " << nr_queries / t_batched * 1e-6
+		<< " Mqueries/s, speedup " << t_single / t_batched << ", " << nr_collisions << " collisions, " << nr_different << " different results" << std::endl;
+	check(nr_different == 0, "batched queries agree with single queries");
+	return get_exit_code();
+}
@@ -0,0 +1,104 @@
+#include <point_cloud/point_cloud.h>
+#include <point_cloud/ann_tree.h>
+#include <cgv/data/grid.h>
+#include <cgv/os/thread_pool.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+
+typedef point_cloud::Pnt Pnt;
+
+/// executor that runs the blocks of the grid build in the global thread pool
+struct pool_executor
+{
+	unsigned get_concurrency() const { return cgv::os::thread_pool::get_global().get_concurrency(); }
+	template <typename F>
+	void run(std::size_t nr_blocks, const F& f) const { cgv::os::parallel_for(std::size_t(0), nr_blocks, std::size_t(1), f); }
+};
+
+typedef cgv::data::grid<Pnt> grid_type;
+typedef cgv::data::grid<Pnt, int, pool_executor> pool_grid_type;
+
+/// sample n points uniformly in the unit cube with reproducible random positions
+void sample_cube(point_cloud& pc, unsigned int n)
+{
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	pc.resize(n);
+	for (unsigned int i = 0; i < n; ++i)
+		pc.pnt(i) = Pnt(uniform(rng), uniform(rng), uniform(rng));
+}
+
+/// build the grid serially and in parallel and compare radius queries with the kd-tree in row major and Morton cell order
+void benchmark(const point_cloud& pc, unsigned int k)
+{
+	int n = (int)pc.get_nr_points();
+	auto pnts = [&pc](int i) -> const Pnt& { return pc.pnt(i); };
+	// choose radius and grid dimension such that spheres and cells contain about k points
+	float r = std::cbrt(3.0f * k / (4.0f * 3.14159265f * n));
+	std::size_t dim = std::max(std::size_t(1), std::size_t(std::cbrt(float(n) / k)));
+	clock_type::time_point start = clock_type::now();
+	ann_tree tree;
+	tree.build(pc);
+	double t_tree_build = seconds_since(start);
+	std::vector<int> N;
+	size_t nr_tree_neighbors = 0;
+	unsigned int nr_queries = std::min(n, 200000);
+	start = clock_type::now();
+	for (unsigned int i = 0; i < nr_queries; ++i) {
+		tree.find_points_in_radius(pc.pnt(i), r, N);
+		nr_tree_neighbors += N.size();
+	}
+	double t_tree_query = seconds_since(start);
+	std::cout << "k=" << k << " kd-tree: build " << t_tree_build << "s, " << nr_queries / t_tree_query * 1e-6 << " Mqueries/s" << std::endl;
+
+	for (int morton = 0; morton < 2; ++morton) {
+		grid_type g;
+		g.set_cell_order(morton ? grid_type::CO_MORTON : grid_type::CO_ROW_MAJOR);
+		g.compute_box(n, pnts);
+		g.set_dim(dim);
+		g.set_max_nr_threads(1);
+		start = clock_type::now();
+		g.sort_points(n, pnts);
+		double t_serial = seconds_since(start);
+		std::vector<int> I = g.get_indices();
+		g.set_max_nr_threads(0);
+		start = clock_type::now();
+		g.sort_points(n, pnts);
+		double t_parallel = seconds_since(start);
+		pool_grid_type pool_g;
+		pool_g.set_cell_order(morton ? pool_grid_type::CO_MORTON : pool_grid_type::CO_ROW_MAJOR);
+		pool_g.compute_box(n, pnts);
+		pool_g.set_dim(dim);
+		start = clock_type::now();
+		pool_g.sort_points(n, pnts);
+		double t_pool = seconds_since(start);
+		size_t nr_grid_neighbors = 0;
+		start = clock_type::now();
+		for (unsigned int i = 0; i < nr_queries; ++i) {
+			N.clear();
+			g.find_points_in_radius(pc.pnt(i), r, pnts, N);
+			nr_grid_neighbors += N.size();
+		}
+		double t_query = seconds_since(start);
+		std::cout << "k=" << k << (morton ? " morton grid   : " : " row major grid: ") << "build serial " << t_serial
+			<< "s, parallel " << t_parallel << "s, thread pool " << t_pool << "s, " << nr_queries / t_query * 1e-6 << " Mqueries/s, speedup over kd-tree "
+			<< t_tree_query / t_query << std::endl;
+		check(I == g.get_indices(), "parallel grid build agrees with serial build");
+		check(I == pool_g.get_indices(), "grid build in the thread pool agrees with serial build");
+		check(nr_grid_neighbors == nr_tree_neighbors, "grid radius queries find the same number of neighbors as the kd-tree");
+	}
+}
+
+/// compare grid and kd-tree radius queries on uniformly distributed points with about 8 and 32 points per query
+int main(int argc, char** argv)
+{
+	unsigned int n = argc > 1 ? atoi(argv[1]) : 2000000;
+	point_cloud pc;
+	sample_cube(pc, n);
+	benchmark(pc, 8);
+	benchmark(pc, 32);
+	return get_exit_code();
+}
@@ -0,0 +1,61 @@
+#include <point_cloud/kd_tree.h>
+#define ANN_USE_FLOAT
+#include <ANN/ANN.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <random>
+#include <cstdlib>
+
+typedef kd_tree<float, 3> tree_type;
+typedef tree_type::point_type Pnt;
+typedef tree_type::Idx Idx;
+
+/// compare construction and knn query times of the native kd_tree with the ann library on random points
+int main(int argc, char** argv)
+{
+	Idx n = argc > 1 ? atoi(argv[1]) : 1000000;
+	Idx k = argc > 2 ? atoi(argv[2]) : 16;
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	std::vector<Pnt> P(n);
+	for (auto& p : P)
+		p = Pnt(uniform(rng), uniform(rng), uniform(rng));
+
+	std::cout << "n = " << n << ", k = " << k << std::endl;
+
+	// ann
+	clock_type::time_point start = clock_type::now();
+	std::vector<ANNpoint> pa(n);
+	for (Idx i = 0; i < n; ++i)
+		pa[i] = &P[i][0];
+	ANNkd_tree ann(&pa[0], n, 3);
+	std::cout << "ann     build: " << seconds_since(start) << "s" << std::endl;
+
+	std::vector<ANNidx> ann_idx(size_t(n)*k);
+	std::vector<ANNdist> ann_dist(k);
+	start = clock_type::now();
+	for (Idx i = 0; i < n; ++i)
+		ann.annkSearch(&P[i][0], k, &ann_idx[size_t(i)*k], &ann_dist[0]);
+	std::cout << "ann     query: " << seconds_since(start) << "s" << std::endl;
+
+	// native kd-tree
+	tree_type tree;
+	start = clock_type::now();
+	tree.build(&P[0], n);
+	std::cout << "kd_tree build: " << seconds_since(start) << "s" << std::endl;
+
+	std::vector<tree_type::result_type> R(size_t(n)*k);
+	start = clock_type::now();
+	for (Idx i = 0; i < n; ++i)
+		tree.find_knn(P[i], k, &R[size_t(i)*k]);
+	std::cout << "kd_tree query: " << seconds_since(start) << "s" << std::endl;
+
+	// compare results, indices may only differ for equal distances
+	size_t nr_mismatches = 0;
+	for (size_t j = 0; j < R.size(); ++j)
+		if (R[j].first != ann_idx[j] && R[j].second != sqr_length(P[ann_idx[j]] - P[j / k]))
+			++nr_mismatches;
+	std::cout << "mismatches: " << nr_mismatches << std::endl;
+	check(nr_mismatches == 0, "kd_tree finds the same nearest neighbors as ann");
+	return get_exit_code();
+}
@@ -0,0 +1,202 @@
+#include <point_cloud/point_cloud.h>
+#include <point_cloud/ann_tree.h>
+#include <point_cloud/neighbor_graph.h>
+#include <point_cloud/normal_estimator.h>
+#include <cgv/math/normal_estimation.h>
+#include <cgv/math/union_find.h>
+#include <test/benchmark.h>
+#include <test/libs/point_cloud/sample_torus.h>
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+typedef point_cloud::Pnt Pnt;
+typedef point_cloud::Nml Nml;
+
+/// variants of the normal estimation
+enum NormalEstimationVariant { NEV_WEIGHTED, NEV_BILATERAL, NEV_PLANE_BILATERAL };
+
+/// compute the weights of the bilateral normal estimation on plane distances serially from the neighbor graph
+void compute_plane_bilateral_weights(const point_cloud& pc, const neighbor_graph& ng, const normal_estimator& ne, unsigned int vi,
+	std::vector<float>& weights, std::vector<Pnt>& points)
+{
+	const std::vector<neighbor_graph::Idx>& Ni = ng.at(vi);
+	weights.resize(Ni.size() + 1);
+	points.resize(Ni.size() + 1);
+	weights[0] = 1;
+	points[0] = pc.pnt(vi);
+	float l0_sqr = ne.estimate_scale(vi)*ne.estimate_scale(vi);
+	float err0_sqr = l0_sqr*ne.noise_to_sampling_ratio*ne.noise_to_sampling_ratio;
+	for (unsigned int j = 0; j < Ni.size(); ++j) {
+		Pnt dij = pc.pnt(Ni[j]) - pc.pnt(vi);
+		float errij = dot(pc.nml(Ni[j]), dij)*dot(pc.nml(Ni[j]), dij);
+		weights[j + 1] = exp(-sqr_length(dij) / l0_sqr)*exp(-errij / err0_sqr);
+		points[j + 1] = pc.pnt(Ni[j]);
+	}
+}
+
+/// compute normals serially with the generic weighted least squares fit from the reference weights of the given variant
+void compute_reference_normals(point_cloud& pc, const neighbor_graph& ng, normal_estimator& ne, NormalEstimationVariant variant, std::vector<Nml>& N)
+{
+	std::vector<float> weights;
+	std::vector<Pnt> points;
+	N.resize(pc.get_nr_points());
+	for (unsigned int vi = 0; vi < pc.get_nr_points(); ++vi) {
+		if (variant == NEV_PLANE_BILATERAL)
+			compute_plane_bilateral_weights(pc, ng, ne, vi, weights, points);
+		else if (variant == NEV_BILATERAL)
+			ne.compute_bilateral_weights(vi, weights, &points);
+		else
+			ne.compute_weights(vi, weights, &points);
+		cgv::math::estimate_normal_wls((unsigned)points.size(), points[0], &weights[0], N[vi]);
+		if (dot(N[vi], pc.nml(vi)) < 0)
+			N[vi] = -N[vi];
+	}
+}
+
+/// return the maximum angle in degrees between the normals of the point cloud and the reference normals
+double max_angle(const point_cloud& pc, const std::vector<Nml>& N)
+{
+	double max_cos_dev = 0;
+	for (unsigned int vi = 0; vi < pc.get_nr_points(); ++vi)
+		max_cos_dev = std::max(max_cos_dev, 1.0 - std::min(1.0, (double)dot(pc.nml(vi), N[vi])));
+	return acos(1.0 - max_cos_dev) * 180 / 3.14159265358979;
+}
+
+/// compare the generic serial normal estimation with the parallel weighted, bilateral and plane bilateral normal estimation for neighborhoods of k points
+void benchmark(point_cloud& pc, unsigned int k)
+{
+	unsigned int n = (unsigned int)pc.get_nr_points();
+	ann_tree tree;
+	tree.build(pc);
+	neighbor_graph ng;
+	ng.build(n, k, tree);
+	normal_estimator ne(pc, ng);
+	ne.bw_type = BWT_GAUSS_ON_NORMALS;
+	// with the default ratio of 0.1 the noise of the torus gives almost all neighbors negligible plane distance weights,
+	// such that the fits are degenerate and the comparison with the reference depends on rounding
+	ne.noise_to_sampling_ratio = 1.0f;
+	std::vector<Nml> N0(n), N;
+	for (unsigned int vi = 0; vi < n; ++vi)
+		N0[vi] = pc.nml(vi);
+
+	const char* variant_names[3] = { " weighted       : ", " bilateral      : ", " plane bilateral: " };
+	for (int variant = NEV_WEIGHTED; variant <= NEV_PLANE_BILATERAL; ++variant) {
+		for (unsigned int vi = 0; vi < n; ++vi)
+			pc.nml(vi) = N0[vi];
+		clock_type::time_point start = clock_type::now();
+		compute_reference_normals(pc, ng, ne, NormalEstimationVariant(variant), N);
+		double t_ref = seconds_since(start);
+		start = clock_type::now();
+		if (variant == NEV_PLANE_BILATERAL)
+			ne.compute_plane_bilateral_weighted_normals(true);
+		else if (variant == NEV_BILATERAL)
+			ne.compute_bilateral_weighted_normals(true);
+		else
+			ne.compute_weighted_normals(true);
+		double t = seconds_since(start);
+		double max_deviation = max_angle(pc, N);
+		std::cout << "k=" << k << variant_names[variant] << "generic " << n / t_ref * 1e-6 << " Mpoints/s, parallel "
+			<< n / t * 1e-6 << " Mpoints/s, speedup " << t_ref / t << ", max deviation " << max_deviation << " degrees" << std::endl;
+		check(max_deviation < 0.1, "parallel normals deviate less than 0.1 degrees from generic normals");
+	}
+	for (unsigned int vi = 0; vi < n; ++vi)
+		pc.nml(vi) = N0[vi];
+}
+
+/** orient normals serially with Kruskal's algorithm on the sorted edges of the neighbor graph and a traversal of the spanning
+    tree. Equal weights are frequent close to one, so ties are broken by the index of the directed edge like in the parallel
+	 orientation, which makes the spanning forest unique. */
+void orient_reference_normals(point_cloud& pc, const neighbor_graph& ng)
+{
+	struct edge { float w; unsigned int index, vi, vj; bool flip; bool operator < (const edge& e) const { return w < e.w || (w == e.w && index < e.index); } };
+	unsigned int n = (unsigned int)pc.get_nr_points(), v0 = 0;
+	std::vector<edge> E;
+	for (unsigned int vi = 0; vi < n; ++vi) {
+		if (pc.pnt(vi)(0) < pc.pnt(v0)(0))
+			v0 = vi;
+		for (unsigned int vj : ng[vi]) {
+			Pnt d = normalize(pc.pnt(vj) - pc.pnt(vi));
+			float w = dot(pc.nml(vi) - 2*dot(pc.nml(vi), d)*d, pc.nml(vj));
+			edge e = { fabs(w), (unsigned int)E.size(), vi, vj, w < 0 };
+			E.push_back(e);
+		}
+	}
+	std::sort(E.begin(), E.end());
+	cgv::math::union_find uf(n);
+	std::vector<std::vector<std::pair<unsigned int, bool> > > T(n);
+	while (!E.empty()) {
+		const edge& e = E.back();
+		if (uf.find(e.vi) != uf.find(e.vj)) {
+			uf.unite(e.vi, e.vj);
+			T[e.vi].push_back(std::make_pair(e.vj, e.flip));
+			T[e.vj].push_back(std::make_pair(e.vi, e.flip));
+		}
+		E.pop_back();
+	}
+	std::vector<std::pair<unsigned int, bool> > Q(1, std::make_pair(v0, pc.nml(v0)(0) > 0));
+	std::vector<bool> visited(n, false);
+	visited[v0] = true;
+	while (!Q.empty()) {
+		std::pair<unsigned int, bool> q = Q.back();
+		Q.pop_back();
+		if (q.second)
+			pc.nml(q.first) = -pc.nml(q.first);
+		for (auto& t : T[q.first])
+			if (!visited[t.first]) {
+				visited[t.first] = true;
+				Q.push_back(std::make_pair(t.first, q.second != t.second));
+			}
+	}
+}
+
+/// compare the orientation of randomly flipped normals with the serial reference and the parallel normal estimator
+void benchmark_orientation(point_cloud& pc, unsigned int k)
+{
+	unsigned int n = (unsigned int)pc.get_nr_points();
+	ann_tree tree;
+	tree.build(pc);
+	neighbor_graph ng;
+	ng.build(n, k, tree);
+	normal_estimator ne(pc, ng);
+	std::mt19937 rng(7);
+	std::vector<Nml> N0(n);
+	for (unsigned int vi = 0; vi < n; ++vi)
+		N0[vi] = (rng() & 1) ? -pc.nml(vi) : pc.nml(vi);
+
+	for (unsigned int vi = 0; vi < n; ++vi)
+		pc.nml(vi) = N0[vi];
+	clock_type::time_point start = clock_type::now();
+	orient_reference_normals(pc, ng);
+	double t_ref = seconds_since(start);
+	std::vector<Nml> N(n);
+	for (unsigned int vi = 0; vi < n; ++vi) {
+		N[vi] = pc.nml(vi);
+		pc.nml(vi) = N0[vi];
+	}
+	start = clock_type::now();
+	ne.orient_normals();
+	double t = seconds_since(start);
+	unsigned int nr_different = 0;
+	for (unsigned int vi = 0; vi < n; ++vi)
+		if (dot(pc.nml(vi), N[vi]) < 0)
+			++nr_different;
+	std::cout << "k=" << k << " orientation: kruskal " << t_ref << "s, boruvka " << t << "s, speedup " << t_ref / t 
+		<< ", " << nr_different << " different orientations" << std::endl;
+	check(nr_different == 0, "parallel orientation agrees with kruskal orientation");
+}
+
+/// compare the generic and the parallel normal estimation and orientation on a noisy sampled torus with 16 and 32 neighbors
+int main(int argc, char** argv)
+{
+	unsigned int n = argc > 1 ? atoi(argv[1]) : 500000;
+	point_cloud pc;
+	sample_torus(pc, n, 1.0f, 0.4f, 0.002f);
+	benchmark(pc, 16);
+	benchmark(pc, 32);
+	benchmark_orientation(pc, 16);
+	benchmark_orientation(pc, 32);
+	return get_exit_code();
+}
@@ -0,0 +1,85 @@
+#include <point_cloud/point_cloud.h>
+#include <point_cloud/octree_point_cloud.h>
+#include <cgv/utils/file.h>
+#include <test/benchmark.h>
+#include <test/libs/point_cloud/sample_torus.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+
+typedef point_cloud::Pnt Pnt;
+typedef point_cloud::Nml Nml;
+typedef point_cloud::Clr Clr;
+
+/// stream the octree along a camera path and report selection and cache statistics
+void stream(octree_point_cloud& opc, size_t memory_budget)
+{
+	opc.set_memory_budget(memory_budget);
+	const point_cloud::Box& B = opc.get_header().box;
+	Pnt center = B.get_center();
+	float extent = B.get_extent().length();
+	// projection factor of a 1080 pixel high viewport with 45 degree field of view
+	float projection_factor = 540.0f / tan(3.14159265f / 8);
+	for (int k = 0; k <= 4; ++k) {
+		Pnt eye = center + Pnt(0.0f, 0.0f, extent*(2.0f - 0.45f*k));
+		clock_type::time_point start = clock_type::now();
+		unsigned int nr_updates = 0;
+		double update_time = 0;
+		do {
+			clock_type::time_point update_start = clock_type::now();
+			opc.update(eye, projection_factor);
+			update_time += seconds_since(update_start);
+			++nr_updates;
+		} while (opc.has_pending_loads());
+		double t = seconds_since(start);
+		point_cloud pc;
+		opc.extract_rendered_points(pc);
+		std::cout << "distance " << (eye - center).length() << ": " << opc.get_rendered_nodes().size() << " nodes, "
+			<< pc.get_nr_points() << " points after " << nr_updates << " updates in " << t << "s (" << 1000 * update_time / nr_updates
+			<< "ms per update), cache " << opc.get_nr_cached_chunks() << " chunks " << opc.get_cache_memory() / 1024 << "KB" << std::endl;
+		check(opc.get_cache_memory() <= memory_budget, "cache memory stays within the memory budget");
+		check(pc.get_nr_points() <= opc.get_header().nr_points, "rendered nodes contain at most all points");
+	}
+}
+
+/// convert a point cloud file or a sampled torus into an octree file and stream it under different memory budgets
+int main(int argc, char** argv)
+{
+	std::string input_file_name = argc > 1 ? argv[1] : "";
+	std::string output_file_name = argc > 2 ? argv[2] : "octree_point_cloud_benchmark.opc";
+	unsigned int n = argc > 3 ? atoi(argv[3]) : 2000000;
+	clock_type::time_point start = clock_type::now();
+	if (input_file_name.empty()) {
+		point_cloud pc;
+		sample_torus(pc, n, 10.0f, 4.0f, 0.0f, true);
+		start = clock_type::now();
+		if (!octree_point_cloud::build(pc, output_file_name)) {
+			std::cerr << "could not write " << output_file_name << std::endl;
+			return 1;
+		}
+	}
+	else if (!octree_point_cloud::convert(input_file_name, output_file_name)) {
+		std::cerr << "could not convert " << input_file_name << " to " << output_file_name << std::endl;
+		return 1;
+	}
+	double t = seconds_since(start);
+	octree_point_cloud opc;
+	if (!opc.open(output_file_name)) {
+		std::cerr << "could not open " << output_file_name << std::endl;
+		return 1;
+	}
+	const octree_point_cloud::octree_file_header& h = opc.get_header();
+	size_t raw_size = size_t(h.nr_points)*(sizeof(Pnt) + (opc.has_normals() ? sizeof(Nml) : 0) + (opc.has_colors() ? sizeof(Clr) : 0));
+	std::cout << h.nr_points << " points in " << opc.get_nr_nodes() << " nodes built in " << t << "s, "
+		<< cgv::utils::file::size(output_file_name) / 1024 << "KB file for " << raw_size / 1024 << "KB of points" << std::endl;
+	cgv::type::uint64_type nr_node_points = 0;
+	for (octree_point_cloud::Cnt ni = 0; ni < opc.get_nr_nodes(); ++ni)
+		nr_node_points += opc.get_node(ni).nr_points;
+	check(nr_node_points == h.nr_points, "chunks of all nodes contain all points");
+	if (input_file_name.empty())
+		check(h.nr_points == n, "octree contains all sampled points");
+	stream(opc, size_t(256) * 1024 * 1024);
+	stream(opc, size_t(4) * 1024 * 1024);
+	return get_exit_code();
+}
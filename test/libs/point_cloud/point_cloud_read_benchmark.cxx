@@ -0,0 +1,199 @@
+#include <point_cloud/point_cloud.h>
+#include <cgv/utils/file.h>
+#include <cgv/utils/scan.h>
+#include <cgv/utils/advanced_scan.h>
+#include <cgv/utils/tokenizer.h>
+#include <test/benchmark.h>
+#include <test/libs/point_cloud/sample_torus.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace cgv::utils;
+
+typedef point_cloud::Pnt Pnt;
+typedef point_cloud::Nml Nml;
+typedef point_cloud::Clr Clr;
+
+/// point cloud that provides the previous single threaded sscanf and tokenizer based readers as reference
+class reference_point_cloud : public point_cloud
+{
+public:
+	using point_cloud::read_xyz;
+	using point_cloud::read_points;
+	using point_cloud::read_ascii;
+	bool read_xyz_with_sscanf(const std::string& file_name)
+	{
+		std::string content;
+		if (!file::read(file_name, content, true))
+			return false;
+		clear();
+		std::vector<line> lines;
+		split_to_lines(content, lines);
+		for (unsigned i = 0; i < lines.size(); ++i) {
+			if (lines[i].empty())
+				continue;
+			Pnt p;
+			int c[3], I;
+			char tmp = lines[i].end[0];
+			content[lines[i].end - content.c_str()] = 0;
+			sscanf(lines[i].begin, "%f %f %f %d %d %d %d", &p[0], &p[1], &p[2], c, c + 1, c + 2, &I);
+			content[lines[i].end - content.c_str()] = tmp;
+			P.push_back(p);
+			C.push_back(Clr(byte_to_color_component(c[0]), byte_to_color_component(c[1]), byte_to_color_component(c[2])));
+		}
+		return true;
+	}
+	bool read_points_with_tokenizer(const std::string& file_name)
+	{
+		std::string content;
+		if (!file::read(file_name, content, true))
+			return false;
+		clear();
+		std::vector<line> lines;
+		split_to_lines(content, lines);
+		bool do_parse = false;
+		for (unsigned i = 0; i < lines.size(); ++i) {
+			if (do_parse) {
+				if (lines[i].empty())
+					continue;
+				std::vector<token> numbers;
+				tokenizer(lines[i]).bite_all(numbers);
+				double values[9];
+				unsigned n = std::min(9, (int)numbers.size());
+				unsigned j;
+				for (j = 0; j < n; ++j) {
+					if (!is_double(numbers[j].begin, numbers[j].end, values[j]))
+						break;
+				}
+				if (j >= 3)
+					P.push_back(Pnt((Crd)values[0], (Crd)values[1], (Crd)values[2]));
+				if (j >= 6)
+					N.push_back(Nml((Crd)values[3], (Crd)values[4], (Crd)values[5]));
+				if (j >= 9)
+					C.push_back(Clr(float_to_color_component(values[6]), float_to_color_component(values[7]), float_to_color_component(values[8])));
+			}
+			if (lines[i] == "#Data:")
+				do_parse = true;
+		}
+		return true;
+	}
+	bool read_ascii_with_getline(const std::string& file_name)
+	{
+		std::ifstream is(file_name.c_str());
+		if (is.fail())
+			return false;
+		clear();
+		while (!is.eof()) {
+			char buffer[4096];
+			is.getline(buffer, 4096);
+			float x, y, z, nx, ny, nz, r, g, b;
+			unsigned int n = sscanf(buffer, "%f %f %f %f %f %f %f %f %f", &x, &y, &z, &nx, &ny, &nz, &r, &g, &b);
+			if (n == 3 || n == 6 || n == 9)
+				P.push_back(Pnt(x, y, z));
+			if (n == 6)
+				N.push_back(Nml(nx, ny, nz));
+			if (n == 9)
+				C.push_back(Clr(float_to_color_component(r), float_to_color_component(g), float_to_color_component(b)));
+		}
+		return true;
+	}
+};
+
+/// write the points of the point cloud in one of the ascii formats: 0 .. xyz with byte colors and intensity, 1 .. points with normals and float colors after a header, 2 .. ascii with normals
+void write_ascii_file(const std::string& file_name, const point_cloud& pc, int format)
+{
+	FILE* fp = fopen(file_name.c_str(), "w");
+	if (format == 1)
+		fprintf(fp, "#Format: x y z nx ny nz r g b\n#Data:\n");
+	for (unsigned i = 0; i < pc.get_nr_points(); ++i) {
+		const Pnt& p = pc.pnt(i);
+		const Nml& n = pc.nml(i);
+		const Clr& c = pc.clr(i);
+		if (format == 0)
+			fprintf(fp, "%.6f %.6f %.6f %d %d %d %d\n", p[0], p[1], p[2], int(point_cloud::color_component_to_byte(c[0])),
+				int(point_cloud::color_component_to_byte(c[1])), int(point_cloud::color_component_to_byte(c[2])), int(i % 4096));
+		else if (format == 1)
+			fprintf(fp, "%.6f %.6f %.6f %.6f %.6f %.6f %.4f %.4f %.4f\n", p[0], p[1], p[2], n[0], n[1], n[2],
+				point_cloud::color_component_to_float(c[0]), point_cloud::color_component_to_float(c[1]), point_cloud::color_component_to_float(c[2]));
+		else
+			fprintf(fp, "%.6f %.6f %.6f %.6f %.6f %.6f\n", p[0], p[1], p[2], n[0], n[1], n[2]);
+	}
+	fclose(fp);
+}
+
+/** return whether both point clouds contain the same points, normals and colors. Coordinates are compared exactly on
+    purpose: from_chars as well as sscanf and is_double round the decimal text correctly to the nearest float, such
+	that any difference indicates a parsing error of the parallel readers. */
+bool equal_point_clouds(const point_cloud& pc0, const point_cloud& pc1)
+{
+	if (pc0.get_nr_points() != pc1.get_nr_points() || pc0.has_normals() != pc1.has_normals() || pc0.has_colors() != pc1.has_colors())
+		return false;
+	for (unsigned i = 0; i < pc0.get_nr_points(); ++i) {
+		if (pc0.pnt(i) != pc1.pnt(i))
+			return false;
+		if (pc0.has_normals() && pc0.nml(i) != pc1.nml(i))
+			return false;
+		if (pc0.has_colors() && !(pc0.clr(i) == pc1.clr(i)))
+			return false;
+	}
+	return true;
+}
+
+/// time reading a file with the reference reader and the parallel reader and check that both read the same point cloud
+template <typename R, typename F>
+void benchmark(const char* name, const std::string& file_name, unsigned n, R read_reference, F read)
+{
+	reference_point_cloud pc0, pc1;
+	clock_type::time_point start = clock_type::now();
+	bool success = read_reference(pc0);
+	double t_reference = seconds_since(start);
+	start = clock_type::now();
+	success = read(pc1) && success;
+	double t = seconds_since(start);
+	double nr_mega_bytes = cgv::utils::file::size(file_name) * 1e-6;
+	std::cout << name << ": reference " << nr_mega_bytes / t_reference << " MB/s, parallel " << nr_mega_bytes / t
+		<< " MB/s, speedup " << t_reference / t << std::endl;
+	check(success, std::string("read ") + file_name);
+	check(pc1.get_nr_points() == n, std::string(name) + " reads all points");
+	check(equal_point_clouds(pc0, pc1), std::string(name) + " reads the same points as the reference reader");
+}
+
+/// compare the parallel ascii readers with the previous single threaded readers on files generated from a sampled torus
+int main(int argc, char** argv)
+{
+	unsigned n = argc > 1 ? atoi(argv[1]) : 2000000;
+	point_cloud pc;
+	sample_torus(pc, n, 10.0f, 4.0f, 0.0f, true);
+	const char* file_names[] = { "point_cloud_read_benchmark.xyz", "point_cloud_read_benchmark.points", "point_cloud_read_benchmark.txt" };
+	for (int format = 0; format < 3; ++format)
+		write_ascii_file(file_names[format], pc, format);
+	std::cout << n << " points" << std::endl;
+
+	benchmark("read_xyz   ", file_names[0], n,
+		[&](reference_point_cloud& pc) { return pc.read_xyz_with_sscanf(file_names[0]); },
+		[&](reference_point_cloud& pc) { return pc.read_xyz(file_names[0]); });
+	benchmark("read_points", file_names[1], n,
+		[&](reference_point_cloud& pc) { return pc.read_points_with_tokenizer(file_names[1]); },
+		[&](reference_point_cloud& pc) { return pc.read_points(file_names[1]); });
+	benchmark("read_ascii ", file_names[2], n,
+		[&](reference_point_cloud& pc) { return pc.read_ascii_with_getline(file_names[2]); },
+		[&](reference_point_cloud& pc) { return pc.read_ascii(file_names[2]); });
+
+	for (int format = 0; format < 3; ++format)
+		std::remove(file_names[format]);
+
+	// color values outside of the byte range saturate
+	FILE* fp = fopen(file_names[0], "w");
+	fprintf(fp, "1 2 3 300 -5 128\n");
+	fclose(fp);
+	reference_point_cloud out_of_range_pc;
+	check(out_of_range_pc.read_xyz(file_names[0]) && out_of_range_pc.get_nr_points() == 1 &&
+		out_of_range_pc.clr(0) == Clr(point_cloud::byte_to_color_component(255), point_cloud::byte_to_color_component(0), point_cloud::byte_to_color_component(128)),
+		"read_xyz clamps out of range colors");
+	std::remove(file_names[0]);
+	return get_exit_code();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <point_cloud/point_cloud.h>
+#include <random>
+#include <cmath>
+
+/** sample n points with normals from a torus with radii R and r around the z-axis with reproducible random positions.
+    With noise > 0 the points are displaced along the normal by gaussian noise of the given standard deviation and
+	with colors the two angles of the torus parametrization are stored in the red and green channels. */
+inline void sample_torus(point_cloud& pc, unsigned int n, float R = 1.0f, float r = 0.4f, float noise = 0.0f, bool with_colors = false)
+{
+	typedef point_cloud::Pnt Pnt;
+	typedef point_cloud::Nml Nml;
+	typedef point_cloud::Clr Clr;
+	const float pi = 3.14159265f;
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> uniform(0.0f, 2*pi);
+	std::normal_distribution<float> gauss(0.0f, noise > 0 ? noise : 1.0f);
+	pc.resize(n);
+	pc.create_normals();
+	if (with_colors)
+		pc.create_colors();
+	for (unsigned int i = 0; i < n; ++i) {
+		float u = uniform(rng), v = uniform(rng);
+		Nml nml(cos(u)*cos(v), sin(u)*cos(v), sin(v));
+		pc.pnt(i) = Pnt(R*cos(u), R*sin(u), 0.0f) + (noise > 0 ? r + gauss(rng) : r)*nml;
+		pc.nml(i) = nml;
+		if (with_colors)
+			pc.clr(i) = Clr(point_cloud::float_to_color_component(u / (2*pi)), point_cloud::float_to_color_component(v / (2*pi)), 0);
+	}
+}
@@ -0,0 +1,93 @@
+#include <point_cloud/point_cloud.h>
+#include <point_cloud/ann_tree.h>
+#include <point_cloud/neighbor_graph.h>
+#include <point_cloud/surface_reconstructor.h>
+#include <test/benchmark.h>
+#include <test/libs/point_cloud/sample_torus.h>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+typedef point_cloud::Pnt Pnt;
+typedef point_cloud::Nml Nml;
+
+/// count undirected edges with one, two and more than two incident triangles and the number of duplicate triangles
+void analyze_mesh(const std::vector<unsigned int>& T, size_t counts[4])
+{
+	std::vector<unsigned long long> E, F;
+	for (size_t i = 0; i < T.size(); i += 3) {
+		unsigned int t[3] = { T[i], T[i + 1], T[i + 2] };
+		for (int e = 0; e < 3; ++e) {
+			unsigned long long a = std::min(t[e], t[(e + 1) % 3]), b = std::max(t[e], t[(e + 1) % 3]);
+			E.push_back((a << 32) | b);
+		}
+		std::sort(t, t + 3);
+		F.push_back(((unsigned long long)t[0] << 42) ^ ((unsigned long long)t[1] << 21) ^ t[2]);
+	}
+	std::sort(E.begin(), E.end());
+	std::sort(F.begin(), F.end());
+	counts[0] = counts[1] = counts[2] = 0;
+	for (size_t i = 0; i < E.size();) {
+		size_t j = i;
+		while (j < E.size() && E[j] == E[i])
+			++j;
+		++counts[std::min(j - i, size_t(3)) - 1];
+		i = j;
+	}
+	counts[3] = F.size() - (std::unique(F.begin(), F.end()) - F.begin());
+}
+
+/// run one reconstruction on a fresh copy of the filtered neighbor graph and return the edge and triangle counts of analyze_mesh
+void reconstruct(const char* name, surface_reconstructor& sr, const neighbor_graph& ng, 
+	const std::vector<std::vector<unsigned char> >& edge_info, const std::vector<unsigned int>& seeds, unsigned int nr_partitions, size_t counts[4])
+{
+	*sr.ng = ng;
+	sr.directed_edge_info = edge_info;
+	std::vector<unsigned int> T = seeds;
+	sr.mark_triangular_faces(T);
+	clock_type::time_point start = clock_type::now();
+	if (nr_partitions == 1) {
+		sr.build_grow_queue(T);
+		sr.grow_all(T);
+	}
+	else
+		sr.grow_all_parallel(T, nr_partitions);
+	double t = seconds_since(start);
+	size_t nr_new = (T.size() - seeds.size()) / 3;
+	analyze_mesh(T, counts);
+	std::cout << name << ": " << t << "s, " << nr_new / t * 1e-3 << " ktriangles/s, " << T.size() / 3 << " triangles, "
+		<< counts[0] << " border edges, " << counts[2] << " non manifold edges, " << counts[3] << " duplicate triangles" << std::endl;
+}
+
+/// compare serial and partitioned parallel region growing on a sampled torus
+int main(int argc, char** argv)
+{
+	unsigned int n = argc > 1 ? atoi(argv[1]) : 200000;
+	unsigned int nr_partitions = argc > 2 ? atoi(argv[2]) : 0;
+	point_cloud pc;
+	sample_torus(pc, n);
+
+	ann_tree tree;
+	tree.build(pc);
+	neighbor_graph ng;
+	ng.build(n, 12, tree);
+
+	surface_reconstructor sr;
+	sr.pc = &pc;
+	sr.ng = &ng;
+	sr.sort_by_tangential_angle();
+	sr.delaunay_fan_neighbor_graph_filter();
+	std::vector<unsigned int> T[3];
+	sr.find_consistent_triangles(T);
+	std::cout << n << " points, " << T[0].size() / 3 << " seed triangles" << std::endl;
+
+	neighbor_graph filtered_ng = ng;
+	std::vector<std::vector<unsigned char> > edge_info = sr.directed_edge_info;
+	size_t serial_counts[4], parallel_counts[4];
+	reconstruct("serial  ", sr, filtered_ng, edge_info, T[0], 1, serial_counts);
+	reconstruct("parallel", sr, filtered_ng, edge_info, T[0], nr_partitions, parallel_counts);
+	check(serial_counts[3] == 0, "serial region growing generates no duplicate triangles");
+	check(parallel_counts[3] == 0, "parallel region growing generates no duplicate triangles");
+	check(parallel_counts[2] <= serial_counts[2], "parallel region growing generates no additional non manifold edges");
+	return get_exit_code();
+}
@@ -0,0 +1,476 @@
+#include <cgv/base/register.h>
+#include <cgv/utils/file.h>
+#include <point_cloud/point_cloud.h>
+#include <point_cloud/ann_tree.h>
+#include <point_cloud/neighbor_graph.h>
+#include <point_cloud/compact_neighbor_graph.h>
+#include <point_cloud/depth_sorter.h>
+#include <point_cloud/octree_point_cloud.h>
+#include <point_cloud/sort_keys.h>
+#include <test/libs/point_cloud/sample_torus.h>
+#include <vector>
+#include <string>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+
+using namespace cgv::base;
+
+typedef graph_location::Idx Idx;
+
+/// check that the neighbor lists of the compact and the vector based neighbor graph coincide
+bool equal_neighbor_graphs(const compact_neighbor_graph& cng, const neighbor_graph& ng)
+{
+	if (cng.size() != ng.size())
+		return false;
+	size_t nr_half_edges = 0;
+	for (Idx vi = 0; vi < (Idx)ng.size(); ++vi) {
+		neighbor_range Ni = cng.neighbors(vi);
+		if (Ni.size() != ng[vi].size() || !std::equal(Ni.begin(), Ni.end(), ng[vi].begin()))
+			return false;
+		nr_half_edges += Ni.size();
+	}
+	return cng.get_nr_half_edges() == nr_half_edges;
+}
+
+/// check construction, symmetrization and navigation of the compact neighbor graph against neighbor_graph
+bool test_compact_neighbor_graph()
+{
+	unsigned int sizes[3] = { 5, 997, 5000 };
+	unsigned int ks[3] = { 3, 12, 30 };
+	for (int s = 0; s < 3; ++s) {
+		point_cloud pc;
+		sample_torus(pc, sizes[s], 1.0f, 0.4f, 0.02f);
+		ann_tree tree;
+		tree.build(pc);
+		for (int j = 0; j < 3; ++j) {
+			neighbor_graph ng;
+			compact_neighbor_graph cng;
+			ng.build(sizes[s], ks[j], tree);
+			cng.build(sizes[s], ks[j], tree);
+			TEST_ASSERT(equal_neighbor_graphs(cng, ng));
+
+			// before symmetrization some reverse edges are missing, which follow_edge reports with an invalid neighbor index
+			bool found_missing_edge = false;
+			for (Idx vi = 0; vi < (Idx)ng.size(); ++vi) {
+				for (Idx ni = 0; ni < (Idx)ng[vi].size(); ++ni) {
+					graph_location gl = cng.follow_edge(graph_location(vi, ni));
+					TEST_ASSERT(gl.vi == ng[vi][ni]);
+					TEST_ASSERT(gl.ni == ng.find(ng[vi][ni], vi));
+					if (gl.ni == -1) {
+						found_missing_edge = true;
+						TEST_ASSERT(cng.follow_wedge(gl).ni == -1);
+					}
+				}
+			}
+			if (sizes[s] > 100) {
+				TEST_ASSERT(found_missing_edge);
+			}
+			cng.compute_reverse_index();
+			TEST_ASSERT(cng.has_reverse_index());
+			for (Idx vi = 0; vi < (Idx)ng.size(); ++vi)
+				for (Idx ni = 0; ni < (Idx)ng[vi].size(); ++ni)
+					TEST_ASSERT(cng.follow_edge(graph_location(vi, ni)).ni == ng.find(ng[vi][ni], vi));
+
+			// symmetrization appends the reverse edges in the same order in both representations
+			ng.symmetrize();
+			cng.symmetrize();
+			TEST_ASSERT(!cng.has_reverse_index() || cng.empty());
+			TEST_ASSERT(equal_neighbor_graphs(cng, ng));
+			// neighbor_graph::build counts k half-edges per vertex also if there are less than k neighbors
+			if (sizes[s] > ks[j])
+				TEST_ASSERT(cng.get_nr_half_edges() == ng.nr_half_edges);
+
+			// after symmetrization each half-edge has a reverse half-edge and the reverse index matches find
+			cng.compute_reverse_index();
+			for (Idx vi = 0; vi < (Idx)ng.size(); ++vi) {
+				for (Idx ni = 0; ni < (Idx)ng[vi].size(); ++ni) {
+					graph_location gl(vi, ni);
+					graph_location gl_rev = cng.follow_edge(gl);
+					TEST_ASSERT(gl_rev == ng.follow_edge(gl));
+					TEST_ASSERT(gl_rev.ni != -1);
+					TEST_ASSERT(cng.follow_edge(gl_rev) == gl);
+				}
+			}
+
+			// compress and expand reproduce the graph
+			compact_neighbor_graph cng_compressed;
+			cng_compressed.compress(ng);
+			TEST_ASSERT(equal_neighbor_graphs(cng_compressed, ng));
+			neighbor_graph ng_expanded;
+			cng.expand(ng_expanded);
+			TEST_ASSERT(ng_expanded == ng);
+			TEST_ASSERT(ng_expanded.nr_half_edges == cng.get_nr_half_edges());
+		}
+	}
+	return true;
+}
+
+/// point cloud that gives access to the ply reader and writer
+class ply_point_cloud : public point_cloud
+{
+public:
+	using point_cloud::read_ply;
+	using point_cloud::read_ply_binary;
+	using point_cloud::write_ply;
+};
+
+/// return the ply name of a scalar type
+const char* get_ply_type_name(cgv::type::uint8_type) { return "uchar"; }
+const char* get_ply_type_name(float) { return "float"; }
+const char* get_ply_type_name(double) { return "double"; }
+
+/// append the binary representation of a value to a byte buffer
+template <typename T>
+void append_scalar(std::string& data, T v)
+{
+	data.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+/// return a color component stored in a ply file of type T, where float types store values in [0,1]
+template <typename T>
+T encode_color_component(point_cloud::ClrComp c) { return T(point_cloud::color_component_to_float(c)); }
+template <>
+cgv::type::uint8_type encode_color_component<cgv::type::uint8_type>(point_cloud::ClrComp c) { return point_cloud::color_component_to_byte(c); }
+
+/// return the color component the ply reader decodes from a value of type T
+point_cloud::ClrComp decode_color_component(cgv::type::uint8_type v) { return point_cloud::byte_to_color_component(v); }
+point_cloud::ClrComp decode_color_component(float v) { return point_cloud::float_to_color_component(v); }
+point_cloud::ClrComp decode_color_component(double v) { return point_cloud::float_to_color_component(v); }
+
+/** write pc as binary little endian ply file with positions of type C, normals of type N if with_normals is set and
+    colors of type K either as rgb or as intensity. An unused uchar property after the positions makes all following
+	properties unaligned and a preceding empty element has to be skipped by the reader. Return the expected
+	point cloud after reading the file back. */
+template <typename C, typename N, typename K>
+point_cloud write_typed_ply(const std::string& file_name, const point_cloud& pc, bool with_normals, bool with_colors, bool as_intensity)
+{
+	std::string data = "ply\nformat binary_little_endian 1.0\ncomment written by test_point_cloud\nelement camera 0\nproperty float focal\n";
+	data += "element vertex " + std::to_string(pc.get_nr_points()) + "\n";
+	for (const char* name : { "x", "y", "z" })
+		data += std::string("property ") + get_ply_type_name(C()) + " " + name + "\n";
+	data += "property uchar flags\n";
+	if (with_normals)
+		for (const char* name : { "nx", "ny", "nz" })
+			data += std::string("property ") + get_ply_type_name(N()) + " " + name + "\n";
+	if (with_colors) {
+		if (as_intensity)
+			data += std::string("property ") + get_ply_type_name(K()) + " intensity\n";
+		else
+			for (const char* name : { "red", "green", "blue" })
+				data += std::string("property ") + get_ply_type_name(K()) + " " + name + "\n";
+	}
+	data += "element face 0\nproperty list uchar int vertex_indices\nend_header\n";
+	point_cloud expected;
+	expected.resize(unsigned(pc.get_nr_points()));
+	if (with_normals)
+		expected.create_normals();
+	if (with_colors)
+		expected.create_colors();
+	for (unsigned i = 0; i < pc.get_nr_points(); ++i) {
+		for (int c = 0; c < 3; ++c) {
+			append_scalar(data, C(pc.pnt(i)[c]));
+			expected.pnt(i)[c] = float(C(pc.pnt(i)[c]));
+		}
+		append_scalar(data, cgv::type::uint8_type(i));
+		if (with_normals)
+			for (int c = 0; c < 3; ++c) {
+				append_scalar(data, N(pc.nml(i)[c]));
+				expected.nml(i)[c] = float(N(pc.nml(i)[c]));
+			}
+		if (with_colors) {
+			for (int c = 0; c < (as_intensity ? 1 : 3); ++c) {
+				K v = encode_color_component<K>(pc.clr(i)[c]);
+				append_scalar(data, v);
+				expected.clr(i)[c] = decode_color_component(v);
+			}
+			if (as_intensity)
+				expected.clr(i)[2] = expected.clr(i)[1] = expected.clr(i)[0];
+		}
+	}
+	cgv::utils::file::write(file_name, data.data(), data.size());
+	return expected;
+}
+
+/// return whether both point clouds contain exactly the same points, normals and colors
+bool equal_point_clouds(const point_cloud& pc0, const point_cloud& pc1)
+{
+	if (pc0.get_nr_points() != pc1.get_nr_points() || pc0.has_normals() != pc1.has_normals() || pc0.has_colors() != pc1.has_colors())
+		return false;
+	for (unsigned i = 0; i < pc0.get_nr_points(); ++i) {
+		if (pc0.pnt(i) != pc1.pnt(i))
+			return false;
+		if (pc0.has_normals() && pc0.nml(i) != pc1.nml(i))
+			return false;
+		if (pc0.has_colors() && !(pc0.clr(i) == pc1.clr(i)))
+			return false;
+	}
+	return true;
+}
+
+/// check the binary ply reader and writer with and without memory mapping on files with several blocks of vertices
+bool test_ply_round_trip()
+{
+	const std::string file_name = "test_point_cloud.ply";
+	// more vertices than one read block of the unmapped reader
+	ply_point_cloud pc;
+	sample_torus(pc, 300000, 1.0f, 0.4f, 0.01f, true);
+	ply_point_cloud positions_only;
+	positions_only.resize(unsigned(pc.get_nr_points()));
+	for (unsigned i = 0; i < pc.get_nr_points(); ++i)
+		positions_only.pnt(i) = pc.pnt(i);
+	for (int mmap = 0; mmap < 2; ++mmap) {
+		// write_ply followed by read_ply reproduces the point cloud
+		ply_point_cloud pc_read;
+		pc_read.set_memory_mapping(mmap != 0);
+		TEST_ASSERT(pc.write_ply(file_name));
+		TEST_ASSERT(pc_read.read_ply(file_name));
+		TEST_ASSERT(equal_point_clouds(pc, pc_read));
+		TEST_ASSERT(!pc_read.is_memory_mapped());
+
+		// tightly packed float positions are referenced in place if memory mapping is enabled
+		ply_point_cloud positions_read;
+		positions_read.set_memory_mapping(mmap != 0);
+		TEST_ASSERT(positions_only.write_ply(file_name));
+		TEST_ASSERT(positions_read.read_ply(file_name));
+		TEST_ASSERT(equal_point_clouds(positions_only, positions_read));
+		TEST_ASSERT(positions_read.is_memory_mapped() == (mmap != 0));
+		positions_read.clear();
+
+		// unaligned properties of different scalar types with rgb or intensity colors
+		typedef cgv::type::uint8_type uchar;
+		for (int as_intensity = 0; as_intensity < 2; ++as_intensity) {
+			point_cloud expected[4] = {
+				write_typed_ply<float, float, uchar>(file_name + "0", pc, true, true, as_intensity != 0),
+				write_typed_ply<double, double, float>(file_name + "1", pc, true, true, as_intensity != 0),
+				write_typed_ply<double, float, double>(file_name + "2", pc, false, true, as_intensity != 0),
+				write_typed_ply<float, double, uchar>(file_name + "3", pc, true, false, as_intensity != 0)
+			};
+			for (int t = 0; t < 4; ++t) {
+				ply_point_cloud typed_read;
+				typed_read.set_memory_mapping(mmap != 0);
+				std::string typed_file_name = file_name + std::to_string(t);
+				TEST_ASSERT(typed_read.read_ply_binary(typed_file_name));
+				TEST_ASSERT(equal_point_clouds(expected[t], typed_read));
+				typed_read.clear();
+				std::remove(typed_file_name.c_str());
+			}
+		}
+
+		// truncated vertex data and a truncated header are rejected
+		std::string content;
+		TEST_ASSERT(pc.write_ply(file_name));
+		TEST_ASSERT(cgv::utils::file::read(file_name, content, false));
+		size_t header_size = content.find("end_header");
+		size_t sizes[2] = { content.size() - 7, header_size };
+		for (int s = 0; s < 2; ++s) {
+			TEST_ASSERT(cgv::utils::file::write(file_name, content.data(), sizes[s]));
+			ply_point_cloud truncated_read;
+			truncated_read.set_memory_mapping(mmap != 0);
+			TEST_ASSERT(!truncated_read.read_ply_binary(file_name));
+		}
+	}
+	std::remove(file_name.c_str());
+	return true;
+}
+
+/// return the depth sort key of a point, which increases from back to front
+cgv::type::uint32_type get_depth_key(const depth_sorter::Pnt& p, const depth_sorter::Pnt& view_dir)
+{
+	return float_to_key(-dot(p, view_dir));
+}
+
+/// return whether order is a permutation of indices with increasing depth keys
+bool is_depth_sorted(const std::vector<depth_sorter::Idx>& order, const std::vector<depth_sorter::Idx>& indices,
+	const std::vector<depth_sorter::Pnt>& points, const depth_sorter::Pnt& view_dir)
+{
+	std::vector<depth_sorter::Idx> sorted_order(order), sorted_indices(indices);
+	std::sort(sorted_order.begin(), sorted_order.end());
+	std::sort(sorted_indices.begin(), sorted_indices.end());
+	if (sorted_order != sorted_indices)
+		return false;
+	for (size_t i = 1; i < order.size(); ++i)
+		if (get_depth_key(points[order[i - 1]], view_dir) > get_depth_key(points[order[i]], view_dir))
+			return false;
+	return true;
+}
+
+/// check radix sort, insertion repair and the asynchronous sorts of the depth sorter against std::sort
+bool test_depth_sorter()
+{
+	typedef depth_sorter::Idx Idx;
+	typedef depth_sorter::Pnt Pnt;
+	typedef cgv::type::uint32_type Key;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+	// float keys preserve the order of negative and positive floats
+	float values[] = { -3e38f, -2.5f, -1.0f, -1e-30f, -0.0f, 0.0f, 1e-30f, 1.0f, 2.5f, 3e38f };
+	for (size_t i = 1; i < sizeof(values) / sizeof(float); ++i) {
+		TEST_ASSERT(float_to_key(values[i - 1]) <= float_to_key(values[i]));
+	}
+
+	// radix sort agrees with a stable sort on keys of negative, positive and many equal floats for one and several blocks
+	size_t sizes[3] = { 1, 1000, 500000 };
+	for (int s = 0; s < 3; ++s) {
+		size_t n = sizes[s];
+		std::vector<Key> keys(n), tmp_keys;
+		std::vector<Idx> vals(n), tmp_vals;
+		for (size_t i = 0; i < n; ++i) {
+			float v = uniform(rng);
+			keys[i] = float_to_key(i % 3 == 0 ? std::floor(8 * v) : v);
+			vals[i] = Idx(i);
+		}
+		std::vector<std::pair<Key, Idx> > ref(n);
+		for (size_t i = 0; i < n; ++i)
+			ref[i] = std::make_pair(keys[i], vals[i]);
+		std::stable_sort(ref.begin(), ref.end(), [](const std::pair<Key, Idx>& a, const std::pair<Key, Idx>& b) { return a.first < b.first; });
+		depth_sorter::radix_sort(keys, vals, tmp_keys, tmp_vals);
+		bool equal = true;
+		for (size_t i = 0; i < n; ++i)
+			equal = equal && keys[i] == ref[i].first && vals[i] == ref[i].second;
+		TEST_ASSERT(equal);
+	}
+
+	// insertion repair fixes a sorted sequence with few local swaps and gives up on a reversed sequence
+	std::vector<Key> keys(1000);
+	std::vector<Idx> vals(1000);
+	for (Idx i = 0; i < 1000; ++i) {
+		keys[i] = float_to_key(float(i / 2) - 250.0f);
+		vals[i] = i;
+	}
+	for (size_t i = 0; i + 1 < keys.size(); i += 7)
+		std::swap(keys[i], keys[i + 1]);
+	TEST_ASSERT(depth_sorter::insertion_sort(keys, vals, 2000));
+	TEST_ASSERT(std::is_sorted(keys.begin(), keys.end()));
+	std::reverse(keys.begin(), keys.end());
+	TEST_ASSERT(!depth_sorter::insertion_sort(keys, vals, 2000));
+	std::vector<Idx> sorted_vals(vals);
+	std::sort(sorted_vals.begin(), sorted_vals.end());
+	bool is_permutation = true;
+	for (Idx i = 0; i < 1000; ++i)
+		is_permutation = is_permutation && sorted_vals[i] == i;
+	TEST_ASSERT(is_permutation);
+
+	// sort a subset of points including duplicates around the origin, such that depths are negative and equal
+	std::vector<Pnt> points(200000);
+	for (size_t i = 0; i < points.size(); ++i)
+		points[i] = i % 5 == 4 ? points[i - 1] : Pnt(uniform(rng), uniform(rng), uniform(rng));
+	std::vector<Idx> indices;
+	for (Idx i = 0; i < Idx(points.size()); i += 1 + i % 2)
+		indices.push_back(i);
+	depth_sorter sorter;
+	sorter.set_indices(indices);
+	Pnt view_dir(0.3f, -0.4f, 0.866f);
+	sorter.update(&points[0], view_dir);
+	TEST_ASSERT(sorter.get_statistics().nr_full_sorts == 1);
+	std::vector<Idx> ref_order(indices);
+	std::stable_sort(ref_order.begin(), ref_order.end(), [&](Idx a, Idx b) {
+		return get_depth_key(points[a], view_dir) < get_depth_key(points[b], view_dir);
+	});
+	TEST_ASSERT(sorter.get_order() == ref_order);
+
+	// small view changes are repaired from the previous order and large changes sort from scratch
+	Pnt view_dirs[3] = { Pnt(0.3001f, -0.4f, 0.866f), Pnt(0.3001f, -0.4001f, 0.866f), Pnt(-0.8f, 0.6f, 0.0f) };
+	for (int v = 0; v < 3; ++v) {
+		unsigned nr_sorts = sorter.get_statistics().nr_full_sorts + sorter.get_statistics().nr_incremental_sorts;
+		do {
+			std::this_thread::yield();
+			sorter.update(&points[0], view_dirs[v]);
+		} while (sorter.get_statistics().nr_full_sorts + sorter.get_statistics().nr_incremental_sorts == nr_sorts);
+		TEST_ASSERT(sorter.get_statistics().last_sort_incremental == (v < 2));
+		TEST_ASSERT(is_depth_sorted(sorter.get_order(), indices, points, view_dirs[v]));
+	}
+	TEST_ASSERT(sorter.get_statistics().nr_incremental_sorts == 2);
+	return true;
+}
+
+/// return whether the box B contains the box b
+bool contains_box(const point_cloud::Box& B, const point_cloud::Box& b)
+{
+	for (int c = 0; c < 3; ++c)
+		if (b.get_min_pnt()(c) < B.get_min_pnt()(c) || b.get_max_pnt()(c) > B.get_max_pnt()(c))
+			return false;
+	return true;
+}
+
+/// return the number of points of the point cloud inside of the box
+unsigned count_points_inside(const point_cloud& pc, const point_cloud::Box& B)
+{
+	unsigned n = 0;
+	for (unsigned i = 0; i < pc.get_nr_points(); ++i)
+		if (B.inside(pc.pnt(i)))
+			++n;
+	return n;
+}
+
+/// update the octree until the selection does not change anymore and return the points of the rendered nodes
+void stream_octree(octree_point_cloud& opc, const point_cloud::Pnt& eye, const point_cloud::HMat* modelview_projection, point_cloud& pc)
+{
+	while (opc.update(eye, 1000.0f, modelview_projection) || opc.has_pending_loads())
+		std::this_thread::yield();
+	opc.extract_rendered_points(pc);
+}
+
+/// check that subtree boxes bound all descendants and that frustum culling keeps nodes whose descendants are visible
+bool test_octree_subtree_boxes()
+{
+	typedef octree_point_cloud::Cnt Cnt;
+	const std::string file_name = "test_point_cloud.opc";
+	point_cloud pc;
+	sample_torus(pc, 50000, 1.0f, 0.4f, 0.0f, false);
+	// with two subsampling cells per axis inner nodes keep at most eight points, such that their chunk boxes are much smaller than their subtrees
+	TEST_ASSERT(octree_point_cloud::build(pc, file_name, 500, 1));
+	octree_point_cloud opc;
+	TEST_ASSERT(opc.open(file_name));
+	TEST_ASSERT(opc.get_nr_nodes() > 9);
+	for (Cnt ni = 0; ni < opc.get_nr_nodes(); ++ni) {
+		const octree_point_cloud::octree_node& node = opc.get_node(ni);
+		TEST_ASSERT(contains_box(opc.get_subtree_box(ni), node.box));
+		for (Cnt ci = node.first_child; ci < node.first_child + node.get_nr_children(); ++ci) {
+			TEST_ASSERT(contains_box(opc.get_subtree_box(ni), opc.get_subtree_box(ci)));
+		}
+	}
+	const point_cloud::Box& B = opc.get_header().box;
+	TEST_ASSERT(contains_box(opc.get_subtree_box(0), B) && contains_box(B, opc.get_subtree_box(0)));
+
+	// without culling and error threshold all points are rendered
+	point_cloud::Pnt eye = B.get_center() + point_cloud::Pnt(0.0f, 0.0f, 5.0f);
+	opc.set_max_screen_space_error(0.0f);
+	point_cloud all_points;
+	stream_octree(opc, eye, 0, all_points);
+	TEST_ASSERT(all_points.get_nr_points() == pc.get_nr_points());
+
+	// an orthographic view of a slab at the largest x coordinates, which the chunk of the root does not reach
+	point_cloud::Box view_box(B);
+	view_box.ref_min_pnt()(0) = B.get_max_pnt()(0) - 0.1f;
+	view_box.ref_max_pnt()(0) += 0.1f;
+	for (int c = 1; c < 3; ++c) {
+		view_box.ref_min_pnt()(c) -= 0.1f;
+		view_box.ref_max_pnt()(c) += 0.1f;
+	}
+	TEST_ASSERT(opc.get_node(0).box.get_max_pnt()(0) < view_box.get_min_pnt()(0));
+	point_cloud::HMat modelview_projection;
+	modelview_projection.identity();
+	for (int c = 0; c < 3; ++c) {
+		modelview_projection(c, c) = 2 / view_box.get_extent()(c);
+		modelview_projection(c, 3) = -(view_box.get_min_pnt()(c) + view_box.get_max_pnt()(c)) / view_box.get_extent()(c);
+	}
+	point_cloud visible_points;
+	stream_octree(opc, eye, &modelview_projection, visible_points);
+	unsigned nr_visible = count_points_inside(all_points, view_box);
+	TEST_ASSERT(nr_visible > 0);
+	TEST_ASSERT(count_points_inside(visible_points, view_box) == nr_visible);
+	TEST_ASSERT(visible_points.get_nr_points() < all_points.get_nr_points());
+	opc.close();
+	std::remove(file_name.c_str());
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_point_cloud_compact_neighbor_graph_reg("point_cloud::compact_neighbor_graph", test_compact_neighbor_graph);
+extern CGV_API test_registration test_point_cloud_ply_round_trip_reg("point_cloud::ply_round_trip", test_ply_round_trip);
+extern CGV_API test_registration test_point_cloud_depth_sorter_reg("point_cloud::depth_sorter", test_depth_sorter);
+extern CGV_API test_registration test_point_cloud_octree_subtree_boxes_reg("point_cloud::octree_subtree_boxes", test_octree_subtree_boxes);
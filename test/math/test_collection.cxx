@@ -19,7 +19,8 @@
 #include <test/math/test_vec.h>
 #include <test/math/test_eig.h>
 #include <test/math/test_gaussj.h>
-//#include <test/math/test_sparse_mat.h>
+#include <test/math/test_sparse_mat.h>
+#include <test/math/test_sparse_les.h>
 #include <test/math/test_polynomial.h>
 #include <test/math/test_bi_polynomial.h>
 #include <test/math/test_model_comp.h>
@@ -50,6 +51,8 @@ bool test_collection()
 	test_eig();//complete
 	test_mat();//complete
 	test_gaussj();//
+	test_sparse_mat();
+	test_sparse_les();
 //	test_statistics();
 	test_align<float>(100, 100, true, true);
 	test_align<float, double>(100, 100, true, true);
@@ -67,9 +70,8 @@ bool test_collection()
 	test_bi_polynomial();
 	//test_distance_transform();
 //	test_model_comparison();
-//	test_sparse_mat();
 	//test_fibo_heap();//complete*/
-	return true;
+	return get_exit_code() == 0;
 }
 
 
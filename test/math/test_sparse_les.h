@@ -0,0 +1,55 @@
+#pragma once
+#include <cgv/math/sparse_les.h>
+#include <test/benchmark.h>
+#include <algorithm>
+#include <cmath>
+
+void test_sparse_les()
+{
+	using namespace cgv::math;
+	//solve a 1d poisson problem with two right hand sides with each built in solver
+	const std::vector<sparse_les_factory_ptr>& F = sparse_les::get_solver_factories();
+	int n = 50;
+	for (unsigned f = 0; f < F.size(); ++f) {
+		std::string name = F[f]->get_solver_name();
+		sparse_les_ptr s = F[f]->create(n, 2, 3*n);
+		for (int i = 0; i < n; ++i) {
+			s->set_mat_entry(i, i, 2.5);
+			if (i > 0)
+				s->set_mat_entry(i, i-1, -1.0);
+			if (i < n-1)
+				s->set_mat_entry(i, i+1, -1.0);
+			s->set_b_entry(i, 0, 1.0);
+			s->set_b_entry(i, 1, double(i % 7));
+		}
+		check(s->solve(), name + " solves the poisson problem");
+		double max_residual = 0;
+		for (int j = 0; j < 2; ++j)
+			for (int i = 0; i < n; ++i) {
+				double r = 2.5*s->get_x_entry(i, j) - s->ref_b_entry(i, j);
+				if (i > 0)
+					r -= s->get_x_entry(i-1, j);
+				if (i < n-1)
+					r -= s->get_x_entry(i+1, j);
+				max_residual = std::max(max_residual, fabs(r));
+			}
+		check(max_residual < 1e-6, name + " computes a solution with small residual");
+	}
+	//the first search direction of the conjugate gradient solvers has zero curvature for the first right hand side
+	//of the symmetric indefinite matrix [0 1; 1 0], which needs to be reported as failure
+	const char* pcg_names[2] = { "pcg_jacobi", "pcg_ic0" };
+	for (int k = 0; k < 2; ++k) {
+		sparse_les_ptr s = sparse_les::create_by_name(pcg_names[k], 2, 2);
+		if (!check(!s.empty(), std::string(pcg_names[k]) + " is registered"))
+			continue;
+		s->set_mat_entry(0, 1, 1.0);
+		s->set_mat_entry(1, 0, 1.0);
+		s->set_b_entry(0, 0, 1.0);
+		s->set_b_entry(1, 0, 0.0);
+		s->set_b_entry(0, 1, 1.0);
+		s->set_b_entry(1, 1, 1.0);
+		check(!s->solve(), std::string(pcg_names[k]) + " reports the break down");
+		check(fabs(s->get_x_entry(0, 1) - 1.0) < 1e-12 && fabs(s->get_x_entry(1, 1) - 1.0) < 1e-12,
+			std::string(pcg_names[k]) + " solves the right hand side without break down");
+	}
+}
@@ -1,17 +1,64 @@
 #pragma once
 #include <cgv/math/sparse_mat.h>
+#include <cmath>
 
 
 void test_sparse_mat()
 {
 	using namespace cgv::math;
-	sparse_mat<double> m1(100,100,10);
+	//assemble from added entries with duplicates and compare against dense products
+	sparse_mat<double> m1(100,80,10);
 	m1.add_entry(10,10,1.0);
 	m1.add_entry(10,20,2.0);
 	m1.add_entry(10,30,3.0);
 	m1.add_entry(30,10,4.0);
 	m1.add_entry(10,10,5.0);
-//	m1.compress();
-	std::cout << m1;
+	m1.add_entry(99,79,-1.5);
+	m1.compress();
+	assert(m1.num_non_zeros() == 5);
+	mat<double> d = m1;
+	assert(d(10,10) == 6.0 && d(99,79) == -1.5);
 
+	vec<double> x(80), y(100), r;
+	for(unsigned i = 0; i < x.size(); i++)
+		x(i) = std::sin(double(i));
+	for(unsigned i = 0; i < y.size(); i++)
+		y(i) = std::cos(double(i));
+	Ax(m1, x, r);
+	assert(length(r - d*x) < 1e-12);
+	Atx(m1, y, r);
+	assert(length(r - transpose(d)*y) < 1e-12);
+
+	//triplets with duplicates that may sum up to zero, compression of dense matrix with negative entries and transposition
+	std::vector<unsigned> I, J;
+	std::vector<double> V;
+	for(unsigned k = 0; k < 1000; k++)
+	{
+		I.push_back((k*37) % 100);
+		J.push_back((k*11) % 80);
+		V.push_back(double(k % 13) - 6.0);
+	}
+	sparse_mat<double> m2(100, 80, I, J, V);
+	mat<double> d2 = m2;
+	sparse_mat<double> m3(d2);
+	assert(m3.num_non_zeros() <= m2.num_non_zeros());
+	m3.transpose();
+	Ax(m3, y, r);
+	assert(length(r - transpose(d2)*y) < 1e-12);
+	Atx(m3, x, r);
+	assert(length(r - d2*x) < 1e-12);
+
+	//forward substitution with lower triangular part
+	sparse_mat<double> L(80, 80);
+	for(unsigned i = 0; i < 80; i++)
+	{
+		L.add_entry(i, i, 2.0);
+		if(i > 0)
+			L.add_entry(i, i-1, -1.0);
+	}
+	L.compress();
+	bool success = low_tri_solve(L, x, r);
+	assert(success);
+	Ax(L, r, y);
+	assert(length(y - x) < 1e-12);
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include <cgv/media/mesh/marching_cubes.h>
+#include <cgv/media/mesh/dual_contouring.h>
+#include <cgv/media/mesh/cuberille.h>
+#include <cgv/media/mesh/narrow_band_func.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace cgv::media::mesh;
+
+/// sphere with ripples, such that a part of the cells is empty and the surface is not trivial
+struct ripple_sphere : public cgv::math::v3_func<double, double>
+{
+	double evaluate(const pnt_type& p) const {
+		return sqrt(p(0)*p(0) + p(1)*p(1) + p(2)*p(2)) - 0.6 + 0.05*sin(10 * p(0))*cos(10 * p(1))*sin(10 * p(2));
+	}
+};
+
+/// same function as functor that is evaluated row wise without virtual calls per sample
+struct ripple_sphere_functor
+{
+	double operator () (double x, double y, double z) const {
+		return sqrt(x*x + y*y + z*z) - 0.6 + 0.05*sin(10 * x)*cos(10 * y)*sin(10 * z);
+	}
+};
+
+/// callback handler that only counts the generated vertices and polygons
+struct counting_handler : public streaming_mesh_callback_handler
+{
+	size_t nr_vertices, nr_polygons;
+	counting_handler() : nr_vertices(0), nr_polygons(0) {}
+	void new_vertex(unsigned int) { ++nr_vertices; }
+	void new_polygon(const std::vector<unsigned int>&) { ++nr_polygons; }
+	void before_drop_vertex(unsigned int) {}
+};
+
+/// run extraction and print throughput in cells per second
+template <typename F>
+void measure(const char* name, unsigned int res, const counting_handler& h, F extract)
+{
+	clock_type::time_point start = clock_type::now();
+	extract();
+	double t = seconds_since(start);
+	double nr_cells = double(res - 1)*(res - 1)*(res - 1);
+	std::cout << name << ": " << t << "s, " << nr_cells / t * 1e-6 << " Mcells/s, "
+		<< h.nr_vertices << " vertices, " << h.nr_polygons << " polygons" << std::endl;
+}
+
+/// check that a marching cubes variant generates the same mesh size as the serial marching cubes
+void check_same_counts(const char* name, const counting_handler& h, const counting_handler& reference)
+{
+	check(h.nr_vertices == reference.nr_vertices && h.nr_polygons == reference.nr_polygons,
+		std::string(name) + " generates as many vertices and polygons as marching cubes");
+}
+
+/// measure throughput of marching cubes, dual contouring and cuberille on a resolution given as first argument
+int main(int argc, char** argv)
+{
+	unsigned int res = argc > 1 ? atoi(argv[1]) : 256;
+	ripple_sphere func;
+	cgv::media::axis_aligned_box<double, 3> box(cgv::math::fvec<double, 3>(-1, -1, -1), cgv::math::fvec<double, 3>(1, 1, 1));
+	std::cout << "resolution " << res << "^3" << std::endl;
+	counting_handler mc_h;
+	{
+		marching_cubes<double, double> mc(func, &mc_h);
+		measure("marching cubes          ", res, mc_h, [&]() { mc.extract(0, box, res, res, res); });
+	}
+	{
+		counting_handler h;
+		marching_cubes<double, double> mc(func, &h);
+		mc.set_nr_threads(0);
+		measure("marching cubes parallel ", res, h, [&]() { mc.extract(0, box, res, res, res); });
+		check_same_counts("parallel marching cubes", h, mc_h);
+	}
+	{
+		cgv::math::inline_v3_func<double, double, ripple_sphere_functor> inline_func;
+		counting_handler h;
+		marching_cubes<double, double> mc(inline_func, &h);
+		measure("marching cubes inline   ", res, h, [&]() { mc.extract(0, box, res, res, res); });
+		check_same_counts("marching cubes on inline function", h, mc_h);
+	}
+	{
+		// the gradient length of ripple_sphere is bounded by 1 + 0.5*sqrt(3)
+		narrow_band_func<double, double> nb_func(func, 1 + 0.5*sqrt(3.0));
+		counting_handler h;
+		marching_cubes<double, double> mc(nb_func, &h);
+		measure("marching cubes band     ", res, h, [&]() { nb_func.build(0, box, res, res, res); mc.extract(0, box, res, res, res); });
+		std::cout << "  evaluated " << 100.0*nb_func.get_nr_sample_evaluations() / (double(res)*res*res) << "% of the samples" << std::endl;
+		check_same_counts("marching cubes on narrow band", h, mc_h);
+	}
+	{
+		counting_handler h;
+		dual_contouring<double, double> dc(func, &h);
+		measure("dual contouring         ", res, h, [&]() { dc.extract(0, box, res, res, res); });
+	}
+	{
+		counting_handler h;
+		cgv::media::mesh::greater_equal<double> pred(0.0);
+		cuberille<double, double, cgv::media::mesh::greater_equal<double> > cb(func, &h, pred);
+		measure("cuberille               ", res, h, [&]() { cb.extract(box, res, res, res); });
+	}
+	return get_exit_code();
+}
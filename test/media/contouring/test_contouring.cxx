@@ -0,0 +1,118 @@
+#include <cgv/base/register.h>
+#include <cgv/media/mesh/marching_cubes.h>
+#include <cgv/media/mesh/dual_contouring.h>
+#include <cgv/media/mesh/narrow_band_func.h>
+#include <vector>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+/// sphere with ripples, such that a part of the cells is empty and the surface is not trivial
+struct ripple_sphere : public cgv::math::v3_func<double, double>
+{
+	double evaluate(const pnt_type& p) const {
+		return sqrt(p(0)*p(0) + p(1)*p(1) + p(2)*p(2)) - 0.6 + 0.05*sin(10 * p(0))*cos(10 * p(1))*sin(10 * p(2));
+	}
+};
+
+/// ripple sphere with values quantized to multiples of 0.01, such that many vertices are snapped to samples
+struct quantized_ripple_sphere : public ripple_sphere
+{
+	double evaluate(const pnt_type& p) const {
+		return floor(ripple_sphere::evaluate(p) * 100 + 0.5) / 100;
+	}
+};
+
+/// callback handler that records all calls of a streaming mesh
+struct recording_handler : public streaming_mesh_callback_handler
+{
+	const streaming_mesh<double>* sm;
+	std::vector<cgv::math::fvec<double, 3> > vertices;
+	std::vector<unsigned int> polygons;
+	std::vector<unsigned int> dropped_vertices;
+	recording_handler() : sm(0) {}
+	void new_vertex(unsigned int vi) { vertices.push_back(sm->vertex_location(vi)); }
+	void new_polygon(const std::vector<unsigned int>& vis) { polygons.insert(polygons.end(), vis.begin(), vis.end()); }
+	void before_drop_vertex(unsigned int vi) { dropped_vertices.push_back(vi); }
+	bool operator == (const recording_handler& h) const { return vertices == h.vertices && polygons == h.polygons && dropped_vertices == h.dropped_vertices; }
+};
+
+/// extract the iso surface of func with marching cubes using the given number of threads and record the output
+void extract_marching_cubes(const cgv::math::v3_func<double, double>& func, unsigned int res, unsigned int nr_threads, recording_handler& h)
+{
+	cgv::media::axis_aligned_box<double, 3> box(cgv::math::fvec<double, 3>(-1, -1, -1), cgv::math::fvec<double, 3>(1, 1, 1));
+	marching_cubes<double, double> mc(func, &h);
+	h.sm = &mc;
+	mc.set_nr_threads(nr_threads);
+	mc.extract(0, box, res, res, res + 3);
+}
+
+/// extract the iso surface of func with dual contouring on the same grid as extract_marching_cubes and record the output
+void extract_dual_contouring(const cgv::math::v3_func<double, double>& func, unsigned int res, recording_handler& h)
+{
+	cgv::media::axis_aligned_box<double, 3> box(cgv::math::fvec<double, 3>(-1, -1, -1), cgv::math::fvec<double, 3>(1, 1, 1));
+	dual_contouring<double, double> dc(func, &h);
+	h.sm = &dc;
+	dc.extract(0, box, res, res, res + 3);
+}
+
+/// check that slab wise extraction produces exactly the same vertices, triangles and drop calls as serial extraction
+bool test_marching_cubes_slabs()
+{
+	ripple_sphere func;
+	quantized_ripple_sphere quantized_func;
+	const cgv::math::v3_func<double, double>* funcs[2] = { &func, &quantized_func };
+	unsigned int resolutions[3] = { 9, 32, 65 };
+	unsigned int thread_counts[3] = { 2, 3, 7 };
+	for (int f = 0; f < 2; ++f) {
+		for (int r = 0; r < 3; ++r) {
+			recording_handler serial;
+			extract_marching_cubes(*funcs[f], resolutions[r], 1, serial);
+			TEST_ASSERT(!serial.polygons.empty());
+			for (int t = 0; t < 3; ++t) {
+				recording_handler slabs;
+				extract_marching_cubes(*funcs[f], resolutions[r], thread_counts[t], slabs);
+				TEST_ASSERT(slabs == serial);
+			}
+		}
+	}
+	return true;
+}
+
+/// check that extraction from the narrow band wrapper produces the same meshes as full evaluation of the grid
+bool test_narrow_band()
+{
+	ripple_sphere func;
+	cgv::media::axis_aligned_box<double, 3> box(cgv::math::fvec<double, 3>(-1, -1, -1), cgv::math::fvec<double, 3>(1, 1, 1));
+	unsigned int resolutions[3] = { 9, 32, 65 };
+	unsigned int block_sizes[3] = { 1, 4, 8 };
+	for (int r = 0; r < 3; ++r) {
+		unsigned int res = resolutions[r];
+		recording_handler mc_full, dc_full;
+		extract_marching_cubes(func, res, 1, mc_full);
+		extract_dual_contouring(func, res, dc_full);
+		TEST_ASSERT(!mc_full.polygons.empty());
+		TEST_ASSERT(!dc_full.polygons.empty());
+		for (int b = 0; b < 3; ++b) {
+			// the gradient length of ripple_sphere is bounded by 1 + 0.5*sqrt(3)
+			narrow_band_func<double, double> nb_func(func, 1 + 0.5*sqrt(3.0), block_sizes[b]);
+			nb_func.build(0, box, res, res, res + 3);
+			recording_handler mc_band, mc_band_slabs, dc_band;
+			extract_marching_cubes(nb_func, res, 1, mc_band);
+			TEST_ASSERT(mc_band == mc_full);
+			if (res > 9)
+				TEST_ASSERT(nb_func.get_nr_sample_evaluations() < size_t(res)*res*(res + 3));
+			extract_marching_cubes(nb_func, res, 3, mc_band_slabs);
+			TEST_ASSERT(mc_band_slabs == mc_full);
+			extract_dual_contouring(nb_func, res, dc_band);
+			TEST_ASSERT(dc_band == dc_full);
+		}
+	}
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_cb_marching_cubes_slabs_reg("cgv::media::mesh::marching_cubes_slabs", test_marching_cubes_slabs);
+extern CGV_API test_registration test_cb_narrow_band_reg("cgv::media::mesh::narrow_band", test_narrow_band);
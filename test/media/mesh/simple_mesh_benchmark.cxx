@@ -0,0 +1,110 @@
+#include <cgv/media/mesh/simple_mesh.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace cgv::media::mesh;
+
+typedef simple_mesh_base::idx_type idx_type;
+typedef simple_mesh_base::vec3i vec3i;
+
+/// write an obj file with a grid of n x n quads with texture coordinates per vertex and one normal per row of quads
+void write_grid_obj(const std::string& file_name, unsigned n)
+{
+	std::ofstream os(file_name.c_str());
+	for (unsigned j = 0; j <= n; ++j)
+		for (unsigned i = 0; i <= n; ++i)
+			os << "v " << i << " " << j << " " << (i*j % 7) << "\nvt " << float(i) / n << " " << float(j) / n << "\n";
+	for (unsigned j = 0; j < n; ++j)
+		os << "vn 0 " << float(j) / n << " 1\n";
+	for (unsigned j = 0; j < n; ++j)
+		for (unsigned i = 0; i < n; ++i) {
+			unsigned v0 = j*(n + 1) + i + 1, v1 = v0 + 1, v2 = v1 + n + 1, v3 = v0 + n + 1;
+			os << "f " << v0 << "/" << v0 << "/" << j + 1 << " " << v1 << "/" << v1 << "/" << j + 1 << " "
+				<< v2 << "/" << v2 << "/" << j + 1 << " " << v3 << "/" << v3 << "/" << j + 1 << "\n";
+		}
+}
+
+/// mesh that provides the previous map based implementations as reference
+class reference_mesh : public simple_mesh<float>
+{
+public:
+	void merge_indices_with_map(std::vector<idx_type>& indices, std::vector<vec3i>& unique_triples) const
+	{
+		std::map<std::tuple<idx_type, idx_type, idx_type>, idx_type> corner_to_index;
+		for (idx_type ci = 0; ci < position_indices.size(); ++ci) {
+			vec3i c(position_indices[ci], tex_coord_indices[ci], normal_indices[ci]);
+			std::tuple<idx_type, idx_type, idx_type> triple(c(0), c(1), c(2));
+			auto iter = corner_to_index.find(triple);
+			idx_type vi;
+			if (iter == corner_to_index.end()) {
+				vi = idx_type(unique_triples.size());
+				corner_to_index[triple] = vi;
+				unique_triples.push_back(c);
+			}
+			else
+				vi = iter->second;
+			indices.push_back(vi);
+		}
+	}
+	void extract_wireframe_element_buffer_with_map(const std::vector<idx_type>& vertex_indices, std::vector<idx_type>& edge_element_buffer) const
+	{
+		std::map<std::tuple<idx_type, idx_type>, idx_type> halfedge_to_count;
+		for (idx_type fi = 0; fi < faces.size(); ++fi) {
+			idx_type last_vi = vertex_indices.at(end_corner(fi) - 1);
+			for (idx_type ci = begin_corner(fi); ci < end_corner(fi); ++ci) {
+				idx_type vi = vertex_indices.at(ci);
+				std::tuple<idx_type, idx_type> halfedge(std::min(vi, last_vi), std::max(vi, last_vi));
+				if (++halfedge_to_count[halfedge] == 1) {
+					edge_element_buffer.push_back(last_vi);
+					edge_element_buffer.push_back(vi);
+				}
+				last_vi = vi;
+			}
+		}
+	}
+};
+
+/// compare the hash based index merging and wireframe extraction with the map based versions on a large quad grid
+int main(int argc, char** argv)
+{
+	unsigned n = argc > 1 ? atoi(argv[1]) : 1000;
+	std::string file_name = "simple_mesh_benchmark.obj";
+	write_grid_obj(file_name, n);
+	reference_mesh M;
+	bool success = M.read(file_name);
+	std::remove(file_name.c_str());
+	if (!success) {
+		std::cerr << "could not read " << file_name << std::endl;
+		return 1;
+	}
+	std::cout << M.get_nr_faces() << " faces, " << M.get_nr_positions() << " positions" << std::endl;
+
+	std::vector<idx_type> I0, I1, E0, E1;
+	std::vector<vec3i> T0, T1;
+	clock_type::time_point start = clock_type::now();
+	M.merge_indices_with_map(I0, T0);
+	double t_map = seconds_since(start);
+	bool include_tex_coords = true, include_normals = true;
+	start = clock_type::now();
+	M.merge_indices(I1, T1, &include_tex_coords, &include_normals);
+	double t_hash = seconds_since(start);
+	std::cout << "merge_indices: map " << t_map << "s, hash " << t_hash << "s, speedup " << t_map / t_hash << ", "
+		<< T1.size() << " unique corners" << std::endl;
+	check(I0 == I1 && T0 == T1, "hash based index merging agrees with map based merging");
+
+	start = clock_type::now();
+	M.extract_wireframe_element_buffer_with_map(I1, E0);
+	t_map = seconds_since(start);
+	start = clock_type::now();
+	M.extract_wireframe_element_buffer(I1, E1);
+	t_hash = seconds_since(start);
+	std::cout << "extract_wireframe_element_buffer: map " << t_map << "s, hash " << t_hash << "s, speedup " << t_map / t_hash << ", "
+		<< E1.size() / 2 << " edges" << std::endl;
+	check(E0 == E1, "hash based wireframe extraction agrees with map based extraction");
+	return get_exit_code();
+}
@@ -0,0 +1,444 @@
+#include <cgv/base/register.h>
+#include <cgv/media/mesh/obj_reader.h>
+#include <cgv/media/mesh/obj_loader.h>
+#include <cgv/utils/file.h>
+#include <cgv/utils/scan.h>
+#include <cgv/utils/tokenizer.h>
+#include <cgv/utils/advanced_scan.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+
+using namespace cgv::base;
+using namespace cgv::utils;
+using namespace cgv::media::mesh;
+
+/// append a line describing a callback with its numeric arguments to the log
+void log_values(std::string& log, const char* kind, const double* values, unsigned n, const char* format = " %.17g")
+{
+	char buffer[64];
+	log += kind;
+	for (unsigned i = 0; i < n; ++i) {
+		snprintf(buffer, sizeof(buffer), format, values[i]);
+		log += buffer;
+	}
+	log += "\n";
+}
+
+/// append a line describing a face with the current group and material to the log, missing texcoord or normal indices are logged as -999
+void log_face(std::string& log, unsigned group_index, unsigned material_index, unsigned vcount, const int* vertices, const int* texcoords, const int* normals)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "f g%u m%u", group_index, material_index);
+	log += buffer;
+	for (unsigned i = 0; i < vcount; ++i) {
+		snprintf(buffer, sizeof(buffer), " %d/%d/%d", vertices[i], texcoords ? texcoords[i] : -999, normals ? normals[i] : -999);
+		log += buffer;
+	}
+	log += "\n";
+}
+
+/// obj reader that logs all callbacks
+template <typename T>
+class recording_obj_reader : public obj_reader_generic<T>
+{
+public:
+	typedef obj_reader_generic<T> base_type;
+	std::string log;
+	void process_vertex(const typename base_type::v3d_type& p) { double v[3] = { double(p(0)), double(p(1)), double(p(2)) }; log_values(log, "v", v, 3); }
+	void process_normal(const typename base_type::v3d_type& n) { double v[3] = { double(n(0)), double(n(1)), double(n(2)) }; log_values(log, "n", v, 3); }
+	void process_texcoord(const typename base_type::v2d_type& t) { double v[2] = { double(t(0)), double(t(1)) }; log_values(log, "t", v, 2); }
+	void process_color(const typename base_type::color_type& c) { double v[4] = { c[0], c[1], c[2], c[3] }; log_values(log, "c", v, 4, " %.9g"); }
+	void process_face(unsigned vcount, int* vertices, int* texcoords, int* normals) { log_face(log, this->get_current_group(), this->get_current_material(), vcount, vertices, texcoords, normals); }
+	void process_group(const std::string& name, const std::string& parameters) { log += "g [" + name + "] [" + parameters + "]\n"; }
+	void process_material(const cgv::media::illum::obj_material& mtl, unsigned idx) { log += "m " + mtl.get_name() + " " + std::to_string(idx) + "\n"; }
+};
+
+/** serial line by line obj reader with tokenizer based parsing as implemented by obj_reader_generic before
+    the chunked parallel parser, which logs the same callbacks as recording_obj_reader. Materials are not supported. */
+template <typename T>
+class serial_obj_reader
+{
+protected:
+	unsigned nr_normals, nr_texcoords, nr_groups;
+	int group_index, material_index;
+	std::map<std::string, unsigned> group_index_lut;
+	/// parse n numbers from the tokens off+1 to off+n if all of them are present and stop at the first token that is not a number
+	static void parse(const std::vector<token>& t, unsigned off, unsigned n, T* v)
+	{
+		if (t.size() <= off + n)
+			return;
+		for (unsigned i = 0; i < n; ++i) {
+			double value;
+			if (!is_double(t[off + 1 + i].begin, t[off + 1 + i].end, value))
+				return;
+			v[i] = T(value);
+		}
+	}
+	void log_coordinates(const char* kind, const std::vector<token>& t, unsigned n)
+	{
+		T v[3] = { 0, 0, 0 };
+		parse(t, 0, n, v);
+		double values[3] = { double(v[0]), double(v[1]), double(v[2]) };
+		log_values(log, kind, values, n);
+	}
+	void log_color(const std::vector<token>& t, unsigned off)
+	{
+		T v[4] = { 0, 0, 0, 1 };
+		double alpha;
+		parse(t, off, 3, v);
+		if (t.size() > 4 + off && is_double(t[4 + off].begin, t[4 + off].end, alpha))
+			v[3] = T(alpha);
+		double values[4] = { double(float(v[0])), double(float(v[1])), double(float(v[2])), double(float(v[3])) };
+		log_values(log, "c", values, 4, " %.9g");
+	}
+	void parse_face(const std::vector<token>& tokens)
+	{
+		std::vector<int> vertex_indices, normal_indices, texcoord_indices;
+		for (unsigned i = 1; i < tokens.size(); i++) {
+			std::vector<token> smaller_tokens;
+			tokenizer(tokens[i]).set_sep("/").bite_all(smaller_tokens);
+			if (smaller_tokens.size() < 1)
+				continue;
+			int vi = atoi(to_string(smaller_tokens[0]).c_str());
+			if (vi > 0)
+				vi -= 1;
+			vertex_indices.push_back(vi);
+			if (smaller_tokens.size() == 1) {
+				if ((int)nr_normals > vi)
+					normal_indices.push_back(vi);
+				if ((int)nr_texcoords > vi)
+					texcoord_indices.push_back(vi);
+				continue;
+			}
+			if (smaller_tokens.size() < 3)
+				continue;
+			unsigned j = 2;
+			if (smaller_tokens[j] != "/") {
+				int ti = atoi(to_string(smaller_tokens[j]).c_str());
+				if (ti > 0)
+					ti -= 1;
+				if ((int)nr_texcoords > ti)
+					texcoord_indices.push_back(ti);
+				++j;
+			}
+			if (smaller_tokens.size() < j + 2)
+				continue;
+			int ni = atoi(to_string(smaller_tokens[j + 1]).c_str());
+			if (ni > 0)
+				ni -= 1;
+			if ((int)nr_normals > ni)
+				normal_indices.push_back(ni);
+		}
+		log_face(log, group_index, material_index, (unsigned)vertex_indices.size(), vertex_indices.data(),
+			texcoord_indices.size() == vertex_indices.size() ? texcoord_indices.data() : 0,
+			normal_indices.size() == vertex_indices.size() ? normal_indices.data() : 0);
+	}
+public:
+	std::string log;
+	serial_obj_reader() : nr_normals(0), nr_texcoords(0), nr_groups(0), group_index(-1), material_index(-1) {}
+	void read(const std::string& content)
+	{
+		std::vector<line> lines;
+		split_to_lines(content, lines);
+		std::vector<token> tokens;
+		for (unsigned li = 0; li < lines.size(); ++li) {
+			tokens.clear();
+			tokenizer(lines[li]).bite_all(tokens);
+			if (tokens.size() == 0)
+				continue;
+			switch (tokens[0][0]) {
+			case 'v':
+				if (tokens[0].size() == 1) {
+					log_coordinates("v", tokens, 3);
+					if (tokens.size() >= 7)
+						log_color(tokens, 3);
+				}
+				else {
+					switch (tokens[0][1]) {
+					case 'n': log_coordinates("n", tokens, 3); ++nr_normals; break;
+					case 't': log_coordinates("t", tokens, 2); ++nr_texcoords; break;
+					case 'c': log_color(tokens, 0); break;
+					}
+				}
+				break;
+			case 'f':
+				if (group_index == -1) {
+					group_index = 0;
+					nr_groups = 1;
+					log += "g [main] []\n";
+					group_index_lut["main"] = group_index;
+				}
+				if (material_index == -1) {
+					material_index = 0;
+					log += "m default 0\n";
+				}
+				parse_face(tokens);
+				break;
+			case 'g':
+				if (tokens.size() > 1) {
+					std::string name = to_string(tokens[1]);
+					std::string parameters;
+					if (tokens.size() > 2)
+						parameters.assign(tokens[2].begin, tokens.back().end - tokens[2].begin);
+					std::map<std::string, unsigned>::iterator it = group_index_lut.find(name);
+					if (it != group_index_lut.end())
+						group_index = it->second;
+					else {
+						group_index = nr_groups++;
+						log += "g [" + name + "] [" + parameters + "]\n";
+						group_index_lut[name] = group_index;
+					}
+				}
+				break;
+			}
+		}
+	}
+};
+
+/** generate an obj file with nr_lines random lines of vertex attributes with valid and malformed numbers, faces with
+    all corner forms and out of range or relative indices, groups, comments, unknown keywords, tabs and CRLF line ends */
+std::string generate_random_obj(unsigned seed, unsigned nr_lines)
+{
+	static const char* weird[] = { "1e5", "1.", ".5", "-0", "1e", "e5", "1.2.3", "abc", "1e5.3", "123456789012345678901234", "1e-300", "1e308",
+		"-.5e-3", "+3", "0.1", "1E+2", "9007199254740993", "0.30000000000000004", "1e23", "1.5e-22", "00012.500", "-", "+", "1e+", "." };
+	static const char* spaces[] = { " ", " ", "\t", "  " };
+	static const char* corner_forms[] = { "v", "v/t", "v//n", "v/t/n", "v/t/n", "x" };
+	static const char* malformed_corner_forms[] = { "v", "v/t", "v//n", "v/t/n", "v/", "/v", "v//", "v/t/" };
+	static const char* other_lines[] = { "", "   ", "vp 1 2", "s off", "o obj", "fo 1 2 3", "gx", "# comment v 1 2 3" };
+	static const char* group_names[] = { "a", "b", "c", "x y" };
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	auto pick = [&](unsigned n) { return unsigned(uniform(rng)*n) % n; };
+	auto number = [&]() -> std::string {
+		char buffer[64];
+		double r = uniform(rng);
+		if (r < 0.1)
+			return weird[pick(sizeof(weird) / sizeof(weird[0]))];
+		if (r < 0.5)
+			snprintf(buffer, sizeof(buffer), "%.6f", 200 * uniform(rng) - 100);
+		else if (r < 0.8)
+			snprintf(buffer, sizeof(buffer), "%.17g", 2000 * uniform(rng) - 1000);
+		else
+			snprintf(buffer, sizeof(buffer), "%g", 2 * uniform(rng) - 1);
+		return buffer;
+	};
+	auto numbers = [&](const char* keyword, const std::vector<unsigned>& counts) -> std::string {
+		std::string l = keyword;
+		for (unsigned n = counts[pick(unsigned(counts.size()))]; n > 0; --n)
+			l += spaces[pick(4)] + number();
+		return l;
+	};
+	auto index = [&](int n) { return std::to_string(int(pick(n + 6)) - 3); };
+	std::string content;
+	int nv = 0, nn = 0, nt = 0;
+	for (unsigned i = 0; i < nr_lines; ++i) {
+		double r = uniform(rng);
+		if (r < 0.3) {
+			content += numbers("v", { 3, 3, 3, 6, 7, 2, 1 });
+			++nv;
+		}
+		else if (r < 0.4) {
+			content += numbers("vn", { 3, 3, 2 });
+			++nn;
+		}
+		else if (r < 0.5) {
+			content += numbers("vt", { 2, 2, 3, 1 });
+			++nt;
+		}
+		else if (r < 0.52)
+			content += numbers("vc", { 3, 4, 5, 2 });
+		else if (r < 0.85) {
+			std::string form = corner_forms[pick(6)];
+			unsigned nr_corners[5] = { 3, 3, 4, 5, 1 };
+			content += "f";
+			for (unsigned c = nr_corners[pick(5)]; c > 0; --c) {
+				std::string f = form == "x" ? malformed_corner_forms[pick(8)] : form;
+				std::string corner;
+				for (char ch : f) {
+					if (ch == 'v')
+						corner += index(nv);
+					else if (ch == 't')
+						corner += index(nt);
+					else if (ch == 'n')
+						corner += index(nn);
+					else
+						corner += ch;
+				}
+				content += spaces[pick(4)] + corner;
+			}
+		}
+		else if (r < 0.9) {
+			content += "g";
+			for (unsigned g = pick(4); g > 0; --g)
+				content += spaces[pick(4)] + std::string(group_names[pick(4)]);
+		}
+		else if (r < 0.95)
+			content += other_lines[pick(sizeof(other_lines) / sizeof(other_lines[0]))];
+		else
+			content += spaces[pick(4)];
+		if (uniform(rng) < 0.05)
+			content += spaces[pick(4)];
+		if (i + 1 < nr_lines || uniform(rng) < 0.5)
+			content += uniform(rng) < 0.3 ? "\r\n" : "\n";
+	}
+	return content;
+}
+
+/// check that the chunked parallel parser of read_obj reports the same callbacks as the serial reader
+template <typename T>
+bool check_obj_reader(const std::string& file_name, const std::string& content)
+{
+	recording_obj_reader<T> reader;
+	TEST_ASSERT(reader.read_obj(file_name));
+	serial_obj_reader<T> reference;
+	reference.read(content);
+	TEST_ASSERT(!reference.log.empty());
+	TEST_ASSERT(reader.log == reference.log);
+	return true;
+}
+
+/// compare the parallel obj parser with the serial reader on random files, the largest of which spans several chunks
+bool test_obj_reader()
+{
+	const std::string file_name = "test_obj_reader.obj";
+	unsigned nr_lines[4] = { 1, 100, 5000, 400000 };
+	for (unsigned s = 0; s < 4; ++s) {
+		std::string content = generate_random_obj(s, nr_lines[s]);
+		TEST_ASSERT(file::write(file_name, content.data(), content.size(), false));
+		if (s == 3) {
+			TEST_ASSERT(content.size() > (4u << 20));
+		}
+		check_obj_reader<double>(file_name, content);
+		check_obj_reader<float>(file_name, content);
+	}
+	std::remove(file_name.c_str());
+	return true;
+}
+
+/// return whether two mapped vectors contain the same elements
+template <typename T>
+bool equal_arrays(const cgv::data::mapped_vector<T>& a, const cgv::data::mapped_vector<T>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i)
+		if (!(a[i] == b[i]))
+			return false;
+	return true;
+}
+
+/// return whether two obj loaders hold the same vertex attributes, indices, faces and groups
+template <typename T>
+bool equal_obj_loaders(const obj_loader_generic<T>& l0, const obj_loader_generic<T>& l1)
+{
+	if (!equal_arrays(l0.vertices, l1.vertices) || !equal_arrays(l0.normals, l1.normals) ||
+		!equal_arrays(l0.texcoords, l1.texcoords) || !equal_arrays(l0.colors, l1.colors) ||
+		!equal_arrays(l0.vertex_indices, l1.vertex_indices) || !equal_arrays(l0.normal_indices, l1.normal_indices) ||
+		!equal_arrays(l0.texcoord_indices, l1.texcoord_indices))
+		return false;
+	if (l0.faces.size() != l1.faces.size() || l0.groups.size() != l1.groups.size() || l0.materials.size() != l1.materials.size())
+		return false;
+	for (size_t i = 0; i < l0.faces.size(); ++i) {
+		const face_info& f0 = l0.faces[i];
+		const face_info& f1 = l1.faces[i];
+		if (f0.degree != f1.degree || f0.first_vertex_index != f1.first_vertex_index || f0.first_texcoord_index != f1.first_texcoord_index ||
+			f0.first_normal_index != f1.first_normal_index || f0.group_index != f1.group_index || f0.material_index != f1.material_index)
+			return false;
+	}
+	for (size_t i = 0; i < l0.groups.size(); ++i)
+		if (l0.groups[i].name != l1.groups[i].name || l0.groups[i].parameters != l1.groups[i].parameters)
+			return false;
+	return true;
+}
+
+/// check that the binary cache written by read_obj is mapped on the next load and rejected once the obj file or the cache changes
+template <typename T>
+void check_obj_loader(const std::string& file_name, const std::string& bin_file_name)
+{
+	std::string content = generate_random_obj(7, 2000);
+	TEST_ASSERT(file::write(file_name, content.data(), content.size(), false));
+	std::remove(bin_file_name.c_str());
+
+	// first load parses the obj file and writes the cache, second load maps the cache
+	obj_loader_generic<T> parsed;
+	TEST_ASSERT(parsed.read_obj(file_name));
+	TEST_ASSERT(!parsed.vertices.empty() && !parsed.faces.empty() && !parsed.groups.empty());
+	TEST_ASSERT(!parsed.vertices.is_mapped());
+	TEST_ASSERT(file::exists(bin_file_name));
+	obj_loader_generic<T> cached;
+	TEST_ASSERT(cached.read_obj(file_name));
+	TEST_ASSERT(cached.vertices.is_mapped() && cached.faces.is_mapped());
+	TEST_ASSERT(equal_obj_loaders(parsed, cached));
+	cached.clear();
+
+	// growing the obj file rejects the cache, the file is parsed again and the cache rewritten
+	content += "\nv 1 2 3\n";
+	TEST_ASSERT(file::write(file_name, content.data(), content.size(), false));
+	obj_loader_generic<T> grown;
+	TEST_ASSERT(!grown.read_obj_bin(bin_file_name, file_name));
+	grown.clear();
+	TEST_ASSERT(grown.read_obj(file_name));
+	TEST_ASSERT(!grown.vertices.is_mapped());
+	TEST_ASSERT(grown.vertices.size() == parsed.vertices.size() + 1);
+	obj_loader_generic<T> grown_cached;
+	TEST_ASSERT(grown_cached.read_obj_bin(bin_file_name, file_name));
+	TEST_ASSERT(equal_obj_loaders(grown, grown_cached));
+	grown_cached.clear();
+
+	// touching the obj file without changing its size rejects the cache as well, wait for the last write time to advance
+	long long write_time = file::get_last_write_time(file_name);
+	content[content.size() - 2] = '4';
+	for (int i = 0; i < 40 && file::get_last_write_time(file_name) == write_time; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		TEST_ASSERT(file::write(file_name, content.data(), content.size(), false));
+	}
+	TEST_ASSERT(file::get_last_write_time(file_name) != write_time);
+	obj_loader_generic<T> touched;
+	TEST_ASSERT(!touched.read_obj_bin(bin_file_name, file_name));
+	touched.clear();
+	TEST_ASSERT(touched.read_obj(file_name));
+	TEST_ASSERT(!touched.vertices.is_mapped());
+	TEST_ASSERT(touched.vertices.size() == grown.vertices.size() && touched.vertices.back() == typename obj_loader_generic<T>::v3d_type(1, 2, 4));
+	obj_loader_generic<T> touched_cached;
+	TEST_ASSERT(touched_cached.read_obj_bin(bin_file_name, file_name));
+	TEST_ASSERT(equal_obj_loaders(touched, touched_cached));
+	touched_cached.clear();
+
+	// a corrupted header is rejected and read_obj falls back to parsing and rewrites a valid cache
+	std::string cache;
+	TEST_ASSERT(file::read(bin_file_name, cache, false));
+	TEST_ASSERT(cache.size() > 8);
+	cache[0] = 'X';
+	TEST_ASSERT(file::write(bin_file_name, cache.data(), cache.size(), false));
+	obj_loader_generic<T> corrupted;
+	TEST_ASSERT(!corrupted.read_obj_bin(bin_file_name, file_name));
+	corrupted.clear();
+	TEST_ASSERT(corrupted.read_obj(file_name));
+	TEST_ASSERT(!corrupted.vertices.is_mapped());
+	TEST_ASSERT(equal_obj_loaders(touched, corrupted));
+	obj_loader_generic<T> repaired;
+	TEST_ASSERT(repaired.read_obj_bin(bin_file_name, file_name));
+	TEST_ASSERT(equal_obj_loaders(touched, repaired));
+	repaired.clear();
+
+	std::remove(file_name.c_str());
+	std::remove(bin_file_name.c_str());
+}
+
+/// test the binary cache of the obj loader for both coordinate types, which use different cache file extensions
+bool test_obj_loader()
+{
+	check_obj_loader<double>("test_obj_loader.obj", "test_obj_loader.bin_obj");
+	check_obj_loader<float>("test_obj_loader.obj", "test_obj_loader.bin_objf");
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_obj_reader_reg("cgv::media::mesh::obj_reader", test_obj_reader);
+extern CGV_API test_registration test_obj_loader_reg("cgv::media::mesh::obj_loader", test_obj_loader);
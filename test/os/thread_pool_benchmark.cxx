@@ -0,0 +1,81 @@
+#include <cgv/os/thread_pool.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace cgv::os;
+
+/// measure latency of spawning empty tasks in a task group and of round trips through futures
+void benchmark_spawn(thread_pool& pool, unsigned nr_tasks)
+{
+	clock_type::time_point start = clock_type::now();
+	task_group tg(pool);
+	for (unsigned i = 0; i < nr_tasks; ++i)
+		tg.run([]() {});
+	tg.wait();
+	double t_group = seconds_since(start);
+
+	start = clock_type::now();
+	unsigned sum = 0;
+	for (unsigned i = 0; i < nr_tasks / 100; ++i)
+		sum += pool.submit([i]() { return i & 1; }).get();
+	double t_future = seconds_since(start);
+	std::cout << "  spawn: " << 1e9*t_group / nr_tasks << " ns per task in group, "
+		<< 1e9*t_future / (nr_tasks / 100) << " ns per future round trip (" << sum << ")" << std::endl;
+	check(sum == nr_tasks / 200, "futures return the results of all submitted tasks");
+}
+
+/// compute bound kernel evaluated per loop index
+double kernel(size_t i)
+{
+	double x = double(i);
+	for (int k = 0; k < 20; ++k)
+		x = std::sqrt(x + k);
+	return x;
+}
+
+/// measure parallel loop over a compute bound kernel and check that all indices have been processed
+double benchmark_loop(thread_pool& pool, std::vector<double>& data, unsigned grain)
+{
+	std::fill(data.begin(), data.end(), -1.0);
+	clock_type::time_point start = clock_type::now();
+	parallel_for(pool, size_t(0), data.size(), size_t(grain), [&](size_t i) {
+		data[i] = kernel(i);
+	});
+	double t = seconds_since(start);
+	size_t nr_wrong = 0;
+	for (size_t i = 0; i < data.size(); ++i)
+		if (data[i] != kernel(i))
+			++nr_wrong;
+	check(nr_wrong == 0, "parallel_for processes every index once");
+	return t;
+}
+
+int main(int argc, char** argv)
+{
+	size_t n = argc > 1 ? atoi(argv[1]) : 10000000;
+	std::vector<double> data(n);
+	unsigned max_nr_workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	std::vector<unsigned> nr_workers(1, 0);
+	for (unsigned w = 1; w < max_nr_workers; w = 2 * w + 1)
+		nr_workers.push_back(w);
+	if (max_nr_workers > 0)
+		nr_workers.push_back(max_nr_workers);
+	double t_serial = 0;
+	for (size_t i = 0; i < nr_workers.size(); ++i) {
+		thread_pool pool(nr_workers[i]);
+		std::cout << "pool with " << nr_workers[i] << " workers" << std::endl;
+		benchmark_spawn(pool, 100000);
+		for (unsigned grain = 64; grain <= 65536; grain *= 32) {
+			double t = benchmark_loop(pool, data, grain);
+			if (i == 0 && grain == 64)
+				t_serial = t;
+			std::cout << "  parallel_for grain " << grain << ": " << t << " s, speedup " << t_serial / t << std::endl;
+		}
+	}
+	return get_exit_code();
+}
@@ -0,0 +1,97 @@
+#include <cgv/utils/scan.h>
+#include <cgv/type/standard_types.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/// numbers stored back to back in one buffer with a terminating zero per number such that the C functions can be used
+struct number_buffer
+{
+	std::vector<char> text;
+	std::vector<size_t> offsets;
+	void add(const char* s)
+	{
+		offsets.push_back(text.size());
+		text.insert(text.end(), s, s + strlen(s) + 1);
+	}
+	size_t size() const { return offsets.size(); }
+	const char* begin(size_t i) const { return &text[offsets[i]]; }
+	const char* end(size_t i) const { return &text[(i + 1 < offsets.size() ? offsets[i + 1] : text.size()) - 1]; }
+};
+
+/// time parsing all numbers of the buffer with f, print the throughput and return the sum of all values
+template <typename F>
+double run(const char* name, const number_buffer& numbers, const F& f)
+{
+	double sum = 0;
+	clock_type::time_point start = clock_type::now();
+	for (size_t i = 0; i < numbers.size(); ++i)
+		sum += f(numbers.begin(i), numbers.end(i));
+	double t = seconds_since(start);
+	std::cout << name << ": " << numbers.size() / t * 1e-6 << " Mnumbers/s, " << numbers.text.size() / t * 1e-6 << " MB/s" << std::endl;
+	return sum;
+}
+
+/// check from_chars against strtod and strtof and return the number of differences
+unsigned count_differences(const number_buffer& numbers)
+{
+	unsigned nr_different = 0;
+	for (size_t i = 0; i < numbers.size(); ++i) {
+		double d = 0, dr = strtod(numbers.begin(i), 0);
+		float f = 0, fr = strtof(numbers.begin(i), 0);
+		if (cgv::utils::from_chars(numbers.begin(i), numbers.end(i), d) != numbers.end(i) || d != dr)
+			++nr_different;
+		if (cgv::utils::from_chars(numbers.begin(i), numbers.end(i), f) != numbers.end(i) || f != fr)
+			++nr_different;
+	}
+	return nr_different;
+}
+
+/// compare cgv::utils::from_chars and is_double with atof, strtod and sscanf on coordinates, random doubles and integers
+int main(int argc, char** argv)
+{
+	unsigned n = argc > 1 ? atoi(argv[1]) : 1000000;
+	std::mt19937_64 rng(7);
+	std::uniform_real_distribution<double> coordinate(-100.0, 100.0);
+	number_buffer coordinates, doubles, integers;
+	char buffer[64];
+	for (unsigned i = 0; i < n; ++i) {
+		snprintf(buffer, sizeof(buffer), "%.6f", coordinate(rng));
+		coordinates.add(buffer);
+		double x;
+		do {
+			cgv::type::uint64_type bits = rng();
+			memcpy(&x, &bits, sizeof(double));
+		} while (x != x || x - x != 0);
+		snprintf(buffer, sizeof(buffer), "%.17g", x);
+		doubles.add(buffer);
+		snprintf(buffer, sizeof(buffer), "%d", int(rng() % 2000001) - 1000000);
+		integers.add(buffer);
+	}
+	const char* names[] = { "coordinates", "random doubles" };
+	const number_buffer* buffers[] = { &coordinates, &doubles };
+	for (int b = 0; b < 2; ++b) {
+		const number_buffer& numbers = *buffers[b];
+		unsigned nr_different = count_differences(numbers);
+		std::cout << names[b] << " (" << nr_different << " differences to strtod and strtof)" << std::endl;
+		check(nr_different == 0, std::string("from_chars parses ") + names[b] + " like strtod and strtof");
+		run("  from_chars double", numbers, [](const char* b, const char* e) { double v = 0; cgv::utils::from_chars(b, e, v); return v; });
+		run("  from_chars float ", numbers, [](const char* b, const char* e) { float v = 0; cgv::utils::from_chars(b, e, v); return double(v); });
+		run("  is_double        ", numbers, [](const char* b, const char* e) { double v = 0; cgv::utils::is_double(b, e, v); return v; });
+		run("  atof             ", numbers, [](const char* b, const char*) { return atof(b); });
+		run("  strtod           ", numbers, [](const char* b, const char*) { return strtod(b, 0); });
+		run("  sscanf           ", numbers, [](const char* b, const char*) { double v = 0; sscanf(b, "%lf", &v); return v; });
+	}
+	std::cout << "integers" << std::endl;
+	double sum_from_chars = run("  from_chars int   ", integers, [](const char* b, const char* e) { int v = 0; cgv::utils::from_chars(b, e, v); return double(v); });
+	double sum_is_integer = run("  is_integer       ", integers, [](const char* b, const char* e) { int v = 0; cgv::utils::is_integer(b, e, v); return double(v); });
+	double sum_atoi = run("  atoi             ", integers, [](const char* b, const char*) { return double(atoi(b)); });
+	run("  sscanf           ", integers, [](const char* b, const char*) { int v = 0; sscanf(b, "%d", &v); return double(v); });
+	check(sum_from_chars == sum_atoi && sum_is_integer == sum_atoi, "from_chars and is_integer parse integers like atoi");
+	return get_exit_code();
+}
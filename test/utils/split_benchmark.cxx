@@ -0,0 +1,77 @@
+#include <cgv/utils/advanced_scan.h>
+#include <cgv/os/thread_pool.h>
+#include <test/benchmark.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+/// time f on the text, print the throughput and return the result of f
+template <typename F>
+size_t run(const char* name, const std::string& text, const F& f)
+{
+	clock_type::time_point start = clock_type::now();
+	size_t result = f(text.data(), text.data() + text.size());
+	double t = seconds_since(start);
+	std::cout << name << ": " << text.size() / t * 1e-9 << " GB/s (" << result << ")" << std::endl;
+	return result;
+}
+
+/// compare throughput of split_to_lines, for_each_line, split_to_lines on parallel line ranges and split_to_tokens on an xyz point file
+int main(int argc, char** argv)
+{
+	unsigned n = argc > 1 ? atoi(argv[1]) : 2000000;
+	unsigned nr_threads = argc > 2 ? atoi(argv[2]) : 0;
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<double> coordinate(-100.0, 100.0);
+	std::string text;
+	char buffer[128];
+	for (unsigned i = 0; i < n; ++i) {
+		snprintf(buffer, sizeof(buffer), "%.6f %.6f %.6f %d %d %d\n", coordinate(rng), coordinate(rng), coordinate(rng), int(rng() % 256), int(rng() % 256), int(rng() % 256));
+		text += buffer;
+	}
+	std::cout << "xyz text with " << n << " lines and " << text.size() * 1e-6 << " MB" << std::endl;
+	size_t nr_newlines = run("  find_newline           ", text, [](const char* b, const char* e) {
+		size_t nr_lines = 0;
+		for (const char* p = b; (p = cgv::utils::find_newline(p, e)) < e; ++p)
+			++nr_lines;
+		return nr_lines;
+	});
+	size_t nr_each_lines = run("  for_each_line          ", text, [](const char* b, const char* e) {
+		size_t nr_lines = 0;
+		cgv::utils::for_each_line(b, e, [&nr_lines](const cgv::utils::line&) { ++nr_lines; });
+		return nr_lines;
+	});
+	size_t nr_lines = run("  split_to_lines         ", text, [](const char* b, const char* e) {
+		std::vector<cgv::utils::line> lines;
+		cgv::utils::split_to_lines(b, e, lines);
+		return lines.size();
+	});
+	size_t nr_parallel_lines = run("  split_to_lines parallel", text, [nr_threads](const char* b, const char* e) {
+		std::vector<cgv::utils::token> ranges;
+		cgv::utils::split_to_line_ranges(b, e, ranges, nr_threads);
+		std::vector<std::vector<cgv::utils::line> > line_ranges(ranges.size());
+		cgv::os::parallel_for(size_t(0), ranges.size(), size_t(1), [&](size_t i) {
+			cgv::utils::split_to_lines(ranges[i].begin, ranges[i].end, line_ranges[i]);
+		});
+		size_t nr_lines = 0;
+		for (size_t i = 0; i < line_ranges.size(); ++i)
+			nr_lines += line_ranges[i].size();
+		return nr_lines;
+	});
+	size_t nr_tokens = run("  split_to_tokens        ", text, [](const char* b, const char* e) {
+		std::vector<cgv::utils::token> tokens;
+		size_t nr_tokens = 0;
+		cgv::utils::for_each_line(b, e, [&tokens, &nr_tokens](const cgv::utils::line& l) {
+			tokens.clear();
+			cgv::utils::split_to_tokens(l, tokens, "");
+			nr_tokens += tokens.size();
+		});
+		return nr_tokens;
+	});
+	check(nr_newlines == n && nr_each_lines == n && nr_lines == n && nr_parallel_lines == n, "all variants find all lines");
+	check(nr_tokens == size_t(6) * n, "split_to_tokens finds six tokens per line");
+	return get_exit_code();
+}
@@ -0,0 +1,197 @@
+#include <cgv/base/register.h>
+#include <cgv/utils/advanced_scan.h>
+#include <cgv/utils/scan.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace cgv::base;
+using namespace cgv::utils;
+
+/// previous tokenizer that tests every character against the whitespace, separator and parenthesis strings
+void reference_split_to_tokens(
+			const char* begin, const char* end,
+			std::vector<token>& tokens,
+			const std::string& separators,
+			bool merge_separators,
+			const std::string& open_parenthesis, const std::string& close_parenthesis,
+			const std::string& whitespaces,
+			unsigned int max_nr_tokens)
+{
+	const char* b = begin;
+	const char* p = b;
+	size_t pos;
+	bool last_is_sep = false;
+	while (p < end) {
+		bool is_sep = false;
+		bool is_whitespace = false;
+		bool create_token = false;
+		if (p == end || (is_whitespace = is_element(*p, whitespaces)))
+			create_token = true;
+		else {
+			is_sep=is_element(*p, separators);
+			if (is_sep) {
+				if (!(last_is_sep && merge_separators))
+					create_token = true;
+			}
+			else
+				if (last_is_sep)
+					create_token = true;
+		}
+		last_is_sep = is_sep;
+		if (create_token) {
+			if (p > b)
+				tokens.push_back(token(b,p));
+			if (is_whitespace)
+				b = p+1;
+			else
+				b = p;
+		}
+		else if ((pos = open_parenthesis.find_first_of(*p)) != std::string::npos) {
+			b = ++p;
+			while (p != end && *p != close_parenthesis[pos])
+				++p;
+			tokens.push_back(token(b,p));
+			b = p+1;
+		}
+		if (p == end)
+			break;
+		++p;
+		if (tokens.size() >= max_nr_tokens)
+			break;
+		if (p == end) {
+			if (p > b)
+				tokens.push_back(token(b,p));
+		}
+	};
+}
+
+/// previous line splitting that searches the newlines character by character
+void reference_split_to_lines(const char* global_begin, const char* global_end, std::vector<line>& lines, bool truncate_trailing_spaces)
+{
+	const char* ptr = global_begin;
+	while (ptr < global_end) {
+		const char* begin = ptr;
+		while (ptr < global_end && *ptr != '\n' )
+			++ptr;
+		const char* end = ptr;
+		if (truncate_trailing_spaces) {
+			while (end > begin && is_space(end[-1]))
+				--end;
+		}
+		else
+			if (end > begin && end[-1] == '\r')
+				--end;
+		lines.push_back(line(begin,end));
+		++ptr;
+	}
+}
+
+/// return whether both token vectors reference the same text ranges
+template <typename T>
+bool equal_tokens(const std::vector<T>& t0, const std::vector<T>& t1)
+{
+	if (t0.size() != t1.size())
+		return false;
+	for (size_t i = 0; i < t0.size(); ++i)
+		if (t0[i].begin != t1[i].begin || t0[i].end != t1[i].end)
+			return false;
+	return true;
+}
+
+/** generate a text of runs of plain characters and single characters from special. The run lengths go up to
+    80 characters such that runs cover several 16 and 32 character blocks of the vectorized searches and end in
+	 their scalar tails at all alignments. */
+std::string generate_random_text(std::mt19937& rng, size_t length, const std::string& special)
+{
+	static const char plain[] = "abcxyz0123456789._";
+	std::string text;
+	while (text.size() < length) {
+		unsigned run_length = rng() % 4 == 0 ? rng() % 81 : rng() % 6;
+		for (unsigned i = 0; i < run_length; ++i)
+			text += plain[rng() % (sizeof(plain) - 1)];
+		text += special[rng() % special.size()];
+	}
+	text.resize(length);
+	return text;
+}
+
+/// one parameter set of split_to_tokens
+struct split_parameters
+{
+	const char* separators;
+	const char* open_parenthesis;
+	const char* close_parenthesis;
+	const char* whitespaces;
+};
+
+/** compare split_to_tokens with the previous tokenizer on random texts. Parameter sets with up to eight distinct
+    special characters use the vectorized search for the end of plain runs, the others the scalar lookup table. */
+bool test_split_to_tokens()
+{
+	static const split_parameters parameters[] = {
+		{ "", "", "", " \t\n" },
+		{ ",", "", "", " " },
+		{ ",;", "(", ")", " \t" },
+		{ ",;:", "'\"", "'\"", " \t\r\n" },
+		{ ".,;:", "'{", "'}", " \t" },
+		{ ",;:=+-", "([{", ")]}", " \t\n" },
+		{ "+-*/=<>!?", "(", ")", " " },
+		{ " ,", "(", ")", " \t" },
+		{ ",(", "(", ")", " " },
+		{ "", "(", ")", "" },
+		{ ",;", "", "", "" }
+	};
+	static const unsigned max_nr_tokens[] = { unsigned(-1), 0, 1, 2, 5, 17 };
+	std::mt19937 rng(25);
+	for (const split_parameters& sp : parameters) {
+		std::string special = std::string(sp.separators) + sp.open_parenthesis + sp.close_parenthesis + sp.whitespaces;
+		if (special.empty())
+			special = " ";
+		for (unsigned i = 0; i < 200; ++i) {
+			std::string text = generate_random_text(rng, rng() % 300, special);
+			// start at all offsets modulo 32 to vary the alignment of the vectorized loads
+			unsigned offset = i % 32 < text.size() ? i % 32 : 0;
+			const char* begin = text.data() + offset;
+			const char* end = text.data() + text.size();
+			for (bool merge_separators : { false, true }) {
+				for (unsigned max_nr : max_nr_tokens) {
+					std::vector<token> tokens, reference_tokens;
+					split_to_tokens(begin, end, tokens, sp.separators, merge_separators, sp.open_parenthesis, sp.close_parenthesis, sp.whitespaces, max_nr);
+					reference_split_to_tokens(begin, end, reference_tokens, sp.separators, merge_separators, sp.open_parenthesis, sp.close_parenthesis, sp.whitespaces, max_nr);
+					TEST_ASSERT(equal_tokens(tokens, reference_tokens));
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/// compare find_newline, split_to_lines and for_each_line with the previous line splitting on random texts with short and long lines
+bool test_split_to_lines()
+{
+	std::mt19937 rng(26);
+	for (unsigned i = 0; i < 1000; ++i) {
+		std::string text = generate_random_text(rng, rng() % 500, i % 2 == 0 ? "\n" : "\n\n\r \t");
+		unsigned offset = i % 32 < text.size() ? i % 32 : 0;
+		const char* begin = text.data() + offset;
+		const char* end = text.data() + text.size();
+		const char* newline = find_newline(begin, end);
+		TEST_ASSERT(newline == std::find(begin, end, '\n'));
+		for (bool truncate_trailing_spaces : { true, false }) {
+			std::vector<line> lines, each_lines, reference_lines;
+			split_to_lines(begin, end, lines, truncate_trailing_spaces);
+			for_each_line(begin, end, [&each_lines](const line& l) { each_lines.push_back(l); }, truncate_trailing_spaces);
+			reference_split_to_lines(begin, end, reference_lines, truncate_trailing_spaces);
+			TEST_ASSERT(equal_tokens(lines, reference_lines));
+			TEST_ASSERT(equal_tokens(each_lines, reference_lines));
+		}
+	}
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_split_to_tokens_reg("cgv::utils::split_to_tokens", test_split_to_tokens);
+extern CGV_API test_registration test_split_to_lines_reg("cgv::utils::split_to_lines", test_split_to_lines);